@@ -104,6 +104,22 @@ static void WriteProfile(rapidjson::PrettyWriter<rapidjson::StringBuffer>& write
 	writer.Bool(profile.IsDrawCursor());
 	writer.Key("disableDirectFlip");
 	writer.Bool(profile.IsDisableDirectFlip());
+	writer.Key("framePacing");
+	writer.Bool(profile.IsFramePacing());
+	writer.Key("framePacingMargin");
+	writer.Double(profile.framePacingMargin);
+	writer.Key("maxFrameRate");
+	writer.Double(profile.maxFrameRate);
+	writer.Key("videoMemoryBudget");
+	writer.Uint(profile.videoMemoryBudget);
+	writer.Key("resourceCacheTimeout");
+	writer.Uint(profile.resourceCacheTimeout);
+	writer.Key("limitToSourceFrameRate");
+	writer.Bool(profile.IsLimitToSourceFrameRate());
+	writer.Key("adaptiveQuality");
+	writer.Bool(profile.IsAdaptiveQuality());
+	writer.Key("autoCaptureMethod");
+	writer.Bool(profile.IsAutoCaptureMethod());
 
 	writer.Key("cursorScaling");
 	writer.Uint((uint32_t)profile.cursorScaling);
@@ -407,6 +423,7 @@ void AppSettings::IsDeveloperMode(bool value) noexcept {
 		_isDebugMode = false;
 		_isDisableEffectCache = false;
 		_isDisableFontCache = false;
+		_isDisableOverlayCache = false;
 		_isSaveEffectSources = false;
 		_isWarningsAreErrors = false;
 	}
@@ -524,6 +541,8 @@ bool AppSettings::_Save(const _AppSettingsData& data) noexcept {
 	writer.Bool(data._isDisableEffectCache);
 	writer.Key("disableFontCache");
 	writer.Bool(data._isDisableFontCache);
+	writer.Key("disableOverlayCache");
+	writer.Bool(data._isDisableOverlayCache);
 	writer.Key("saveEffectSources");
 	writer.Bool(data._isSaveEffectSources);
 	writer.Key("warningsAreErrors");
@@ -692,6 +711,7 @@ void AppSettings::_LoadSettings(const rapidjson::GenericObject<true, rapidjson::
 	JsonHelper::ReadBool(root, "debugMode", _isDebugMode);
 	JsonHelper::ReadBool(root, "disableEffectCache", _isDisableEffectCache);
 	JsonHelper::ReadBool(root, "disableFontCache", _isDisableFontCache);
+	JsonHelper::ReadBool(root, "disableOverlayCache", _isDisableOverlayCache);
 	JsonHelper::ReadBool(root, "saveEffectSources", _isSaveEffectSources);
 	JsonHelper::ReadBool(root, "warningsAreErrors", _isWarningsAreErrors);
 	JsonHelper::ReadBool(root, "allowScalingMaximized", _isAllowScalingMaximized);
@@ -858,6 +878,20 @@ bool AppSettings::_LoadProfile(
 	JsonHelper::ReadBoolFlag(profileObj, "adjustCursorSpeed", MagFlags::AdjustCursorSpeed, profile.flags);
 	JsonHelper::ReadBoolFlag(profileObj, "drawCursor", MagFlags::DrawCursor, profile.flags);
 	JsonHelper::ReadBoolFlag(profileObj, "disableDirectFlip", MagFlags::DisableDirectFlip, profile.flags);
+	JsonHelper::ReadBoolFlag(profileObj, "framePacing", MagFlags::FramePacing, profile.flags);
+	JsonHelper::ReadFloat(profileObj, "framePacingMargin", profile.framePacingMargin);
+	if (profile.framePacingMargin < 0) {
+		profile.framePacingMargin = 1.5f;
+	}
+	JsonHelper::ReadFloat(profileObj, "maxFrameRate", profile.maxFrameRate);
+	if (profile.maxFrameRate < 0) {
+		profile.maxFrameRate = 0.0f;
+	}
+	JsonHelper::ReadUInt(profileObj, "videoMemoryBudget", profile.videoMemoryBudget);
+	JsonHelper::ReadUInt(profileObj, "resourceCacheTimeout", profile.resourceCacheTimeout);
+	JsonHelper::ReadBoolFlag(profileObj, "limitToSourceFrameRate", MagFlags::LimitToSourceFrameRate, profile.flags);
+	JsonHelper::ReadBoolFlag(profileObj, "adaptiveQuality", MagFlags::AdaptiveQuality, profile.flags);
+	JsonHelper::ReadBoolFlag(profileObj, "autoCaptureMethod", MagFlags::AutoCaptureMethod, profile.flags);
 
 	{
 		uint32_t cursorScaling = (uint32_t)CursorScaling::NoScaling;
@@ -54,6 +54,7 @@ struct _AppSettingsData {
 	bool _isDebugMode = false;
 	bool _isDisableEffectCache = false;
 	bool _isDisableFontCache = false;
+	bool _isDisableOverlayCache = false;
 	bool _isSaveEffectSources = false;
 	bool _isWarningsAreErrors = false;
 	bool _isAllowScalingMaximized = false;
@@ -225,6 +226,15 @@ public:
 		SaveAsync();
 	}
 
+	bool IsDisableOverlayCache() const noexcept {
+		return _isDisableOverlayCache;
+	}
+
+	void IsDisableOverlayCache(bool value) noexcept {
+		_isDisableOverlayCache = value;
+		SaveAsync();
+	}
+
 	bool IsSaveEffectSources() const noexcept {
 		return _isSaveEffectSources;
 	}
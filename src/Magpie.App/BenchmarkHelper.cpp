@@ -0,0 +1,276 @@
+#include "pch.h"
+#include "BenchmarkHelper.h"
+#if __has_include("BenchmarkHelper.g.cpp")
+#include "BenchmarkHelper.g.cpp"
+#endif
+#include "ScalingModesService.h"
+#include "ScalingMode.h"
+#include "Logger.h"
+#include "StrUtils.h"
+#include "Win32Utils.h"
+#include <shellapi.h>
+
+using namespace ::Magpie::Core;
+
+namespace winrt::Magpie::App::implementation {
+
+// 命令行参数：
+// <缩放模式文件> [-mode <名字>] [-input <宽>x<高> | -replay <录制文件>] [-output <宽>x<高>]
+// [-frames <帧数>] [-warmup <帧数>] [-graphicscard <序号>] [-warp] [-nocache] [-inline] [-out <结果文件>]
+// 缩放模式文件和导出的缩放模式格式相同，未指定 -mode 时使用第一个缩放模式
+struct BenchmarkArguments {
+	std::wstring scalingModesFile;
+	std::wstring scalingModeName;
+	std::wstring resultFile = L"benchmark.json";
+	bool isInlineParams = false;
+	Benchmark::Options options;
+};
+
+static bool ParseSize(const wchar_t* str, SIZE& result) noexcept {
+	return swscanf_s(str, L"%ldx%ld", &result.cx, &result.cy) == 2 && result.cx > 0 && result.cy > 0;
+}
+
+static bool ParseUInt(const wchar_t* str, uint32_t& result) noexcept {
+	return swscanf_s(str, L"%u", &result) == 1;
+}
+
+static bool ParseArguments(const hstring& arguments, BenchmarkArguments& result) {
+	int argc = 0;
+	std::unique_ptr<wchar_t*, decltype(&LocalFree)> argv(nullptr, LocalFree);
+	if (!arguments.empty()) {
+		argv.reset(CommandLineToArgvW(arguments.c_str(), &argc));
+		if (!argv) {
+			Logger::Get().Win32Error("CommandLineToArgvW 失败");
+			return false;
+		}
+	}
+
+	for (int i = 0; i < argc; ++i) {
+		const std::wstring_view arg = argv.get()[i];
+		// 除开关外的选项都需要一个值
+		const wchar_t* value = i + 1 < argc ? argv.get()[i + 1] : nullptr;
+
+		bool success = true;
+		if (arg == L"-warp") {
+			result.options.useWarp = true;
+			continue;
+		} else if (arg == L"-nocache") {
+			result.options.disableEffectCache = true;
+			continue;
+		} else if (arg == L"-inline") {
+			result.isInlineParams = true;
+			continue;
+		} else if (arg[0] != L'-') {
+			result.scalingModesFile = arg;
+			continue;
+		} else if (!value) {
+			success = false;
+		} else if (arg == L"-mode") {
+			result.scalingModeName = value;
+		} else if (arg == L"-input") {
+			success = ParseSize(value, result.options.inputSize);
+		} else if (arg == L"-replay") {
+			result.options.replayFile = value;
+		} else if (arg == L"-output") {
+			success = ParseSize(value, result.options.outputSize);
+		} else if (arg == L"-frames") {
+			success = ParseUInt(value, result.options.frameCount) && result.options.frameCount > 0;
+		} else if (arg == L"-warmup") {
+			success = ParseUInt(value, result.options.warmupFrameCount);
+		} else if (arg == L"-graphicscard") {
+			uint32_t graphicsCard = 0;
+			success = ParseUInt(value, graphicsCard);
+			result.options.graphicsCard = (int)graphicsCard;
+		} else if (arg == L"-out") {
+			result.resultFile = value;
+		} else {
+			success = false;
+		}
+
+		if (!success) {
+			Logger::Get().Error(StrUtils::Concat("非法的基准测试参数：", StrUtils::UTF16ToUTF8(arg)));
+			return false;
+		}
+
+		// 跳过值
+		++i;
+	}
+
+	if (result.scalingModesFile.empty()) {
+		Logger::Get().Error("未指定缩放模式文件");
+		return false;
+	}
+
+	return true;
+}
+
+static bool LoadEffects(const BenchmarkArguments& arguments, std::vector<EffectOption>& effects) {
+	std::string json;
+	if (!Win32Utils::ReadTextFile(arguments.scalingModesFile.c_str(), json)) {
+		Logger::Get().Error("读取缩放模式文件失败");
+		return false;
+	}
+
+	rapidjson::Document doc;
+	// 和导入时相同，放宽 json 格式限制
+	doc.ParseInsitu<rapidjson::kParseCommentsFlag | rapidjson::kParseTrailingCommasFlag>(json.data());
+	if (doc.HasParseError()) {
+		Logger::Get().Error(fmt::format("解析缩放模式失败\n\t错误码：{}", (int)doc.GetParseError()));
+		return false;
+	}
+
+	if (!doc.IsObject()) {
+		Logger::Get().Error("缩放模式文件格式错误");
+		return false;
+	}
+
+	std::vector<ScalingMode> scalingModes;
+	if (!ScalingModesService::Parse(((const rapidjson::Document&)doc).GetObj(), scalingModes)) {
+		Logger::Get().Error("解析缩放模式失败");
+		return false;
+	}
+
+	auto it = std::find_if(scalingModes.begin(), scalingModes.end(), [&](const ScalingMode& scalingMode) {
+		return arguments.scalingModeName.empty() || scalingMode.name == arguments.scalingModeName;
+	});
+	if (it == scalingModes.end() || it->effects.empty()) {
+		Logger::Get().Error("找不到缩放模式或缩放模式为空");
+		return false;
+	}
+
+	effects = std::move(it->effects);
+	if (arguments.isInlineParams) {
+		for (EffectOption& effect : effects) {
+			effect.flags |= EffectOptionFlags::InlineParams;
+		}
+	}
+
+	return true;
+}
+
+static void WriteDistribution(
+	rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer,
+	const char* name,
+	const Benchmark::Distribution& distribution
+) {
+	writer.Key(name);
+	writer.StartObject();
+	writer.Key("mean");
+	writer.Double(distribution.mean);
+	writer.Key("p50");
+	writer.Double(distribution.p50);
+	writer.Key("p90");
+	writer.Double(distribution.p90);
+	writer.Key("p99");
+	writer.Double(distribution.p99);
+	writer.Key("max");
+	writer.Double(distribution.max);
+	writer.EndObject();
+}
+
+static void WriteSize(rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer, const char* name, SIZE size) {
+	writer.Key(name);
+	writer.StartObject();
+	writer.Key("width");
+	writer.Int(size.cx);
+	writer.Key("height");
+	writer.Int(size.cy);
+	writer.EndObject();
+}
+
+static void WriteResult(
+	rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer,
+	const Benchmark::Options& options,
+	const Benchmark::Result& result
+) {
+	writer.StartObject();
+	writer.Key("version");
+	writer.String(
+#ifdef MAGPIE_VERSION_TAG
+		STRING(MAGPIE_VERSION_TAG)
+#else
+		"dev"
+#endif
+	);
+	writer.Key("adapter");
+	writer.String(result.adapter.c_str());
+	writer.Key("warp");
+	writer.Bool(result.isWarp);
+	writer.Key("replayFile");
+	writer.String(StrUtils::UTF16ToUTF8(options.replayFile).c_str());
+	WriteSize(writer, "inputSize", result.inputSize);
+	WriteSize(writer, "outputSize", result.outputSize);
+	writer.Key("frameCount");
+	writer.Uint(options.frameCount);
+	writer.Key("measuredFrameCount");
+	writer.Uint(result.measuredFrameCount);
+	writer.Key("totalCompileTime");
+	writer.Double(result.totalCompileTime);
+	WriteDistribution(writer, "gpuTime", result.gpuTime);
+	WriteDistribution(writer, "frameTime", result.frameTime);
+	writer.Key("baseVideoMemory");
+	writer.Uint64(result.baseVideoMemory);
+	writer.Key("peakVideoMemory");
+	writer.Uint64(result.peakVideoMemory);
+
+	writer.Key("effects");
+	writer.StartArray();
+	for (const Benchmark::EffectResult& effect : result.effects) {
+		writer.StartObject();
+		writer.Key("name");
+		writer.String(effect.name.c_str());
+		WriteSize(writer, "outputSize", effect.outputSize);
+		writer.Key("compileTime");
+		writer.Double(effect.compileTime);
+		writer.Key("cacheHit");
+		writer.Bool(effect.isCacheHit);
+		WriteDistribution(writer, "gpuTime", effect.gpuTime);
+
+		writer.Key("passes");
+		writer.StartArray();
+		for (const Benchmark::PassResult& pass : effect.passes) {
+			writer.StartObject();
+			writer.Key("desc");
+			writer.String(pass.desc.c_str());
+			WriteDistribution(writer, "gpuTime", pass.gpuTime);
+			writer.EndObject();
+		}
+		writer.EndArray();
+
+		writer.EndObject();
+	}
+	writer.EndArray();
+
+	writer.EndObject();
+}
+
+int32_t BenchmarkHelper::Run(const hstring& arguments) {
+	BenchmarkArguments benchmarkArguments;
+	if (!ParseArguments(arguments, benchmarkArguments)) {
+		return 1;
+	}
+
+	if (!LoadEffects(benchmarkArguments, benchmarkArguments.options.effects)) {
+		return 1;
+	}
+
+	Benchmark::Result result;
+	if (!Benchmark::Run(benchmarkArguments.options, result)) {
+		Logger::Get().Error("基准测试失败");
+		return 1;
+	}
+
+	rapidjson::StringBuffer json;
+	rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(json);
+	WriteResult(writer, benchmarkArguments.options, result);
+
+	if (!Win32Utils::WriteTextFile(benchmarkArguments.resultFile.c_str(), { json.GetString(), json.GetLength() })) {
+		Logger::Get().Error("保存基准测试结果失败");
+		return 1;
+	}
+
+	Logger::Get().Info(StrUtils::Concat("基准测试结果已保存到 ", StrUtils::UTF16ToUTF8(benchmarkArguments.resultFile)));
+	return 0;
+}
+
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "BenchmarkHelper.g.h"
+
+namespace winrt::Magpie::App::implementation {
+
+// 命令行的基准测试模式，不初始化设置和界面
+struct BenchmarkHelper : BenchmarkHelperT<BenchmarkHelper> {
+    BenchmarkHelper() = default;
+
+    static int32_t Run(const hstring& arguments);
+};
+
+}
+
+namespace winrt::Magpie::App::factory_implementation {
+
+struct BenchmarkHelper : BenchmarkHelperT<BenchmarkHelper, implementation::BenchmarkHelper> {
+};
+
+}
@@ -15,6 +15,7 @@
 #include "ScalingModesService.h"
 #include "ScalingMode.h"
 #include "EffectsService.h"
+#include "MagService.h"
 
 using namespace Magpie::Core;
 
@@ -144,6 +145,7 @@ void EffectParametersViewModel::_ScalingModeBoolParameter_PropertyChanged(
 	_Data()[StrUtils::UTF8ToUTF16(effectName)] = (float)boolParamImpl->Value();
 
 	LazySaveAppSettings();
+	MagService::Get().UpdateScalingOptions();
 }
 
 void EffectParametersViewModel::_ScalingModeFloatParameter_PropertyChanged(
@@ -160,6 +162,7 @@ void EffectParametersViewModel::_ScalingModeFloatParameter_PropertyChanged(
 	_Data()[StrUtils::UTF8ToUTF16(effectName)] = (float)floatParamImpl->Value();
 
 	LazySaveAppSettings();
+	MagService::Get().UpdateScalingOptions();
 }
 
 phmap::flat_hash_map<std::wstring, float>& EffectParametersViewModel::_Data() {
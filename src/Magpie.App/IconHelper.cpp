@@ -4,6 +4,7 @@
 #include "Utils.h"
 #include "Win32Utils.h"
 #include "StrUtils.h"
+#include "PixelUtils.h"
 
 using namespace winrt;
 using namespace Windows::Graphics::Imaging;
@@ -68,32 +69,16 @@ static SoftwareBitmap HIcon2SoftwareBitmap(HICON hIcon) {
 			return nullptr;
 		}
 
-		const UINT pixelsSize = bmp.bmWidth * bmp.bmHeight * 4;
+		const size_t pixelCount = (size_t)bmp.bmWidth * bmp.bmHeight;
+		uint32_t* pixels32 = (uint32_t*)pixels;
 
 		// 若颜色掩码有 A 通道，则是彩色图标，否则是彩色掩码图标
-		bool hasAlpha = false;
-		for (UINT i = 3; i < pixelsSize; i += 4) {
-			if (pixels[i] != 0) {
-				hasAlpha = true;
-				break;
-			}
-		}
-
-		if (hasAlpha) {
-			// 彩色图标
-			for (size_t i = 0; i < pixelsSize; i += 4) {
-				// 预乘 Alpha 通道
-				float alpha = pixels[i + 3] / 255.0f;
-
-				pixels[i] = (BYTE)std::lroundf(pixels[i] * alpha);
-				pixels[i + 1] = (BYTE)std::lroundf(pixels[i + 1] * alpha);
-				pixels[i + 2] = (BYTE)std::lroundf(pixels[i + 2] * alpha);
-			}
+		if (PixelUtils::HasAlpha(pixels32, pixelCount)) {
+			// 彩色图标，预乘 Alpha 通道
+			PixelUtils::PremultiplyAlpha(pixels32, pixelCount);
 		} else {
 			// 彩色掩码图标
-			for (size_t i = 0; i < pixelsSize; i += 4) {
-				pixels[i + 3] = 255;
-			}
+			PixelUtils::FillAlpha(pixels32, pixelCount);
 		}
 	}
 
@@ -24,6 +24,7 @@ void MagService::Initialize() {
 	AppSettings::Get().IsAutoRestoreChanged({ this, &MagService::_Settings_IsAutoRestoreChanged });
 	_magRuntime.emplace();
 	_magRuntime->IsRunningChanged({ this, &MagService::_MagRuntime_IsRunningChanged });
+	_magRuntime->CaptureMethodProbed({ this, &MagService::_MagRuntime_CaptureMethodProbed });
 
 	ShortcutService::Get().ShortcutActivated(
 		{ this, &MagService::_ShortcutService_ShortcutPressed }
@@ -241,12 +242,57 @@ fire_and_forget MagService::_MagRuntime_IsRunningChanged(bool isRunning) {
 	_isRunningChangedEvent(isRunning);
 }
 
+fire_and_forget MagService::_MagRuntime_CaptureMethodProbed(HWND hwndSrc, CaptureMethod captureMethod) {
+	co_await _dispatcher;
+
+	if (!IsWindow(hwndSrc)) {
+		co_return;
+	}
+
+	// 记住选中的捕获方式，之后缩放时不再试用
+	ProfileService& profileService = ProfileService::Get();
+	Profile& profile = profileService.GetProfileForWindow(hwndSrc);
+	if (&profile == &profileService.DefaultProfile()) {
+		// 默认配置适用于所有窗口，一个窗口的结果不能代表其他窗口，每次缩放都重新试用
+		co_return;
+	}
+
+	profile.captureMethod = captureMethod;
+	profile.IsAutoCaptureMethod(false);
+
+	AppSettings::Get().SaveAsync();
+}
+
 bool MagService::_StartScale(HWND hWnd, const Profile& profile) {
-	if (profile.scalingMode < 0) {
+	MagOptions options;
+	if (!_CreateMagOptions(profile, options)) {
 		return false;
 	}
 
+	_isAutoScaling = profile.isAutoScale;
+	_magRuntime->Run(hWnd, options);
+	return true;
+}
+
+void MagService::UpdateScalingOptions() {
+	if (!_magRuntime || !_magRuntime->IsRunning()) {
+		return;
+	}
+
+	const Profile& profile = ProfileService::Get().GetProfileForWindow(_magRuntime->HwndSrc());
 	MagOptions options;
+	if (!_CreateMagOptions(profile, options)) {
+		return;
+	}
+
+	_magRuntime->UpdateOptions(options);
+}
+
+bool MagService::_CreateMagOptions(const Profile& profile, MagOptions& options) {
+	if (profile.scalingMode < 0) {
+		return false;
+	}
+
 	options.effects = ScalingModesService::Get().GetScalingMode(profile.scalingMode).effects;
 	if (options.effects.empty()) {
 		return false;
@@ -264,6 +310,10 @@ bool MagService::_StartScale(HWND hWnd, const Profile& profile) {
 	options.multiMonitorUsage = profile.multiMonitorUsage;
 	options.cursorInterpolationMode = profile.cursorInterpolationMode;
 	options.flags = profile.flags;
+	options.framePacingMargin = profile.framePacingMargin;
+	options.maxFrameRate = profile.maxFrameRate;
+	options.videoMemoryBudget = profile.videoMemoryBudget;
+	options.resourceCacheTimeout = profile.resourceCacheTimeout;
 
 	if (profile.isCroppingEnabled) {
 		options.cropping = profile.cropping;
@@ -313,13 +363,14 @@ bool MagService::_StartScale(HWND hWnd, const Profile& profile) {
 	options.IsDebugMode(settings.IsDebugMode());
 	options.IsDisableEffectCache(settings.IsDisableEffectCache());
 	options.IsDisableFontCache(settings.IsDisableFontCache());
+	options.IsDisableOverlayCache(settings.IsDisableOverlayCache());
 	options.IsSaveEffectSources(settings.IsSaveEffectSources());
 	options.IsWarningsAreErrors(settings.IsWarningsAreErrors());
+	// 开发者模式下修改效果文件后自动重新加载
+	options.IsHotReloadEffects(settings.IsDeveloperMode());
 	options.IsAllowScalingMaximized(settings.IsAllowScalingMaximized());
 	options.IsSimulateExclusiveFullscreen(settings.IsSimulateExclusiveFullscreen());
 
-	_isAutoScaling = profile.isAutoScale;
-	_magRuntime->Run(hWnd, options);
 	return true;
 }
 
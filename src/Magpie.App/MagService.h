@@ -108,6 +108,9 @@ public:
 	// 强制重新检查前台窗口
 	void CheckForeground();
 
+	// 缩放模式或效果参数改变后调用，缩放时立即应用到效果链
+	void UpdateScalingOptions();
+
 private:
 	MagService() = default;
 
@@ -123,8 +126,12 @@ private:
 
 	fire_and_forget _MagRuntime_IsRunningChanged(bool isRunning);
 
+	fire_and_forget _MagRuntime_CaptureMethodProbed(HWND hwndSrc, ::Magpie::Core::CaptureMethod captureMethod);
+
 	bool _StartScale(HWND hWnd, const Profile& profile);
 
+	bool _CreateMagOptions(const Profile& profile, ::Magpie::Core::MagOptions& options);
+
 	void _ScaleForegroundWindow();
 
 	bool _CheckSrcWnd(HWND hWnd) noexcept;
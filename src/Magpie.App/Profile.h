@@ -29,6 +29,10 @@ struct Profile {
 		cursorInterpolationMode = other.cursorInterpolationMode;
 		launchParameters = other.launchParameters;
 		flags = other.flags;
+		framePacingMargin = other.framePacingMargin;
+		maxFrameRate = other.maxFrameRate;
+		videoMemoryBudget = other.videoMemoryBudget;
+		resourceCacheTimeout = other.resourceCacheTimeout;
 	}
 
 	DEFINE_FLAG_ACCESSOR(IsDisableWindowResizing, ::Magpie::Core::MagFlags::DisableWindowResizing, flags)
@@ -40,6 +44,10 @@ struct Profile {
 	DEFINE_FLAG_ACCESSOR(IsAdjustCursorSpeed, ::Magpie::Core::MagFlags::AdjustCursorSpeed, flags)
 	DEFINE_FLAG_ACCESSOR(IsDrawCursor, ::Magpie::Core::MagFlags::DrawCursor, flags)
 	DEFINE_FLAG_ACCESSOR(IsDisableDirectFlip, ::Magpie::Core::MagFlags::DisableDirectFlip, flags)
+	DEFINE_FLAG_ACCESSOR(IsFramePacing, ::Magpie::Core::MagFlags::FramePacing, flags)
+	DEFINE_FLAG_ACCESSOR(IsLimitToSourceFrameRate, ::Magpie::Core::MagFlags::LimitToSourceFrameRate, flags)
+	DEFINE_FLAG_ACCESSOR(IsAdaptiveQuality, ::Magpie::Core::MagFlags::AdaptiveQuality, flags)
+	DEFINE_FLAG_ACCESSOR(IsAutoCaptureMethod, ::Magpie::Core::MagFlags::AutoCaptureMethod, flags)
 
 	std::wstring name;
 
@@ -53,6 +61,14 @@ struct Profile {
 
 	CursorScaling cursorScaling = CursorScaling::NoScaling;
 	float customCursorScaling = 1.0;
+	// 帧调度的安全余量，单位为毫秒。界面中无法修改
+	float framePacingMargin = 1.5f;
+	// 关闭垂直同步时的最大帧率，0 表示不限制
+	float maxFrameRate = 0.0f;
+	// 显存预算，单位为 MiB，0 表示不限制。界面中无法修改
+	uint32_t videoMemoryBudget = 0;
+	// 退出缩放后保留 D3D 设备、着色器和纹理的时长，单位为秒，0 表示立即释放。界面中无法修改
+	uint32_t resourceCacheTimeout = 60;
 
 	::Magpie::Core::Cropping cropping{};
 	// -1 表示原样
@@ -407,6 +407,7 @@ void ProfileViewModel::ScalingMode(int value) {
 	_propertyChangedEvent(*this, PropertyChangedEventArgs(L"ScalingMode"));
 
 	AppSettings::Get().SaveAsync();
+	MagService::Get().UpdateScalingOptions();
 }
 
 int ProfileViewModel::CaptureMethod() const noexcept {
@@ -438,6 +439,21 @@ void ProfileViewModel::CaptureMethod(int value) {
 	AppSettings::Get().SaveAsync();
 }
 
+bool ProfileViewModel::IsAutoCaptureMethod() const noexcept {
+	return _data->IsAutoCaptureMethod();
+}
+
+void ProfileViewModel::IsAutoCaptureMethod(bool value) {
+	if (_data->IsAutoCaptureMethod() == value) {
+		return;
+	}
+
+	_data->IsAutoCaptureMethod(value);
+	_propertyChangedEvent(*this, PropertyChangedEventArgs(L"IsAutoCaptureMethod"));
+
+	AppSettings::Get().SaveAsync();
+}
+
 bool ProfileViewModel::IsAutoScale() const noexcept {
 	return _data->isAutoScale;
 }
@@ -562,6 +578,8 @@ void ProfileViewModel::IsVSync(bool value) {
 
 	_data->IsVSync(value);
 	_propertyChangedEvent(*this, PropertyChangedEventArgs(L"IsVSync"));
+	_propertyChangedEvent(*this, PropertyChangedEventArgs(L"IsFramePacingEnabled"));
+	_propertyChangedEvent(*this, PropertyChangedEventArgs(L"IsFrameRateLimiterEnabled"));
 
 	AppSettings::Get().SaveAsync();
 }
@@ -577,6 +595,77 @@ void ProfileViewModel::IsTripleBuffering(bool value) {
 
 	_data->IsTripleBuffering(value);
 	_propertyChangedEvent(*this, PropertyChangedEventArgs(L"IsTripleBuffering"));
+	_propertyChangedEvent(*this, PropertyChangedEventArgs(L"IsFramePacingEnabled"));
+
+	AppSettings::Get().SaveAsync();
+}
+
+bool ProfileViewModel::IsFramePacing() const noexcept {
+	return _data->IsFramePacing();
+}
+
+void ProfileViewModel::IsFramePacing(bool value) {
+	if (_data->IsFramePacing() == value) {
+		return;
+	}
+
+	_data->IsFramePacing(value);
+	_propertyChangedEvent(*this, PropertyChangedEventArgs(L"IsFramePacing"));
+
+	AppSettings::Get().SaveAsync();
+}
+
+bool ProfileViewModel::IsFramePacingEnabled() const noexcept {
+	// 允许额外的延迟时帧调度没有意义
+	return _data->IsVSync() && !_data->IsTripleBuffering();
+}
+
+double ProfileViewModel::MaxFrameRate() const noexcept {
+	return _data->maxFrameRate;
+}
+
+void ProfileViewModel::MaxFrameRate(double value) {
+	if (_data->maxFrameRate == value) {
+		return;
+	}
+
+	_data->maxFrameRate = std::isnan(value) ? 0.0f : (float)std::max(value, 0.0);
+	_propertyChangedEvent(*this, PropertyChangedEventArgs(L"MaxFrameRate"));
+
+	AppSettings::Get().SaveAsync();
+}
+
+bool ProfileViewModel::IsLimitToSourceFrameRate() const noexcept {
+	return _data->IsLimitToSourceFrameRate();
+}
+
+void ProfileViewModel::IsLimitToSourceFrameRate(bool value) {
+	if (_data->IsLimitToSourceFrameRate() == value) {
+		return;
+	}
+
+	_data->IsLimitToSourceFrameRate(value);
+	_propertyChangedEvent(*this, PropertyChangedEventArgs(L"IsLimitToSourceFrameRate"));
+
+	AppSettings::Get().SaveAsync();
+}
+
+bool ProfileViewModel::IsFrameRateLimiterEnabled() const noexcept {
+	// 垂直同步已限制了帧率
+	return !_data->IsVSync();
+}
+
+bool ProfileViewModel::IsAdaptiveQuality() const noexcept {
+	return _data->IsAdaptiveQuality();
+}
+
+void ProfileViewModel::IsAdaptiveQuality(bool value) {
+	if (_data->IsAdaptiveQuality() == value) {
+		return;
+	}
+
+	_data->IsAdaptiveQuality(value);
+	_propertyChangedEvent(*this, PropertyChangedEventArgs(L"IsAdaptiveQuality"));
 
 	AppSettings::Get().SaveAsync();
 }
@@ -76,6 +76,9 @@ struct ProfileViewModel : ProfileViewModelT<ProfileViewModel> {
 	int CaptureMethod() const noexcept;
 	void CaptureMethod(int value);
 
+	bool IsAutoCaptureMethod() const noexcept;
+	void IsAutoCaptureMethod(bool value);
+
 	bool IsAutoScale() const noexcept;
 	void IsAutoScale(bool value);
 
@@ -103,6 +106,22 @@ struct ProfileViewModel : ProfileViewModelT<ProfileViewModel> {
 	bool IsTripleBuffering() const noexcept;
 	void IsTripleBuffering(bool value);
 
+	bool IsFramePacing() const noexcept;
+	void IsFramePacing(bool value);
+
+	bool IsFramePacingEnabled() const noexcept;
+
+	double MaxFrameRate() const noexcept;
+	void MaxFrameRate(double value);
+
+	bool IsLimitToSourceFrameRate() const noexcept;
+	void IsLimitToSourceFrameRate(bool value);
+
+	bool IsFrameRateLimiterEnabled() const noexcept;
+
+	bool IsAdaptiveQuality() const noexcept;
+	void IsAdaptiveQuality(bool value);
+
 	bool IsDisableWindowResizing() const noexcept;
 	void IsDisableWindowResizing(bool value);
 
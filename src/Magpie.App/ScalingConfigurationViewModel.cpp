@@ -11,6 +11,7 @@
 #include "Win32Utils.h"
 #include "ScalingMode.h"
 #include "FileDialogHelper.h"
+#include "MagService.h"
 
 using namespace ::Magpie::Core;
 
@@ -178,6 +179,7 @@ void ScalingConfigurationViewModel::DownscalingEffectIndex(int value) {
 	_propertyChangedEvent(*this, PropertyChangedEventArgs(L"DownscalingEffectParameters"));
 
 	AppSettings::Get().SaveAsync();
+	MagService::Get().UpdateScalingOptions();
 }
 
 bool ScalingConfigurationViewModel::DownscalingEffectHasParameters() noexcept {
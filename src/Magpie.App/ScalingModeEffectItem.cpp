@@ -11,6 +11,7 @@
 #include "Logger.h"
 #include "ScalingMode.h"
 #include "StrUtils.h"
+#include "MagService.h"
 
 using namespace ::Magpie::Core;
 namespace MagpieCore = ::Magpie::Core;
@@ -141,6 +142,7 @@ void ScalingModeEffectItem::ScalingType(int value) {
 	_propertyChangedEvent(*this, PropertyChangedEventArgs(L"IsShowScalingPixels"));
 
 	AppSettings::Get().SaveAsync();
+	MagService::Get().UpdateScalingOptions();
 }
 
 bool ScalingModeEffectItem::IsShowScalingFactors() const noexcept {
@@ -169,6 +171,7 @@ void ScalingModeEffectItem::ScalingFactorX(double value) {
 	
 	_propertyChangedEvent(*this, PropertyChangedEventArgs(L"ScalingFactorX"));
 	AppSettings::Get().SaveAsync();
+	MagService::Get().UpdateScalingOptions();
 }
 
 double ScalingModeEffectItem::ScalingFactorY() const noexcept {
@@ -187,6 +190,7 @@ void ScalingModeEffectItem::ScalingFactorY(double value) {
 
 	_propertyChangedEvent(*this, PropertyChangedEventArgs(L"ScalingFactorY"));
 	AppSettings::Get().SaveAsync();
+	MagService::Get().UpdateScalingOptions();
 }
 
 double ScalingModeEffectItem::ScalingPixelsX() const noexcept {
@@ -205,6 +209,7 @@ void ScalingModeEffectItem::ScalingPixelsX(double value) {
 
 	_propertyChangedEvent(*this, PropertyChangedEventArgs(L"ScalingPixelsX"));
 	AppSettings::Get().SaveAsync();
+	MagService::Get().UpdateScalingOptions();
 }
 
 double ScalingModeEffectItem::ScalingPixelsY() const noexcept {
@@ -223,6 +228,7 @@ void ScalingModeEffectItem::ScalingPixelsY(double value) {
 
 	_propertyChangedEvent(*this, PropertyChangedEventArgs(L"ScalingPixelsY"));
 	AppSettings::Get().SaveAsync();
+	MagService::Get().UpdateScalingOptions();
 }
 
 void ScalingModeEffectItem::Remove() {
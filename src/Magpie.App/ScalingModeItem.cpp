@@ -9,6 +9,7 @@
 #include "AppSettings.h"
 #include "EffectsService.h"
 #include "EffectHelper.h"
+#include "MagService.h"
 
 using namespace Magpie::Core;
 
@@ -121,6 +122,7 @@ void ScalingModeItem::_Effects_VectorChanged(IObservableVector<IInspectable> con
 
 	_propertyChangedEvent(*this, PropertyChangedEventArgs(L"Description"));
 	AppSettings::Get().SaveAsync();
+	MagService::Get().UpdateScalingOptions();
 }
 
 void ScalingModeItem::_ScalingModeEffectItem_Removed(IInspectable const&, uint32_t index) {
@@ -145,6 +147,7 @@ void ScalingModeItem::_ScalingModeEffectItem_Removed(IInspectable const&, uint32
 	_propertyChangedEvent(*this, PropertyChangedEventArgs(L"HasUnkownEffects"));
 
 	AppSettings::Get().SaveAsync();
+	MagService::Get().UpdateScalingOptions();
 }
 
 void ScalingModeItem::_ScalingModeEffectItem_Moved(ScalingModeEffectItem const& sender, bool isUp) {
@@ -199,6 +202,7 @@ void ScalingModeItem::AddEffect(const hstring& fullName) {
 	}
 
 	AppSettings::Get().SaveAsync();
+	MagService::Get().UpdateScalingOptions();
 }
 
 hstring ScalingModeItem::Name() const noexcept {
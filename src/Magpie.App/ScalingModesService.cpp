@@ -238,7 +238,11 @@ static bool LoadScalingMode(
 	return true;
 }
 
-bool ScalingModesService::Import(const rapidjson::GenericObject<true, rapidjson::Value>& root, bool loadingSettings) noexcept {
+static bool LoadScalingModes(
+	const rapidjson::GenericObject<true, rapidjson::Value>& root,
+	std::vector<ScalingMode>& scalingModes,
+	bool loadingSettings
+) {
 	auto scalingModesNode = root.FindMember("scalingModes");
 	if (scalingModesNode == root.MemberEnd()) {
 		return true;
@@ -249,13 +253,7 @@ bool ScalingModesService::Import(const rapidjson::GenericObject<true, rapidjson:
 	}
 
 	const auto& scalingModesArray = scalingModesNode->value.GetArray();
-	const rapidjson::SizeType size = scalingModesArray.Size();
-	if (size == 0) {
-		return true;
-	}
-
-	std::vector<ScalingMode> scalingModes;
-	scalingModes.reserve(size);
+	scalingModes.reserve(scalingModesArray.Size());
 
 	for (const auto& elem : scalingModesArray) {
 		if (!elem.IsObject()) {
@@ -275,6 +273,15 @@ bool ScalingModesService::Import(const rapidjson::GenericObject<true, rapidjson:
 		}
 	}
 
+	return true;
+}
+
+bool ScalingModesService::Import(const rapidjson::GenericObject<true, rapidjson::Value>& root, bool loadingSettings) noexcept {
+	std::vector<ScalingMode> scalingModes;
+	if (!LoadScalingModes(root, scalingModes, loadingSettings)) {
+		return false;
+	}
+
 	if (scalingModes.empty()) {
 		return true;
 	}
@@ -295,6 +302,13 @@ bool ScalingModesService::Import(const rapidjson::GenericObject<true, rapidjson:
 	return true;
 }
 
+bool ScalingModesService::Parse(
+	const rapidjson::GenericObject<true, rapidjson::Value>& root,
+	std::vector<ScalingMode>& scalingModes
+) noexcept {
+	return LoadScalingModes(root, scalingModes, false);
+}
+
 static bool LoadLegacyScalingMode(
 	const rapidjson::GenericObject<true, rapidjson::Value>& scalingModeObj,
 	ScalingMode& scalingMode
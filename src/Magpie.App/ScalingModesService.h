@@ -85,6 +85,12 @@ public:
 	bool Import(const rapidjson::GenericObject<true, rapidjson::Value>& root, bool loadingSettings) noexcept;
 
 	bool ImportLegacy(const rapidjson::Document& doc) noexcept;
+
+	// 解析 Export 导出的缩放模式，不修改设置，供基准测试使用
+	static bool Parse(
+		const rapidjson::GenericObject<true, rapidjson::Value>& root,
+		std::vector<ScalingMode>& scalingModes
+	) noexcept;
 private:
 	ScalingModesService() = default;
 
@@ -210,6 +210,8 @@ void SettingsViewModel::IsInlineParams(bool value) noexcept {
 
 	settings.IsInlineParams(value);
 	_propertyChangedEvent(*this, PropertyChangedEventArgs(L"IsInlineParams"));
+
+	MagService::Get().UpdateScalingOptions();
 }
 
 bool SettingsViewModel::IsDeveloperMode() const noexcept {
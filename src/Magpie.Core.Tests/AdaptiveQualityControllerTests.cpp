@@ -0,0 +1,140 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "AdaptiveQualityController.h"
+
+using namespace Magpie::Core;
+
+namespace {
+
+using Action = AdaptiveQualityController::Action;
+
+// 记录的一帧。isFullChain 为 false 表示没有新帧，只渲染了部分通道
+struct TraceFrame {
+	float gpuTime;
+	bool isFullChain;
+};
+
+struct ReplayResult {
+	Action action = Action::None;
+	// 第一次调整所在的帧在记录中的位置，没有调整时为 -1
+	int frameIdx = -1;
+};
+
+// 和 Renderer 相同，只输入渲染整个效果链的帧的用时。遇到第一次调整时停止
+ReplayResult Replay(
+	AdaptiveQualityController& controller,
+	std::span<const TraceFrame> trace,
+	bool canDecrease,
+	bool canIncrease,
+	bool skipPartialFrames = true
+) {
+	for (size_t i = 0; i < trace.size(); ++i) {
+		if (skipPartialFrames && !trace[i].isFullChain) {
+			continue;
+		}
+
+		const Action action = controller.AddSample(trace[i].gpuTime, canDecrease, canIncrease);
+		if (action != Action::None) {
+			return { action, (int)i };
+		}
+	}
+
+	return {};
+}
+
+std::vector<TraceFrame> ConstantTrace(float gpuTime, size_t count) {
+	return std::vector<TraceFrame>(count, TraceFrame{ gpuTime, true });
+}
+
+}
+
+// 帧源每隔一帧才有新帧，没有新帧时只渲染最后一个通道
+TEST_CASE(AdaptiveQualityController, PartialFramesSkipped) {
+	std::vector<TraceFrame> trace;
+	for (int i = 0; i < 200; ++i) {
+		trace.push_back({ 20.0f, true });
+		trace.push_back({ 2.0f, false });
+	}
+
+	{
+		AdaptiveQualityController controller(16.0f);
+		const ReplayResult result = Replay(controller, trace, true, false);
+		CHECK(result.action == Action::Decrease);
+		// 第 15 个完整的帧
+		CHECK(result.frameIdx == 28);
+	}
+
+	{
+		// 部分帧拉低了平均用时，始终无法发现超出预算
+		AdaptiveQualityController controller(16.0f);
+		const ReplayResult result = Replay(controller, trace, true, false, false);
+		CHECK(result.action == Action::None);
+	}
+}
+
+TEST_CASE(AdaptiveQualityController, DecreaseAfterHold) {
+	AdaptiveQualityController controller(16.0f);
+
+	// 短暂的峰值不足以降低画质
+	std::vector<TraceFrame> trace = ConstantTrace(30.0f, 5);
+	trace.resize(100, TraceFrame{ 8.0f, true });
+	CHECK(Replay(controller, trace, true, false).action == Action::None);
+
+	controller.Reset();
+	trace = ConstantTrace(20.0f, 100);
+	const ReplayResult result = Replay(controller, trace, true, false);
+	CHECK(result.action == Action::Decrease);
+	// 先忽略 30 帧，之后持续 15 帧
+	CHECK(result.frameIdx == 30 + 15 - 1);
+}
+
+TEST_CASE(AdaptiveQualityController, CannotAdjust) {
+	{
+		AdaptiveQualityController controller(16.0f);
+		CHECK(Replay(controller, ConstantTrace(20.0f, 1000), false, true).action == Action::None);
+	}
+	{
+		AdaptiveQualityController controller(16.0f);
+		CHECK(Replay(controller, ConstantTrace(5.0f, 1000), true, false).action == Action::None);
+	}
+}
+
+TEST_CASE(AdaptiveQualityController, IncreaseAfterHold) {
+	AdaptiveQualityController controller(16.0f);
+
+	// 低于预算但余量不足
+	CHECK(Replay(controller, ConstantTrace(12.0f, 1000), true, true).action == Action::None);
+
+	controller.Reset();
+	const ReplayResult result = Replay(controller, ConstantTrace(5.0f, 1000), true, true);
+	CHECK(result.action == Action::Increase);
+	CHECK(result.frameIdx == 30 + 180 - 1);
+}
+
+// 提高画质后很快又超出预算，下次提高画质前需等待两倍的时间
+TEST_CASE(AdaptiveQualityController, FailedIncreaseBacksOff) {
+	AdaptiveQualityController controller(16.0f);
+
+	ReplayResult result = Replay(controller, ConstantTrace(5.0f, 1000), true, true);
+	CHECK(result.action == Action::Increase);
+	CHECK(result.frameIdx == 180 - 1);
+
+	result = Replay(controller, ConstantTrace(20.0f, 1000), true, true);
+	CHECK(result.action == Action::Decrease);
+	CHECK(result.frameIdx == 30 + 15 - 1);
+
+	result = Replay(controller, ConstantTrace(5.0f, 1000), true, true);
+	CHECK(result.action == Action::Increase);
+	CHECK(result.frameIdx == 30 + 360 - 1);
+}
+
+TEST_CASE(AdaptiveQualityController, NegativeSamplesIgnored) {
+	AdaptiveQualityController controller(16.0f);
+
+	// 尚无结果时 GPUTimer 返回负数
+	CHECK(Replay(controller, ConstantTrace(-1.0f, 1000), true, true).action == Action::None);
+	CHECK(controller.GetAverageTime() < 0);
+
+	controller.AddSample(10.0f, true, true);
+	CHECK(controller.GetAverageTime() == 10.0f);
+}
@@ -0,0 +1,98 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "CaptureMethodScorer.h"
+#include <cfloat>
+
+using namespace Magpie::Core;
+
+namespace {
+
+using ProbeResult = CaptureMethodScorer::ProbeResult;
+
+ProbeResult MakeResult(
+	CaptureMethod method,
+	std::vector<float> acquireTimes,
+	std::vector<float> copyTimes = {},
+	std::vector<float> frameIntervals = {}
+) {
+	ProbeResult result;
+	result.method = method;
+	result.acquireTimes = std::move(acquireTimes);
+	result.copyTimes = std::move(copyTimes);
+	result.frameIntervals = std::move(frameIntervals);
+	return result;
+}
+
+bool IsNear(float a, float b) noexcept {
+	return std::abs(a - b) < 1e-4f;
+}
+
+}
+
+TEST_CASE(CaptureMethodScorer, Unavailable) {
+	// 没有取得新帧
+	CHECK(CaptureMethodScorer::Score(MakeResult(CaptureMethod::GDI, {})) == FLT_MAX);
+
+	ProbeResult result = MakeResult(CaptureMethod::GDI, { 1.0f });
+	result.failed = true;
+	CHECK(CaptureMethodScorer::Score(result) == FLT_MAX);
+}
+
+TEST_CASE(CaptureMethodScorer, MedianCost) {
+	// 偶尔的停顿不影响结果
+	const ProbeResult result = MakeResult(CaptureMethod::GraphicsCapture,
+		{ 0.5f, 0.4f, 30.0f, 0.6f, 0.5f }, { 0.2f, 0.2f, 5.0f });
+	CHECK(IsNear(CaptureMethodScorer::Score(result), 0.5f + 0.2f));
+}
+
+TEST_CASE(CaptureMethodScorer, Jitter) {
+	// 帧间隔少于两个时无法衡量抖动
+	CHECK(IsNear(CaptureMethodScorer::Score(
+		MakeResult(CaptureMethod::GraphicsCapture, { 1.0f }, {}, { 100.0f })), 1.0f));
+
+	// 帧间隔为 16 和 33 交替，偏离中位数 16 的中位数为 0
+	CHECK(IsNear(CaptureMethodScorer::Score(MakeResult(CaptureMethod::GraphicsCapture,
+		{ 1.0f }, {}, { 16.0f, 33.0f, 16.0f, 33.0f, 16.0f })), 1.0f));
+
+	// 偏离中位数 16 的中位数为 4，权重为 0.5
+	CHECK(IsNear(CaptureMethodScorer::Score(MakeResult(CaptureMethod::GraphicsCapture,
+		{ 1.0f }, {}, { 12.0f, 16.0f, 20.0f, 12.0f, 20.0f })), 1.0f + 2.0f));
+}
+
+TEST_CASE(CaptureMethodScorer, PickCheapest) {
+	const ProbeResult results[] = {
+		MakeResult(CaptureMethod::GraphicsCapture, { 2.0f }, { 0.5f }),
+		MakeResult(CaptureMethod::DesktopDuplication, { 0.5f }, { 0.3f }),
+		MakeResult(CaptureMethod::GDI, { 4.0f }, { 0.5f }),
+	};
+	CHECK(CaptureMethodScorer::Pick(results) == 1);
+}
+
+// 分数相近时选择优先级更高的
+TEST_CASE(CaptureMethodScorer, PickPrefersEarlierOnTie) {
+	const ProbeResult results[] = {
+		MakeResult(CaptureMethod::GraphicsCapture, { 1.05f }),
+		MakeResult(CaptureMethod::DesktopDuplication, { 1.0f }),
+	};
+	CHECK(CaptureMethodScorer::Pick(results) == 0);
+
+	const ProbeResult results2[] = {
+		MakeResult(CaptureMethod::GraphicsCapture, { 1.5f }),
+		MakeResult(CaptureMethod::DesktopDuplication, { 1.0f }),
+	};
+	CHECK(CaptureMethodScorer::Pick(results2) == 1);
+}
+
+TEST_CASE(CaptureMethodScorer, PickSkipsFailed) {
+	ProbeResult results[] = {
+		MakeResult(CaptureMethod::GraphicsCapture, { 0.1f }),
+		MakeResult(CaptureMethod::GDI, { 5.0f }),
+	};
+	results[0].failed = true;
+	CHECK(CaptureMethodScorer::Pick(results) == 1);
+
+	results[1].failed = true;
+	CHECK(CaptureMethodScorer::Pick(results) == -1);
+
+	CHECK(CaptureMethodScorer::Pick({}) == -1);
+}
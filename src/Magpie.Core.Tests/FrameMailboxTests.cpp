@@ -0,0 +1,113 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "FrameMailbox.h"
+
+using namespace Magpie::Core;
+
+namespace {
+
+// 每个字段都写入帧的序号，读取时检查是否一致以发现生产者和消费者同时访问同一缓冲区
+struct TestFrame {
+	std::array<uint64_t, 16> values{};
+};
+
+}
+
+TEST_CASE(FrameMailbox, NoFrameBeforePublish) {
+	FrameMailbox<TestFrame> mailbox;
+	CHECK(mailbox.TryConsume() == nullptr);
+}
+
+TEST_CASE(FrameMailbox, ConsumeLatest) {
+	FrameMailbox<TestFrame> mailbox;
+
+	mailbox.GetWriteBuffer().values[0] = 1;
+	mailbox.Publish();
+	mailbox.GetWriteBuffer().values[0] = 2;
+	mailbox.Publish();
+
+	// 未被取走的旧帧被覆盖
+	TestFrame* frame = mailbox.TryConsume();
+	CHECK(frame != nullptr);
+	CHECK(frame && frame->values[0] == 2);
+	CHECK(&mailbox.GetReadBuffer() == frame);
+
+	// 每帧只能取得一次
+	CHECK(mailbox.TryConsume() == nullptr);
+}
+
+TEST_CASE(FrameMailbox, BuffersAreExclusive) {
+	FrameMailbox<TestFrame> mailbox;
+
+	for (int i = 0; i < 10; ++i) {
+		mailbox.Publish();
+		if (i % 3 == 0) {
+			mailbox.TryConsume();
+		}
+
+		// 生产者和消费者独占的缓冲区总是不同
+		CHECK(&mailbox.GetWriteBuffer() != &mailbox.GetReadBuffer());
+	}
+}
+
+// 一个生产者和一个消费者同时全速运行，检查消费者取得的帧完整、不重复且顺序正确
+TEST_CASE(FrameMailbox, SPSCStress) {
+	static constexpr uint64_t FRAME_COUNT = 2'000'000;
+
+	FrameMailbox<TestFrame> mailbox;
+
+	std::thread producer([&mailbox] {
+		for (uint64_t seq = 1; seq <= FRAME_COUNT; ++seq) {
+			TestFrame& frame = mailbox.GetWriteBuffer();
+			for (uint64_t& value : frame.values) {
+				value = seq;
+			}
+			mailbox.Publish();
+		}
+	});
+
+	uint64_t lastSeq = 0;
+	uint64_t consumedCount = 0;
+	bool isTorn = false;
+	bool isOutOfOrder = false;
+	bool isOverwritten = false;
+	while (lastSeq != FRAME_COUNT) {
+		TestFrame* frame = mailbox.TryConsume();
+		if (!frame) {
+			continue;
+		}
+
+		const uint64_t seq = frame->values[0];
+		for (uint64_t value : frame->values) {
+			if (value != seq) {
+				isTorn = true;
+			}
+		}
+
+		if (seq <= lastSeq) {
+			isOutOfOrder = true;
+			break;
+		}
+
+		// 持有帧期间生产者不应写入它
+		std::this_thread::yield();
+		for (uint64_t value : frame->values) {
+			if (value != seq) {
+				isOverwritten = true;
+			}
+		}
+
+		lastSeq = seq;
+		++consumedCount;
+	}
+
+	producer.join();
+
+	CHECK(!isTorn);
+	CHECK(!isOutOfOrder);
+	CHECK(!isOverwritten);
+	// 最后一帧总能被取得
+	CHECK(lastSeq == FRAME_COUNT);
+	CHECK(consumedCount > 0 && consumedCount <= FRAME_COUNT);
+	std::printf("  消费者取得了 %llu 帧中的 %llu 帧\n", FRAME_COUNT, consumedCount);
+}
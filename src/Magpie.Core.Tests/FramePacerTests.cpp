@@ -0,0 +1,118 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "FramePacer.h"
+
+using namespace Magpie::Core;
+
+namespace {
+
+// 以微秒为单位，和 60Hz 接近
+constexpr int64_t PERIOD = 16667;
+constexpr int64_t MARGIN = 1000;
+
+// 按调度渲染 count 帧，每帧用时 renderTime
+void RenderFrames(FramePacer& pacer, int64_t& now, int64_t renderTime, uint32_t count) {
+	for (uint32_t i = 0; i < count; ++i) {
+		const FramePacer::Schedule schedule = pacer.GetSchedule(now, 0, PERIOD, MARGIN);
+		now = schedule.wakeTime + renderTime;
+		pacer.AddSample(schedule, schedule.wakeTime, now);
+	}
+}
+
+}
+
+TEST_CASE(FramePacer, DeadlineIsNextVBlank) {
+	FramePacer pacer;
+
+	// 在两次垂直同步之间
+	CHECK(pacer.GetSchedule(PERIOD * 3 + 100, PERIOD, PERIOD, MARGIN).deadline == PERIOD * 4);
+	// 恰好在垂直同步时，下一次垂直同步才是截止时间
+	CHECK(pacer.GetSchedule(PERIOD * 4, PERIOD, PERIOD, MARGIN).deadline == PERIOD * 5);
+	// 已知的垂直同步还未到来
+	CHECK(pacer.GetSchedule(100, PERIOD, PERIOD, MARGIN).deadline == PERIOD);
+}
+
+TEST_CASE(FramePacer, NoDelayWithoutPrediction) {
+	FramePacer pacer;
+	CHECK(pacer.PredictRenderTime() < 0);
+
+	const FramePacer::Schedule schedule = pacer.GetSchedule(500, 0, PERIOD, MARGIN);
+	CHECK(schedule.wakeTime == 500);
+	CHECK(schedule.deadline == PERIOD);
+
+	// 刷新间隔未知时不调度
+	const FramePacer::Schedule noPeriod = pacer.GetSchedule(500, 0, 0, MARGIN);
+	CHECK(noPeriod.wakeTime == 500 && noPeriod.deadline == 500);
+}
+
+TEST_CASE(FramePacer, PredictionNeedsEnoughSamples) {
+	FramePacer pacer;
+	int64_t now = 0;
+
+	RenderFrames(pacer, now, 2000, 7);
+	CHECK(pacer.PredictRenderTime() < 0);
+
+	RenderFrames(pacer, now, 2000, 1);
+	CHECK(pacer.PredictRenderTime() == 2000);
+	CHECK(pacer.GetFrameCount() == 8);
+}
+
+TEST_CASE(FramePacer, PredictsHighPercentile) {
+	FramePacer pacer;
+
+	// 用时为 1000, 2000, ..., 10000，第 90 百分位是第 9 小的样本
+	for (int64_t i = 1; i <= 10; ++i) {
+		const FramePacer::Schedule schedule{ 0, PERIOD };
+		pacer.AddSample(schedule, 0, i * 1000);
+	}
+	CHECK(pacer.PredictRenderTime() == 9000);
+}
+
+TEST_CASE(FramePacer, WakesAsLateAsPossible) {
+	FramePacer pacer;
+	int64_t now = 0;
+	RenderFrames(pacer, now, 3000, 16);
+	CHECK(pacer.PredictRenderTime() == 3000);
+
+	const int64_t start = PERIOD * 10 + 10;
+	const FramePacer::Schedule schedule = pacer.GetSchedule(start, 0, PERIOD, MARGIN);
+	CHECK(schedule.deadline == PERIOD * 11);
+	CHECK(schedule.wakeTime == PERIOD * 11 - 3000 - MARGIN);
+}
+
+TEST_CASE(FramePacer, StartsNowWhenLate) {
+	FramePacer pacer;
+	int64_t now = 0;
+	RenderFrames(pacer, now, 3000, 16);
+
+	// 距离下一次垂直同步不足预测的用时，不推迟到再下一次垂直同步
+	const int64_t start = PERIOD * 11 - 2000;
+	const FramePacer::Schedule schedule = pacer.GetSchedule(start, 0, PERIOD, MARGIN);
+	CHECK(schedule.wakeTime == start);
+	CHECK(schedule.deadline == PERIOD * 11);
+}
+
+TEST_CASE(FramePacer, CountsMisses) {
+	FramePacer pacer;
+	const FramePacer::Schedule schedule{ 0, PERIOD };
+
+	pacer.AddSample(schedule, 0, PERIOD - 1);
+	pacer.AddSample(schedule, 0, PERIOD);
+	CHECK(pacer.GetMissCount() == 0);
+
+	pacer.AddSample(schedule, 0, PERIOD + 1);
+	CHECK(pacer.GetMissCount() == 1);
+	CHECK(pacer.GetFrameCount() == 3);
+}
+
+TEST_CASE(FramePacer, AdaptsToNewRenderTime) {
+	FramePacer pacer;
+	int64_t now = 0;
+
+	RenderFrames(pacer, now, 8000, 64);
+	CHECK(pacer.PredictRenderTime() == 8000);
+
+	// 只保留最近的样本，旧的用时最终被完全替换
+	RenderFrames(pacer, now, 2000, 64);
+	CHECK(pacer.PredictRenderTime() == 2000);
+}
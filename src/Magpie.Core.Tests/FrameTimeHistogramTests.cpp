@@ -0,0 +1,190 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "FrameTimeHistogram.h"
+
+using namespace Magpie::Core;
+using namespace Magpie::Core::Tests;
+
+namespace {
+
+// 桶的相对误差不超过 1/64，另有转换为微秒时的舍入误差
+bool IsClose(float value, float expected) noexcept {
+	return std::abs(value - expected) <= expected * 0.03f + 0.001f;
+}
+
+// 排序后按相同的规则取第几个样本，作为精确的参考
+float ExactPercentile(std::vector<float> samples, float percentile) noexcept {
+	std::sort(samples.begin(), samples.end());
+	const size_t rank = std::clamp((size_t)std::ceil(percentile / 100.0f * samples.size()), (size_t)1, samples.size());
+	return samples[rank - 1];
+}
+
+}
+
+TEST_CASE(FrameTimeHistogram, EmptyHasNoPercentile) {
+	FrameTimeHistogram histogram(16);
+	CHECK(histogram.GetSampleCount() == 0);
+	CHECK(histogram.GetPercentile(50) < 0);
+	CHECK(histogram.GetMax() < 0);
+}
+
+TEST_CASE(FrameTimeHistogram, SmallValuesAreExact) {
+	FrameTimeHistogram histogram(16);
+
+	// 低于 64 微秒的值每个桶宽 1 微秒
+	histogram.AddSample(0.010f);
+	histogram.AddSample(0.020f);
+	histogram.AddSample(0.030f);
+	histogram.AddSample(0.040f);
+
+	CHECK(histogram.GetPercentile(25) == 0.010f);
+	CHECK(histogram.GetPercentile(50) == 0.020f);
+	CHECK(histogram.GetPercentile(75) == 0.030f);
+	CHECK(histogram.GetPercentile(100) == 0.040f);
+}
+
+TEST_CASE(FrameTimeHistogram, PercentileEdges) {
+	FrameTimeHistogram histogram(16);
+	histogram.AddSample(1.0f);
+	histogram.AddSample(2.0f);
+	histogram.AddSample(4.0f);
+
+	// 第 0 百分位取最小的样本，超出范围的百分位被限制
+	CHECK(IsClose(histogram.GetPercentile(0), 1.0f));
+	CHECK(IsClose(histogram.GetPercentile(100), 4.0f));
+	CHECK(IsClose(histogram.GetPercentile(200), 4.0f));
+	// 排名向上取整：3 个样本的第 34 百分位是第 2 个
+	CHECK(IsClose(histogram.GetPercentile(34), 2.0f));
+}
+
+TEST_CASE(FrameTimeHistogram, MatchesSortedSamples) {
+	FrameTimeHistogram histogram(1000);
+	std::vector<float> samples;
+
+	// 帧时间的典型分布：大多在 16.7ms 附近，少数尖峰
+	std::mt19937 rng(42);
+	std::normal_distribution<float> normal(16.7f, 1.5f);
+	std::uniform_real_distribution<float> spike(30.0f, 120.0f);
+	for (int i = 0; i < 1000; ++i) {
+		const float value = i % 50 == 0 ? spike(rng) : std::max(normal(rng), 0.0f);
+		samples.push_back(value);
+		histogram.AddSample(value);
+	}
+
+	for (float percentile : { 1.0f, 10.0f, 50.0f, 90.0f, 95.0f, 99.0f, 99.9f, 100.0f }) {
+		CHECK(IsClose(histogram.GetPercentile(percentile), ExactPercentile(samples, percentile)));
+	}
+}
+
+TEST_CASE(FrameTimeHistogram, WideRange) {
+	// 覆盖从微秒到数秒的范围
+	for (float value : { 0.07f, 0.5f, 3.3f, 16.7f, 33.3f, 250.0f, 1000.0f, 4000.0f }) {
+		FrameTimeHistogram histogram(4);
+		histogram.AddSample(value);
+		CHECK(IsClose(histogram.GetPercentile(50), value));
+		CHECK(IsClose(histogram.GetMax(), value));
+	}
+}
+
+TEST_CASE(FrameTimeHistogram, SlidingWindow) {
+	FrameTimeHistogram histogram(10);
+	for (int i = 0; i < 10; ++i) {
+		histogram.AddSample(100.0f);
+	}
+	CHECK(IsClose(histogram.GetPercentile(50), 100.0f));
+
+	// 旧的样本依次被移出
+	for (int i = 0; i < 9; ++i) {
+		histogram.AddSample(1.0f);
+	}
+	CHECK(histogram.GetSampleCount() == 10);
+	CHECK(IsClose(histogram.GetPercentile(90), 1.0f));
+	CHECK(IsClose(histogram.GetPercentile(100), 100.0f));
+	CHECK(histogram.GetMax() == 100.0f);
+
+	histogram.AddSample(1.0f);
+	CHECK(IsClose(histogram.GetPercentile(100), 1.0f));
+	CHECK(histogram.GetMax() == 1.0f);
+}
+
+TEST_CASE(FrameTimeHistogram, MaxIsExact) {
+	FrameTimeHistogram histogram(8);
+	histogram.AddSample(16.0f);
+	histogram.AddSample(33.337f);
+	histogram.AddSample(17.0f);
+
+	// 百分位数是桶的中点，最大值是精确到微秒的样本
+	CHECK(histogram.GetMax() == 33.337f);
+}
+
+TEST_CASE(FrameTimeHistogram, IgnoresNegative) {
+	FrameTimeHistogram histogram(8);
+	histogram.AddSample(-1.0f);
+	CHECK(histogram.GetSampleCount() == 0);
+
+	histogram.AddSample(5.0f);
+	histogram.AddSample(-5.0f);
+	CHECK(histogram.GetSampleCount() == 1);
+	CHECK(IsClose(histogram.GetPercentile(0), 5.0f));
+}
+
+TEST_CASE(FrameTimeHistogram, Reset) {
+	FrameTimeHistogram histogram(8);
+	histogram.AddSample(5.0f);
+	histogram.AddSample(50.0f);
+	histogram.Reset();
+
+	CHECK(histogram.GetSampleCount() == 0);
+	CHECK(histogram.GetPercentile(50) < 0);
+
+	// 重置后桶中不能残留旧的样本
+	histogram.AddSample(1.0f);
+	CHECK(IsClose(histogram.GetPercentile(100), 1.0f));
+	CHECK(histogram.GetMax() == 1.0f);
+}
+
+// GPUTimer 每帧为三个直方图各添加一个样本，覆盖层每帧查询若干百分位数。
+// 和每次查询时复制并部分排序窗口的做法对比
+BENCHMARK(FrameTimeHistogram, AddSampleAndQuery) {
+	static constexpr uint32_t WINDOW_SIZE = 1000;
+	static constexpr uint32_t BATCH_SIZE = 1000;
+
+	std::mt19937 rng(42);
+	std::normal_distribution<float> normal(16.7f, 1.5f);
+	std::vector<float> values(BATCH_SIZE * 4);
+	for (float& value : values) {
+		value = std::max(normal(rng), 0.0f);
+	}
+
+	FrameTimeHistogram histogram(WINDOW_SIZE);
+	size_t valueIdx = 0;
+	const double addNs = MeasureNanoseconds([&]() {
+		for (uint32_t i = 0; i < BATCH_SIZE; ++i) {
+			histogram.AddSample(values[valueIdx]);
+			valueIdx = (valueIdx + 1) % values.size();
+		}
+	}) / BATCH_SIZE;
+
+	float sum = 0.0f;
+	const double queryNs = MeasureNanoseconds([&]() {
+		for (uint32_t i = 0; i < 100; ++i) {
+			sum += histogram.GetPercentile(99);
+		}
+	}) / 100;
+
+	std::vector<float> window(values.begin(), values.begin() + WINDOW_SIZE);
+	std::vector<float> sorted(WINDOW_SIZE);
+	const double sortNs = MeasureNanoseconds([&]() {
+		for (uint32_t i = 0; i < 100; ++i) {
+			sorted = window;
+			auto nth = sorted.begin() + WINDOW_SIZE * 99 / 100;
+			std::nth_element(sorted.begin(), nth, sorted.end());
+			sum += *nth;
+		}
+	}) / 100;
+
+	KeepResult((uint64_t)sum);
+
+	std::printf("  AddSample：%.1f ns/样本\n", addNs);
+	std::printf("  GetPercentile：%.1f ns/次，复制窗口并 nth_element：%.1f ns/次\n", queryNs, sortNs);
+}
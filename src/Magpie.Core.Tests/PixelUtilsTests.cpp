@@ -0,0 +1,206 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "PixelUtils.h"
+
+using namespace Magpie::Core::Tests;
+
+namespace {
+
+// 以下为改用 PixelUtils 前 CursorManager 和 IconHelper 中的逐像素实现，作为参考
+
+bool HasAlphaReference(const uint32_t* pixels, size_t count) noexcept {
+	for (size_t i = 0; i < count; ++i) {
+		if (pixels[i] >> 24) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void PremultiplyAlphaReference(uint32_t* pixels, size_t count, bool swapRB, bool invertAlpha) noexcept {
+	for (size_t i = 0; i < count; ++i) {
+		uint8_t* px = (uint8_t*)(pixels + i);
+		const float alpha = px[3] / 255.0f;
+		px[0] = (uint8_t)std::lroundf(px[0] * alpha);
+		px[1] = (uint8_t)std::lroundf(px[1] * alpha);
+		px[2] = (uint8_t)std::lroundf(px[2] * alpha);
+
+		if (swapRB) {
+			std::swap(px[0], px[2]);
+		}
+		if (invertAlpha) {
+			px[3] = 255 - px[3];
+		}
+	}
+}
+
+void SwapRBReference(uint32_t* pixels, size_t count) noexcept {
+	for (size_t i = 0; i < count; ++i) {
+		uint8_t* px = (uint8_t*)(pixels + i);
+		std::swap(px[0], px[2]);
+	}
+}
+
+void CopyMaskToChannelReference(uint32_t* pixels, const uint32_t* mask, size_t count, uint32_t channel) noexcept {
+	for (size_t i = 0; i < count; ++i) {
+		((uint8_t*)(pixels + i))[channel] = (uint8_t)mask[i];
+	}
+}
+
+void FillAlphaReference(uint32_t* pixels, size_t count) noexcept {
+	for (size_t i = 0; i < count; ++i) {
+		((uint8_t*)(pixels + i))[3] = 255;
+	}
+}
+
+std::vector<uint32_t> RandomPixels(size_t count, uint32_t seed) {
+	std::mt19937 rng(seed);
+	std::vector<uint32_t> pixels(count);
+	for (uint32_t& pixel : pixels) {
+		pixel = rng();
+	}
+	return pixels;
+}
+
+// 覆盖 SIMD 实现每次处理的像素数的边界，以及剩余像素交给标量实现的情况
+constexpr size_t TEST_COUNTS[] = { 0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 255, 1023 };
+
+}
+
+TEST_CASE(PixelUtils, HasAlpha) {
+	for (size_t count : TEST_COUNTS) {
+		std::vector<uint32_t> pixels = RandomPixels(count, (uint32_t)count);
+		for (uint32_t& pixel : pixels) {
+			pixel &= 0x00FFFFFF;
+		}
+		CHECK(!PixelUtils::HasAlpha(pixels.data(), count));
+
+		// 每个位置上的非零 A 通道都应被发现
+		for (size_t i = 0; i < count; ++i) {
+			pixels[i] |= 0x01000000;
+			CHECK(PixelUtils::HasAlpha(pixels.data(), count));
+			pixels[i] &= 0x00FFFFFF;
+		}
+	}
+}
+
+TEST_CASE(PixelUtils, PremultiplyAlphaAllValues) {
+	// 每个像素的 B、G、R 通道都为 c，A 通道为 a，遍历所有组合
+	std::vector<uint32_t> pixels(256 * 256);
+	for (uint32_t a = 0; a < 256; ++a) {
+		for (uint32_t c = 0; c < 256; ++c) {
+			pixels[a * 256 + c] = c | (c << 8) | (c << 16) | (a << 24);
+		}
+	}
+
+	std::vector<uint32_t> expected = pixels;
+	PremultiplyAlphaReference(expected.data(), expected.size(), false, false);
+	PixelUtils::PremultiplyAlpha(pixels.data(), pixels.size());
+	CHECK(pixels == expected);
+}
+
+TEST_CASE(PixelUtils, PremultiplyAlphaOptions) {
+	for (size_t count : TEST_COUNTS) {
+		for (int options = 0; options < 4; ++options) {
+			const bool swapRB = options & 1;
+			const bool invertAlpha = options & 2;
+
+			std::vector<uint32_t> pixels = RandomPixels(count, (uint32_t)count);
+			std::vector<uint32_t> expected = pixels;
+			PremultiplyAlphaReference(expected.data(), count, swapRB, invertAlpha);
+			PixelUtils::PremultiplyAlpha(pixels.data(), count, swapRB, invertAlpha);
+			CHECK(pixels == expected);
+		}
+	}
+}
+
+TEST_CASE(PixelUtils, SwapRB) {
+	for (size_t count : TEST_COUNTS) {
+		std::vector<uint32_t> pixels = RandomPixels(count, (uint32_t)count);
+		std::vector<uint32_t> expected = pixels;
+		SwapRBReference(expected.data(), count);
+		PixelUtils::SwapRB(pixels.data(), count);
+		CHECK(pixels == expected);
+	}
+}
+
+TEST_CASE(PixelUtils, CopyMaskToChannel) {
+	for (size_t count : TEST_COUNTS) {
+		const std::vector<uint32_t> mask = RandomPixels(count, (uint32_t)count + 1);
+		for (uint32_t channel = 0; channel < 4; ++channel) {
+			std::vector<uint32_t> pixels = RandomPixels(count, (uint32_t)count);
+			std::vector<uint32_t> expected = pixels;
+			CopyMaskToChannelReference(expected.data(), mask.data(), count, channel);
+			PixelUtils::CopyMaskToChannel(pixels.data(), mask.data(), count, channel);
+			CHECK(pixels == expected);
+		}
+	}
+}
+
+TEST_CASE(PixelUtils, FillAlpha) {
+	for (size_t count : TEST_COUNTS) {
+		std::vector<uint32_t> pixels = RandomPixels(count, (uint32_t)count);
+		std::vector<uint32_t> expected = pixels;
+		FillAlphaReference(expected.data(), count);
+		PixelUtils::FillAlpha(pixels.data(), count);
+		CHECK(pixels == expected);
+	}
+}
+
+// 256x256 是大尺寸光标和图标的典型大小
+BENCHMARK(PixelUtils, PremultiplyAlpha) {
+	static constexpr size_t PIXEL_COUNT = 256 * 256;
+
+	const std::vector<uint32_t> source = RandomPixels(PIXEL_COUNT, 42);
+	std::vector<uint32_t> pixels(PIXEL_COUNT);
+
+	// 每次运行前恢复原始数据，两者的复制开销相同
+	const double referenceNs = MeasureNanoseconds([&]() {
+		pixels = source;
+		PremultiplyAlphaReference(pixels.data(), PIXEL_COUNT, true, false);
+	}) / PIXEL_COUNT;
+	KeepResult(pixels[0]);
+
+	const double simdNs = MeasureNanoseconds([&]() {
+		pixels = source;
+		PixelUtils::PremultiplyAlpha(pixels.data(), PIXEL_COUNT, true, false);
+	}) / PIXEL_COUNT;
+	KeepResult(pixels[0]);
+
+	std::printf("  逐像素：%.2f ns/像素，PixelUtils：%.2f ns/像素\n", referenceNs, simdNs);
+}
+
+BENCHMARK(PixelUtils, Others) {
+	static constexpr size_t PIXEL_COUNT = 256 * 256;
+
+	std::vector<uint32_t> pixels = RandomPixels(PIXEL_COUNT, 42);
+	const std::vector<uint32_t> mask = RandomPixels(PIXEL_COUNT, 43);
+
+	const auto report = [&](const char* name, auto&& reference, auto&& simd) {
+		const double referenceNs = MeasureNanoseconds(reference) / PIXEL_COUNT;
+		KeepResult(pixels[0]);
+		const double simdNs = MeasureNanoseconds(simd) / PIXEL_COUNT;
+		KeepResult(pixels[0]);
+		std::printf("  %s：逐像素 %.2f ns/像素，PixelUtils %.2f ns/像素\n", name, referenceNs, simdNs);
+	};
+
+	report("SwapRB",
+		[&]() { SwapRBReference(pixels.data(), PIXEL_COUNT); },
+		[&]() { PixelUtils::SwapRB(pixels.data(), PIXEL_COUNT); });
+	report("CopyMaskToChannel",
+		[&]() { CopyMaskToChannelReference(pixels.data(), mask.data(), PIXEL_COUNT, 3); },
+		[&]() { PixelUtils::CopyMaskToChannel(pixels.data(), mask.data(), PIXEL_COUNT, 3); });
+	report("FillAlpha",
+		[&]() { FillAlphaReference(pixels.data(), PIXEL_COUNT); },
+		[&]() { PixelUtils::FillAlpha(pixels.data(), PIXEL_COUNT); });
+
+	// 没有非零的 A 通道时需要扫描所有像素
+	for (uint32_t& pixel : pixels) {
+		pixel &= 0x00FFFFFF;
+	}
+	bool hasAlpha = false;
+	report("HasAlpha",
+		[&]() { hasAlpha |= HasAlphaReference(pixels.data(), PIXEL_COUNT); },
+		[&]() { hasAlpha |= PixelUtils::HasAlpha(pixels.data(), PIXEL_COUNT); });
+	KeepResult(hasAlpha);
+}
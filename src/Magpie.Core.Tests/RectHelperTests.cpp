@@ -0,0 +1,170 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "RectHelper.h"
+#include <random>
+
+using namespace Magpie::Core;
+
+namespace {
+
+bool operator==(const RECT& r1, const RECT& r2) noexcept {
+	return r1.left == r2.left && r1.top == r2.top && r1.right == r2.right && r1.bottom == r2.bottom;
+}
+
+bool Contains(const RECT& outer, const RECT& inner) noexcept {
+	return outer.left <= inner.left && outer.top <= inner.top
+		&& outer.right >= inner.right && outer.bottom >= inner.bottom;
+}
+
+// 合并只会用并集替换矩形，因此每个输入的矩形都应完全位于某个结果矩形中
+bool IsCovered(const SmallVectorImpl<RECT>& result, std::span<const RECT> inputs) noexcept {
+	for (const RECT& input : inputs) {
+		if (std::none_of(result.begin(), result.end(), [&](const RECT& rect) { return Contains(rect, input); })) {
+			return false;
+		}
+	}
+	return true;
+}
+
+}
+
+TEST_CASE(RectHelper, ClipRect) {
+	const RECT clip{ 100, 100, 300, 200 };
+	SmallVector<RECT> result;
+
+	// 完全位于 clip 中，坐标转换为以 clip 的左上角为原点
+	RectHelper::ClipRect({ 110, 120, 150, 160 }, clip, result);
+	CHECK(result.size() == 1);
+	CHECK(result.back() == RECT{ 10, 20, 50, 60 });
+
+	// 部分重叠
+	RectHelper::ClipRect({ 50, 150, 120, 400 }, clip, result);
+	CHECK(result.size() == 2);
+	CHECK(result.back() == RECT{ 0, 50, 20, 100 });
+
+	// 覆盖整个 clip
+	RectHelper::ClipRect({ 0, 0, 1000, 1000 }, clip, result);
+	CHECK(result.size() == 3);
+	CHECK(result.back() == RECT{ 0, 0, 200, 100 });
+
+	// 不相交或只有边相接时不添加
+	RectHelper::ClipRect({ 400, 400, 500, 500 }, clip, result);
+	RectHelper::ClipRect({ 300, 100, 400, 200 }, clip, result);
+	RectHelper::ClipRect({ 150, 150, 150, 180 }, clip, result);
+	CHECK(result.size() == 3);
+}
+
+TEST_CASE(RectHelper, CoalesceOverlappingAndAdjacent) {
+	SmallVector<RECT> rects;
+
+	rects.assign({ RECT{ 0, 0, 100, 100 }, RECT{ 20, 20, 120, 120 } });
+	// 包围盒多出的面积为 2 * 20 * 20，不超过覆盖面积的 1/4
+	RectHelper::CoalesceRects(rects);
+	CHECK(rects.size() == 1);
+	CHECK(rects[0] == RECT{ 0, 0, 120, 120 });
+
+	// 重叠较少时包围盒多出的面积过大
+	rects.assign({ RECT{ 0, 0, 100, 100 }, RECT{ 50, 50, 150, 150 } });
+	RectHelper::CoalesceRects(rects);
+	CHECK(rects.size() == 2);
+
+	rects.assign({ RECT{ 0, 0, 100, 100 }, RECT{ 100, 0, 200, 100 } });
+	RectHelper::CoalesceRects(rects);
+	CHECK(rects.size() == 1);
+	CHECK(rects[0] == RECT{ 0, 0, 200, 100 });
+
+	// 相距很远时合并会复制大量未更新的区域
+	rects.assign({ RECT{ 0, 0, 10, 10 }, RECT{ 500, 500, 510, 510 } });
+	RectHelper::CoalesceRects(rects);
+	CHECK(rects.size() == 2);
+}
+
+// 后两个矩形合并后才能和第一个矩形合并
+TEST_CASE(RectHelper, CoalesceCascade) {
+	SmallVector<RECT> rects;
+	rects.assign({ RECT{ 0, 0, 100, 20 }, RECT{ 0, 20, 50, 40 }, RECT{ 50, 20, 100, 40 } });
+
+	RectHelper::CoalesceRects(rects);
+	CHECK(rects.size() == 1);
+	CHECK(rects[0] == RECT{ 0, 0, 100, 40 });
+}
+
+TEST_CASE(RectHelper, CoalesceTrivial) {
+	SmallVector<RECT> rects;
+	RectHelper::CoalesceRects(rects);
+	CHECK(rects.empty());
+
+	rects.push_back({ 1, 2, 3, 4 });
+	RectHelper::CoalesceRects(rects);
+	CHECK(rects.size() == 1);
+	CHECK(rects[0] == RECT{ 1, 2, 3, 4 });
+}
+
+// 合并后的矩形仍多于 maxCount 时使用包围盒
+TEST_CASE(RectHelper, CoalesceMaxCountFallback) {
+	SmallVector<RECT> rects;
+	for (LONG i = 0; i < 5; ++i) {
+		rects.push_back({ i * 100, i * 100, i * 100 + 10, i * 100 + 10 });
+	}
+	const SmallVector<RECT> inputs = rects;
+
+	RectHelper::CoalesceRects(rects, 5);
+	CHECK(rects.size() == 5);
+
+	RectHelper::CoalesceRects(rects, 4);
+	CHECK(rects.size() == 1);
+	CHECK(rects[0] == RECT{ 0, 0, 410, 410 });
+	CHECK(IsCovered(rects, inputs));
+}
+
+// 输入超过 256 个矩形时不尝试合并，直接使用包围盒
+TEST_CASE(RectHelper, CoalesceTooManyInputs) {
+	SmallVector<RECT> rects;
+	for (LONG i = 0; i < 257; ++i) {
+		rects.push_back({ i * 20, 0, i * 20 + 1, 1 });
+	}
+
+	RectHelper::CoalesceRects(rects, 1000);
+	CHECK(rects.size() == 1);
+	CHECK(rects[0] == RECT{ 0, 0, 256 * 20 + 1, 1 });
+
+	// 256 个时仍逐个合并。这些矩形相距太远，无法合并
+	rects.clear();
+	for (LONG i = 0; i < 256; ++i) {
+		rects.push_back({ i * 20, 0, i * 20 + 1, 1 });
+	}
+
+	RectHelper::CoalesceRects(rects, 1000);
+	CHECK(rects.size() == 256);
+}
+
+TEST_CASE(RectHelper, CoalesceRandom) {
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<LONG> posDist(0, 1000);
+	std::uniform_int_distribution<LONG> sizeDist(1, 200);
+	std::uniform_int_distribution<int> countDist(0, 300);
+
+	bool isCovered = true;
+	bool isWithinMaxCount = true;
+	for (int iteration = 0; iteration < 200; ++iteration) {
+		SmallVector<RECT> rects;
+		for (int i = 0, count = countDist(rng); i < count; ++i) {
+			const LONG left = posDist(rng);
+			const LONG top = posDist(rng);
+			rects.push_back({ left, top, left + sizeDist(rng), top + sizeDist(rng) });
+		}
+		const SmallVector<RECT> inputs = rects;
+
+		RectHelper::CoalesceRects(rects);
+
+		if (!IsCovered(rects, inputs)) {
+			isCovered = false;
+		}
+		if (rects.size() > 16) {
+			isWithinMaxCount = false;
+		}
+	}
+
+	CHECK(isCovered);
+	CHECK(isWithinMaxCount);
+}
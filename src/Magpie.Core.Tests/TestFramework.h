@@ -0,0 +1,62 @@
+#pragma once
+
+// 极简的测试框架。TEST_CASE 定义的测试用例和 BENCHMARK 定义的基准测试在静态初始化时注册，由 main 依次运行
+namespace Magpie::Core::Tests {
+
+struct TestCase {
+	const char* name;
+	void (*func)();
+};
+
+std::vector<TestCase>& GetTestCases() noexcept;
+
+std::vector<TestCase>& GetBenchmarks() noexcept;
+
+struct TestRegistrar {
+	TestRegistrar(std::vector<TestCase>& testCases, const char* name, void (*func)()) noexcept {
+		testCases.push_back({ name, func });
+	}
+};
+
+// 记录失败的检查，不中断当前测试用例
+void ReportFailure(const char* expr, const char* file, int line) noexcept;
+
+// 防止基准测试中未使用的结果被优化掉
+void KeepResult(uint64_t value) noexcept;
+
+// 重复运行 func 至少 200 毫秒，返回每次运行的平均用时，单位为纳秒。
+// 每次运行应包含足够多的工作，使读取时钟的开销可以忽略
+template <typename Fn>
+double MeasureNanoseconds(Fn&& func) noexcept {
+	using namespace std::chrono;
+
+	// 预热缓存和分支预测
+	func();
+
+	uint64_t runCount = 0;
+	const steady_clock::time_point start = steady_clock::now();
+	steady_clock::time_point now;
+	do {
+		func();
+		++runCount;
+		now = steady_clock::now();
+	} while (now - start < 200ms);
+
+	return duration<double, std::nano>(now - start).count() / runCount;
+}
+
+}
+
+#define _TEST_REGISTER(registry, id, displayName) \
+	static void id(); \
+	static ::Magpie::Core::Tests::TestRegistrar id##_registrar(::Magpie::Core::Tests::registry(), displayName, id); \
+	static void id()
+
+#define TEST_CASE(group, name) _TEST_REGISTER(GetTestCases, group##_##name, #group "." #name)
+
+// 基准测试不检查结果，自行输出测得的用时
+#define BENCHMARK(group, name) _TEST_REGISTER(GetBenchmarks, group##_##name##_Benchmark, #group "." #name)
+
+// 可变参数使表达式中可以包含逗号，如 RECT{ 0, 0, 1, 1 }
+#define CHECK(...) \
+	((__VA_ARGS__) ? (void)0 : ::Magpie::Core::Tests::ReportFailure(#__VA_ARGS__, __FILE__, __LINE__))
@@ -0,0 +1,188 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "ViewCache.h"
+#include "SmallVector.h"
+
+using namespace Magpie::Core;
+
+namespace {
+
+// WARP 设备不依赖显卡，在任何环境中都可用
+winrt::com_ptr<ID3D11Device> CreateWarpDevice() noexcept {
+	winrt::com_ptr<ID3D11Device> device;
+	const D3D_FEATURE_LEVEL featureLevel = D3D_FEATURE_LEVEL_11_0;
+	D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_WARP, NULL, 0,
+		&featureLevel, 1, D3D11_SDK_VERSION, device.put(), nullptr, nullptr);
+	return device;
+}
+
+winrt::com_ptr<ID3D11Texture2D> CreateTexture(ID3D11Device* device, UINT bindFlags, UINT size = 16) noexcept {
+	D3D11_TEXTURE2D_DESC desc{};
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.Width = size;
+	desc.Height = size;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = bindFlags;
+
+	winrt::com_ptr<ID3D11Texture2D> texture;
+	device->CreateTexture2D(&desc, nullptr, texture.put());
+	return texture;
+}
+
+// 统计被销毁的纹理数
+struct DestructionCounter {
+	void Watch(ID3D11Texture2D* texture) noexcept {
+		winrt::com_ptr<ID3DDestructionNotifier> notifier;
+		if (SUCCEEDED(texture->QueryInterface(IID_PPV_ARGS(notifier.put())))) {
+			UINT callbackId;
+			notifier->RegisterDestructionCallback(&_OnDestroyed, this, &callbackId);
+		}
+	}
+
+	uint32_t count = 0;
+
+private:
+	static void WINAPI _OnDestroyed(void* data) {
+		++((DestructionCounter*)data)->count;
+	}
+};
+
+constexpr UINT ALL_BIND_FLAGS = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_RENDER_TARGET;
+
+}
+
+TEST_CASE(ViewCache, SameViewWhileHeld) {
+	winrt::com_ptr<ID3D11Device> device = CreateWarpDevice();
+	CHECK(device);
+	if (!device) {
+		return;
+	}
+
+	ViewCache cache;
+	cache.Initialize(device.get());
+
+	winrt::com_ptr<ID3D11Texture2D> texture = CreateTexture(device.get(), ALL_BIND_FLAGS);
+	winrt::com_ptr<ID3D11ShaderResourceView> srv1 = cache.GetShaderResourceView(texture.get());
+	winrt::com_ptr<ID3D11ShaderResourceView> srv2 = cache.GetShaderResourceView(texture.get());
+	CHECK(srv1 && srv1 == srv2);
+
+	// 不同类型的视图分别缓存
+	winrt::com_ptr<ID3D11UnorderedAccessView> uav = cache.GetUnorderedAccessView(texture.get());
+	winrt::com_ptr<ID3D11RenderTargetView> rtv = cache.GetRenderTargetView(texture.get());
+	CHECK(uav && rtv);
+	CHECK(cache.GetCount() == 3);
+}
+
+TEST_CASE(ViewCache, EvictWhenViewsReleased) {
+	winrt::com_ptr<ID3D11Device> device = CreateWarpDevice();
+	CHECK(device);
+	if (!device) {
+		return;
+	}
+
+	ViewCache cache;
+	cache.Initialize(device.get());
+
+	DestructionCounter counter;
+	winrt::com_ptr<ID3D11Texture2D> texture = CreateTexture(device.get(), ALL_BIND_FLAGS);
+	counter.Watch(texture.get());
+
+	winrt::com_ptr<ID3D11ShaderResourceView> srv = cache.GetShaderResourceView(texture.get());
+	winrt::com_ptr<ID3D11UnorderedAccessView> uav = cache.GetUnorderedAccessView(texture.get());
+	CHECK(cache.GetCount() == 2);
+
+	// 视图仍持有纹理
+	texture = nullptr;
+	CHECK(counter.count == 0);
+
+	srv = nullptr;
+	CHECK(cache.GetCount() == 1);
+	uav = nullptr;
+	CHECK(cache.GetCount() == 0);
+	CHECK(counter.count == 1);
+}
+
+TEST_CASE(ViewCache, NoEntryOnFailure) {
+	winrt::com_ptr<ID3D11Device> device = CreateWarpDevice();
+	CHECK(device);
+	if (!device) {
+		return;
+	}
+
+	ViewCache cache;
+	cache.Initialize(device.get());
+
+	// 没有 D3D11_BIND_UNORDERED_ACCESS 标志无法创建 UAV
+	winrt::com_ptr<ID3D11Texture2D> texture = CreateTexture(device.get(), D3D11_BIND_SHADER_RESOURCE);
+	CHECK(!cache.GetUnorderedAccessView(texture.get()));
+	CHECK(!cache.GetRenderTargetView(texture.get()));
+	CHECK(cache.GetCount() == 0);
+
+	winrt::com_ptr<ID3D11ShaderResourceView> srv = cache.GetShaderResourceView(texture.get());
+	CHECK(srv);
+	CHECK(cache.GetCount() == 1);
+}
+
+// 模拟反复替换效果链：每条效果链创建自己的中间纹理和视图，替换时全部释放，
+// 只有帧源的输出跨效果链存活。视图和纹理都不应累积
+TEST_CASE(ViewCache, ChainRebuildStress) {
+	winrt::com_ptr<ID3D11Device> device = CreateWarpDevice();
+	CHECK(device);
+	if (!device) {
+		return;
+	}
+
+	ViewCache cache;
+	cache.Initialize(device.get());
+
+	winrt::com_ptr<ID3D11Texture2D> frameSourceOutput = CreateTexture(device.get(), D3D11_BIND_SHADER_RESOURCE);
+	// 帧源持有自己输出的视图
+	winrt::com_ptr<ID3D11ShaderResourceView> outputSrv = cache.GetShaderResourceView(frameSourceOutput.get());
+
+	static constexpr uint32_t REBUILD_COUNT = 5000;
+	static constexpr uint32_t TEXTURES_PER_CHAIN = 4;
+
+	DestructionCounter counter;
+	uint32_t createdCount = 0;
+	bool isOutputViewShared = true;
+
+	for (uint32_t i = 0; i < REBUILD_COUNT; ++i) {
+		{
+			SmallVector<winrt::com_ptr<ID3D11Texture2D>, TEXTURES_PER_CHAIN> textures;
+			SmallVector<winrt::com_ptr<ID3D11ShaderResourceView>, TEXTURES_PER_CHAIN + 1> srvs;
+			SmallVector<winrt::com_ptr<ID3D11UnorderedAccessView>, TEXTURES_PER_CHAIN> uavs;
+
+			srvs.push_back(cache.GetShaderResourceView(frameSourceOutput.get()));
+			isOutputViewShared &= srvs.back() == outputSrv;
+
+			// 尺寸随效果链变化，和替换效果链时一样
+			const UINT size = 8 + i % 16;
+			for (uint32_t j = 0; j < TEXTURES_PER_CHAIN; ++j) {
+				textures.push_back(CreateTexture(device.get(), ALL_BIND_FLAGS, size));
+				counter.Watch(textures.back().get());
+				++createdCount;
+
+				srvs.push_back(cache.GetShaderResourceView(textures.back().get()));
+				uavs.push_back(cache.GetUnorderedAccessView(textures.back().get()));
+			}
+
+			// 纹理先于视图释放，视图释放后纹理随之销毁
+			textures.clear();
+		}
+
+		if (cache.GetCount() != 1 || counter.count != createdCount) {
+			break;
+		}
+	}
+
+	CHECK(isOutputViewShared);
+	CHECK(cache.GetCount() == 1);
+	CHECK(counter.count == createdCount);
+	CHECK(createdCount == REBUILD_COUNT * TEXTURES_PER_CHAIN);
+
+	outputSrv = nullptr;
+	CHECK(cache.GetCount() == 0);
+}
@@ -0,0 +1,89 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "Logger.h"
+
+namespace Magpie::Core::Tests {
+
+std::vector<TestCase>& GetTestCases() noexcept {
+	static std::vector<TestCase> testCases;
+	return testCases;
+}
+
+std::vector<TestCase>& GetBenchmarks() noexcept {
+	static std::vector<TestCase> benchmarks;
+	return benchmarks;
+}
+
+static uint32_t failureCount = 0;
+
+void ReportFailure(const char* expr, const char* file, int line) noexcept {
+	++failureCount;
+	std::printf("  %s(%d): CHECK(%s) 失败\n", file, line, expr);
+}
+
+static volatile uint64_t resultSink = 0;
+
+void KeepResult(uint64_t value) noexcept {
+	resultSink = resultSink + value;
+}
+
+}
+
+using namespace Magpie::Core::Tests;
+
+static void RunBenchmarks(std::string_view filter) noexcept {
+	for (const TestCase& benchmark : GetBenchmarks()) {
+		if (!filter.empty() && std::string_view(benchmark.name).find(filter) == std::string_view::npos) {
+			continue;
+		}
+
+		std::printf("[BENCH ] %s\n", benchmark.name);
+		benchmark.func();
+	}
+}
+
+// 用法：Magpie.Core.Tests [--bench] [过滤器]
+// 只运行名字包含过滤器的测试用例，返回值为失败的测试用例数。指定 --bench 时改为运行基准测试，
+// 应使用 Release 配置
+int main(int argc, char* argv[]) {
+	// 以 UTF-8 输出
+	SetConsoleOutputCP(CP_UTF8);
+
+	// 被测试的代码出错时会记录日志
+	Logger::Get().Initialize(spdlog::level::info, "logs\\tests.log", 100000, 1);
+
+	int argIdx = 1;
+	const bool isBenchmark = argc > argIdx && std::string_view(argv[argIdx]) == "--bench";
+	if (isBenchmark) {
+		++argIdx;
+	}
+	const std::string_view filter = argc > argIdx ? argv[argIdx] : "";
+
+	if (isBenchmark) {
+		RunBenchmarks(filter);
+		return 0;
+	}
+
+	uint32_t runCount = 0;
+	uint32_t failedCaseCount = 0;
+	for (const TestCase& testCase : GetTestCases()) {
+		if (!filter.empty() && std::string_view(testCase.name).find(filter) == std::string_view::npos) {
+			continue;
+		}
+
+		std::printf("[ RUN  ] %s\n", testCase.name);
+		const uint32_t oldFailureCount = failureCount;
+		testCase.func();
+		++runCount;
+
+		if (failureCount == oldFailureCount) {
+			std::printf("[  OK  ] %s\n", testCase.name);
+		} else {
+			++failedCaseCount;
+			std::printf("[FAILED] %s\n", testCase.name);
+		}
+	}
+
+	std::printf("%u 个测试用例中有 %u 个失败\n", runCount, failedCaseCount);
+	return (int)failedCaseCount;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include "CommonPch.h"
+
+// DirectX 头文件
+#include <d3d11_4.h>
+
+#pragma comment(lib, "d3d11.lib")
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
@@ -0,0 +1,85 @@
+#include "pch.h"
+#include "AdaptiveQualityController.h"
+
+namespace Magpie::Core {
+
+// 计算移动平均时新样本的权重
+static constexpr float AVERAGE_ALPHA = 0.2f;
+// 平均用时低于预算的这个比例才认为有余量。更好的效果的开销通常高得多，比例过高会来回切换
+static constexpr float HEADROOM_RATIO = 0.6f;
+// 调整后忽略的帧数，替换效果链后最初几帧的用时不稳定
+static constexpr uint32_t SETTLE_FRAMES = 30;
+// 连续超出预算这么多帧后降低画质
+static constexpr uint32_t DECREASE_HOLD_FRAMES = 15;
+// 连续有余量这么多帧后提高画质，提高画质失败后加倍，最多加倍到 MAX_INCREASE_HOLD_FRAMES
+static constexpr uint32_t INCREASE_HOLD_FRAMES = 180;
+static constexpr uint32_t MAX_INCREASE_HOLD_FRAMES = INCREASE_HOLD_FRAMES * 16;
+// 提高画质后这么多帧内又降低画质视为失败，超过则视为成功
+static constexpr uint32_t INCREASE_TRIAL_FRAMES = 600;
+
+AdaptiveQualityController::AdaptiveQualityController(float budget) noexcept
+	: _budget(budget), _increaseHoldFrames(INCREASE_HOLD_FRAMES) {}
+
+AdaptiveQualityController::Action AdaptiveQualityController::AddSample(
+	float gpuTime,
+	bool canDecrease,
+	bool canIncrease
+) noexcept {
+	if (gpuTime < 0) {
+		return Action::None;
+	}
+
+	if (_framesSinceIncrease != UINT32_MAX) {
+		if (++_framesSinceIncrease >= INCREASE_TRIAL_FRAMES) {
+			// 提高画质成功，恢复初始的等待时间
+			_framesSinceIncrease = UINT32_MAX;
+			_increaseHoldFrames = INCREASE_HOLD_FRAMES;
+		}
+	}
+
+	if (_settleFrames > 0) {
+		--_settleFrames;
+		return Action::None;
+	}
+
+	_averageTime = _averageTime < 0 ? gpuTime : _averageTime + (gpuTime - _averageTime) * AVERAGE_ALPHA;
+
+	if (_averageTime > _budget) {
+		++_overBudgetFrames;
+		_underBudgetFrames = 0;
+	} else if (_averageTime < _budget * HEADROOM_RATIO) {
+		++_underBudgetFrames;
+		_overBudgetFrames = 0;
+	} else {
+		_overBudgetFrames = 0;
+		_underBudgetFrames = 0;
+	}
+
+	if (canDecrease && _overBudgetFrames >= DECREASE_HOLD_FRAMES) {
+		if (_framesSinceIncrease != UINT32_MAX) {
+			// 提高画质失败，下次需等待更久
+			_increaseHoldFrames = std::min(_increaseHoldFrames * 2, MAX_INCREASE_HOLD_FRAMES);
+			_framesSinceIncrease = UINT32_MAX;
+		}
+
+		Reset();
+		return Action::Decrease;
+	}
+
+	if (canIncrease && _underBudgetFrames >= _increaseHoldFrames) {
+		_framesSinceIncrease = 0;
+		Reset();
+		return Action::Increase;
+	}
+
+	return Action::None;
+}
+
+void AdaptiveQualityController::Reset() noexcept {
+	_averageTime = -1.0f;
+	_settleFrames = SETTLE_FRAMES;
+	_overBudgetFrames = 0;
+	_underBudgetFrames = 0;
+}
+
+}
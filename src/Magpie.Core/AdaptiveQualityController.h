@@ -0,0 +1,51 @@
+#pragma once
+
+namespace Magpie::Core {
+
+// 自适应画质的决策模型。根据每帧效果链的 GPU 用时决定降低或提高画质
+// 超出预算和有余量都需持续一段时间才调整，调整后的一段时间内不再评估，避免来回切换。
+// 提高画质后很快又超出预算说明余量不足，之后提高画质前需等待更久
+// 只进行计算，不依赖 D3D，可以用记录的用时序列重放
+class AdaptiveQualityController {
+public:
+	enum class Action {
+		None,
+		Decrease,
+		Increase
+	};
+
+	// budget 为每帧效果链 GPU 用时的预算，单位为 ms
+	explicit AdaptiveQualityController(float budget) noexcept;
+
+	// 输入一帧的 GPU 用时，单位为 ms。canDecrease 和 canIncrease 表示当前能否继续调整
+	Action AddSample(float gpuTime, bool canDecrease, bool canIncrease) noexcept;
+
+	// 效果链改变后调用，之前的样本不再代表当前的开销
+	void Reset() noexcept;
+
+	float GetBudget() const noexcept {
+		return _budget;
+	}
+
+	// GPU 用时的指数移动平均，尚无样本时为负数
+	float GetAverageTime() const noexcept {
+		return _averageTime;
+	}
+
+private:
+	float _budget = 0.0f;
+	float _averageTime = -1.0f;
+
+	// 调整后还需忽略的样本数
+	uint32_t _settleFrames = 0;
+	// 连续超出预算和有余量的帧数
+	uint32_t _overBudgetFrames = 0;
+	uint32_t _underBudgetFrames = 0;
+
+	// 提高画质前有余量需持续的帧数，提高画质失败后加倍
+	uint32_t _increaseHoldFrames = 0;
+	// 上次提高画质后经过的帧数，用于判断是否失败
+	uint32_t _framesSinceIncrease = UINT32_MAX;
+};
+
+}
@@ -0,0 +1,422 @@
+#include "pch.h"
+#include "Benchmark.h"
+#include "MagApp.h"
+#include "DeviceResources.h"
+#include "EffectCompiler.h"
+#include "EffectDrawer.h"
+#include "EffectHelper.h"
+#include "GPUTimer.h"
+#include "FrameTimeHistogram.h"
+#include "ReplayFrameSource.h"
+#include "Logger.h"
+#include "StrUtils.h"
+#include "Utils.h"
+#include "Win32Utils.h"
+
+namespace Magpie::Core {
+
+// 同时等待结果的查询的数量
+static constexpr uint32_t QUERY_DEPTH = 8;
+// GPU 最多落后的帧数，和关闭垂直同步时交换链的最大延迟相近
+static constexpr uint32_t MAX_PENDING_FRAMES = 3;
+// 每隔这么多帧检索一次显存占用
+static constexpr uint32_t VIDEO_MEMORY_SAMPLE_INTERVAL = 32;
+
+// 在直方图之外记录总和以计算平均值
+class TimingStats {
+public:
+	explicit TimingStats(uint32_t sampleCount) : _histogram(sampleCount) {}
+
+	void AddSample(float value) noexcept {
+		_histogram.AddSample(value);
+		_sum += value;
+	}
+
+	Benchmark::Distribution GetDistribution() const noexcept {
+		const uint32_t count = _histogram.GetSampleCount();
+		if (count == 0) {
+			return {};
+		}
+
+		Benchmark::Distribution result;
+		result.mean = float(_sum / count);
+		result.p50 = _histogram.GetPercentile(50);
+		result.p90 = _histogram.GetPercentile(90);
+		result.p99 = _histogram.GetPercentile(99);
+		result.max = _histogram.GetMax();
+		return result;
+	}
+
+private:
+	FrameTimeHistogram _histogram;
+	double _sum = 0.0;
+};
+
+static uint64_t GetVideoMemoryUsage() noexcept {
+	IDXGIAdapter4* adapter = MagApp::Get().GetDeviceResources().GetGraphicsAdapter();
+
+	uint64_t result = 0;
+	for (DXGI_MEMORY_SEGMENT_GROUP group : { DXGI_MEMORY_SEGMENT_GROUP_LOCAL, DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL }) {
+		DXGI_QUERY_VIDEO_MEMORY_INFO info{};
+		if (SUCCEEDED(adapter->QueryVideoMemoryInfo(0, group, &info))) {
+			result += info.CurrentUsage;
+		}
+	}
+	return result;
+}
+
+// 依次编译以得到每个效果的用时。先只读取缓存以区分命中缓存和编译的用时
+static bool CompileEffect(const EffectOption& option, bool disableCache, EffectDesc& desc, Benchmark::EffectResult& result) {
+	const auto resetDesc = [&]() {
+		desc = {};
+		desc.name = StrUtils::UTF16ToUTF8(option.name);
+		// 将文件夹分隔符统一为 '\'
+		for (char& c : desc.name) {
+			if (c == '/') {
+				c = '\\';
+			}
+		}
+
+		// 没有效果负责渲染光标，因此都不是最后一个效果
+		if (option.flags & EffectOptionFlags::InlineParams) {
+			desc.flags |= EffectFlags::InlineParams;
+		}
+		if (option.flags & EffectOptionFlags::FP16) {
+			desc.flags |= EffectFlags::FP16;
+		}
+	};
+
+	result.name = StrUtils::UTF16ToUTF8(option.name);
+
+	bool success = false;
+	if (!disableCache) {
+		resetDesc();
+		int duration = Utils::Measure([&]() {
+			success = !EffectCompiler::Compile(desc, EffectCompilerFlags::CacheOnly, &option.parameters);
+		});
+
+		if (success) {
+			result.isCacheHit = true;
+			result.compileTime = duration / 1000.0f;
+			return true;
+		}
+	}
+
+	resetDesc();
+	int duration = Utils::Measure([&]() {
+		success = !EffectCompiler::Compile(desc, disableCache ? EffectCompilerFlags::NoCache : 0, &option.parameters);
+	});
+
+	if (!success) {
+		Logger::Get().Error(StrUtils::Concat("编译 ", result.name, ".hlsl 失败"));
+		return false;
+	}
+
+	result.compileTime = duration / 1000.0f;
+	return true;
+}
+
+// 未指定录制文件时使用的输入，渐变叠加噪声，每次运行都相同
+static winrt::com_ptr<ID3D11Texture2D> CreateTestPattern(SIZE size) {
+	std::vector<uint32_t> pixels((size_t)size.cx * size.cy);
+
+	uint32_t state = 0x12345678;
+	for (LONG y = 0; y < size.cy; ++y) {
+		for (LONG x = 0; x < size.cx; ++x) {
+			// xorshift32
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+
+			const uint32_t noise = state & 0x3F;
+			const uint32_t r = std::min(uint32_t(x * 191 / size.cx) + noise, 255u);
+			const uint32_t g = std::min(uint32_t(y * 191 / size.cy) + noise, 255u);
+			const uint32_t b = std::min(uint32_t((x ^ y) & 0x7F) + noise, 255u);
+			pixels[(size_t)y * size.cx + x] = b | (g << 8) | (r << 16) | 0xFF000000;
+		}
+	}
+
+	D3D11_SUBRESOURCE_DATA initData{};
+	initData.pSysMem = pixels.data();
+	initData.SysMemPitch = size.cx * 4;
+
+	return MagApp::Get().GetDeviceResources().CreateTexture2D(
+		GPUMemoryOwner::FrameSource,
+		DXGI_FORMAT_B8G8R8A8_UNORM,
+		size.cx,
+		size.cy,
+		D3D11_BIND_SHADER_RESOURCE,
+		D3D11_USAGE_IMMUTABLE,
+		0,
+		&initData
+	);
+}
+
+// 所有 D3D 资源都在此释放，之后才能销毁 DeviceResources
+static bool RunBenchmark(const Benchmark::Options& options, Benchmark::Result& result) {
+	DeviceResources& dr = MagApp::Get().GetDeviceResources();
+	ID3D11DeviceContext4* d3dDC = dr.GetD3DDC();
+
+	{
+		DXGI_ADAPTER_DESC1 adapterDesc{};
+		dr.GetGraphicsAdapter()->GetDesc1(&adapterDesc);
+		result.adapter = StrUtils::UTF16ToUTF8(adapterDesc.Description);
+		result.isWarp = dr.IsWarp();
+	}
+
+	result.baseVideoMemory = GetVideoMemoryUsage();
+	result.peakVideoMemory = result.baseVideoMemory;
+
+	// 准备输入
+	std::unique_ptr<ReplayFrameSource> frameSource;
+	winrt::com_ptr<ID3D11Texture2D> input;
+	if (options.replayFile.empty()) {
+		input = CreateTestPattern(options.inputSize);
+		if (!input) {
+			Logger::Get().Error("创建输入纹理失败");
+			return false;
+		}
+	} else {
+		frameSource = std::make_unique<ReplayFrameSource>();
+		if (!frameSource->Initialize()) {
+			Logger::Get().Error("初始化 ReplayFrameSource 失败");
+			return false;
+		}
+
+		// 第一帧总是更新整个帧
+		if (frameSource->Update() != FrameSourceBase::UpdateState::NewFrame) {
+			Logger::Get().Error("读取第一帧失败");
+			return false;
+		}
+		input.copy_from(frameSource->GetOutput());
+	}
+
+	{
+		D3D11_TEXTURE2D_DESC inputDesc;
+		input->GetDesc(&inputDesc);
+		result.inputSize = { (LONG)inputDesc.Width, (LONG)inputDesc.Height };
+	}
+
+	// 编译并构建效果链
+	const uint32_t effectCount = (uint32_t)options.effects.size();
+	result.effects.resize(effectCount);
+
+	std::vector<EffectDrawer> effects(effectCount);
+	std::vector<std::string> passNames;
+	// 每个效果的第一个通道在 passNames 中的位置
+	std::vector<uint32_t> firstPassIndices(effectCount + 1);
+
+	ID3D11Texture2D* effectInput = input.get();
+	for (uint32_t i = 0; i < effectCount; ++i) {
+		const EffectOption& option = options.effects[i];
+		Benchmark::EffectResult& effectResult = result.effects[i];
+
+		EffectDesc desc;
+		if (!CompileEffect(option, options.disableEffectCache, desc, effectResult)) {
+			return false;
+		}
+		result.totalCompileTime += effectResult.compileTime;
+
+		if (!effects[i].Initialize(dr, desc, option, effectInput)) {
+			Logger::Get().Error(fmt::format("初始化效果#{} ({}) 失败", i, effectResult.name));
+			return false;
+		}
+		effectInput = effects[i].GetOutputTexture();
+
+		D3D11_TEXTURE2D_DESC outputDesc;
+		effectInput->GetDesc(&outputDesc);
+		effectResult.outputSize = { (LONG)outputDesc.Width, (LONG)outputDesc.Height };
+
+		firstPassIndices[i] = (uint32_t)passNames.size();
+		for (const EffectPassDesc& passDesc : effects[i].GetDesc().passes) {
+			effectResult.passes.emplace_back().desc = passDesc.desc;
+			passNames.push_back(passDesc.desc.empty() ? desc.name : StrUtils::Concat(desc.name, "/", passDesc.desc));
+		}
+	}
+	firstPassIndices[effectCount] = (uint32_t)passNames.size();
+	result.outputSize = result.effects.back().outputSize;
+
+	// 没有光标，帧数每帧递增
+	std::array<EffectHelper::Constant32, 12> dynamicConstants{};
+	dynamicConstants[0].intVal = INT_MAX;
+	dynamicConstants[1].intVal = INT_MAX;
+	dynamicConstants[2].intVal = INT_MAX;
+	dynamicConstants[3].intVal = INT_MAX;
+	dynamicConstants[6].uintVal = UINT_MAX;
+	dynamicConstants[7].uintVal = UINT_MAX;
+
+	winrt::com_ptr<ID3D11Buffer> dynamicCB;
+	{
+		D3D11_BUFFER_DESC bd{};
+		bd.Usage = D3D11_USAGE_DYNAMIC;
+		bd.ByteWidth = 4 * (UINT)dynamicConstants.size();
+		bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+		HRESULT hr = dr.GetD3DDevice()->CreateBuffer(&bd, nullptr, dynamicCB.put());
+		if (FAILED(hr)) {
+			Logger::Get().ComError("CreateBuffer 失败", hr);
+			return false;
+		}
+	}
+
+	// 统计每一帧的结果
+	const uint32_t passCount = (uint32_t)passNames.size();
+	std::vector<TimingStats> passStats;
+	passStats.reserve(passCount);
+	for (uint32_t i = 0; i < passCount; ++i) {
+		passStats.emplace_back(options.frameCount);
+	}
+	std::vector<TimingStats> effectStats;
+	effectStats.reserve(effectCount);
+	for (uint32_t i = 0; i < effectCount; ++i) {
+		effectStats.emplace_back(options.frameCount);
+	}
+	TimingStats gpuTimeStats(options.frameCount);
+	TimingStats frameTimeStats(options.frameCount);
+
+	GPUTimer gpuTimer;
+	gpuTimer.StartProfiling(std::chrono::microseconds(0), std::move(passNames), QUERY_DEPTH);
+	if (!gpuTimer.IsProfiling()) {
+		Logger::Get().Error("StartProfiling 失败");
+		return false;
+	}
+
+	// 结果按帧的顺序到达，最初的结果属于预热的帧
+	uint32_t skippedResultCount = 0;
+	gpuTimer.SetPassTimingsCallback([&](const SmallVectorImpl<float>& passTimings) {
+		if (skippedResultCount < options.warmupFrameCount) {
+			++skippedResultCount;
+			return;
+		}
+
+		float gpuTime = 0.0f;
+		for (uint32_t i = 0; i < effectCount; ++i) {
+			float effectTime = 0.0f;
+			for (uint32_t j = firstPassIndices[i]; j < firstPassIndices[i + 1]; ++j) {
+				passStats[j].AddSample(passTimings[j]);
+				effectTime += passTimings[j];
+			}
+
+			effectStats[i].AddSample(effectTime);
+			gpuTime += effectTime;
+		}
+
+		gpuTimeStats.AddSample(gpuTime);
+		++result.measuredFrameCount;
+	});
+
+	Logger::Get().Info(fmt::format("开始基准测试\n\t输入尺寸：{}x{}\n\t输出尺寸：{}x{}\n\t帧数：{}",
+		result.inputSize.cx, result.inputSize.cy, result.outputSize.cx, result.outputSize.cy, options.frameCount));
+
+	const uint32_t totalFrameCount = options.warmupFrameCount + options.frameCount;
+	auto lastFrameTime = std::chrono::steady_clock::now();
+	for (uint32_t frame = 0; frame < totalFrameCount; ++frame) {
+		gpuTimer.WaitForProfilingResults(MAX_PENDING_FRAMES);
+
+		const auto now = std::chrono::steady_clock::now();
+		if (frame > options.warmupFrameCount) {
+			frameTimeStats.AddSample(std::chrono::duration<float, std::milli>(now - lastFrameTime).count());
+		}
+		lastFrameTime = now;
+
+		if (frameSource && frame > 0) {
+			if (frameSource->Update() == FrameSourceBase::UpdateState::Error) {
+				Logger::Get().Error("读取录制文件失败");
+				return false;
+			}
+		}
+
+		gpuTimer.OnBeginFrame();
+
+		dynamicConstants[9].uintVal = frame;
+		D3D11_MAPPED_SUBRESOURCE ms;
+		HRESULT hr = d3dDC->Map(dynamicCB.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &ms);
+		if (FAILED(hr)) {
+			Logger::Get().ComError("Map 失败", hr);
+			return false;
+		}
+		std::memcpy(ms.pData, dynamicConstants.data(), dynamicConstants.size() * 4);
+		d3dDC->Unmap(dynamicCB.get(), 0);
+
+		{
+			ID3D11Buffer* t = dynamicCB.get();
+			d3dDC->CSSetConstantBuffers(0, 1, &t);
+		}
+
+		gpuTimer.OnBeginEffects();
+		UINT idx = 0;
+		for (EffectDrawer& effect : effects) {
+			effect.Draw(gpuTimer, idx);
+		}
+		gpuTimer.OnEndEffects();
+		// 基准测试不绘制覆盖层
+		gpuTimer.OnEndOverlay();
+
+		if (frame % VIDEO_MEMORY_SAMPLE_INTERVAL == 0) {
+			result.peakVideoMemory = std::max(result.peakVideoMemory, GetVideoMemoryUsage());
+		}
+	}
+
+	gpuTimer.WaitForProfilingResults();
+	result.peakVideoMemory = std::max(result.peakVideoMemory, GetVideoMemoryUsage());
+
+	for (uint32_t i = 0; i < effectCount; ++i) {
+		Benchmark::EffectResult& effectResult = result.effects[i];
+		effectResult.gpuTime = effectStats[i].GetDistribution();
+		for (uint32_t j = 0; j < effectResult.passes.size(); ++j) {
+			effectResult.passes[j].gpuTime = passStats[firstPassIndices[i] + j].GetDistribution();
+		}
+	}
+	result.gpuTime = gpuTimeStats.GetDistribution();
+	result.frameTime = frameTimeStats.GetDistribution();
+
+	d3dDC->ClearState();
+	return true;
+}
+
+bool Benchmark::Run(const Options& options, Result& result) {
+	if (options.effects.empty() || options.frameCount == 0) {
+		Logger::Get().Error("基准测试选项非法");
+		return false;
+	}
+
+	if (options.replayFile.empty() && (options.inputSize.cx <= 0 || options.inputSize.cy <= 0)) {
+		Logger::Get().Error("非法的输入尺寸");
+		return false;
+	}
+
+	if (options.outputSize.cx <= 0 || options.outputSize.cy <= 0) {
+		Logger::Get().Error("非法的输出尺寸");
+		return false;
+	}
+
+	MagOptions magOptions;
+	magOptions.effects = options.effects;
+	magOptions.graphicsCard = options.graphicsCard;
+	magOptions.captureMethod = CaptureMethod::Replay;
+	magOptions.replayFile = options.replayFile;
+	// 每帧都前进一帧，和录制时的帧率无关
+	magOptions.replayFrameRate = -1.0f;
+	magOptions.IsUseWarp(options.useWarp);
+	magOptions.IsDisableEffectCache(options.disableEffectCache);
+
+	MagApp& magApp = MagApp::Get();
+	if (!magApp.StartHeadless(std::move(magOptions), options.outputSize)) {
+		Logger::Get().Error("StartHeadless 失败");
+		return false;
+	}
+
+	result = {};
+	const bool success = RunBenchmark(options, result);
+
+	magApp.StopHeadless();
+
+	if (success) {
+		Logger::Get().Info(fmt::format("基准测试完成\n\t有效帧数：{}\n\tGPU 用时中位数：{} 毫秒\n\t编译总计用时：{} 毫秒",
+			result.measuredFrameCount, result.gpuTime.p50, result.totalCompileTime));
+	}
+	return success;
+}
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "MagOptions.h"
+
+namespace Magpie::Core {
+
+// 不创建窗口，在固定的输入上重复渲染效果链，统计每个通道和效果的 GPU 用时、编译用时和显存占用。
+// 用于在不同版本和机器之间比较性能，使用 WARP 时可在没有显卡的环境中运行
+class Benchmark {
+public:
+	struct Options {
+		std::vector<EffectOption> effects;
+		// 不为空时从录制文件读取输入，每帧前进一帧
+		std::wstring replayFile;
+		// 未指定录制文件时输入的尺寸，内容为固定的测试图案
+		SIZE inputSize{ 1280, 720 };
+		// 代替缩放窗口的尺寸，Fit 和 Fill 缩放以此为准
+		SIZE outputSize{ 3840, 2160 };
+		uint32_t frameCount = 500;
+		// 预热的帧数，不计入统计
+		uint32_t warmupFrameCount = 30;
+		int graphicsCard = -1;
+		bool useWarp = false;
+		bool disableEffectCache = false;
+	};
+
+	// 单位为 ms
+	struct Distribution {
+		float mean = 0.0f;
+		float p50 = 0.0f;
+		float p90 = 0.0f;
+		float p99 = 0.0f;
+		float max = 0.0f;
+	};
+
+	struct PassResult {
+		std::string desc;
+		Distribution gpuTime;
+	};
+
+	struct EffectResult {
+		std::string name;
+		SIZE outputSize{};
+		// 命中缓存时为读取缓存的用时，否则为编译的用时，单位为 ms
+		float compileTime = 0.0f;
+		bool isCacheHit = false;
+		Distribution gpuTime;
+		std::vector<PassResult> passes;
+	};
+
+	struct Result {
+		std::string adapter;
+		bool isWarp = false;
+		SIZE inputSize{};
+		SIZE outputSize{};
+		// 得到 GPU 用时的帧数，时间戳不可靠的帧被丢弃
+		uint32_t measuredFrameCount = 0;
+		// 依次编译所有效果的用时，单位为 ms
+		float totalCompileTime = 0.0f;
+		// 整个效果链每帧的 GPU 用时和 CPU 端的帧间隔
+		Distribution gpuTime;
+		Distribution frameTime;
+		// 进程的显存占用在构建效果链前的值和运行期间的峰值，单位为字节。两者之差即效果链的纹理、
+		// 着色器和常量缓冲区占用的显存
+		uint64_t baseVideoMemory = 0;
+		uint64_t peakVideoMemory = 0;
+		std::vector<EffectResult> effects;
+	};
+
+	// 在调用线程上同步运行，期间 MagApp 处于无窗口状态
+	static bool Run(const Options& options, Result& result);
+};
+
+}
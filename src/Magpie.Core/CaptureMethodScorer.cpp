@@ -0,0 +1,72 @@
+#include "pch.h"
+#include "CaptureMethodScorer.h"
+#include <cfloat>
+
+namespace Magpie::Core {
+
+// 帧间隔的抖动折算为开销时的权重，帧到达不均匀会造成卡顿，但不直接占用渲染时间
+static constexpr float JITTER_WEIGHT = 0.5f;
+// 分数不超过最低分的这个倍数加上 TIE_MARGIN 时视为相近，此时选择优先级更高的。
+// 试用的帧数很少，测量误差不可忽略
+static constexpr float TIE_RATIO = 1.1f;
+static constexpr float TIE_MARGIN = 0.05f;
+
+// 会改变 values 中元素的顺序
+static float Median(std::vector<float>& values) noexcept {
+	if (values.empty()) {
+		return 0.0f;
+	}
+
+	const auto mid = values.begin() + values.size() / 2;
+	std::nth_element(values.begin(), mid, values.end());
+	return *mid;
+}
+
+float CaptureMethodScorer::Score(const ProbeResult& result) noexcept {
+	if (result.failed || result.acquireTimes.empty()) {
+		return FLT_MAX;
+	}
+
+	// 使用中位数，试用期间偶尔的停顿不应影响结果
+	std::vector<float> values = result.acquireTimes;
+	float score = Median(values);
+
+	values = result.copyTimes;
+	score += Median(values);
+
+	// 抖动为帧间隔偏离中位数的中位数，窗口内容静止时帧间隔太少，无法衡量
+	if (result.frameIntervals.size() >= 2) {
+		values = result.frameIntervals;
+		const float medianInterval = Median(values);
+		for (float& value : values) {
+			value = std::abs(value - medianInterval);
+		}
+		score += Median(values) * JITTER_WEIGHT;
+	}
+
+	return score;
+}
+
+int CaptureMethodScorer::Pick(std::span<const ProbeResult> results) noexcept {
+	std::vector<float> scores(results.size());
+	float minScore = FLT_MAX;
+	for (size_t i = 0; i < results.size(); ++i) {
+		scores[i] = Score(results[i]);
+		minScore = std::min(minScore, scores[i]);
+	}
+
+	if (minScore == FLT_MAX) {
+		return -1;
+	}
+
+	const float threshold = minScore * TIE_RATIO + TIE_MARGIN;
+	for (size_t i = 0; i < results.size(); ++i) {
+		if (scores[i] <= threshold) {
+			return (int)i;
+		}
+	}
+
+	return -1;
+}
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "MagOptions.h"
+
+namespace Magpie::Core {
+
+// 根据试用各捕获模式时测得的数据为它们打分并选出开销最小的
+// 只进行计算，不依赖 D3D 和帧源，时间的单位均为 ms
+class CaptureMethodScorer {
+public:
+	struct ProbeResult {
+		CaptureMethod method = CaptureMethod::GraphicsCapture;
+		// 初始化或 Update 失败
+		bool failed = false;
+		// 每次取得新帧时 Update 的 CPU 用时
+		std::vector<float> acquireTimes;
+		// 每次取得新帧时复制的 GPU 用时，无法测量时为空
+		std::vector<float> copyTimes;
+		// 相邻新帧的捕获间隔
+		std::vector<float> frameIntervals;
+	};
+
+	// 分数越低越好，不可用时为 FLT_MAX
+	static float Score(const ProbeResult& result) noexcept;
+
+	// results 应按优先级从高到低排列，分数相近时选择靠前的。返回选中的索引，都不可用时返回 -1
+	static int Pick(std::span<const ProbeResult> results) noexcept;
+};
+
+}
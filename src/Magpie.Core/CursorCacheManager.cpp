@@ -0,0 +1,161 @@
+#include "pch.h"
+#include "CursorCacheManager.h"
+#include "YasHelper.h"
+#include "Logger.h"
+#include "Win32Utils.h"
+#include "CommonSharedConstants.h"
+#include "StrUtils.h"
+
+namespace Magpie::Core {
+
+template<typename Archive>
+void serialize(Archive& ar, CursorBitmap& o) {
+	ar& o.type& o.width& o.height& o.pixels;
+}
+
+// 缓存版本
+// 当缓存文件结构或光标的转换方式有更改时更新它，使旧缓存失效
+static constexpr const uint32_t CURSORS_CACHE_VERSION = 1;
+
+// 内存和磁盘上只保留最近使用的光标
+static constexpr const size_t MAX_CACHE_COUNT = 128;
+
+static std::wstring GetCacheFileName() noexcept {
+	return StrUtils::Concat(CommonSharedConstants::CACHE_DIR, L"cursors");
+}
+
+void CursorCacheManager::Load() noexcept {
+	if (_isLoaded) {
+		return;
+	}
+	_isLoaded = true;
+
+	std::wstring cacheFileName = GetCacheFileName();
+	if (!Win32Utils::FileExists(cacheFileName.c_str())) {
+		return;
+	}
+
+	std::vector<BYTE> buf;
+	if (!Win32Utils::ReadFile(cacheFileName.c_str(), buf) || buf.empty()) {
+		return;
+	}
+
+	std::vector<std::pair<uint64_t, CursorBitmap>> items;
+	try {
+		yas::mem_istream mi(buf.data(), buf.size());
+		yas::binary_iarchive<yas::mem_istream, yas::binary> ia(mi);
+
+		uint32_t cacheVersion;
+		ia& cacheVersion;
+		if (cacheVersion != CURSORS_CACHE_VERSION) {
+			Logger::Get().Info("光标缓存版本不匹配");
+			return;
+		}
+
+		uint32_t count = 0;
+		ia& count;
+		items.resize(count);
+		for (auto& [hash, bitmap] : items) {
+			ia& hash& bitmap;
+		}
+	} catch (...) {
+		Logger::Get().Error("反序列化光标缓存失败");
+		return;
+	}
+
+	// 文件中按最近使用的时间升序排列
+	for (auto& [hash, bitmap] : items) {
+		if ((size_t)bitmap.width * bitmap.height * 4 != bitmap.pixels.size()) {
+			continue;
+		}
+
+		// 本次运行中已转换的光标优先
+		auto [it, inserted] = _cache.try_emplace(hash);
+		if (inserted) {
+			it->second.bitmap = std::move(bitmap);
+			it->second.lastAccess = ++_lastAccess;
+		}
+	}
+
+	Logger::Get().Info(fmt::format("已读取 {} 个缓存的光标", items.size()));
+}
+
+void CursorCacheManager::Save() noexcept {
+	if (!_isDirty) {
+		return;
+	}
+	_isDirty = false;
+
+	std::vector<std::pair<uint64_t, const _CacheItem*>> sortedItems;
+	sortedItems.reserve(_cache.size());
+	for (const auto& [hash, item] : _cache) {
+		sortedItems.emplace_back(hash, &item);
+	}
+	std::sort(sortedItems.begin(), sortedItems.end(), [](const auto& l, const auto& r) {
+		return l.second->lastAccess < r.second->lastAccess;
+	});
+
+	std::vector<BYTE> buf;
+	buf.reserve(65536);
+
+	try {
+		yas::vector_ostream os(buf);
+		yas::binary_oarchive<yas::vector_ostream<BYTE>, yas::binary> oa(os);
+
+		oa& CURSORS_CACHE_VERSION;
+
+		const uint32_t count = (uint32_t)sortedItems.size();
+		oa& count;
+		for (const auto& [hash, item] : sortedItems) {
+			oa& hash& item->bitmap;
+		}
+	} catch (...) {
+		Logger::Get().Error("序列化光标缓存失败");
+		return;
+	}
+
+	if (!Win32Utils::DirExists(CommonSharedConstants::CACHE_DIR)) {
+		if (!CreateDirectory(CommonSharedConstants::CACHE_DIR, nullptr)) {
+			Logger::Get().Win32Error("创建 cache 文件夹失败");
+			return;
+		}
+	}
+
+	std::wstring cacheFileName = GetCacheFileName();
+	if (!Win32Utils::WriteFile(cacheFileName.c_str(), buf.data(), buf.size())) {
+		Logger::Get().Error("保存光标缓存失败");
+	}
+}
+
+const CursorBitmap* CursorCacheManager::Find(uint64_t hash) noexcept {
+	auto it = _cache.find(hash);
+	if (it == _cache.end()) {
+		return nullptr;
+	}
+
+	// 已是最近使用的光标时顺序不变，无需重新写入
+	if (it->second.lastAccess != _lastAccess) {
+		it->second.lastAccess = ++_lastAccess;
+		_isDirty = true;
+	}
+	return &it->second.bitmap;
+}
+
+const CursorBitmap* CursorCacheManager::Add(uint64_t hash, CursorBitmap&& bitmap) noexcept {
+	auto [it, inserted] = _cache.try_emplace(hash);
+	it->second.bitmap = std::move(bitmap);
+	it->second.lastAccess = ++_lastAccess;
+	_isDirty = true;
+
+	if (inserted && _cache.size() > MAX_CACHE_COUNT) {
+		// 新加入的光标是最近使用的，不会被移除
+		auto oldest = std::min_element(_cache.begin(), _cache.end(), [](const auto& l, const auto& r) {
+			return l.second.lastAccess < r.second.lastAccess;
+		});
+		_cache.erase(oldest);
+	}
+
+	return &it->second.bitmap;
+}
+
+}
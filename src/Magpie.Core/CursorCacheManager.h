@@ -0,0 +1,53 @@
+#pragma once
+#include <parallel_hashmap/phmap.h>
+
+namespace Magpie::Core {
+
+// 转换后的光标位图，格式为 R8G8B8A8_UNORM，含义见 CursorManager::CursorType
+struct CursorBitmap {
+	uint8_t type = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<BYTE> pixels;
+};
+
+// 以光标原始位图的哈希为键缓存转换后的位图，避免每次缩放都重新转换
+class CursorCacheManager {
+public:
+	static CursorCacheManager& Get() noexcept {
+		static CursorCacheManager instance;
+		return instance;
+	}
+
+	CursorCacheManager(const CursorCacheManager&) = delete;
+	CursorCacheManager(CursorCacheManager&&) = delete;
+
+	// 从磁盘读取缓存，只在首次调用时读取
+	void Load() noexcept;
+
+	// 缓存有变化时写入磁盘
+	void Save() noexcept;
+
+	// 返回的指针在下一次调用 Add 前有效
+	const CursorBitmap* Find(uint64_t hash) noexcept;
+
+	// 缓存已满时移除最久未使用的光标
+	const CursorBitmap* Add(uint64_t hash, CursorBitmap&& bitmap) noexcept;
+
+private:
+	CursorCacheManager() = default;
+
+	struct _CacheItem {
+		CursorBitmap bitmap;
+		uint32_t lastAccess = 0;
+	};
+
+	// Find 返回的指针需要稳定。不超过 MAX_CACHE_COUNT 项，因此全部写入磁盘
+	phmap::node_hash_map<uint64_t, _CacheItem> _cache;
+	uint32_t _lastAccess = 0;
+
+	bool _isLoaded = false;
+	bool _isDirty = false;
+};
+
+}
@@ -9,6 +9,8 @@
 #include "GraphicsCaptureFrameSource.h"
 #include "WindowHelper.h"
 #include "Utils.h"
+#include "CursorCacheManager.h"
+#include "PixelUtils.h"
 #include <magnification.h>
 
 #pragma comment(lib, "Magnification.lib")
@@ -16,6 +18,10 @@
 
 namespace Magpie::Core {
 
+// 光标图集的初始尺寸，容纳常见的光标绰绰有余
+static constexpr LONG INITIAL_ATLAS_SIZE = 256;
+static constexpr LONG MAX_ATLAS_SIZE = 2048;
+
 // 将源窗口的光标位置映射到缩放后的光标位置
 // 当光标位于源窗口之外，与源窗口的距离不会缩放
 static POINT SrcToHost(POINT pt, bool screenCoord) {
@@ -102,6 +108,8 @@ CursorManager::~CursorManager() {
 	}
 
 	MagApp::Get().UnregisterWndProcHandler(_handlerId);
+
+	CursorCacheManager::Get().Save();
 }
 
 static std::optional<LRESULT> HostWndProc(HWND /*hWnd*/, UINT message, WPARAM /*wParam*/, LPARAM /*lParam*/) {
@@ -165,6 +173,16 @@ bool CursorManager::Initialize() {
 		_StartCapture(cursorPos);
 	}
 
+	if (MagApp::Get().GetOptions().IsDrawCursor()) {
+		CursorCacheManager::Get().Load();
+
+		// 预先创建图集，切换光标时无需创建纹理
+		if (!_CreateAtlas({ INITIAL_ATLAS_SIZE, INITIAL_ATLAS_SIZE })) {
+			Logger::Get().Error("创建光标图集失败");
+			return false;
+		}
+	}
+
 	Logger::Get().Info("CursorManager 初始化完成");
 	return true;
 }
@@ -233,6 +251,9 @@ static HWND WindowFromPoint(POINT pt, bool clickThroughHost) {
 }
 
 void CursorManager::OnBeginFrame() {
+	_lastCursor = _curCursor;
+	_lastCursorPos = _curCursorPos;
+
 	_UpdateCursorClip();
 
 	if (!MagApp::Get().GetOptions().IsDrawCursor() || !_isShowCursor || !_isUnderCapture) {
@@ -271,23 +292,34 @@ void CursorManager::OnBeginFrame() {
 	_curCursor = ci.hCursor;
 }
 
-bool CursorManager::GetCursorTexture(ID3D11Texture2D** texture, CursorManager::CursorType& cursorType) {
-	if (_curCursorInfo->texture) {
-		*texture = _curCursorInfo->texture.get();
-		cursorType = _curCursorInfo->type;
-		return true;
+bool CursorManager::GetCursorTexture(ID3D11Texture2D** texture, CursorManager::CursorType& cursorType, RECT& rect) {
+	// 不在图集中的光标需要转换结果，它可能已被移出 CursorCacheManager，这时重新转换
+	if (_curCursorInfo->isTextureResolved && !_atlasSlots.contains(_curCursorInfo->hash)
+		&& !CursorCacheManager::Get().Find(_curCursorInfo->hash)) {
+		_curCursorInfo->isTextureResolved = false;
 	}
 
-	if (!_ResolveCursor(_curCursor, true)) {
-		return false;
-	} else {
+	if (!_curCursorInfo->isTextureResolved) {
+		if (!_ResolveCursor(_curCursor, true)) {
+			return false;
+		}
+
 		const char* cursorTypes[] = { "Color", "Masked Color", "Monochrome" };
 		Logger::Get().Info(fmt::format("已解析光标：{}\n\t类型：{}",
 			(void*)_curCursor, cursorTypes[(int)_curCursorInfo->type]));
 	}
 
-	*texture = _curCursorInfo->texture.get();
+	POINT pos;
+	if (auto it = _atlasSlots.find(_curCursorInfo->hash); it != _atlasSlots.end()) {
+		pos = it->second;
+	} else if (!_AddToAtlas(_curCursorInfo->hash, pos)) {
+		Logger::Get().Error("将光标添加到图集失败");
+		return false;
+	}
+
+	*texture = _atlas.get();
 	cursorType = _curCursorInfo->type;
+	rect = { pos.x, pos.y, pos.x + _curCursorInfo->size.cx, pos.y + _curCursorInfo->size.cy };
 	return true;
 }
 
@@ -453,9 +485,54 @@ void CursorManager::_StopCapture(POINT cursorPos, bool onDestroy) {
 	}
 }
 
+// bits 依次为掩码和颜色位图，单色光标没有颜色位图。转换后的格式见 CursorManager::CursorType
+static CursorBitmap ConvertCursorBitmap(std::vector<BYTE>& bits, SIZE size, bool isMonochrome) {
+	CursorBitmap result;
+	result.width = size.cx;
+	result.height = size.cy;
+
+	const size_t pixelCount = (size_t)size.cx * size.cy;
+	const size_t bitmapSize = pixelCount * 4;
+
+	if (isMonochrome) {
+		// 单色光标
+		result.type = (uint8_t)CursorManager::CursorType::Monochrome;
+
+		// 红色通道是 AND 掩码，绿色通道是 XOR 掩码
+		// 这里将下半部分的 XOR 掩码复制到上半部分的绿色通道中
+		uint32_t* pixels = (uint32_t*)bits.data();
+		PixelUtils::CopyMaskToChannel(pixels, pixels + pixelCount, pixelCount, 1);
+
+		result.pixels.assign(bits.begin(), bits.begin() + bitmapSize);
+		return result;
+	}
+
+	const uint32_t* maskPixels = (const uint32_t*)bits.data();
+	result.pixels.assign(bits.begin() + bitmapSize, bits.end());
+	uint32_t* pixels = (uint32_t*)result.pixels.data();
+
+	// 若颜色掩码有 A 通道，则是彩色光标，否则是彩色掩码光标
+	if (PixelUtils::HasAlpha(pixels, pixelCount)) {
+		// 彩色光标
+		result.type = (uint8_t)CursorManager::CursorType::Color;
+
+		// 预乘 Alpha 通道
+		PixelUtils::PremultiplyAlpha(pixels, pixelCount, true, true);
+	} else {
+		// 彩色掩码光标
+		result.type = (uint8_t)CursorManager::CursorType::MaskedColor;
+
+		// 将 XOR 掩码复制到透明通道中
+		PixelUtils::SwapRB(pixels, pixelCount);
+		PixelUtils::CopyMaskToChannel(pixels, maskPixels, pixelCount, 3);
+	}
+
+	return result;
+}
+
 bool CursorManager::_ResolveCursor(HCURSOR hCursor, bool resolveTexture) {
 	auto it = _cursorInfos.find(hCursor);
-	if (it != _cursorInfos.end() && (!resolveTexture || (resolveTexture && _curCursorInfo->texture))) {
+	if (it != _cursorInfos.end() && (!resolveTexture || it->second.isTextureResolved)) {
 		_curCursorInfo = &it->second;
 		return true;
 	}
@@ -489,8 +566,6 @@ bool CursorManager::_ResolveCursor(HCURSOR hCursor, bool resolveTexture) {
 		return true;
 	}
 
-	auto& dr = MagApp::Get().GetDeviceResources();
-
 	BITMAPINFO bi{};
 	bi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
 	bi.bmiHeader.biWidth = bmp.bmWidth;
@@ -500,123 +575,135 @@ bool CursorManager::_ResolveCursor(HCURSOR hCursor, bool resolveTexture) {
 	bi.bmiHeader.biBitCount = 32;
 	bi.bmiHeader.biSizeImage = bmp.bmWidth * bmp.bmHeight * 4;
 
-	if (ii.hbmColor == NULL) {
-		// 单色光标
-		_curCursorInfo->type = CursorType::Monochrome;
+	const bool isMonochrome = ii.hbmColor == NULL;
 
-		std::unique_ptr<BYTE[]> pixels(new BYTE[bi.bmiHeader.biSizeImage]);
+	// 依次为掩码和颜色位图
+	std::vector<BYTE> bits(isMonochrome ? bi.bmiHeader.biSizeImage : bi.bmiHeader.biSizeImage * 2);
+	{
 		HDC hdc = GetDC(NULL);
-		if (GetDIBits(hdc, ii.hbmMask, 0, bmp.bmHeight, pixels.get(), &bi, DIB_RGB_COLORS) != bmp.bmHeight) {
-			Logger::Get().Win32Error("GetDIBits 失败");
+		Utils::ScopeExit se1([hdc]() {
 			ReleaseDC(NULL, hdc);
-			return false;
-		}
-		ReleaseDC(NULL, hdc);
+		});
 
-		// 红色通道是 AND 掩码，绿色通道是 XOR 掩码
-		// 这里将下半部分的 XOR 掩码复制到上半部分的绿色通道中
-		const int halfSize = bi.bmiHeader.biSizeImage / 8;
-		BYTE* upPtr = &pixels[1];
-		BYTE* downPtr = &pixels[static_cast<size_t>(halfSize) * 4];
-		for (int i = 0; i < halfSize; ++i) {
-			*upPtr = *downPtr;
-
-			upPtr += 4;
-			downPtr += 4;
+		if (GetDIBits(hdc, ii.hbmMask, 0, bmp.bmHeight, bits.data(), &bi, DIB_RGB_COLORS) != bmp.bmHeight) {
+			Logger::Get().Win32Error("GetDIBits 失败");
+			return false;
 		}
 
-		D3D11_SUBRESOURCE_DATA initData{};
-		initData.pSysMem = pixels.get();
-		initData.SysMemPitch = bmp.bmWidth * 4;
-
-		_curCursorInfo->texture = dr.CreateTexture2D(
-			DXGI_FORMAT_R8G8B8A8_UNORM,
-			bmp.bmWidth,
-			bmp.bmHeight / 2,
-			D3D11_BIND_SHADER_RESOURCE,
-			D3D11_USAGE_IMMUTABLE,
-			0,
-			&initData
-		);
-		if (!_curCursorInfo->texture) {
-			Logger::Get().Error("创建纹理失败");
+		if (!isMonochrome && GetDIBits(hdc, ii.hbmColor, 0, bmp.bmHeight,
+			bits.data() + bi.bmiHeader.biSizeImage, &bi, DIB_RGB_COLORS) != bmp.bmHeight) {
+			Logger::Get().Win32Error("GetDIBits 失败");
 			return false;
 		}
+	}
 
-		return true;
+	// 不同的句柄可能有相同的内容，如动画光标的帧或应用重新加载的光标，它们共用转换结果和图集中的位置
+	const uint64_t hash = Utils::HashData(bits);
+
+	CursorCacheManager& cacheManager = CursorCacheManager::Get();
+	const CursorBitmap* bitmap = cacheManager.Find(hash);
+	if (!bitmap || bitmap->width != (uint32_t)_curCursorInfo->size.cx || bitmap->height != (uint32_t)_curCursorInfo->size.cy) {
+		bitmap = cacheManager.Add(hash, ConvertCursorBitmap(bits, _curCursorInfo->size, isMonochrome));
 	}
 
-	std::unique_ptr<BYTE[]> pixels(new BYTE[bi.bmiHeader.biSizeImage]);
-	HDC hdc = GetDC(NULL);
-	if (GetDIBits(hdc, ii.hbmColor, 0, bmp.bmHeight, pixels.get(), &bi, DIB_RGB_COLORS) != bmp.bmHeight) {
-		Logger::Get().Win32Error("GetDIBits 失败");
-		ReleaseDC(NULL, hdc);
+	_curCursorInfo->hash = hash;
+	_curCursorInfo->type = (CursorType)bitmap->type;
+	_curCursorInfo->isTextureResolved = true;
+	return true;
+}
+
+bool CursorManager::_CreateAtlas(SIZE size) {
+	auto& dr = MagApp::Get().GetDeviceResources();
+
+	winrt::com_ptr<ID3D11Texture2D> atlas = dr.CreateTexture2D(
+		GPUMemoryOwner::Cursor,
+		DXGI_FORMAT_R8G8B8A8_UNORM,
+		size.cx,
+		size.cy,
+		D3D11_BIND_SHADER_RESOURCE
+	);
+	if (!atlas) {
+		Logger::Get().Error("创建纹理失败");
 		return false;
 	}
-	ReleaseDC(NULL, hdc);
 
-	// 若颜色掩码有 A 通道，则是彩色光标，否则是彩色掩码光标
-	bool hasAlpha = false;
-	for (UINT i = 3; i < bi.bmiHeader.biSizeImage; i += 4) {
-		if (pixels[i] != 0) {
-			hasAlpha = true;
-			break;
-		}
+	if (_atlas) {
+		// 扩大图集时保留已有的光标
+		D3D11_BOX box = { 0, 0, 0, (UINT)_atlasSize.cx, (UINT)_atlasSize.cy, 1 };
+		dr.GetD3DDC()->CopySubresourceRegion(atlas.get(), 0, 0, 0, 0, _atlas.get(), 0, &box);
+
+		Logger::Get().Info(fmt::format("光标图集已扩大到 {}x{}", size.cx, size.cy));
 	}
 
-	if (hasAlpha) {
-		// 彩色光标
-		_curCursorInfo->type = CursorType::Color;
+	_atlas = std::move(atlas);
+	_atlasSize = size;
+	return true;
+}
 
-		for (size_t i = 0; i < bi.bmiHeader.biSizeImage; i += 4) {
-			// 预乘 Alpha 通道
-			double alpha = pixels[i + 3] / 255.0f;
+bool CursorManager::_AddToAtlas(uint64_t hash, POINT& pos) {
+	const CursorBitmap* bitmap = CursorCacheManager::Get().Find(hash);
+	if (!bitmap) {
+		return false;
+	}
 
-			BYTE b = (BYTE)std::lround(pixels[i] * alpha);
-			pixels[i] = (BYTE)std::lround(pixels[i + 2] * alpha);
-			pixels[i + 1] = (BYTE)std::lround(pixels[i + 1] * alpha);
-			pixels[i + 2] = b;
+	const UINT width = bitmap->width;
+	const UINT height = bitmap->height;
 
-			pixels[i + 3] = 255 - pixels[i + 3];
-		}
-	} else {
-		// 彩色掩码光标
-		_curCursorInfo->type = CursorType::MaskedColor;
+	// 包含边框
+	const SIZE slotSize = { (LONG)width + 2, (LONG)height + 2 };
+	if (slotSize.cx > MAX_ATLAS_SIZE || slotSize.cy > MAX_ATLAS_SIZE) {
+		Logger::Get().Error(fmt::format("光标尺寸过大：{}x{}", width, height));
+		return false;
+	}
 
-		std::unique_ptr<BYTE[]> maskPixels(new BYTE[bi.bmiHeader.biSizeImage]);
-		hdc = GetDC(NULL);
-		if (GetDIBits(hdc, ii.hbmMask, 0, bmp.bmHeight, maskPixels.get(), &bi, DIB_RGB_COLORS) != bmp.bmHeight) {
-			Logger::Get().Win32Error("GetDIBits 失败");
-			ReleaseDC(NULL, hdc);
-			return false;
-		}
-		ReleaseDC(NULL, hdc);
+	// 当前货架放不下则换到下一个货架
+	if (_shelfPos.x + slotSize.cx > _atlasSize.cx) {
+		_shelfPos = { 0, _shelfPos.y + _shelfHeight };
+		_shelfHeight = 0;
+	}
 
-		// 将 XOR 掩码复制到透明通道中
-		for (size_t i = 0; i < bi.bmiHeader.biSizeImage; i += 4) {
-			std::swap(pixels[i], pixels[i + 2]);
-			pixels[i + 3] = maskPixels[i];
+	while (_shelfPos.y + slotSize.cy > _atlasSize.cy) {
+		if (_atlasSize.cx < MAX_ATLAS_SIZE) {
+			if (!_CreateAtlas({ _atlasSize.cx * 2, _atlasSize.cy * 2 })) {
+				return false;
+			}
+		} else {
+			// 图集已满则清空，其他光标再次使用时重新添加
+			Logger::Get().Info("光标图集已满，将清空");
+			_atlasSlots.clear();
+			_shelfPos = {};
+			_shelfHeight = 0;
 		}
 	}
 
-	D3D11_SUBRESOURCE_DATA initData{};
-	initData.pSysMem = &pixels[0];
-	initData.SysMemPitch = bmp.bmWidth * 4;
+	pos = { _shelfPos.x + 1, _shelfPos.y + 1 };
+	_shelfPos.x += slotSize.cx;
+	_shelfHeight = std::max(_shelfHeight, slotSize.cy);
 
-	_curCursorInfo->texture = dr.CreateTexture2D(
-		DXGI_FORMAT_R8G8B8A8_UNORM,
-		bmp.bmWidth,
-		bmp.bmHeight,
-		D3D11_BIND_SHADER_RESOURCE,
-		D3D11_USAGE_IMMUTABLE,
-		0,
-		&initData
-	);
-	if (!_curCursorInfo->texture) {
-		Logger::Get().Error("创建纹理失败");
-		return false;
+	// 边框复制边缘的像素，和 CLAMP 寻址的效果相同，双线性插值时不会采样到相邻的光标
+	std::vector<uint32_t> pixels((size_t)slotSize.cx * slotSize.cy);
+	const uint32_t* srcPixels = (const uint32_t*)bitmap->pixels.data();
+	for (UINT y = 0; y < (UINT)slotSize.cy; ++y) {
+		const uint32_t* srcRow = srcPixels + (size_t)(std::clamp(y, 1u, height) - 1) * width;
+		uint32_t* dstRow = pixels.data() + (size_t)y * slotSize.cx;
+
+		dstRow[0] = srcRow[0];
+		std::memcpy(dstRow + 1, srcRow, width * 4);
+		dstRow[width + 1] = srcRow[width - 1];
 	}
 
+	D3D11_BOX box = {
+		UINT(pos.x - 1),
+		UINT(pos.y - 1),
+		0,
+		UINT(pos.x - 1 + slotSize.cx),
+		UINT(pos.y - 1 + slotSize.cy),
+		1
+	};
+	MagApp::Get().GetDeviceResources().GetD3DDC()->UpdateSubresource(
+		_atlas.get(), 0, &box, pixels.data(), slotSize.cx * 4, 0);
+
+	_atlasSlots.emplace(hash, pos);
 	return true;
 }
 
@@ -31,6 +31,12 @@ public:
 		return _curCursor ? _curCursorInfo : nullptr;
 	}
 
+	// 光标的形状、位置或可见性和上一帧相比是否有变化
+	bool IsCursorChanged() const noexcept {
+		return _curCursor != _lastCursor || (_curCursor && (_curCursorPos.x != _lastCursorPos.x
+			|| _curCursorPos.y != _lastCursorPos.y));
+	}
+
 	enum class CursorType {
 		// 彩色光标，此时纹理中 RGB 通道已预乘 A 通道（premultiplied alpha），A 通道已预先取反
 		// 这是为了减少着色器的计算量以及确保（可能进行的）双线性差值的准确性
@@ -43,7 +49,8 @@ public:
 		// RG 通道的值只能是 0 或 255
 		Monochrome
 	};
-	bool GetCursorTexture(ID3D11Texture2D** texture, CursorManager::CursorType& cursorType);
+	// 所有光标共用一个图集，rect 为当前光标在图集中的位置
+	bool GetCursorTexture(ID3D11Texture2D** texture, CursorManager::CursorType& cursorType, RECT& rect);
 
 	void OnCursorCapturedOnOverlay();
 
@@ -76,6 +83,10 @@ private:
 
 	bool _ResolveCursor(HCURSOR hCursor, bool resolveTexture);
 
+	bool _CreateAtlas(SIZE size);
+
+	bool _AddToAtlas(uint64_t hash, POINT& pos);
+
 	void _AdjustCursorSpeed();
 
 	void _UpdateCursorClip();
@@ -94,14 +105,28 @@ private:
 	// 当前帧的光标，光标不可见则为 NULL
 	HCURSOR _curCursor = NULL;
 	POINT _curCursorPos{};
+	// 上一帧的光标，用于检测变化
+	HCURSOR _lastCursor = NULL;
+	POINT _lastCursorPos{};
 
 	struct _CursorInfo : CursorInfo {
-		winrt::com_ptr<ID3D11Texture2D> texture = nullptr;
+		// 原始位图的哈希，用于在图集和 CursorCacheManager 中查找
+		uint64_t hash = 0;
 		CursorType type = CursorType::Color;
+		bool isTextureResolved = false;
 	};
 	_CursorInfo* _curCursorInfo = nullptr;
 
 	phmap::flat_hash_map<HCURSOR, _CursorInfo> _cursorInfos;
+
+	// 光标图集，使用货架算法分配空间，每个光标周围有一像素的边框
+	winrt::com_ptr<ID3D11Texture2D> _atlas;
+	SIZE _atlasSize{};
+	// 当前货架的左上角和高度
+	POINT _shelfPos{};
+	LONG _shelfHeight = 0;
+	// 哈希 -> 光标在图集中的位置（不含边框）
+	phmap::flat_hash_map<uint64_t, POINT> _atlasSlots;
 };
 
 }
@@ -5,6 +5,7 @@
 #include "Logger.h"
 #include "Win32Utils.h"
 #include "SmallVector.h"
+#include "RectHelper.h"
 
 
 namespace Magpie::Core {
@@ -71,6 +72,10 @@ static winrt::com_ptr<IDXGIOutput1> GetDXGIOutput(HMONITOR hMonitor) {
 DesktopDuplicationFrameSource::~DesktopDuplicationFrameSource() {
 	_exiting.store(true, std::memory_order_release);
 	WaitForSingleObject(_hDDPThread, 1000);
+
+	if (_curSharedTexture) {
+		_curSharedTexture->mutex->ReleaseSync(0);
+	}
 }
 
 bool DesktopDuplicationFrameSource::Initialize() {
@@ -112,7 +117,9 @@ bool DesktopDuplicationFrameSource::Initialize() {
 
 	auto& dr = MagApp::Get().GetDeviceResources();
 
+	// 第一帧到达前作为占位
 	_output = dr.CreateTexture2D(
+		GPUMemoryOwner::FrameSource,
 		DXGI_FORMAT_B8G8R8A8_UNORM,
 		_srcFrameRect.right - _srcFrameRect.left,
 		_srcFrameRect.bottom - _srcFrameRect.top,
@@ -123,41 +130,13 @@ bool DesktopDuplicationFrameSource::Initialize() {
 		return false;
 	}
 
-	// 创建共享纹理
-	_sharedTex = dr.CreateTexture2D(
-		DXGI_FORMAT_B8G8R8A8_UNORM,
-		_srcFrameRect.right - _srcFrameRect.left,
-		_srcFrameRect.bottom - _srcFrameRect.top,
-		D3D11_BIND_SHADER_RESOURCE,
-		D3D11_USAGE_DEFAULT,
-		D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX
-	);
-	if (!_sharedTex) {
-		Logger::Get().Error("创建 Texture2D 失败");
-		return false;
-	}
-
-	_sharedTexMutex = _sharedTex.try_as<IDXGIKeyedMutex>();
-	if (!_sharedTexMutex) {
-		Logger::Get().Error("检索 IDXGIKeyedMutex 失败");
-		return false;
-	}
-
-	winrt::com_ptr<IDXGIResource> sharedDxgiRes = _sharedTex.try_as<IDXGIResource>();
-	if (!sharedDxgiRes) {
-		Logger::Get().Error("检索 IDXGIResource 失败");
-		return false;
-	}
-
-	HANDLE hSharedTex = NULL;
-	HRESULT hr = sharedDxgiRes->GetSharedHandle(&hSharedTex);
-	if (FAILED(hr)) {
-		Logger::Get().Error("GetSharedHandle 失败");
+	if (!_InitializeDdpD3D()) {
+		Logger::Get().Error("初始化 D3D 失败");
 		return false;
 	}
 
-	if (!_InitializeDdpD3D(hSharedTex)) {
-		Logger::Get().Error("初始化 D3D 失败");
+	if (!_CreateSharedTextures()) {
+		Logger::Get().Error("_CreateSharedTextures 失败");
 		return false;
 	}
 
@@ -167,7 +146,7 @@ bool DesktopDuplicationFrameSource::Initialize() {
 		return false;
 	}
 
-	hr = output->DuplicateOutput(_ddpD3dDevice.get(), _outputDup.put());
+	HRESULT hr = output->DuplicateOutput(_ddpD3dDevice.get(), _outputDup.put());
 	if (FAILED(hr)) {
 		Logger::Get().ComError("DuplicateOutput 失败", hr);
 		return false;
@@ -197,6 +176,7 @@ bool DesktopDuplicationFrameSource::Initialize() {
 	}
 
 
+	_hwndHost = MagApp::Get().GetHwndHost();
 	_hDDPThread = CreateThread(nullptr, 0, _DDPThreadProc, this, 0, nullptr);
 	if (!_hDDPThread) {
 		return false;
@@ -208,36 +188,33 @@ bool DesktopDuplicationFrameSource::Initialize() {
 
 
 FrameSourceBase::UpdateState DesktopDuplicationFrameSource::Update() {
-	const UINT newFrameState = _newFrameState.load(std::memory_order_acquire);
-	if (newFrameState == 2) {
+	_SharedTexture* sharedTexture = _sharedTextures.TryConsume();
+	if (!sharedTexture) {
 		// 第一帧之前不渲染
-		return UpdateState::Waiting;
-	} else if (newFrameState == 0) {
-		return UpdateState::NoUpdate;
-	}
-
-	// 不必等待，当 newFrameState 变化时捕获线程已将锁释放
-	HRESULT hr = _sharedTexMutex->AcquireSync(1, 0);
-	if (hr == static_cast<HRESULT>(WAIT_TIMEOUT)) {
-		return UpdateState::Waiting;
+		return _curSharedTexture ? UpdateState::NoUpdate : UpdateState::Waiting;
 	}
 
-	if (FAILED(hr)) {
+	// 捕获线程发布前已释放了锁，不会等待
+	HRESULT hr = sharedTexture->mutex->AcquireSync(0, 0);
+	if (hr != S_OK) {
 		Logger::Get().ComError("AcquireSync 失败", hr);
 		return UpdateState::Error;
 	}
 
-	// 不需要对捕获线程可见
-	_newFrameState.store(0, std::memory_order_relaxed);
-
-	MagApp::Get().GetDeviceResources().GetD3DDC()->CopyResource(_output.get(), _sharedTex.get());
+	if (_curSharedTexture) {
+		// 之前的共享纹理归还给捕获线程，GPU 上的访问由键控互斥体同步
+		_curSharedTexture->mutex->ReleaseSync(0);
+	}
 
-	_sharedTexMutex->ReleaseSync(0);
+	// 直接将共享纹理作为输出，效果将在渲染前绑定它
+	_curSharedTexture = sharedTexture;
+	_output = sharedTexture->texture;
+	_frameTime = sharedTexture->frameTime;
 
 	return UpdateState::NewFrame;
 }
 
-bool DesktopDuplicationFrameSource::_InitializeDdpD3D(HANDLE hSharedTex) {
+bool DesktopDuplicationFrameSource::_InitializeDdpD3D() {
 	UINT createDeviceFlags = D3D11_CREATE_DEVICE_BGRA_SUPPORT;
 	if (DeviceResources::IsDebugLayersAvailable()) {
 		// 在 DEBUG 配置启用调试层
@@ -269,17 +246,64 @@ bool DesktopDuplicationFrameSource::_InitializeDdpD3D(HANDLE hSharedTex) {
 		return false;
 	}
 
-	// 获取共享纹理
-	hr = _ddpD3dDevice->OpenSharedResource(hSharedTex, IID_PPV_ARGS(_ddpSharedTex.put()));
-	if (FAILED(hr)) {
-		Logger::Get().ComError("OpenSharedResource 失败", hr);
-		return false;
-	}
+	return true;
+}
 
-	_ddpSharedTexMutex = _ddpSharedTex.try_as<IDXGIKeyedMutex>();
-	if (!_ddpSharedTexMutex) {
-		Logger::Get().Error("检索 IDXGIKeyedMutex 失败");
-		return false;
+bool DesktopDuplicationFrameSource::_CreateSharedTextures() noexcept {
+	DeviceResources& dr = MagApp::Get().GetDeviceResources();
+
+	for (_SharedTexture& sharedTexture : _sharedTextures.GetBuffers()) {
+		sharedTexture.texture = dr.CreateTexture2D(
+			GPUMemoryOwner::FrameSource,
+			DXGI_FORMAT_B8G8R8A8_UNORM,
+			_srcFrameRect.right - _srcFrameRect.left,
+			_srcFrameRect.bottom - _srcFrameRect.top,
+			D3D11_BIND_SHADER_RESOURCE,
+			D3D11_USAGE_DEFAULT,
+			D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX
+		);
+		if (!sharedTexture.texture) {
+			Logger::Get().Error("创建 Texture2D 失败");
+			return false;
+		}
+
+		sharedTexture.mutex = sharedTexture.texture.try_as<IDXGIKeyedMutex>();
+		if (!sharedTexture.mutex) {
+			Logger::Get().Error("检索 IDXGIKeyedMutex 失败");
+			return false;
+		}
+
+		sharedTexture.srv = dr.GetShaderResourceView(sharedTexture.texture.get());
+		if (!sharedTexture.srv) {
+			Logger::Get().Error("GetShaderResourceView 失败");
+			return false;
+		}
+
+		winrt::com_ptr<IDXGIResource> sharedDxgiRes = sharedTexture.texture.try_as<IDXGIResource>();
+		if (!sharedDxgiRes) {
+			Logger::Get().Error("检索 IDXGIResource 失败");
+			return false;
+		}
+
+		HANDLE hSharedTex = NULL;
+		HRESULT hr = sharedDxgiRes->GetSharedHandle(&hSharedTex);
+		if (FAILED(hr)) {
+			Logger::Get().Error("GetSharedHandle 失败");
+			return false;
+		}
+
+		// 获取共享纹理
+		hr = _ddpD3dDevice->OpenSharedResource(hSharedTex, IID_PPV_ARGS(sharedTexture.ddpTexture.put()));
+		if (FAILED(hr)) {
+			Logger::Get().ComError("OpenSharedResource 失败", hr);
+			return false;
+		}
+
+		sharedTexture.ddpMutex = sharedTexture.ddpTexture.try_as<IDXGIKeyedMutex>();
+		if (!sharedTexture.ddpMutex) {
+			Logger::Get().Error("检索 IDXGIKeyedMutex 失败");
+			return false;
+		}
 	}
 
 	return true;
@@ -288,9 +312,28 @@ bool DesktopDuplicationFrameSource::_InitializeDdpD3D(HANDLE hSharedTex) {
 DWORD WINAPI DesktopDuplicationFrameSource::_DDPThreadProc(LPVOID lpThreadParameter) {
 	DesktopDuplicationFrameSource& that = *(DesktopDuplicationFrameSource*)lpThreadParameter;
 
+	const RECT& srcClientInMonitor = that._srcClientInMonitor;
+	const D3D11_BOX& frameInMonitor = that._frameInMonitor;
+
 	DXGI_OUTDUPL_FRAME_INFO info{};
 	winrt::com_ptr<IDXGIResource> dxgiRes;
 	SmallVector<uint8_t, 0> dupMetaData;
+	// 当前帧中源窗口更新的区域，坐标以源窗口左上角为原点
+	SmallVector<RECT> updateRects;
+	// 整个源窗口，坐标以源窗口左上角为原点
+	const RECT srcClientRect = {
+		0,
+		0,
+		srcClientInMonitor.right - srcClientInMonitor.left,
+		srcClientInMonitor.bottom - srcClientInMonitor.top
+	};
+	// 每个共享纹理自上次写入以来累积的更新区域，写入时只需复制这些区域。
+	// 共享纹理尚未初始化时需复制整个窗口
+	std::array<SmallVector<RECT>, 3> pendingRects;
+	for (SmallVector<RECT>& rects : pendingRects) {
+		rects.push_back(srcClientRect);
+	}
+	bool isFirstFrame = true;
 
 	while (!that._exiting.load(std::memory_order_acquire)) {
 		if (dxgiRes) {
@@ -306,55 +349,52 @@ DWORD WINAPI DesktopDuplicationFrameSource::_DDPThreadProc(LPVOID lpThreadParame
 			continue;
 		}
 
-		bool noUpdate = true;
+		updateRects.clear();
 
-		// 检索 move rects 和 dirty rects
-		// 这些区域如果和窗口客户区有重叠则表明画面有变化
 		if (info.TotalMetadataBufferSize) {
+			// 检索 move rects 和 dirty rects，只需复制和窗口客户区重叠的部分
 			if (info.TotalMetadataBufferSize > dupMetaData.size()) {
 				dupMetaData.resize(info.TotalMetadataBufferSize);
 			}
 
 			UINT bufSize = info.TotalMetadataBufferSize;
 
-			// move rects
+			// move rects。桌面图像中目标区域已是移动后的内容，因此直接复制目标区域，
+			// 无需在共享纹理内移动。源区域可能在窗口外，在共享纹理内移动也无法得到正确的结果
 			hr = that._outputDup->GetFrameMoveRects(bufSize, (DXGI_OUTDUPL_MOVE_RECT*)dupMetaData.data(), &bufSize);
-			if (FAILED(hr)) {
-				Logger::Get().ComError("GetFrameMoveRects 失败", hr);
-				continue;
-			}
-
-			UINT nRect = bufSize / sizeof(DXGI_OUTDUPL_MOVE_RECT);
-			for (UINT i = 0; i < nRect; ++i) {
-				const DXGI_OUTDUPL_MOVE_RECT& rect = ((DXGI_OUTDUPL_MOVE_RECT*)dupMetaData.data())[i];
-				if (Win32Utils::CheckOverlap(that._srcClientInMonitor, rect.DestinationRect)) {
-					noUpdate = false;
-					break;
+			if (SUCCEEDED(hr)) {
+				const UINT nMoveRect = bufSize / sizeof(DXGI_OUTDUPL_MOVE_RECT);
+				for (UINT i = 0; i < nMoveRect; ++i) {
+					const DXGI_OUTDUPL_MOVE_RECT& rect = ((DXGI_OUTDUPL_MOVE_RECT*)dupMetaData.data())[i];
+					RectHelper::ClipRect(rect.DestinationRect, srcClientInMonitor, updateRects);
 				}
-			}
 
-			if (noUpdate) {
 				bufSize = info.TotalMetadataBufferSize;
 
 				// dirty rects
 				hr = that._outputDup->GetFrameDirtyRects(bufSize, (RECT*)dupMetaData.data(), &bufSize);
-				if (FAILED(hr)) {
+				if (SUCCEEDED(hr)) {
+					const UINT nDirtyRect = bufSize / sizeof(RECT);
+					for (UINT i = 0; i < nDirtyRect; ++i) {
+						RectHelper::ClipRect(((RECT*)dupMetaData.data())[i], srcClientInMonitor, updateRects);
+					}
+				} else {
 					Logger::Get().ComError("GetFrameDirtyRects 失败", hr);
-					continue;
 				}
+			} else {
+				Logger::Get().ComError("GetFrameMoveRects 失败", hr);
+			}
 
-				nRect = bufSize / sizeof(RECT);
-				for (UINT i = 0; i < nRect; ++i) {
-					const RECT& rect = ((RECT*)dupMetaData.data())[i];
-					if (Win32Utils::CheckOverlap(that._srcClientInMonitor, rect)) {
-						noUpdate = false;
-						break;
-					}
-				}
+			if (SUCCEEDED(hr)) {
+				RectHelper::CoalesceRects(updateRects);
+			} else {
+				// 无法得知更新的区域，复制整个窗口。丢弃这一帧会使共享纹理缺少这些更新
+				updateRects.assign(1, srcClientRect);
 			}
 		}
 
-		if (noUpdate) {
+		// 第一帧总是发布
+		if (updateRects.empty() && !isFirstFrame) {
 			continue;
 		}
 
@@ -364,13 +404,20 @@ DWORD WINAPI DesktopDuplicationFrameSource::_DDPThreadProc(LPVOID lpThreadParame
 			continue;
 		}
 
-		hr = that._ddpSharedTexMutex->AcquireSync(0, 100);
+		for (SmallVector<RECT>& rects : pendingRects) {
+			rects.append(updateRects.begin(), updateRects.end());
+			RectHelper::CoalesceRects(rects);
+		}
+
+		// FrameMailbox 保证渲染线程不会使用这个纹理，只在 GPU 仍在读取时等待
+		_SharedTexture& sharedTexture = that._sharedTextures.GetWriteBuffer();
+		hr = sharedTexture.ddpMutex->AcquireSync(0, 100);
 		while (hr == static_cast<HRESULT>(WAIT_TIMEOUT)) {
 			if (that._exiting.load(std::memory_order_acquire)) {
 				return 0;
 			}
 
-			hr = that._ddpSharedTexMutex->AcquireSync(0, 100);
+			hr = sharedTexture.ddpMutex->AcquireSync(0, 100);
 		}
 
 		if (FAILED(hr)) {
@@ -378,10 +425,36 @@ DWORD WINAPI DesktopDuplicationFrameSource::_DDPThreadProc(LPVOID lpThreadParame
 			continue;
 		}
 
+		SmallVector<RECT>& rectsToCopy = pendingRects[that._sharedTextures.GetWriteIndex()];
+		for (const RECT& rect : rectsToCopy) {
+			D3D11_BOX box = {
+				frameInMonitor.left + (UINT)rect.left,
+				frameInMonitor.top + (UINT)rect.top,
+				0,
+				frameInMonitor.left + (UINT)rect.right,
+				frameInMonitor.top + (UINT)rect.bottom,
+				1
+			};
+			that._ddpD3dDC->CopySubresourceRegion(
+				sharedTexture.ddpTexture.get(), 0, rect.left, rect.top, 0, d3dRes.get(), 0, &box);
+		}
+		rectsToCopy.clear();
+
+		// 只有光标改变时 LastPresentTime 为 0
+		if (info.LastPresentTime.QuadPart != 0) {
+			sharedTexture.frameTime = info.LastPresentTime.QuadPart;
+		} else {
+			LARGE_INTEGER now;
+			QueryPerformanceCounter(&now);
+			sharedTexture.frameTime = now.QuadPart;
+		}
+
+		sharedTexture.ddpMutex->ReleaseSync(0);
+		that._sharedTextures.Publish();
+		isFirstFrame = false;
 
-		that._ddpD3dDC->CopySubresourceRegion(that._ddpSharedTex.get(), 0, 0, 0, 0, d3dRes.get(), 0, &that._frameInMonitor);
-		that._ddpSharedTexMutex->ReleaseSync(1);
-		that._newFrameState.store(1, std::memory_order_release);
+		// 唤醒可能正在空闲的渲染线程
+		PostMessage(that._hwndHost, WM_NULL, 0, 0);
 	}
 
 	return 0;
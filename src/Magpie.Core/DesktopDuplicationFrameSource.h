@@ -1,5 +1,6 @@
 #pragma once
 #include "FrameSourceBase.h"
+#include "FrameMailbox.h"
 
 namespace Magpie::Core {
 
@@ -32,29 +33,37 @@ protected:
 	}
 
 private:
-	bool _InitializeDdpD3D(HANDLE hSharedTex);
+	bool _InitializeDdpD3D();
+
+	bool _CreateSharedTextures() noexcept;
 
 	static DWORD WINAPI _DDPThreadProc(LPVOID lpThreadParameter);
 
 	winrt::com_ptr<IDXGIOutputDuplication> _outputDup;
 
 	HANDLE _hDDPThread = NULL;
+	HWND _hwndHost = NULL;
 	std::atomic<bool> _exiting = false;
-	// 0: 等待新帧
-	// 1: 新帧到达
-	// 2: 等待第一帧
-	std::atomic<UINT> _newFrameState = 2;
 
 	// DDP 线程使用的 D3D 设备
 	winrt::com_ptr<ID3D11Device> _ddpD3dDevice;
 	winrt::com_ptr<ID3D11DeviceContext> _ddpD3dDC;
 
-	// 这些均指向同一个纹理
-	// 用于在 D3D Device 间同步对该纹理的访问
-	winrt::com_ptr<ID3D11Texture2D> _sharedTex;
-	winrt::com_ptr<IDXGIKeyedMutex> _sharedTexMutex;
-	winrt::com_ptr<ID3D11Texture2D> _ddpSharedTex;
-	winrt::com_ptr<IDXGIKeyedMutex> _ddpSharedTexMutex;
+	// 在两个 D3D 设备间共享的纹理，texture 和 ddpTexture 指向同一个纹理。
+	// FrameMailbox 保证了同一时刻只有一方使用，键控互斥体只用于同步 GPU 上的访问，两方都使用键 0
+	struct _SharedTexture {
+		winrt::com_ptr<ID3D11Texture2D> texture;
+		winrt::com_ptr<IDXGIKeyedMutex> mutex;
+		// 只由渲染线程使用，持有视图使效果切换输入时总能从缓存中取出
+		winrt::com_ptr<ID3D11ShaderResourceView> srv;
+		winrt::com_ptr<ID3D11Texture2D> ddpTexture;
+		winrt::com_ptr<IDXGIKeyedMutex> ddpMutex;
+		// 最后一次更新时桌面图像被呈现的时刻，单位为 QPC 计数
+		int64_t frameTime = 0;
+	};
+	FrameMailbox<_SharedTexture> _sharedTextures;
+	// 渲染线程当前作为输出的共享纹理，第一帧到达前为空
+	_SharedTexture* _curSharedTexture = nullptr;
 
 	RECT _srcClientInMonitor{};
 	D3D11_BOX _frameInMonitor{};
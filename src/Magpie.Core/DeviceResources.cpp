@@ -3,42 +3,67 @@
 #include "MagApp.h"
 #include "StrUtils.h"
 #include "Logger.h"
+#include "Utils.h"
 
 namespace Magpie::Core {
 
 bool DeviceResources::Initialize() {
+	// 无窗口时不呈现，无需交换链，也无需检查可变刷新率支持
+	const bool isHeadless = MagApp::Get().IsHeadless();
+
+	const MagOptions& options = MagApp::Get().GetOptions();
+	_memoryTracker.SetBudget((uint64_t)options.videoMemoryBudget * 1024 * 1024);
+	_memoryTracker.ResetPeak();
+
+	if (_d3dDevice) {
+		// 复用上次缩放的 D3D 设备
+		Logger::Get().Info("复用已有的 D3D 设备");
+
+		if (!isHeadless && !MagApp::Get().GetOptions().IsVSync() && !_supportTearing) {
+			Logger::Get().Error("当前显示器不支持可变刷新率");
+			return false;
+		}
+	} else {
 #ifdef _DEBUG
-	UINT flag = DXGI_CREATE_FACTORY_DEBUG;
+		UINT flag = DXGI_CREATE_FACTORY_DEBUG;
 #else
-	UINT flag = 0;
+		UINT flag = 0;
 #endif // _DEBUG
 
-	HRESULT hr = CreateDXGIFactory2(flag, IID_PPV_ARGS(_dxgiFactory.put()));
-	if (FAILED(hr)) {
-		Logger::Get().ComError("CreateDXGIFactory2 失败", hr);
-		return false;
-	}
+		HRESULT hr = CreateDXGIFactory2(flag, IID_PPV_ARGS(_dxgiFactory.put()));
+		if (FAILED(hr)) {
+			Logger::Get().ComError("CreateDXGIFactory2 失败", hr);
+			return false;
+		}
 
-	// 检查可变帧率支持
-	BOOL supportTearing = FALSE;
+		// 检查可变帧率支持
+		BOOL supportTearing = FALSE;
 
-	hr = _dxgiFactory->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &supportTearing, sizeof(supportTearing));
-	if (FAILED(hr)) {
-		Logger::Get().ComWarn("CheckFeatureSupport 失败", hr);
-	}
-	_supportTearing = !!supportTearing;
+		hr = _dxgiFactory->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &supportTearing, sizeof(supportTearing));
+		if (FAILED(hr)) {
+			Logger::Get().ComWarn("CheckFeatureSupport 失败", hr);
+		}
+		_supportTearing = !!supportTearing;
 
-	Logger::Get().Info(fmt::format("可变刷新率支持：{}", supportTearing ? "是" : "否"));
+		Logger::Get().Info(fmt::format("可变刷新率支持：{}", supportTearing ? "是" : "否"));
 
-	if (!MagApp::Get().GetOptions().IsVSync() && !supportTearing) {
-		Logger::Get().Error("当前显示器不支持可变刷新率");
-		//MagApp::Get().SetErrorMsg(ErrorMessages::VSYNC_OFF_NOT_SUPPORTED);
-		return false;
+		if (!isHeadless && !MagApp::Get().GetOptions().IsVSync() && !supportTearing) {
+			Logger::Get().Error("当前显示器不支持可变刷新率");
+			//MagApp::Get().SetErrorMsg(ErrorMessages::VSYNC_OFF_NOT_SUPPORTED);
+			return false;
+		}
+
+		if (!_ObtainGraphicsAdapterAndD3DDevice()) {
+			Logger::Get().Error("找不到可用的图形适配器");
+			return false;
+		}
+
+		_graphicsCard = MagApp::Get().GetOptions().graphicsCard;
+		_viewCache.Initialize(_d3dDevice.get());
 	}
 
-	if(!_ObtainGraphicsAdapterAndD3DDevice()) {
-		Logger::Get().Error("找不到可用的图形适配器");
-		return false;
+	if (isHeadless) {
+		return true;
 	}
 
 	if (!_CreateSwapChain()) {
@@ -50,6 +75,7 @@ bool DeviceResources::Initialize() {
 }
 
 winrt::com_ptr<ID3D11Texture2D> DeviceResources::CreateTexture2D(
+	GPUMemoryOwner owner,
 	DXGI_FORMAT format,
 	UINT width,
 	UINT height,
@@ -70,6 +96,17 @@ winrt::com_ptr<ID3D11Texture2D> DeviceResources::CreateTexture2D(
 	desc.Usage = usage;
 	desc.MiscFlags = miscFlags;
 
+	// 在驱动分配之前检查，以免运行中途显存不足
+	const uint64_t bytes = GPUMemoryTracker::CalcTextureBytes(format, width, height);
+	if (!_memoryTracker.IsWithinBudget(bytes) && !_texturePool.empty()) {
+		// 纹理池中空闲的纹理也计入预算，先释放它们再检查
+		Logger::Get().Info("超出显存预算，释放纹理池");
+		TrimCachedResources();
+	}
+	if (!_memoryTracker.CheckBudget(bytes, owner)) {
+		return nullptr;
+	}
+
 	winrt::com_ptr<ID3D11Texture2D> result;
 	HRESULT hr = _d3dDevice->CreateTexture2D(&desc, pInitialData, result.put());
 	if (FAILED(hr)) {
@@ -77,9 +114,125 @@ winrt::com_ptr<ID3D11Texture2D> DeviceResources::CreateTexture2D(
 		return nullptr;
 	}
 
+	_memoryTracker.Track(result.get(), owner);
 	return result;
 }
 
+bool DeviceResources::IsReusable(const MagOptions& options) const noexcept {
+	if (!_d3dDevice || options.graphicsCard != _graphicsCard || options.IsUseWarp() != _isWarp) {
+		return false;
+	}
+
+	// 设备已移除（如驱动更新）则无法复用
+	return SUCCEEDED(_d3dDevice->GetDeviceRemovedReason());
+}
+
+void DeviceResources::ReleaseSessionResources() noexcept {
+	_d3dDC->ClearState();
+
+	_backBuffer = nullptr;
+
+	_frameLatencyWaitableObject.reset();
+	_swapChain = nullptr;
+
+	// 确保交换链立即销毁，否则无法为新的缩放窗口创建交换链
+	_d3dDC->Flush();
+
+	// 缩放的各组件都已销毁，它们持有的视图也应随之销毁
+	if (const size_t viewCount = _viewCache.GetCount(); viewCount > 0) {
+		Logger::Get().Warn(fmt::format("缩放结束后仍有 {} 个视图存活", viewCount));
+	}
+}
+
+winrt::com_ptr<ID3D11Texture2D> DeviceResources::AcquirePooledTexture(
+	DXGI_FORMAT format,
+	UINT width,
+	UINT height,
+	UINT bindFlags,
+	std::string_view ownerName
+) {
+	winrt::com_ptr<ID3D11Texture2D> result;
+
+	auto it = _texturePool.find(std::make_tuple(format, width, height, bindFlags));
+	if (it != _texturePool.end() && !it->second.empty()) {
+		result = std::move(it->second.back());
+		it->second.pop_back();
+	} else {
+		result = CreateTexture2D(GPUMemoryOwner::Effect, format, width, height, bindFlags);
+		if (!result) {
+			return nullptr;
+		}
+	}
+
+	// 纹理可能来自其他效果
+	_memoryTracker.Track(result.get(), GPUMemoryOwner::Effect, ownerName);
+	return result;
+}
+
+void DeviceResources::RecycleTexture(winrt::com_ptr<ID3D11Texture2D>&& texture) noexcept {
+	if (!texture) {
+		return;
+	}
+
+	// 纹理池中的纹理不再属于任何效果
+	_memoryTracker.Track(texture.get(), GPUMemoryOwner::Effect, "TEXTURE_POOL");
+
+	D3D11_TEXTURE2D_DESC desc;
+	texture->GetDesc(&desc);
+	_texturePool[std::make_tuple(desc.Format, desc.Width, desc.Height, desc.BindFlags)]
+		.push_back(std::move(texture));
+}
+
+void DeviceResources::TrimCachedResources() noexcept {
+	_texturePool.clear();
+
+	const size_t oldSize = _shaderMap.size();
+	phmap::erase_if(_shaderMap, [](const auto& pair) {
+		return pair.second.useCount == 0;
+	});
+	if (_shaderMap.size() != oldSize) {
+		Logger::Get().Info(fmt::format("已释放 {} 个不再使用的计算着色器", oldSize - _shaderMap.size()));
+	}
+}
+
+bool DeviceResources::GetComputeShader(ID3DBlob* cso, ID3D11ComputeShader** result) {
+	const uint64_t hash = Utils::HashData({ (const BYTE*)cso->GetBufferPointer(), cso->GetBufferSize() });
+
+	auto it = _shaderMap.find(hash);
+	if (it != _shaderMap.end()) {
+		++it->second.useCount;
+		*result = it->second.shader.get();
+		return true;
+	}
+
+	winrt::com_ptr<ID3D11ComputeShader> shader;
+	HRESULT hr = _d3dDevice->CreateComputeShader(
+		cso->GetBufferPointer(), cso->GetBufferSize(), nullptr, shader.put());
+	if (FAILED(hr)) {
+		Logger::Get().ComError("创建计算着色器失败", hr);
+		return false;
+	}
+
+	*result = shader.get();
+	_shaderMap.emplace(hash, _CachedShader{ std::move(shader), 1 });
+	return true;
+}
+
+void DeviceResources::ReleaseComputeShader(ID3D11ComputeShader* shader) noexcept {
+	if (!shader) {
+		return;
+	}
+
+	// 着色器通常只有几十个，无需为此建立反向索引
+	for (auto& [hash, cached] : _shaderMap) {
+		if (cached.shader.get() == shader) {
+			assert(cached.useCount > 0);
+			--cached.useCount;
+			return;
+		}
+	}
+}
+
 void DeviceResources::BeginFrame() {
 	WaitForSingleObjectEx(_frameLatencyWaitableObject.get(), 1000, TRUE);
 	_d3dDC->ClearState();
@@ -127,6 +280,10 @@ bool DeviceResources::IsDebugLayersAvailable() noexcept {
 }
 
 bool DeviceResources::_ObtainGraphicsAdapterAndD3DDevice() noexcept {
+	if (MagApp::Get().GetOptions().IsUseWarp()) {
+		return _TryCreateWarpDevice();
+	}
+
 	winrt::com_ptr<IDXGIAdapter1> adapter;
 
 	int adapterIdx = MagApp::Get().GetOptions().graphicsCard;
@@ -175,13 +332,24 @@ bool DeviceResources::_ObtainGraphicsAdapterAndD3DDevice() noexcept {
 	}
 
 	// 作为最后手段，回落到 Basic Render Driver Adapter（WARP）
+	return _TryCreateWarpDevice();
+}
+
+bool DeviceResources::_TryCreateWarpDevice() noexcept {
 	// https://docs.microsoft.com/en-us/windows/win32/direct3darticles/directx-warp
-	HRESULT hr = _dxgiFactory->EnumWarpAdapter(IID_PPV_ARGS(&adapter));
+	winrt::com_ptr<IDXGIAdapter1> adapter;
+	HRESULT hr = _dxgiFactory->EnumWarpAdapter(IID_PPV_ARGS(adapter.put()));
 	if (FAILED(hr)) {
-		Logger::Get().ComError("创建 WARP 设备失败", hr);
+		Logger::Get().ComError("EnumWarpAdapter 失败", hr);
 		return false;
 	}
 
+	if (!_TryCreateD3DDevice(adapter.get())) {
+		Logger::Get().Error("创建 WARP 设备失败");
+		return false;
+	}
+
+	_isWarp = true;
 	Logger::Get().Info("已创建 WARP 设备");
 	return true;
 }
@@ -355,65 +523,6 @@ bool DeviceResources::_CreateSwapChain() {
 	return true;
 }
 
-bool DeviceResources::GetShaderResourceView(ID3D11Texture2D* texture, ID3D11ShaderResourceView** result) {
-	auto it = _srvMap.find(texture);
-	if (it != _srvMap.end()) {
-		*result = it->second.get();
-		return true;
-	}
-
-	winrt::com_ptr<ID3D11ShaderResourceView>& r = _srvMap[texture];
-	HRESULT hr = _d3dDevice->CreateShaderResourceView(texture, nullptr, r.put());
-	if (FAILED(hr)) {
-		Logger::Get().ComError("CreateShaderResourceView 失败", hr);
-		return false;
-	} else {
-		*result = r.get();
-		return true;
-	}
-}
-
-bool DeviceResources::GetUnorderedAccessView(ID3D11Texture2D* texture, ID3D11UnorderedAccessView** result) {
-	auto it = _uavMap.find(texture);
-	if (it != _uavMap.end()) {
-		*result = it->second.get();
-		return true;
-	}
-
-	winrt::com_ptr<ID3D11UnorderedAccessView>& r = _uavMap[texture];
-
-	D3D11_UNORDERED_ACCESS_VIEW_DESC desc{};
-	desc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
-	desc.Texture2D.MipSlice = 0;
-
-	HRESULT hr = _d3dDevice->CreateUnorderedAccessView(texture, &desc, r.put());
-	if (FAILED(hr)) {
-		Logger::Get().ComError("CreateUnorderedAccessView 失败", hr);
-		return false;
-	} else {
-		*result = r.get();
-		return true;
-	}
-}
-
-bool DeviceResources::GetRenderTargetView(ID3D11Texture2D* texture, ID3D11RenderTargetView** result) {
-	auto it = _rtvMap.find(texture);
-	if (it != _rtvMap.end()) {
-		*result = it->second.get();
-		return true;
-	}
-
-	winrt::com_ptr<ID3D11RenderTargetView>& r = _rtvMap[texture];
-	HRESULT hr = _d3dDevice->CreateRenderTargetView(texture, nullptr, r.put());
-	if (FAILED(hr)) {
-		Logger::Get().ComError("CreateRenderTargetView 失败", hr);
-		return false;
-	} else {
-		*result = r.get();
-		return true;
-	}
-}
-
 bool DeviceResources::GetSampler(D3D11_FILTER filterMode, D3D11_TEXTURE_ADDRESS_MODE addressMode, ID3D11SamplerState** result) {
 	auto key = std::make_pair(filterMode, addressMode);
 	auto it = _samMap.find(key);
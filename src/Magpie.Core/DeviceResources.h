@@ -1,20 +1,34 @@
 #pragma once
 #include "Win32Utils.h"
 #include <parallel_hashmap/phmap.h>
+#include "SmallVector.h"
+#include "GPUMemoryTracker.h"
+#include "ViewCache.h"
 
 namespace Magpie::Core {
 
+struct MagOptions;
+
 class DeviceResources {
 public:
 	DeviceResources() = default;
 	DeviceResources(const DeviceResources&) = delete;
 	DeviceResources(DeviceResources&&) = delete;
 
+	// 已创建 D3D 设备时只重新创建交换链。无窗口时不创建交换链，GetSwapChain 和 GetBackBuffer 返回空
 	bool Initialize();
 
+	// 检查 D3D 设备是否可以在新的缩放中复用
+	bool IsReusable(const MagOptions& options) const noexcept;
+
+	// 退出缩放时调用，释放和缩放窗口绑定的资源，保留 D3D 设备和缓存的资源
+	void ReleaseSessionResources() noexcept;
+
 	static bool IsDebugLayersAvailable() noexcept;
 
+	// 超出显存预算时失败，见 GPUMemoryTracker
 	winrt::com_ptr<ID3D11Texture2D> CreateTexture2D(
+		GPUMemoryOwner owner,
 		DXGI_FORMAT format,
 		UINT width,
 		UINT height,
@@ -24,13 +38,43 @@ public:
 		const D3D11_SUBRESOURCE_DATA* pInitialData = nullptr
 	);
 
+	// 优先从纹理池中取出格式和尺寸相同的纹理，找不到时创建新纹理。纹理池只用于效果的中间纹理，
+	// ownerName 为 "效果名/纹理名"
+	winrt::com_ptr<ID3D11Texture2D> AcquirePooledTexture(
+		DXGI_FORMAT format,
+		UINT width,
+		UINT height,
+		UINT bindFlags,
+		std::string_view ownerName
+	);
+
+	// 将不再使用的纹理放回纹理池，供之后的缩放复用
+	void RecycleTexture(winrt::com_ptr<ID3D11Texture2D>&& texture) noexcept;
+
+	// 释放纹理池中所有纹理和没有使用者的计算着色器。缩放结束后它们仍被保留，
+	// 供之后的缩放复用，直到 resourceCacheTimeout 到期时随 DeviceResources 一起释放
+	void TrimCachedResources() noexcept;
+
+	// 根据字节码的哈希缓存计算着色器。使用者不再需要时应调用 ReleaseComputeShader，
+	// 没有使用者的着色器在 TrimCachedResources 时释放
+	bool GetComputeShader(ID3DBlob* cso, ID3D11ComputeShader** result);
+
+	void ReleaseComputeShader(ID3D11ComputeShader* shader) noexcept;
+
 	bool GetSampler(D3D11_FILTER filterMode, D3D11_TEXTURE_ADDRESS_MODE addressMode, ID3D11SamplerState** result);
 
-	bool GetRenderTargetView(ID3D11Texture2D* texture, ID3D11RenderTargetView** result);
+	// 视图由调用者持有，见 ViewCache。失败时返回空
+	winrt::com_ptr<ID3D11RenderTargetView> GetRenderTargetView(ID3D11Texture2D* texture) noexcept {
+		return _viewCache.GetRenderTargetView(texture);
+	}
 
-	bool GetShaderResourceView(ID3D11Texture2D* texture, ID3D11ShaderResourceView** result);
+	winrt::com_ptr<ID3D11ShaderResourceView> GetShaderResourceView(ID3D11Texture2D* texture) noexcept {
+		return _viewCache.GetShaderResourceView(texture);
+	}
 
-	bool GetUnorderedAccessView(ID3D11Texture2D* texture, ID3D11UnorderedAccessView** result);
+	winrt::com_ptr<ID3D11UnorderedAccessView> GetUnorderedAccessView(ID3D11Texture2D* texture) noexcept {
+		return _viewCache.GetUnorderedAccessView(texture);
+	}
 
 	ID3D11Device5* GetD3DDevice() const noexcept { return _d3dDevice.get(); }
 	D3D_FEATURE_LEVEL GetFeatureLevel() const noexcept { return _featureLevel; }
@@ -40,6 +84,8 @@ public:
 	IDXGIFactory7* GetDXGIFactory() const noexcept { return _dxgiFactory.get(); }
 	IDXGIDevice4* GetDXGIDevice() const noexcept { return _dxgiDevice.get(); }
 	IDXGIAdapter4* GetGraphicsAdapter() const noexcept { return _graphicsAdapter.get(); }
+	bool IsWarp() const noexcept { return _isWarp; }
+	GPUMemoryTracker& GetMemoryTracker() noexcept { return _memoryTracker; }
 
 	void BeginFrame();
 
@@ -50,8 +96,13 @@ private:
 
 	bool _TryCreateD3DDevice(IDXGIAdapter1* adapter) noexcept;
 
+	bool _TryCreateWarpDevice() noexcept;
+
 	bool _CreateSwapChain();
 
+	// 需在所有缓存的资源之前声明，这些资源销毁时会通知它
+	GPUMemoryTracker _memoryTracker;
+
 	winrt::com_ptr<IDXGIFactory7> _dxgiFactory;
 	winrt::com_ptr<IDXGIDevice4> _dxgiDevice;
 	winrt::com_ptr<IDXGISwapChain4> _swapChain;
@@ -61,18 +112,34 @@ private:
 
 	Win32Utils::ScopedHandle _frameLatencyWaitableObject;
 	bool _supportTearing = false;
+	bool _isWarp = false;
 	D3D_FEATURE_LEVEL _featureLevel = D3D_FEATURE_LEVEL_10_0;
 
 	winrt::com_ptr<ID3D11Texture2D> _backBuffer;
 
-	phmap::flat_hash_map<ID3D11Texture2D*, winrt::com_ptr<ID3D11RenderTargetView>> _rtvMap;
-	phmap::flat_hash_map<ID3D11Texture2D*, winrt::com_ptr<ID3D11ShaderResourceView>> _srvMap;
-	phmap::flat_hash_map<ID3D11Texture2D*, winrt::com_ptr<ID3D11UnorderedAccessView>> _uavMap;
+	// 创建 D3D 设备时使用的图形适配器序号，用于判断能否复用
+	int _graphicsCard = -1;
+
+	ViewCache _viewCache;
 
 	phmap::flat_hash_map<
 		std::pair<D3D11_FILTER, D3D11_TEXTURE_ADDRESS_MODE>,
 		winrt::com_ptr<ID3D11SamplerState>
 	> _samMap;
+
+	struct _CachedShader {
+		winrt::com_ptr<ID3D11ComputeShader> shader;
+		// 使用此着色器的效果数
+		uint32_t useCount = 0;
+	};
+	// 字节码的哈希 -> 着色器
+	phmap::flat_hash_map<uint64_t, _CachedShader> _shaderMap;
+
+	// (格式, 宽, 高, 绑定标志) -> [纹理]
+	phmap::flat_hash_map<
+		std::tuple<DXGI_FORMAT, UINT, UINT, UINT>,
+		SmallVector<winrt::com_ptr<ID3D11Texture2D>, 1>
+	> _texturePool;
 };
 
 }
@@ -13,7 +13,8 @@ bool DirectXHelper::CompileComputeShader(
 	const char* sourceName,
 	ID3DInclude* include,
 	const std::vector<std::pair<std::string, std::string>>& macros,
-	bool warningsAreErrors
+	bool warningsAreErrors,
+	std::string* errorMsg
 ) {
 	winrt::com_ptr<ID3DBlob> errorMsgs = nullptr;
 
@@ -39,6 +40,10 @@ bool DirectXHelper::CompileComputeShader(
 	if (FAILED(hr)) {
 		if (errorMsgs) {
 			Logger::Get().ComError(StrUtils::Concat("编译计算着色器失败：", (const char*)errorMsgs->GetBufferPointer()), hr);
+
+			if (errorMsg) {
+				*errorMsg = (const char*)errorMsgs->GetBufferPointer();
+			}
 		}
 		return false;
 	}
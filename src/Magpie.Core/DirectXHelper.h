@@ -10,7 +10,8 @@ struct DirectXHelper {
 		const char* sourceName = nullptr,
 		ID3DInclude* include = nullptr,
 		const std::vector<std::pair<std::string, std::string>>& macros = {},
-		bool warningsAreErrors = false
+		bool warningsAreErrors = false,
+		std::string* errorMsg = nullptr	// 编译失败时存储编译器的错误信息
 	);
 };
 
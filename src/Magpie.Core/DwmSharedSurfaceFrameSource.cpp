@@ -30,6 +30,67 @@ bool DwmSharedSurfaceFrameSource::Initialize() {
 		return false;
 	}
 
+	if (!_CalcFrameInWnd()) {
+		Logger::Get().Error("_CalcFrameInWnd 失败");
+		return false;
+	}
+
+	if (!_CreateOutput()) {
+		Logger::Get().Error("_CreateOutput 失败");
+		return false;
+	}
+
+	Logger::Get().Info("DwmSharedSurfaceFrameSource 初始化完成");
+	return true;
+}
+
+bool DwmSharedSurfaceFrameSource::OnSrcWndRectChanged() {
+	if (!_UpdateSrcFrameRect()) {
+		Logger::Get().Error("_UpdateSrcFrameRect 失败");
+		return false;
+	}
+
+	const D3D11_BOX oldFrameInWnd = _frameInWnd;
+	if (!_CalcFrameInWnd()) {
+		Logger::Get().Error("_CalcFrameInWnd 失败");
+		return false;
+	}
+
+	// 只移动窗口时无需重新创建纹理
+	if (_frameInWnd.right - _frameInWnd.left == oldFrameInWnd.right - oldFrameInWnd.left
+		&& _frameInWnd.bottom - _frameInWnd.top == oldFrameInWnd.bottom - oldFrameInWnd.top
+	) {
+		return true;
+	}
+
+	return _CreateOutput();
+}
+
+FrameSourceBase::UpdateState DwmSharedSurfaceFrameSource::Update() {
+	HANDLE sharedTextureHandle = NULL;
+	if (!_dwmGetDxSharedSurface(MagApp::Get().GetHwndSrc(),
+		&sharedTextureHandle, nullptr, nullptr, nullptr, nullptr)
+		|| !sharedTextureHandle
+		) {
+		Logger::Get().Win32Error("DwmGetDxSharedSurface 失败");
+		return UpdateState::Error;
+	}
+
+	winrt::com_ptr<ID3D11Texture2D> sharedTexture;
+	HRESULT hr = MagApp::Get().GetDeviceResources().GetD3DDevice()
+		->OpenSharedResource(sharedTextureHandle, IID_PPV_ARGS(&sharedTexture));
+	if (FAILED(hr)) {
+		Logger::Get().ComError("OpenSharedResource 失败", hr);
+		return UpdateState::Error;
+	}
+
+	MagApp::Get().GetDeviceResources().GetD3DDC()
+		->CopySubresourceRegion(_output.get(), 0, 0, 0, 0, sharedTexture.get(), 0, &_frameInWnd);
+
+	return UpdateState::NewFrame;
+}
+
+bool DwmSharedSurfaceFrameSource::_CalcFrameInWnd() {
 	HWND hwndSrc = MagApp::Get().GetHwndSrc();
 
 	double a, bx, by;
@@ -65,10 +126,15 @@ bool DwmSharedSurfaceFrameSource::Initialize() {
 		1
 	};
 
+	return true;
+}
+
+bool DwmSharedSurfaceFrameSource::_CreateOutput() {
 	_output = MagApp::Get().GetDeviceResources().CreateTexture2D(
+		GPUMemoryOwner::FrameSource,
 		DXGI_FORMAT_B8G8R8A8_UNORM,
-		frameRect.right - frameRect.left,
-		frameRect.bottom - frameRect.top,
+		_frameInWnd.right - _frameInWnd.left,
+		_frameInWnd.bottom - _frameInWnd.top,
 		D3D11_BIND_SHADER_RESOURCE
 	);
 	if (!_output) {
@@ -76,32 +142,7 @@ bool DwmSharedSurfaceFrameSource::Initialize() {
 		return false;
 	}
 
-	Logger::Get().Info("DwmSharedSurfaceFrameSource 初始化完成");
 	return true;
 }
 
-FrameSourceBase::UpdateState DwmSharedSurfaceFrameSource::Update() {
-	HANDLE sharedTextureHandle = NULL;
-	if (!_dwmGetDxSharedSurface(MagApp::Get().GetHwndSrc(),
-		&sharedTextureHandle, nullptr, nullptr, nullptr, nullptr)
-		|| !sharedTextureHandle
-		) {
-		Logger::Get().Win32Error("DwmGetDxSharedSurface 失败");
-		return UpdateState::Error;
-	}
-
-	winrt::com_ptr<ID3D11Texture2D> sharedTexture;
-	HRESULT hr = MagApp::Get().GetDeviceResources().GetD3DDevice()
-		->OpenSharedResource(sharedTextureHandle, IID_PPV_ARGS(&sharedTexture));
-	if (FAILED(hr)) {
-		Logger::Get().ComError("OpenSharedResource 失败", hr);
-		return UpdateState::Error;
-	}
-
-	MagApp::Get().GetDeviceResources().GetD3DDC()
-		->CopySubresourceRegion(_output.get(), 0, 0, 0, 0, sharedTexture.get(), 0, &_frameInWnd);
-
-	return UpdateState::NewFrame;
-}
-
 }
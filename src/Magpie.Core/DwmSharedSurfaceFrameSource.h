@@ -16,6 +16,8 @@ public:
 		return false;
 	}
 
+	bool OnSrcWndRectChanged() override;
+
 	const char* GetName() const noexcept override {
 		return "DwmSharedSurface";
 	}
@@ -30,6 +32,11 @@ protected:
 	}
 
 private:
+	// 计算源窗口客户区在 DWM 共享表面中的位置
+	bool _CalcFrameInWnd();
+
+	bool _CreateOutput();
+
 	using _DwmGetDxSharedSurfaceFunc = bool(
 		HWND hWnd,
 		HANDLE* phSurface,
@@ -77,7 +77,7 @@ static constexpr const uint32_t MAX_CACHE_COUNT = 127;
 
 // 缓存版本
 // 当缓存文件结构有更改时更新它，使旧缓存失效
-static constexpr const uint32_t EFFECT_CACHE_VERSION = 12;
+static constexpr const uint32_t EFFECT_CACHE_VERSION = 13;
 
 
 static std::wstring GetLinearEffectName(std::wstring_view effectName) {
@@ -12,6 +12,7 @@
 #include "EffectHelper.h"
 #include "Win32Utils.h"
 #include "EffectDesc.h"
+#include "TraceRecorder.h"
 
 namespace Magpie::Core {
 
@@ -1227,7 +1228,7 @@ static UINT GeneratePassSource(
 	color = saturate(color);
 	pos += __offset.zw;
 	if ((int)pos.x >= __cursorRect.x && (int)pos.y >= __cursorRect.y && (int)pos.x < __cursorRect.z && (int)pos.y < __cursorRect.w) {
-		float4 mask = __CURSOR.SampleLevel(__CURSOR_SAMPLER, (pos - __cursorRect.xy + 0.5f) * __cursorPt, 0);
+		float4 mask = __CURSOR.SampleLevel(__CURSOR_SAMPLER, __cursorUVOffset + (pos - __cursorRect.xy + 0.5f) * __cursorPt, 0);
 		if (__cursorType == 0){
 			color = color * mask.a + mask.rgb;
 		} else if (__cursorType == 1) {
@@ -1438,7 +1439,8 @@ static UINT CompilePasses(
 	uint32_t flags,
 	const SmallVector<std::string_view>& commonBlocks,
 	const SmallVector<std::string_view>& passBlocks,
-	const phmap::flat_hash_map<std::wstring, float>* inlineParams
+	const phmap::flat_hash_map<std::wstring, float>* inlineParams,
+	std::string* errorMsg
 ) {
 	////////////////////////////////////////////////////////////////////////////////////////////////////////
 	//
@@ -1452,6 +1454,7 @@ static UINT CompilePasses(
 	uint2 __cursorPos;
 	uint __cursorType;
 	uint __frameCount;
+	float2 __cursorUVOffset;
 };
 cbuffer __CB2 : register(b1) {
 	uint2 __inputSize;
@@ -1497,6 +1500,9 @@ cbuffer __CB2 : register(b1) {
 		? L"effects\\"
 		: L"effects\\" + StrUtils::UTF8ToUTF16(std::string_view(desc.name.c_str(), delimPos + 1)));
 
+	// 每个通道的错误信息，并行编译时分开存储
+	std::vector<std::string> passErrorMsgs(errorMsg ? passBlocks.size() : 0);
+
 	// 并行生成代码和编译
 	Win32Utils::RunParallel([&](UINT id) {
 		std::string source;
@@ -1517,12 +1523,20 @@ cbuffer __CB2 : register(b1) {
 		}
 
 		if (!DirectXHelper::CompileComputeShader(source, "__M", desc.passes[id].cso.put(),
-			fmt::format("{}_Pass{}.hlsl", desc.name, id + 1).c_str(), &passInclude, macros, flags & EffectCompilerFlags::WarningsAreErrors)
+			fmt::format("{}_Pass{}.hlsl", desc.name, id + 1).c_str(), &passInclude, macros,
+			flags & EffectCompilerFlags::WarningsAreErrors, errorMsg ? &passErrorMsgs[id] : nullptr)
 		) {
 			Logger::Get().Error(fmt::format("编译 Pass{} 失败", id + 1));
 		}
 	}, (UINT)passBlocks.size());
 
+	if (errorMsg) {
+		errorMsg->clear();
+		for (const std::string& msg : passErrorMsgs) {
+			errorMsg->append(msg);
+		}
+	}
+
 	// 检查编译结果
 	for (const EffectPassDesc& d : desc.passes) {
 		if (!d.cso) {
@@ -1537,8 +1551,11 @@ cbuffer __CB2 : register(b1) {
 uint32_t EffectCompiler::Compile(
 	EffectDesc& desc,
 	uint32_t flags,
-	const phmap::flat_hash_map<std::wstring, float>* inlineParams
+	const phmap::flat_hash_map<std::wstring, float>* inlineParams,
+	std::string* errorMsg
 ) {
+	TraceRecorder::Scope traceScope(TraceRecorder::Track::Compile, desc.name);
+
 	bool noCompile = flags & EffectCompilerFlags::NoCompile;
 	bool noCache = noCompile || (flags & EffectCompilerFlags::NoCache);
 
@@ -1565,7 +1582,7 @@ uint32_t EffectCompiler::Compile(
 	std::wstring hash;
 	if (!noCache) {
 		hash = EffectCacheManager::GetHash(source, desc.flags & EffectFlags::InlineParams ? inlineParams : nullptr);
-		if (!hash.empty()) {
+		if (!hash.empty() && !(flags & EffectCompilerFlags::RefreshCache)) {
 			if (EffectCacheManager::Get().Load(effectName, hash, desc)) {
 				// 已从缓存中读取
 				return 0;
@@ -1573,6 +1590,10 @@ uint32_t EffectCompiler::Compile(
 		}
 	}
 
+	if (flags & EffectCompilerFlags::CacheOnly) {
+		return 3;
+	}
+
 	std::string_view sourceView(source);
 
 	// 检查头
@@ -1754,7 +1775,7 @@ uint32_t EffectCompiler::Compile(
 			return 1;
 		}
 
-		if (CompilePasses(desc, flags, commonBlocks, passBlocks, inlineParams)) {
+		if (CompilePasses(desc, flags, commonBlocks, passBlocks, inlineParams, errorMsg)) {
 			Logger::Get().Error("编译着色器失败");
 			return 1;
 		}
@@ -11,6 +11,10 @@ struct EffectCompilerFlags {
 	static constexpr const uint32_t WarningsAreErrors = 0x4;
 	// 只解析输出尺寸和参数，供用户界面使用
 	static constexpr const uint32_t NoCompile = 0x8;
+	// 只从缓存中读取，未命中时返回 3 而不编译
+	static constexpr const uint32_t CacheOnly = 0x10;
+	// 不读取缓存但保存编译结果，用于被包含的文件改变后更新缓存
+	static constexpr const uint32_t RefreshCache = 0x20;
 };
 
 struct EffectCompiler {
@@ -18,7 +22,8 @@ struct EffectCompiler {
 	static uint32_t Compile(
 		EffectDesc& desc,
 		uint32_t flags,	// EffectCompilerFlags
-		const phmap::flat_hash_map<std::wstring, float>* inlineParams = nullptr
+		const phmap::flat_hash_map<std::wstring, float>* inlineParams = nullptr,
+		std::string* errorMsg = nullptr	// 编译着色器失败时存储编译器的错误信息
 	);
 
 	// 当前 MagpieFX 版本
@@ -6,7 +6,6 @@
 #include "DeviceResources.h"
 #include "TextureLoader.h"
 #include "StrUtils.h"
-#include "Renderer.h"
 #include "CursorManager.h"
 #include "GPUTimer.h"
 #include "EffectHelper.h"
@@ -23,54 +22,224 @@
 
 namespace Magpie::Core {
 
+EffectDrawer::~EffectDrawer() {
+	// 没有效果使用的着色器将在 TrimCachedResources 时释放
+	for (ID3D11ComputeShader* shader : _shaders) {
+		_deviceResources->ReleaseComputeShader(shader);
+	}
+
+	if (_textures.empty()) {
+		return;
+	}
+
+	const bool isLastEffect = _desc.flags & EffectFlags::LastEffect;
+
+	// 第一个纹理是输入，最后一个效果的输出是后缓冲区，它们都不属于此效果
+	for (size_t i = 1, end = _textures.size() - (isLastEffect ? 1 : 0); i < end; ++i) {
+		if (i < _desc.textures.size() && !_desc.textures[i].source.empty()) {
+			// 从文件加载的纹理不可复用
+			continue;
+		}
+
+		_deviceResources->RecycleTexture(std::move(_textures[i]));
+	}
+}
+
 bool EffectDrawer::Initialize(
+	DeviceResources& deviceResources,
 	const EffectDesc& desc,
 	const EffectOption& option,
 	ID3D11Texture2D* inputTex,
 	RECT* outputRect,
 	RECT* virtualOutputRect
 ) {
+	_deviceResources = &deviceResources;
 	_desc = desc;
+	_scalingType = option.scalingType;
+	_scale = option.scale;
+
+	bool isLastEffect = desc.flags & EffectFlags::LastEffect;
+	bool isInlineParams = desc.flags & EffectFlags::InlineParams;
+
+	DeviceResources& dr = *_deviceResources;
+
+	_samplers.resize(desc.samplers.size());
+	for (UINT i = 0; i < _samplers.size(); ++i) {
+		const EffectSamplerDesc& samDesc = desc.samplers[i];
+		if (!dr.GetSampler(
+			samDesc.filterType == EffectSamplerFilterType::Linear ? D3D11_FILTER_MIN_MAG_MIP_LINEAR : D3D11_FILTER_MIN_MAG_MIP_POINT,
+			samDesc.addressType == EffectSamplerAddressType::Clamp ? D3D11_TEXTURE_ADDRESS_CLAMP : D3D11_TEXTURE_ADDRESS_WRAP,
+			&_samplers[i])
+			) {
+			Logger::Get().Error(fmt::format("创建采样器 {} 失败", samDesc.name));
+			return false;
+		}
+	}
 
 	SIZE inputSize{};
+	SIZE outputSize{};
+	if (!_UpdateTextures(inputTex, inputSize, outputSize)) {
+		return false;
+	}
+
+	_shaders.resize(desc.passes.size());
+	for (UINT i = 0; i < _shaders.size(); ++i) {
+		if (!dr.GetComputeShader(desc.passes[i].cso.get(), &_shaders[i])) {
+			Logger::Get().Error("GetComputeShader 失败");
+			return false;
+		}
+	}
+
+	if (!_UpdateViews(outputSize)) {
+		return false;
+	}
+
+	if (isLastEffect) {
+		if (!dr.GetSampler(
+			MagApp::Get().GetOptions().cursorInterpolationMode == CursorInterpolationMode::NearestNeighbor ? D3D11_FILTER_MIN_MAG_MIP_POINT : D3D11_FILTER_MIN_MAG_MIP_LINEAR,
+			D3D11_TEXTURE_ADDRESS_CLAMP,
+			&_samplers.emplace_back(nullptr)
+			)) {
+			Logger::Get().Error("GetSampler 失败");
+			return false;
+		}
+	}
+
+	// 大小必须为 4 的倍数
+	size_t psStylePassParams = 0;
+	for (UINT i = 0, end = (UINT)desc.passes.size() - 1; i < end; ++i) {
+		if (desc.passes[i].isPSStyle) {
+			psStylePassParams += 4;
+		}
+	}
+	_constants.resize((_GetBuiltinConstantCount() + psStylePassParams + (isInlineParams ? 0 : desc.params.size()) + 3) / 4 * 4);
+
+	_UpdateBuiltinConstants(inputSize, outputSize, outputRect, virtualOutputRect);
+
+	if (!isInlineParams && !_UpdateParameterConstants(option)) {
+		return false;
+	}
+
+	D3D11_BUFFER_DESC bd{};
+	bd.Usage = D3D11_USAGE_DEFAULT;
+	bd.ByteWidth = 4 * (UINT)_constants.size();
+	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+	D3D11_SUBRESOURCE_DATA initData{};
+	initData.pSysMem = _constants.data();
+
+	HRESULT hr = dr.GetD3DDevice()->CreateBuffer(&bd, &initData, _constantBuffer.put());
+	if (FAILED(hr)) {
+		Logger::Get().ComError("CreateBuffer 失败", hr);
+		return false;
+	}
+	dr.GetMemoryTracker().Track(_constantBuffer.get(), GPUMemoryOwner::Effect, StrUtils::Concat(_desc.name, "/CONSTANTS"));
+
+	return true;
+}
+
+bool EffectDrawer::Resize(ID3D11Texture2D* inputTex, RECT* outputRect, RECT* virtualOutputRect) {
+	SIZE inputSize{};
+	SIZE outputSize{};
+	if (!_UpdateTextures(inputTex, inputSize, outputSize)) {
+		return false;
+	}
+
+	if (!_UpdateViews(outputSize)) {
+		return false;
+	}
+
+	// 着色器和常量缓冲区的布局不变，只需更新内置常量
+	_UpdateBuiltinConstants(inputSize, outputSize, outputRect, virtualOutputRect);
+	_deviceResources->GetD3DDC()->UpdateSubresource(
+		_constantBuffer.get(), 0, nullptr, _constants.data(), 0, 0);
+
+	return true;
+}
+
+bool EffectDrawer::UpdateParameters(const EffectOption& option) {
+	assert(!(_desc.flags & EffectFlags::InlineParams));
+
+	if (!_UpdateParameterConstants(option)) {
+		return false;
+	}
+
+	_deviceResources->GetD3DDC()->UpdateSubresource(
+		_constantBuffer.get(), 0, nullptr, _constants.data(), 0, 0);
+	return true;
+}
+
+bool EffectDrawer::SetInput(ID3D11Texture2D* inputTex) {
+	if (_textures[0].get() == inputTex) {
+		return true;
+	}
+
+#ifdef _DEBUG
+	{
+		D3D11_TEXTURE2D_DESC oldDesc;
+		_textures[0]->GetDesc(&oldDesc);
+		D3D11_TEXTURE2D_DESC newDesc;
+		inputTex->GetDesc(&newDesc);
+		assert(oldDesc.Width == newDesc.Width && oldDesc.Height == newDesc.Height);
+	}
+#endif
+
+	winrt::com_ptr<ID3D11ShaderResourceView> inputSrv = _deviceResources->GetShaderResourceView(inputTex);
+	if (!inputSrv) {
+		Logger::Get().Error("GetShaderResourceView 失败");
+		return false;
+	}
+
+	_textures[0].copy_from(inputTex);
+	_textureSrvs[0] = std::move(inputSrv);
+
+	for (size_t i = 0; i < _desc.passes.size(); ++i) {
+		const EffectPassDesc& passDesc = _desc.passes[i];
+		for (size_t j = 0; j < passDesc.inputs.size(); ++j) {
+			if (passDesc.inputs[j] == 0) {
+				_srvs[i][j] = _textureSrvs[0].get();
+			}
+		}
+	}
+
+	return true;
+}
+
+bool EffectDrawer::_UpdateTextures(ID3D11Texture2D* inputTex, SIZE& inputSize, SIZE& outputSize) {
 	{
 		D3D11_TEXTURE2D_DESC inputDesc;
 		inputTex->GetDesc(&inputDesc);
 		inputSize = { (LONG)inputDesc.Width, (LONG)inputDesc.Height };
 	}
 
-	const SIZE hostSize = Win32Utils::GetSizeOfRect(MagApp::Get().GetHostWndRect());;
-	bool isLastEffect = desc.flags & EffectFlags::LastEffect;
-	bool isInlineParams = desc.flags & EffectFlags::InlineParams;
+	const SIZE hostSize = Win32Utils::GetSizeOfRect(MagApp::Get().GetHostWndRect());
+	bool isLastEffect = _desc.flags & EffectFlags::LastEffect;
 
-	DeviceResources& dr = MagApp::Get().GetDeviceResources();
-	auto d3dDevice = dr.GetD3DDevice();
+	DeviceResources& dr = *_deviceResources;
 
 	static mu::Parser exprParser;
 	exprParser.DefineConst("INPUT_WIDTH", inputSize.cx);
 	exprParser.DefineConst("INPUT_HEIGHT", inputSize.cy);
 
-	SIZE outputSize{};
-
-	if (desc.outSizeExpr.first.empty()) {
-		switch (option.scalingType) {
+	if (_desc.outSizeExpr.first.empty()) {
+		switch (_scalingType) {
 		case ScalingType::Normal:
 		{
-			outputSize.cx = std::lroundf(inputSize.cx * option.scale.first);
-			outputSize.cy = std::lroundf(inputSize.cy * option.scale.second);
+			outputSize.cx = std::lroundf(inputSize.cx * _scale.first);
+			outputSize.cy = std::lroundf(inputSize.cy * _scale.second);
 			break;
 		}
 		case ScalingType::Fit:
 		{
 			float fillScale = std::min(float(hostSize.cx) / inputSize.cx, float(hostSize.cy) / inputSize.cy);
-			outputSize.cx = std::lroundf(inputSize.cx * fillScale * option.scale.first);
-			outputSize.cy = std::lroundf(inputSize.cy * fillScale * option.scale.second);
+			outputSize.cx = std::lroundf(inputSize.cx * fillScale * _scale.first);
+			outputSize.cy = std::lroundf(inputSize.cy * fillScale * _scale.second);
 			break;
 		}
 		case ScalingType::Absolute:
 		{
-			outputSize.cx = std::lroundf(option.scale.first);
-			outputSize.cy = std::lroundf(option.scale.second);
+			outputSize.cx = std::lroundf(_scale.first);
+			outputSize.cy = std::lroundf(_scale.second);
 			break;
 		}
 		case ScalingType::Fill:
@@ -80,13 +249,13 @@ bool EffectDrawer::Initialize(
 		}
 		}
 	} else {
-		assert(!desc.outSizeExpr.second.empty());
+		assert(!_desc.outSizeExpr.second.empty());
 
 		try {
-			exprParser.SetExpr(desc.outSizeExpr.first);
+			exprParser.SetExpr(_desc.outSizeExpr.first);
 			outputSize.cx = std::lround(exprParser.Eval());
 
-			exprParser.SetExpr(desc.outSizeExpr.second);
+			exprParser.SetExpr(_desc.outSizeExpr.second);
 			outputSize.cy = std::lround(exprParser.Eval());
 		} catch (const mu::ParserError& e) {
 			Logger::Get().Error(fmt::format("计算输出尺寸 {} 失败：{}", e.GetExpr(), e.GetMsg()));
@@ -102,37 +271,57 @@ bool EffectDrawer::Initialize(
 	exprParser.DefineConst("OUTPUT_WIDTH", outputSize.cx);
 	exprParser.DefineConst("OUTPUT_HEIGHT", outputSize.cy);
 
-	_samplers.resize(desc.samplers.size());
-	for (UINT i = 0; i < _samplers.size(); ++i) {
-		const EffectSamplerDesc& samDesc = desc.samplers[i];
-		if (!dr.GetSampler(
-			samDesc.filterType == EffectSamplerFilterType::Linear ? D3D11_FILTER_MIN_MAG_MIP_LINEAR : D3D11_FILTER_MIN_MAG_MIP_POINT,
-			samDesc.addressType == EffectSamplerAddressType::Clamp ? D3D11_TEXTURE_ADDRESS_CLAMP : D3D11_TEXTURE_ADDRESS_WRAP,
-			&_samplers[i])
-			) {
-			Logger::Get().Error(fmt::format("创建采样器 {} 失败", samDesc.name));
+	// 尺寸不变的纹理继续使用，否则放回纹理池并取出新尺寸的纹理
+	auto updateTexture = [&](winrt::com_ptr<ID3D11Texture2D>& texture, DXGI_FORMAT format, SIZE size, std::string_view texName) {
+		if (texture) {
+			D3D11_TEXTURE2D_DESC texDesc;
+			texture->GetDesc(&texDesc);
+			if (texDesc.Width == (UINT)size.cx && texDesc.Height == (UINT)size.cy) {
+				return true;
+			}
+
+			dr.RecycleTexture(std::move(texture));
+		}
+
+		texture = dr.AcquirePooledTexture(
+			format,
+			size.cx,
+			size.cy,
+			D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS,
+			StrUtils::Concat(_desc.name, "/", texName)
+		);
+		if (!texture) {
+			Logger::Get().Error("创建纹理失败");
 			return false;
 		}
-	}
+
+		return true;
+	};
 
 	// 创建中间纹理
 	// 第一个为 INPUT，最后一个为 OUTPUT
-	_textures.resize(desc.textures.size() + 1);
+	_textures.resize(_desc.textures.size() + 1);
 	_textures[0].copy_from(inputTex);
-	for (size_t i = 1; i < desc.textures.size(); ++i) {
-		const EffectIntermediateTextureDesc& texDesc = desc.textures[i];
+	for (size_t i = 1; i < _desc.textures.size(); ++i) {
+		const EffectIntermediateTextureDesc& texDesc = _desc.textures[i];
 
 		if (!texDesc.source.empty()) {
+			if (_textures[i]) {
+				// 从文件加载的纹理尺寸固定
+				continue;
+			}
+
 			// 从文件加载纹理
-			size_t delimPos = desc.name.find_last_of('\\');
+			size_t delimPos = _desc.name.find_last_of('\\');
 			std::string texPath = delimPos == std::string::npos 
 				? StrUtils::Concat("effects\\", texDesc.source)
-				: StrUtils::Concat("effects\\", std::string_view(desc.name.c_str(), delimPos + 1), texDesc.source);
+				: StrUtils::Concat("effects\\", std::string_view(_desc.name.c_str(), delimPos + 1), texDesc.source);
 			_textures[i] = TextureLoader::Load(StrUtils::UTF8ToUTF16(texPath).c_str());
 			if (!_textures[i]) {
 				Logger::Get().Error(fmt::format("加载纹理 {} 失败", texDesc.source));
 				return false;
 			}
+			dr.GetMemoryTracker().Track(_textures[i].get(), GPUMemoryOwner::Effect, StrUtils::Concat(_desc.name, "/", texDesc.name));
 
 			if (texDesc.format != EffectIntermediateTextureFormat::UNKNOWN) {
 				// 检查纹理格式是否匹配
@@ -161,14 +350,7 @@ bool EffectDrawer::Initialize(
 				return false;
 			}
 
-			_textures[i] = dr.CreateTexture2D(
-				EffectHelper::FORMAT_DESCS[(UINT)texDesc.format].dxgiFormat,
-				texSize.cx,
-				texSize.cy,
-				D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS
-			);
-			if (!_textures[i]) {
-				Logger::Get().Error("创建纹理失败");
+			if (!updateTexture(_textures[i], EffectHelper::FORMAT_DESCS[(UINT)texDesc.format].dxgiFormat, texSize, texDesc.name)) {
 				return false;
 			}
 		}
@@ -176,37 +358,46 @@ bool EffectDrawer::Initialize(
 
 	if (!isLastEffect) {
 		// 创建输出纹理
-		_textures.back() = dr.CreateTexture2D(
-			DXGI_FORMAT_R8G8B8A8_UNORM,
-			outputSize.cx,
-			outputSize.cy,
-			D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS
-		);
-
-		if (!_textures.back()) {
-			Logger::Get().Error("创建纹理失败");
+		if (!updateTexture(_textures.back(), DXGI_FORMAT_R8G8B8A8_UNORM, outputSize, "OUTPUT")) {
 			return false;
 		}
 	} else {
 		_textures.back().copy_from(dr.GetBackBuffer());
 	}
 
-	_shaders.resize(desc.passes.size());
-	_srvs.resize(desc.passes.size());
-	_uavs.resize(desc.passes.size());
-	for (UINT i = 0; i < _shaders.size(); ++i) {
-		const EffectPassDesc& passDesc = desc.passes[i];
+	return true;
+}
 
-		HRESULT hr = d3dDevice->CreateComputeShader(
-			passDesc.cso->GetBufferPointer(), passDesc.cso->GetBufferSize(), nullptr, _shaders[i].put());
-		if (FAILED(hr)) {
-			Logger::Get().ComError("创建计算着色器失败", hr);
-			return false;
+bool EffectDrawer::_UpdateViews(SIZE outputSize) {
+	DeviceResources& dr = *_deviceResources;
+
+	// 旧的视图在替换前仍被持有，未改变的纹理可以从缓存中取出它们的视图
+	SmallVector<winrt::com_ptr<ID3D11ShaderResourceView>> textureSrvs(_textures.size());
+	SmallVector<winrt::com_ptr<ID3D11UnorderedAccessView>> textureUavs(_textures.size());
+
+	auto getSrv = [&](size_t idx) -> ID3D11ShaderResourceView* {
+		if (!textureSrvs[idx]) {
+			textureSrvs[idx] = dr.GetShaderResourceView(_textures[idx].get());
+		}
+		return textureSrvs[idx].get();
+	};
+	auto getUav = [&](size_t idx) -> ID3D11UnorderedAccessView* {
+		if (!textureUavs[idx]) {
+			textureUavs[idx] = dr.GetUnorderedAccessView(_textures[idx].get());
 		}
+		return textureUavs[idx].get();
+	};
+
+	_srvs.resize(_desc.passes.size());
+	_uavs.resize(_desc.passes.size());
+	_dispatches.clear();
+	for (UINT i = 0; i < _desc.passes.size(); ++i) {
+		const EffectPassDesc& passDesc = _desc.passes[i];
 
 		_srvs[i].resize(passDesc.inputs.size());
 		for (UINT j = 0; j < passDesc.inputs.size(); ++j) {
-			if (!dr.GetShaderResourceView(_textures[passDesc.inputs[j]].get(), &_srvs[i][j])) {
+			_srvs[i][j] = getSrv(passDesc.inputs[j]);
+			if (!_srvs[i][j]) {
 				Logger::Get().Error("GetShaderResourceView 失败");
 				return false;
 			}
@@ -215,7 +406,8 @@ bool EffectDrawer::Initialize(
 		if (!passDesc.outputs.empty()) {
 			_uavs[i].resize(passDesc.outputs.size() * 2);
 			for (UINT j = 0; j < passDesc.outputs.size(); ++j) {
-				if (!dr.GetUnorderedAccessView(_textures[passDesc.outputs[j]].get(), &_uavs[i][j])) {
+				_uavs[i][j] = getUav(passDesc.outputs[j]);
+				if (!_uavs[i][j]) {
 					Logger::Get().Error("GetUnorderedAccessView 失败");
 					return false;
 				}
@@ -230,7 +422,8 @@ bool EffectDrawer::Initialize(
 		} else {
 			// 最后一个 pass 输出到 OUTPUT
 			_uavs[i].resize(2);
-			if (!dr.GetUnorderedAccessView(_textures.back().get(), &_uavs[i][0])) {
+			_uavs[i][0] = getUav(_textures.size() - 1);
+			if (!_uavs[i][0]) {
 				Logger::Get().Error("GetUnorderedAccessView 失败");
 				return false;
 			}
@@ -245,29 +438,25 @@ bool EffectDrawer::Initialize(
 		}
 	}
 
-	if (isLastEffect) {
+	if (_desc.flags & EffectFlags::LastEffect) {
 		// 为光标渲染预留空间
 		_srvs.back().push_back(nullptr);
-
-		if (!dr.GetSampler(
-			MagApp::Get().GetOptions().cursorInterpolationMode == CursorInterpolationMode::NearestNeighbor ? D3D11_FILTER_MIN_MAG_MIP_POINT : D3D11_FILTER_MIN_MAG_MIP_LINEAR,
-			D3D11_TEXTURE_ADDRESS_CLAMP,
-			&_samplers.emplace_back(nullptr)
-			)) {
-			Logger::Get().Error("GetSampler 失败");
-			return false;
-		}
 	}
 
-	// 大小必须为 4 的倍数
-	size_t builtinConstantCount = isLastEffect ? 16 : 12;
-	size_t psStylePassParams = 0;
-	for (UINT i = 0, end = (UINT)desc.passes.size() - 1; i < end; ++i) {
-		if (desc.passes[i].isPSStyle) {
-			psStylePassParams += 4;
-		}
-	}
-	_constants.resize((builtinConstantCount + psStylePassParams + (isInlineParams ? 0 : desc.params.size()) + 3) / 4 * 4);
+	_textureSrvs = std::move(textureSrvs);
+	_textureUavs = std::move(textureUavs);
+	return true;
+}
+
+void EffectDrawer::_UpdateBuiltinConstants(
+	SIZE inputSize,
+	SIZE outputSize,
+	RECT* outputRect,
+	RECT* virtualOutputRect
+) {
+	const SIZE hostSize = Win32Utils::GetSizeOfRect(MagApp::Get().GetHostWndRect());
+	bool isLastEffect = _desc.flags & EffectFlags::LastEffect;
+
 	// cbuffer __CB2 : register(b1) {
 	//     uint2 __inputSize;
 	//     uint2 __outputSize;
@@ -328,83 +517,74 @@ bool EffectDrawer::Initialize(
 	}
 
 	// PS 样式的通道需要的参数
-	EffectHelper::Constant32* pCurParam = _constants.data() + builtinConstantCount;
-	if (psStylePassParams > 0) {
-		for (UINT i = 0, end = (UINT)desc.passes.size() - 1; i < end; ++i) {
-			if (desc.passes[i].isPSStyle) {
-				D3D11_TEXTURE2D_DESC outputDesc;
-				_textures[desc.passes[i].outputs[0]]->GetDesc(&outputDesc);
-				pCurParam->uintVal = outputDesc.Width;
-				++pCurParam;
-				pCurParam->uintVal = outputDesc.Height;
-				++pCurParam;
-				pCurParam->floatVal = 1.0f / outputDesc.Width;
-				++pCurParam;
-				pCurParam->floatVal = 1.0f / outputDesc.Height;
-				++pCurParam;
-			}
+	EffectHelper::Constant32* pCurParam = _constants.data() + _GetBuiltinConstantCount();
+	for (UINT i = 0, end = (UINT)_desc.passes.size() - 1; i < end; ++i) {
+		if (_desc.passes[i].isPSStyle) {
+			D3D11_TEXTURE2D_DESC outputDesc;
+			_textures[_desc.passes[i].outputs[0]]->GetDesc(&outputDesc);
+			pCurParam->uintVal = outputDesc.Width;
+			++pCurParam;
+			pCurParam->uintVal = outputDesc.Height;
+			++pCurParam;
+			pCurParam->floatVal = 1.0f / outputDesc.Width;
+			++pCurParam;
+			pCurParam->floatVal = 1.0f / outputDesc.Height;
+			++pCurParam;
+		}
+	}
+}
+
+bool EffectDrawer::_UpdateParameterConstants(const EffectOption& option) {
+	// 参数位于内置常量和 PS 样式通道的参数之后
+	EffectHelper::Constant32* pCurParam = _constants.data() + _GetBuiltinConstantCount();
+	for (UINT i = 0, end = (UINT)_desc.passes.size() - 1; i < end; ++i) {
+		if (_desc.passes[i].isPSStyle) {
+			pCurParam += 4;
 		}
 	}
 
-	if (!isInlineParams) {
-		for (UINT i = 0; i < desc.params.size(); ++i) {
-			const auto& paramDesc = desc.params[i];
-			auto it = option.parameters.find(StrUtils::UTF8ToUTF16(paramDesc.name));
+	for (UINT i = 0; i < _desc.params.size(); ++i) {
+		const auto& paramDesc = _desc.params[i];
+		auto it = option.parameters.find(StrUtils::UTF8ToUTF16(paramDesc.name));
 
-			if (paramDesc.constant.index() == 0) {
-				const EffectConstant<float>& constant = std::get<0>(paramDesc.constant);
-				float value = constant.defaultValue;
+		if (paramDesc.constant.index() == 0) {
+			const EffectConstant<float>& constant = std::get<0>(paramDesc.constant);
+			float value = constant.defaultValue;
 
-				if (it != option.parameters.end()) {
-					value = it->second;
+			if (it != option.parameters.end()) {
+				value = it->second;
 
-					if (value < constant.minValue || value > constant.maxValue) {
-						Logger::Get().Error(fmt::format("参数 {} 的值非法", paramDesc.name));
-						return false;
-					}
+				if (value < constant.minValue || value > constant.maxValue) {
+					Logger::Get().Error(fmt::format("参数 {} 的值非法", paramDesc.name));
+					return false;
 				}
+			}
 
-				pCurParam->floatVal = value;
-			} else {
-				const EffectConstant<int>& constant = std::get<1>(paramDesc.constant);
-				int value = constant.defaultValue;
+			pCurParam->floatVal = value;
+		} else {
+			const EffectConstant<int>& constant = std::get<1>(paramDesc.constant);
+			int value = constant.defaultValue;
 
-				if (it != option.parameters.end()) {
-					value = (int)std::lroundf(it->second);
+			if (it != option.parameters.end()) {
+				value = (int)std::lroundf(it->second);
 
-					if ((value < constant.minValue) || (value > constant.maxValue)) {
-						Logger::Get().Error(StrUtils::Concat("参数 ", paramDesc.name, " 的值非法"));
-						return false;
-					}
+				if ((value < constant.minValue) || (value > constant.maxValue)) {
+					Logger::Get().Error(StrUtils::Concat("参数 ", paramDesc.name, " 的值非法"));
+					return false;
 				}
-
-				pCurParam->intVal = value;
 			}
 
-			++pCurParam;
+			pCurParam->intVal = value;
 		}
-	}
-
-	D3D11_BUFFER_DESC bd{};
-	bd.Usage = D3D11_USAGE_DEFAULT;
-	bd.ByteWidth = 4 * (UINT)_constants.size();
-	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
 
-	D3D11_SUBRESOURCE_DATA initData{};
-	initData.pSysMem = _constants.data();
-
-	HRESULT hr = dr.GetD3DDevice()->CreateBuffer(&bd, &initData, _constantBuffer.put());
-	if (FAILED(hr)) {
-		Logger::Get().ComError("CreateBuffer 失败", hr);
-		return false;
+		++pCurParam;
 	}
 
 	return true;
 }
 
-void EffectDrawer::Draw(UINT& idx, bool noUpdate) {
-	auto d3dDC = MagApp::Get().GetDeviceResources().GetD3DDC();
-	auto& gpuTimer = MagApp::Get().GetRenderer().GetGPUTimer();
+void EffectDrawer::Draw(GPUTimer& gpuTimer, UINT& idx, bool noUpdate) {
+	auto d3dDC = _deviceResources->GetD3DDC();
 
 	{
 		ID3D11Buffer* t = _constantBuffer.get();
@@ -423,9 +603,19 @@ void EffectDrawer::Draw(UINT& idx, bool noUpdate) {
 	}
 }
 
+uint64_t EffectDrawer::GetThreadCount() const noexcept {
+	uint64_t result = 0;
+	for (size_t i = 0; i < _dispatches.size(); ++i) {
+		const std::array<uint32_t, 3>& numThreads = _desc.passes[i].numThreads;
+		result += (uint64_t)_dispatches[i].first * _dispatches[i].second
+			* numThreads[0] * numThreads[1] * numThreads[2];
+	}
+	return result;
+}
+
 void EffectDrawer::_DrawPass(UINT i) {
-	auto d3dDC = MagApp::Get().GetDeviceResources().GetD3DDC();
-	d3dDC->CSSetShader(_shaders[i].get(), nullptr, 0);
+	auto d3dDC = _deviceResources->GetD3DDC();
+	d3dDC->CSSetShader(_shaders[i], nullptr, 0);
 
 	if ((_desc.flags & EffectFlags::LastEffect) && i == _dispatches.size() - 1) {
 		// 最后一个效果的最后一个通道负责渲染光标
@@ -435,10 +625,13 @@ void EffectDrawer::_DrawPass(UINT i) {
 		if (cm.HasCursor()) {
 			ID3D11Texture2D* cursorTex;
 			CursorManager::CursorType ct;
-			if (cm.GetCursorTexture(&cursorTex, ct)) {
-				if (!MagApp::Get().GetDeviceResources().GetShaderResourceView(cursorTex, &_srvs[i].back())) {
+			RECT cursorTexRect;
+			if (cm.GetCursorTexture(&cursorTex, ct, cursorTexRect)) {
+				_cursorSrv = _deviceResources->GetShaderResourceView(cursorTex);
+				if (!_cursorSrv) {
 					Logger::Get().Error("GetShaderResourceView 出错");
 				}
+				_srvs[i].back() = _cursorSrv.get();
 			} else {
 				Logger::Get().Error("GetCursorTexture 出错");
 			}
@@ -6,6 +6,9 @@
 namespace Magpie::Core {
 
 struct EffectOption;
+enum class ScalingType;
+class GPUTimer;
+class DeviceResources;
 
 class EffectDrawer {
 public:
@@ -13,7 +16,11 @@ public:
 	EffectDrawer(const EffectDrawer&) = delete;
 	EffectDrawer(EffectDrawer&&) = default;
 
+	// 将中间纹理放回纹理池，因此 deviceResources 的生命周期应长于 EffectDrawer
+	~EffectDrawer();
+
 	bool Initialize(
+		DeviceResources& deviceResources,
 		const EffectDesc& desc,
 		const EffectOption& option,
 		ID3D11Texture2D* inputTex,
@@ -21,7 +28,24 @@ public:
 		RECT* virtualOutputRect = nullptr
 	);
 
-	void Draw(UINT& idx, bool noUpdate = false);
+	// 输入尺寸或主窗口尺寸改变后重新计算各纹理的尺寸，只重新分配尺寸改变的纹理
+	// 着色器和常量缓冲区保持不变
+	bool Resize(ID3D11Texture2D* inputTex, RECT* outputRect = nullptr, RECT* virtualOutputRect = nullptr);
+
+	// 就地更新非内联的参数
+	bool UpdateParameters(const EffectOption& option);
+
+	// 输入纹理被替换为尺寸相同的纹理时调用，只重新绑定 INPUT
+	bool SetInput(ID3D11Texture2D* inputTex);
+
+	// 之后需调用 Resize 使新的缩放选项生效
+	void SetScaling(ScalingType scalingType, std::pair<float, float> scale) noexcept {
+		_scalingType = scalingType;
+		_scale = scale;
+	}
+
+	// 每个通道结束后调用 gpuTimer.OnEndPass，idx 为通道在整个效果链中的序号
+	void Draw(GPUTimer& gpuTimer, UINT& idx, bool noUpdate = false);
 
 	bool IsUseDynamic() const noexcept {
 		return _desc.flags & EffectFlags::UseDynamic;
@@ -31,17 +55,43 @@ public:
 		return _desc;
 	}
 
+	// 所有通道的线程总数，用于粗略比较效果的开销
+	uint64_t GetThreadCount() const noexcept;
+
 	ID3D11Texture2D* GetOutputTexture() const noexcept {
 		return _textures.empty() ? nullptr : _textures.back().get();
 	}
 
 private:
+	bool _UpdateTextures(ID3D11Texture2D* inputTex, SIZE& inputSize, SIZE& outputSize);
+
+	bool _UpdateViews(SIZE outputSize);
+
+	void _UpdateBuiltinConstants(
+		SIZE inputSize,
+		SIZE outputSize,
+		RECT* outputRect,
+		RECT* virtualOutputRect
+	);
+
+	bool _UpdateParameterConstants(const EffectOption& option);
+
+	size_t _GetBuiltinConstantCount() const noexcept {
+		return (_desc.flags & EffectFlags::LastEffect) ? 16 : 12;
+	}
+
 	void _DrawPass(UINT i);
 
 	EffectDesc _desc;
+	ScalingType _scalingType{};
+	std::pair<float, float> _scale{ 1.0f, 1.0f };
 
 	SmallVector<ID3D11SamplerState*> _samplers;
 	SmallVector<winrt::com_ptr<ID3D11Texture2D>> _textures;
+	// 纹理的视图由效果持有，_srvs 和 _uavs 中是它们的指针。未使用的视图为空
+	SmallVector<winrt::com_ptr<ID3D11ShaderResourceView>> _textureSrvs;
+	SmallVector<winrt::com_ptr<ID3D11UnorderedAccessView>> _textureUavs;
+	winrt::com_ptr<ID3D11ShaderResourceView> _cursorSrv;
 	std::vector<SmallVector<ID3D11ShaderResourceView*>> _srvs;
 	// 后半部分为空，用于解绑
 	std::vector<SmallVector<ID3D11UnorderedAccessView*>> _uavs;
@@ -49,7 +99,10 @@ private:
 	SmallVector<EffectHelper::Constant32, 32> _constants;
 	winrt::com_ptr<ID3D11Buffer> _constantBuffer;
 
-	SmallVector<winrt::com_ptr<ID3D11ComputeShader>> _shaders;
+	// 由 DeviceResources 缓存，析构时归还
+	SmallVector<ID3D11ComputeShader*> _shaders;
+
+	DeviceResources* _deviceResources = nullptr;
 
 	SmallVector<std::pair<UINT, UINT>> _dispatches;
 };
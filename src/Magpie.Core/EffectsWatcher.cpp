@@ -0,0 +1,266 @@
+#include "pch.h"
+#include "EffectsWatcher.h"
+#include "Logger.h"
+#include "StrUtils.h"
+#include "CommonSharedConstants.h"
+#include "SmallVector.h"
+
+namespace Magpie::Core {
+
+// 接收通知的缓冲区大小，溢出时无法得知哪些文件改变
+static constexpr DWORD NOTIFY_BUFFER_SIZE = 16384;
+
+// 编辑器保存文件时常产生多个通知，等待这段时间没有新的通知后再提交
+static constexpr DWORD MERGE_INTERVAL = 200;
+
+EffectsWatcher::~EffectsWatcher() {
+	if (_hThread) {
+		SetEvent(_hExitEvent.get());
+		WaitForSingleObject(_hThread.get(), INFINITE);
+	}
+}
+
+bool EffectsWatcher::Initialize(HWND hwndNotify) noexcept {
+	_hwndNotify = hwndNotify;
+
+	_hEffectsDir.reset(Win32Utils::SafeHandle(CreateFile(
+		CommonSharedConstants::EFFECTS_DIR,
+		FILE_LIST_DIRECTORY,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+		nullptr
+	)));
+	if (!_hEffectsDir) {
+		Logger::Get().Win32Error("打开 effects 文件夹失败");
+		return false;
+	}
+
+	_hExitEvent.reset(CreateEvent(nullptr, TRUE, FALSE, nullptr));
+	if (!_hExitEvent) {
+		Logger::Get().Win32Error("CreateEvent 失败");
+		return false;
+	}
+
+	_hThread.reset(CreateThread(nullptr, 0, _ThreadProc, this, 0, nullptr));
+	if (!_hThread) {
+		Logger::Get().Win32Error("CreateThread 失败");
+		return false;
+	}
+
+	Logger::Get().Info("已开始监视 effects 文件夹");
+	return true;
+}
+
+phmap::flat_hash_set<std::wstring> EffectsWatcher::TakeChangedFiles() noexcept {
+	if (!_hasChanges.load(std::memory_order_acquire)) {
+		return {};
+	}
+
+	std::scoped_lock lk(_mutex);
+	_hasChanges.store(false, std::memory_order_relaxed);
+	return std::exchange(_changedFiles, {});
+}
+
+// 转换为 TakeChangedFiles 返回的形式，并去除 "." 和 ".."
+static std::wstring NormalizePath(std::wstring_view path) noexcept {
+	SmallVector<std::wstring_view> segments;
+
+	size_t segStart = 0;
+	for (size_t i = 0; i <= path.size(); ++i) {
+		if (i != path.size() && path[i] != L'\\' && path[i] != L'/') {
+			continue;
+		}
+
+		std::wstring_view segment = path.substr(segStart, i - segStart);
+		segStart = i + 1;
+
+		if (segment.empty() || segment == L".") {
+			continue;
+		}
+
+		if (segment == L"..") {
+			if (!segments.empty()) {
+				segments.pop_back();
+			}
+		} else {
+			segments.push_back(segment);
+		}
+	}
+
+	std::wstring result;
+	for (std::wstring_view segment : segments) {
+		if (!result.empty()) {
+			result.push_back(L'\\');
+		}
+		result.append(segment);
+	}
+
+	StrUtils::ToLowerCase(result);
+	return result;
+}
+
+// 递归查找包含的文件。和 EffectCompiler 中的 PassInclude 相同，路径都相对于效果所在的文件夹
+// 不处理注释和条件编译，可能多找到一些文件
+static void CollectIncludes(
+	const std::wstring& fileName,
+	std::wstring_view localDir,
+	phmap::flat_hash_set<std::wstring>& result
+) noexcept {
+	std::string source;
+	if (!Win32Utils::ReadTextFile(StrUtils::Concat(CommonSharedConstants::EFFECTS_DIR, fileName).c_str(), source)) {
+		return;
+	}
+
+	static constexpr std::string_view INCLUDE_DIRECTIVE = "#include";
+
+	std::string_view sourceView(source);
+	for (size_t pos = sourceView.find(INCLUDE_DIRECTIVE); pos != std::string_view::npos;
+		pos = sourceView.find(INCLUDE_DIRECTIVE, pos)
+	) {
+		pos += INCLUDE_DIRECTIVE.size();
+
+		const size_t start = sourceView.find_first_of("\"<\n", pos);
+		if (start == std::string_view::npos || sourceView[start] == '\n') {
+			continue;
+		}
+
+		const size_t end = sourceView.find_first_of(sourceView[start] == '"' ? "\"\n" : ">\n", start + 1);
+		if (end == std::string_view::npos || sourceView[end] == '\n') {
+			continue;
+		}
+
+		std::wstring includeFileName = NormalizePath(StrUtils::Concat(
+			localDir, StrUtils::UTF8ToUTF16(sourceView.substr(start + 1, end - start - 1))));
+		if (result.insert(includeFileName).second) {
+			CollectIncludes(includeFileName, localDir, result);
+		}
+
+		pos = end;
+	}
+}
+
+bool EffectsWatcher::IsEffectChanged(
+	std::wstring_view effectName,
+	const phmap::flat_hash_set<std::wstring>& changedFiles
+) noexcept {
+	if (changedFiles.contains(std::wstring())) {
+		return true;
+	}
+
+	std::wstring effectFileName = NormalizePath(StrUtils::Concat(effectName, L".hlsl"));
+	if (changedFiles.contains(effectFileName)) {
+		return true;
+	}
+
+	const size_t delimPos = effectFileName.find_last_of(L'\\');
+	std::wstring_view localDir = delimPos == std::wstring::npos
+		? std::wstring_view()
+		: std::wstring_view(effectFileName.c_str(), delimPos + 1);
+
+	phmap::flat_hash_set<std::wstring> includes;
+	CollectIncludes(effectFileName, localDir, includes);
+
+	for (const std::wstring& include : includes) {
+		if (changedFiles.contains(include)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+DWORD WINAPI EffectsWatcher::_ThreadProc(LPVOID lpThreadParameter) {
+	EffectsWatcher& that = *(EffectsWatcher*)lpThreadParameter;
+	HANDLE hEffectsDir = that._hEffectsDir.get();
+
+	Win32Utils::ScopedHandle hIOEvent(CreateEvent(nullptr, TRUE, FALSE, nullptr));
+	if (!hIOEvent) {
+		Logger::Get().Win32Error("CreateEvent 失败");
+		return 1;
+	}
+
+	OVERLAPPED overlapped{};
+	overlapped.hEvent = hIOEvent.get();
+
+	// FILE_NOTIFY_INFORMATION 需 DWORD 对齐
+	std::unique_ptr<DWORD[]> buffer(new DWORD[NOTIFY_BUFFER_SIZE / sizeof(DWORD)]);
+
+	const HANDLE handles[] = { that._hExitEvent.get(), hIOEvent.get() };
+
+	// 尚未提交的改变
+	phmap::flat_hash_set<std::wstring> changedFiles;
+	bool isReading = false;
+
+	while (true) {
+		if (!isReading) {
+			ResetEvent(hIOEvent.get());
+			if (!ReadDirectoryChangesW(hEffectsDir, buffer.get(), NOTIFY_BUFFER_SIZE, TRUE,
+				FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE, nullptr, &overlapped, nullptr)
+			) {
+				Logger::Get().Win32Error("ReadDirectoryChangesW 失败");
+				break;
+			}
+			isReading = true;
+		}
+
+		const DWORD waitResult = WaitForMultipleObjects(
+			(DWORD)std::size(handles), handles, FALSE, changedFiles.empty() ? INFINITE : MERGE_INTERVAL);
+
+		if (waitResult == WAIT_TIMEOUT) {
+			{
+				std::scoped_lock lk(that._mutex);
+				that._changedFiles.insert(changedFiles.begin(), changedFiles.end());
+				that._hasChanges.store(true, std::memory_order_release);
+			}
+			changedFiles.clear();
+
+			// 唤醒可能正在等待新帧的缩放线程
+			PostMessage(that._hwndNotify, WM_NULL, 0, 0);
+			continue;
+		}
+
+		if (waitResult != WAIT_OBJECT_0 + 1) {
+			// 退出
+			break;
+		}
+
+		isReading = false;
+
+		DWORD bytesReturned = 0;
+		if (!GetOverlappedResult(hEffectsDir, &overlapped, &bytesReturned, FALSE)) {
+			Logger::Get().Win32Error("GetOverlappedResult 失败");
+			break;
+		}
+
+		if (bytesReturned == 0) {
+			// 缓冲区溢出
+			changedFiles.emplace();
+			continue;
+		}
+
+		const BYTE* cur = (const BYTE*)buffer.get();
+		while (true) {
+			const FILE_NOTIFY_INFORMATION& info = *(const FILE_NOTIFY_INFORMATION*)cur;
+			changedFiles.insert(NormalizePath(
+				std::wstring_view(info.FileName, info.FileNameLength / sizeof(WCHAR))));
+
+			if (info.NextEntryOffset == 0) {
+				break;
+			}
+			cur += info.NextEntryOffset;
+		}
+	}
+
+	if (isReading) {
+		CancelIoEx(hEffectsDir, &overlapped);
+
+		DWORD bytesReturned = 0;
+		GetOverlappedResult(hEffectsDir, &overlapped, &bytesReturned, TRUE);
+	}
+
+	return 0;
+}
+
+}
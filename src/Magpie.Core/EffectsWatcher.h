@@ -0,0 +1,41 @@
+#pragma once
+#include "Win32Utils.h"
+#include <parallel_hashmap/phmap.h>
+
+namespace Magpie::Core {
+
+// 监视 effects 文件夹中的文件改变，用于缩放时热重载效果
+// 在单独的线程中接收通知
+class EffectsWatcher {
+public:
+	EffectsWatcher() = default;
+	EffectsWatcher(const EffectsWatcher&) = delete;
+	EffectsWatcher(EffectsWatcher&&) = delete;
+
+	~EffectsWatcher();
+
+	// 文件改变后向 hwndNotify 发送 WM_NULL
+	bool Initialize(HWND hwndNotify) noexcept;
+
+	// 取出自上次调用以来改变的文件，路径相对于 effects 文件夹，使用 '\' 分隔且为小写
+	// 包含空字符串时表示无法得知哪些文件改变
+	phmap::flat_hash_set<std::wstring> TakeChangedFiles() noexcept;
+
+	// 检查效果的源文件或它包含的文件是否在 changedFiles 中
+	static bool IsEffectChanged(std::wstring_view effectName, const phmap::flat_hash_set<std::wstring>& changedFiles) noexcept;
+
+private:
+	static DWORD WINAPI _ThreadProc(LPVOID lpThreadParameter);
+
+	Win32Utils::ScopedHandle _hEffectsDir;
+	Win32Utils::ScopedHandle _hExitEvent;
+	Win32Utils::ScopedHandle _hThread;
+	HWND _hwndNotify = NULL;
+
+	// 用于同步对 _changedFiles 的访问
+	Win32Utils::SRWMutex _mutex;
+	phmap::flat_hash_set<std::wstring> _changedFiles;
+	std::atomic<bool> _hasChanges = false;
+};
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <array>
+#include <atomic>
+
+namespace Magpie::Core {
+
+// 用于在捕获线程和渲染线程间传递帧的三重缓冲，无锁
+// 生产者和消费者各独占一个缓冲区，剩下的一个用于交换。生产者总是可以写入，
+// 消费者总是取得最新的帧，未被取走的旧帧会被覆盖
+// 只支持一个生产者和一个消费者
+template <typename T>
+class FrameMailbox {
+public:
+	FrameMailbox() = default;
+	FrameMailbox(const FrameMailbox&) = delete;
+	FrameMailbox(FrameMailbox&&) = delete;
+
+	// 用于在开始传递前初始化所有缓冲区
+	std::array<T, 3>& GetBuffers() noexcept {
+		return _buffers;
+	}
+
+	// 生产者当前独占的缓冲区
+	T& GetWriteBuffer() noexcept {
+		return _buffers[_writeIndex];
+	}
+
+	uint32_t GetWriteIndex() const noexcept {
+		return _writeIndex;
+	}
+
+	// 生产者发布已写入的缓冲区，之后 GetWriteBuffer 将返回另一个缓冲区
+	void Publish() noexcept {
+		const uint32_t prev = _middle.exchange(_writeIndex | NEW_FRAME_FLAG, std::memory_order_acq_rel);
+		_writeIndex = prev & INDEX_MASK;
+	}
+
+	// 消费者取得最新发布的缓冲区，没有新的帧时返回 nullptr。
+	// 返回的缓冲区由消费者独占，直到下一次成功调用
+	T* TryConsume() noexcept {
+		if (!(_middle.load(std::memory_order_relaxed) & NEW_FRAME_FLAG)) {
+			return nullptr;
+		}
+
+		const uint32_t prev = _middle.exchange(_readIndex, std::memory_order_acq_rel);
+		_readIndex = prev & INDEX_MASK;
+		return &_buffers[_readIndex];
+	}
+
+	// 消费者当前独占的缓冲区，尚未取得过帧时为初始的缓冲区
+	T& GetReadBuffer() noexcept {
+		return _buffers[_readIndex];
+	}
+
+private:
+	static constexpr uint32_t INDEX_MASK = 0x3;
+	static constexpr uint32_t NEW_FRAME_FLAG = 0x4;
+
+	std::array<T, 3> _buffers{};
+
+	// 只由生产者访问
+	uint32_t _writeIndex = 0;
+	// 用于交换的缓冲区，NEW_FRAME_FLAG 表示它是尚未被取走的新帧
+	std::atomic<uint32_t> _middle = 1;
+	// 只由消费者访问
+	uint32_t _readIndex = 2;
+};
+
+}
@@ -0,0 +1,62 @@
+#include "pch.h"
+#include "FramePacer.h"
+
+namespace Magpie::Core {
+
+// 使用这个百分位的渲染用时作为预测值，偶尔的波动由安全余量吸收
+static constexpr uint32_t PREDICTION_PERCENTILE = 90;
+
+FramePacer::Schedule FramePacer::GetSchedule(
+	int64_t now,
+	int64_t lastVBlank,
+	int64_t period,
+	int64_t margin
+) const noexcept {
+	if (period <= 0) {
+		return { now, now };
+	}
+
+	// 下一次垂直同步
+	int64_t deadline = lastVBlank;
+	if (deadline <= now) {
+		deadline += ((now - deadline) / period + 1) * period;
+	}
+
+	if (_predictedRenderTime < 0) {
+		return { now, deadline };
+	}
+
+	const int64_t wakeTime = deadline - _predictedRenderTime - margin;
+	// 来不及时立即开始，不推迟到下一次垂直同步，那样反而增加延迟
+	return { std::max(wakeTime, now), deadline };
+}
+
+void FramePacer::AddSample(const Schedule& schedule, int64_t startTime, int64_t endTime) noexcept {
+	++_frameCount;
+	if (endTime > schedule.deadline) {
+		++_missCount;
+	}
+
+	_samples[_nextSample] = endTime - startTime;
+	_nextSample = (_nextSample + 1) % MAX_SAMPLES;
+	if (_sampleCount < MAX_SAMPLES) {
+		++_sampleCount;
+	}
+
+	_UpdatePrediction();
+}
+
+void FramePacer::_UpdatePrediction() noexcept {
+	if (_sampleCount < MIN_SAMPLES) {
+		_predictedRenderTime = -1;
+		return;
+	}
+
+	std::array<int64_t, MAX_SAMPLES> sorted = _samples;
+	const auto end = sorted.begin() + _sampleCount;
+	const auto nth = sorted.begin() + (_sampleCount - 1) * PREDICTION_PERCENTILE / 100;
+	std::nth_element(sorted.begin(), nth, end);
+	_predictedRenderTime = *nth;
+}
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <array>
+
+namespace Magpie::Core {
+
+// 帧调度的预测模型。根据最近的渲染用时预测下一帧的用时，计算开始捕获的时刻，
+// 使帧在垂直同步前尽可能晚地完成，以缩短捕获到显示的延迟
+// 只进行计算，不依赖 D3D 和 DWM。时间可以使用任意单位，通常为 QPC 计数
+class FramePacer {
+public:
+	struct Schedule {
+		// 应开始捕获和渲染的时刻
+		int64_t wakeTime = 0;
+		// 帧需在此之前完成，即预测的下一次垂直同步
+		int64_t deadline = 0;
+	};
+
+	// 计算调度。now 为当前时刻，lastVBlank 为最近一次垂直同步的时刻，period 为刷新间隔，
+	// margin 为安全余量。样本不足或来不及时 wakeTime 为 now
+	Schedule GetSchedule(int64_t now, int64_t lastVBlank, int64_t period, int64_t margin) const noexcept;
+
+	// 记录一帧的渲染用时。schedule 为这一帧的调度，startTime 和 endTime 为实际开始和完成的时刻
+	void AddSample(const Schedule& schedule, int64_t startTime, int64_t endTime) noexcept;
+
+	// 预测的渲染用时，样本不足时返回 -1
+	int64_t PredictRenderTime() const noexcept {
+		return _predictedRenderTime;
+	}
+
+	uint32_t GetFrameCount() const noexcept {
+		return _frameCount;
+	}
+
+	// 估计的错过垂直同步的次数
+	uint32_t GetMissCount() const noexcept {
+		return _missCount;
+	}
+
+private:
+	void _UpdatePrediction() noexcept;
+
+	static constexpr uint32_t MAX_SAMPLES = 64;
+	// 至少有这么多样本才开始调度
+	static constexpr uint32_t MIN_SAMPLES = 8;
+
+	std::array<int64_t, MAX_SAMPLES> _samples{};
+	uint32_t _sampleCount = 0;
+	uint32_t _nextSample = 0;
+
+	int64_t _predictedRenderTime = -1;
+
+	uint32_t _frameCount = 0;
+	uint32_t _missCount = 0;
+};
+
+}
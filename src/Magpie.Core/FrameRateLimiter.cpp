@@ -0,0 +1,125 @@
+#include "pch.h"
+#include "FrameRateLimiter.h"
+#include "Logger.h"
+#include "Utils.h"
+
+namespace Magpie::Core {
+
+// 计时器的唤醒时间通常有数百微秒的误差，最后这段时间自旋等待
+static constexpr int64_t SPIN_TIME_US = 500;
+
+// 源窗口的帧率低于这个值时不再跟随，否则源窗口静止时光标会变得卡顿
+static constexpr float MIN_SOURCE_FRAME_RATE = 30.0f;
+
+// 测量源窗口帧率时新样本的权重
+static constexpr double SOURCE_FRAME_INTERVAL_ALPHA = 0.1;
+
+bool FrameRateLimiter::Initialize(float maxFrameRate, bool limitToSourceFrameRate) noexcept {
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	_qpcFrequency = frequency.QuadPart;
+	_spinTime = _qpcFrequency * SPIN_TIME_US / 1'000'000;
+
+	// 高精度计时器从 Win10 v1803 开始提供
+	_hTimer.reset(CreateWaitableTimerEx(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS));
+	if (!_hTimer) {
+		_hTimer.reset(CreateWaitableTimerEx(nullptr, nullptr, 0, TIMER_ALL_ACCESS));
+		if (!_hTimer) {
+			Logger::Get().Win32Error("CreateWaitableTimerEx 失败");
+			return false;
+		}
+	}
+
+	_maxFrameRateInterval = maxFrameRate > 0 ? int64_t(_qpcFrequency / maxFrameRate) : 0;
+	_isLimitToSourceFrameRate = limitToSourceFrameRate;
+	_jitterStartTime = Utils::GetQPC();
+
+	Logger::Get().Info(fmt::format("已启用帧率限制\n\t最大帧率：{}\n\t跟随源窗口：{}",
+		maxFrameRate, limitToSourceFrameRate ? "是" : "否"));
+	return true;
+}
+
+void FrameRateLimiter::WaitForNextFrame() noexcept {
+	int64_t now = Utils::GetQPC();
+
+	const int64_t interval = _GetFrameInterval();
+	const int64_t targetTime = _lastTargetTime + interval;
+
+	if (interval == 0 || _lastTargetTime == 0 || targetTime <= now) {
+		// 来不及或无需等待时以当前时刻为基准，否则之后的帧会试图追赶
+		if (interval != 0 && _lastFrameTime != 0) {
+			_AddJitterSample(now - _lastFrameTime, interval);
+		}
+
+		_lastTargetTime = now;
+		_lastFrameTime = now;
+		return;
+	}
+
+	if (targetTime - now > _spinTime) {
+		// 负值表示相对时间，单位为 100 纳秒
+		LARGE_INTEGER dueTime;
+		dueTime.QuadPart = -(targetTime - _spinTime - now) * 10'000'000 / _qpcFrequency;
+		if (SetWaitableTimerEx(_hTimer.get(), &dueTime, 0, nullptr, nullptr, nullptr, 0)) {
+			WaitForSingleObject(_hTimer.get(), INFINITE);
+		} else {
+			Logger::Get().Win32Error("SetWaitableTimerEx 失败");
+		}
+	}
+
+	do {
+		YieldProcessor();
+		now = Utils::GetQPC();
+	} while (now < targetTime);
+
+	_AddJitterSample(now - _lastFrameTime, interval);
+
+	// 以目标时刻为基准，避免误差累积
+	_lastTargetTime = targetTime;
+	_lastFrameTime = now;
+}
+
+void FrameRateLimiter::OnSourceFrame(int64_t captureTime) noexcept {
+	if (!_isLimitToSourceFrameRate) {
+		return;
+	}
+
+	// 帧源改变时捕获的时刻可能不再递增，只重新开始测量
+	if (_lastSourceFrameTime != 0 && captureTime > _lastSourceFrameTime) {
+		// 源窗口静止后的第一帧间隔很长，限制它的影响
+		const double interval = (double)std::min(captureTime - _lastSourceFrameTime, int64_t(_qpcFrequency / MIN_SOURCE_FRAME_RATE));
+		_sourceFrameInterval = _sourceFrameInterval == 0 ? interval
+			: _sourceFrameInterval + (interval - _sourceFrameInterval) * SOURCE_FRAME_INTERVAL_ALPHA;
+	}
+	_lastSourceFrameTime = captureTime;
+}
+
+float FrameRateLimiter::GetFrameRateLimit() const noexcept {
+	const int64_t interval = _GetFrameInterval();
+	return interval == 0 ? 0.0f : float(_qpcFrequency) / interval;
+}
+
+int64_t FrameRateLimiter::_GetFrameInterval() const noexcept {
+	if (!_isLimitToSourceFrameRate) {
+		return _maxFrameRateInterval;
+	}
+
+	// 比源窗口的帧率略高一些，避免因测量误差丢帧
+	const int64_t sourceInterval = int64_t(_sourceFrameInterval * 0.9);
+	return std::max(sourceInterval, _maxFrameRateInterval);
+}
+
+void FrameRateLimiter::_AddJitterSample(int64_t frameInterval, int64_t targetInterval) noexcept {
+	_jitterSum += std::abs(frameInterval - targetInterval);
+	++_jitterCount;
+
+	const int64_t now = _lastFrameTime + frameInterval;
+	if (now - _jitterStartTime >= _qpcFrequency) {
+		_jitter = float(_jitterSum * 1000.0 / _jitterCount / _qpcFrequency);
+		_jitterSum = 0;
+		_jitterCount = 0;
+		_jitterStartTime = now;
+	}
+}
+
+}
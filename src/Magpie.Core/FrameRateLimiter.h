@@ -0,0 +1,60 @@
+#pragma once
+#include "Win32Utils.h"
+
+namespace Magpie::Core {
+
+// 不使用垂直同步时限制帧率
+// 使用高精度计时器等待，只在最后一小段时间自旋以提高精度
+class FrameRateLimiter {
+public:
+	FrameRateLimiter() = default;
+	FrameRateLimiter(const FrameRateLimiter&) = delete;
+	FrameRateLimiter(FrameRateLimiter&&) = delete;
+
+	// maxFrameRate 为 0 表示只限制到源窗口的帧率
+	bool Initialize(float maxFrameRate, bool limitToSourceFrameRate) noexcept;
+
+	// 在每帧开始前调用，等待到和上一帧间隔足够的时刻
+	void WaitForNextFrame() noexcept;
+
+	// 帧源有新帧时调用，用于测量源窗口的帧率。captureTime 为帧被捕获的时刻，单位为 QPC 计数。
+	// 使用捕获的时刻而不是调用的时刻，渲染线程的调度不会影响测得的间隔
+	void OnSourceFrame(int64_t captureTime) noexcept;
+
+	// 当前限制的帧率，尚未测得源窗口的帧率时可能为 0
+	float GetFrameRateLimit() const noexcept;
+
+	// 最近一秒中帧间隔和目标间隔的平均偏差，单位为 ms
+	float GetJitter() const noexcept {
+		return _jitter;
+	}
+
+private:
+	// 两帧之间的目标间隔，单位为 QPC 计数，0 表示不限制
+	int64_t _GetFrameInterval() const noexcept;
+
+	void _AddJitterSample(int64_t frameInterval, int64_t targetInterval) noexcept;
+
+	Win32Utils::ScopedHandle _hTimer;
+	int64_t _qpcFrequency = 0;
+	// 自旋等待的时长，计时器的精度无法满足这段时间的需求
+	int64_t _spinTime = 0;
+
+	int64_t _maxFrameRateInterval = 0;
+	bool _isLimitToSourceFrameRate = false;
+
+	// 上一帧的目标开始时刻和实际开始时刻
+	int64_t _lastTargetTime = 0;
+	int64_t _lastFrameTime = 0;
+
+	// 源窗口帧间隔的指数移动平均
+	int64_t _lastSourceFrameTime = 0;
+	double _sourceFrameInterval = 0;
+
+	int64_t _jitterSum = 0;
+	uint32_t _jitterCount = 0;
+	int64_t _jitterStartTime = 0;
+	float _jitter = 0.0f;
+};
+
+}
@@ -25,13 +25,26 @@ public:
 
 	virtual bool IsScreenCapture() = 0;
 
+	// 源窗口位置或大小改变后就地更新捕获区域，输出纹理的尺寸可能随之改变
+	// 返回 false 表示不支持或更新失败，需要重新开始缩放
+	virtual bool OnSrcWndRectChanged() {
+		return false;
+	}
+
 	// 注意：此函数返回源窗口作为输入部分的位置，但可能和 GetOutput 获取到的纹理尺寸不同
 	const RECT& GetSrcFrameRect() const noexcept { return _srcFrameRect; }
 
+	// 直接使用捕获到的纹理时每帧返回的纹理可能不同，但尺寸不变
 	ID3D11Texture2D* GetOutput() {
 		return _output.get();
 	}
 
+	// 最新的帧被捕获的时刻，单位为 QPC 计数。为 0 表示帧源无法得知，
+	// 此时可认为在 Update 中捕获
+	int64_t GetFrameTime() const noexcept {
+		return _frameTime;
+	}
+
 	virtual const char* GetName() const noexcept = 0;
 
 protected:
@@ -55,6 +68,7 @@ protected:
 	RECT _srcFrameRect{};
 
 	winrt::com_ptr<ID3D11Texture2D> _output;
+	int64_t _frameTime = 0;
 
 	bool _roundCornerDisabled = false;
 	bool _windowResizingDisabled = false;
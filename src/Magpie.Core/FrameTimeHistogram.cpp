@@ -0,0 +1,91 @@
+#include "pch.h"
+#include "FrameTimeHistogram.h"
+#include <bit>
+
+namespace Magpie::Core {
+
+FrameTimeHistogram::FrameTimeHistogram(uint32_t windowSize)
+	: _samples(std::make_unique<uint32_t[]>(windowSize)), _windowSize(windowSize) {
+	assert(windowSize > 0);
+}
+
+void FrameTimeHistogram::AddSample(float value) noexcept {
+	if (value < 0) {
+		return;
+	}
+
+	// 转换为微秒，过大的值没有意义，只需避免溢出
+	const uint32_t us = (uint32_t)std::min(value * 1000.0f + 0.5f, 4e9f);
+
+	if (_sampleCount == _windowSize) {
+		// 移出最早的样本
+		--_buckets[_GetBucketIndex(_samples[_nextSample])];
+	} else {
+		++_sampleCount;
+	}
+
+	_samples[_nextSample] = us;
+	_nextSample = (_nextSample + 1) % _windowSize;
+	++_buckets[_GetBucketIndex(us)];
+}
+
+float FrameTimeHistogram::GetPercentile(float percentile) const noexcept {
+	if (_sampleCount == 0) {
+		return -1.0f;
+	}
+
+	// 第几个样本，从 1 开始
+	const uint32_t rank = std::clamp((uint32_t)std::ceil(percentile / 100.0f * _sampleCount), 1u, _sampleCount);
+
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < BUCKET_COUNT; ++i) {
+		count += _buckets[i];
+		if (count >= rank) {
+			return _GetBucketValue(i) / 1000.0f;
+		}
+	}
+
+	assert(false);
+	return -1.0f;
+}
+
+float FrameTimeHistogram::GetMax() const noexcept {
+	if (_sampleCount == 0) {
+		return -1.0f;
+	}
+
+	uint32_t maxValue = 0;
+	for (uint32_t i = 0; i < _sampleCount; ++i) {
+		maxValue = std::max(maxValue, _samples[i]);
+	}
+	return maxValue / 1000.0f;
+}
+
+void FrameTimeHistogram::Reset() noexcept {
+	_buckets.fill(0);
+	_nextSample = 0;
+	_sampleCount = 0;
+}
+
+uint32_t FrameTimeHistogram::_GetBucketIndex(uint32_t value) noexcept {
+	if (value < SUB_BUCKET_COUNT) {
+		return value;
+	}
+
+	// 右移 shift 位后落在 [HALF_SUB_BUCKET_COUNT, SUB_BUCKET_COUNT)
+	const uint32_t shift = (uint32_t)std::bit_width(value) - SUB_BUCKET_BITS;
+	return SUB_BUCKET_COUNT + (shift - 1) * HALF_SUB_BUCKET_COUNT + ((value >> shift) - HALF_SUB_BUCKET_COUNT);
+}
+
+float FrameTimeHistogram::_GetBucketValue(uint32_t idx) noexcept {
+	if (idx < SUB_BUCKET_COUNT) {
+		return (float)idx;
+	}
+
+	const uint32_t shift = (idx - SUB_BUCKET_COUNT) / HALF_SUB_BUCKET_COUNT + 1;
+	const uint32_t subIdx = (idx - SUB_BUCKET_COUNT) % HALF_SUB_BUCKET_COUNT + HALF_SUB_BUCKET_COUNT;
+	const uint64_t lowerBound = (uint64_t)subIdx << shift;
+	return lowerBound + ((1ull << shift) - 1) / 2.0f;
+}
+
+}
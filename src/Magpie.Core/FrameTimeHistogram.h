@@ -0,0 +1,49 @@
+#pragma once
+#include <array>
+
+namespace Magpie::Core {
+
+// 统计最近若干个样本的分布，用于计算百分位数。桶的宽度随数值按 2 的幂增长（类似 HdrHistogram），
+// 相对误差不超过约 3%。所有内存在构造时分配，添加样本和查询都不分配内存
+class FrameTimeHistogram {
+public:
+	// windowSize 为滑动窗口包含的样本数
+	explicit FrameTimeHistogram(uint32_t windowSize);
+
+	// 单位为 ms，负数被忽略
+	void AddSample(float value) noexcept;
+
+	// percentile 的范围为 [0, 100]。单位为 ms，没有样本时为负数
+	float GetPercentile(float percentile) const noexcept;
+
+	// 窗口内的最大值，是精确值
+	float GetMax() const noexcept;
+
+	uint32_t GetSampleCount() const noexcept {
+		return _sampleCount;
+	}
+
+	void Reset() noexcept;
+
+private:
+	// 低于 SUB_BUCKET_COUNT 微秒的值每个桶宽 1 微秒，之后每翻一倍使用 SUB_BUCKET_COUNT / 2 个桶
+	static constexpr uint32_t SUB_BUCKET_BITS = 6;
+	static constexpr uint32_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+	static constexpr uint32_t HALF_SUB_BUCKET_COUNT = SUB_BUCKET_COUNT / 2;
+	static constexpr uint32_t BUCKET_COUNT = SUB_BUCKET_COUNT + (32 - SUB_BUCKET_BITS) * HALF_SUB_BUCKET_COUNT;
+
+	static uint32_t _GetBucketIndex(uint32_t value) noexcept;
+
+	// 桶的中点，单位为微秒
+	static float _GetBucketValue(uint32_t idx) noexcept;
+
+	std::array<uint32_t, BUCKET_COUNT> _buckets{};
+
+	// 窗口内的样本，单位为微秒，用于移出最早的样本
+	std::unique_ptr<uint32_t[]> _samples;
+	uint32_t _windowSize = 0;
+	uint32_t _nextSample = 0;
+	uint32_t _sampleCount = 0;
+};
+
+}
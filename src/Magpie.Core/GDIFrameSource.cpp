@@ -3,10 +3,16 @@
 #include "MagApp.h"
 #include "DeviceResources.h"
 #include "Logger.h"
+#include "Utils.h"
 
 
 namespace Magpie::Core {
 
+GDIFrameSource::~GDIFrameSource() {
+	_StopCaptureThread();
+	_ReleaseFrameBitmaps();
+}
+
 bool GDIFrameSource::Initialize() {
 	if (!FrameSourceBase::Initialize()) {
 		Logger::Get().Error("初始化 FrameSourceBase 失败");
@@ -18,6 +24,92 @@ bool GDIFrameSource::Initialize() {
 		return false;
 	}
 
+	if (!_CalcFrameRect()) {
+		Logger::Get().Error("_CalcFrameRect 失败");
+		return false;
+	}
+
+	if (!_CreateOutput()) {
+		Logger::Get().Error("_CreateOutput 失败");
+		return false;
+	}
+
+	if (!_CreateFrameBitmaps()) {
+		Logger::Get().Error("_CreateFrameBitmaps 失败");
+		return false;
+	}
+
+	_hwndSrc = MagApp::Get().GetHwndSrc();
+	_hwndHost = MagApp::Get().GetHwndHost();
+	if (!_StartCaptureThread()) {
+		Logger::Get().Error("_StartCaptureThread 失败");
+		return false;
+	}
+
+	Logger::Get().Info("GDIFrameSource 初始化完成");
+	return true;
+}
+
+bool GDIFrameSource::OnSrcWndRectChanged() {
+	// 捕获线程使用 _frameRect 和帧的位图，更新前停止它
+	_StopCaptureThread();
+
+	if (!_UpdateSrcFrameRect()) {
+		Logger::Get().Error("_UpdateSrcFrameRect 失败");
+		return false;
+	}
+
+	const SIZE oldFrameSize = Win32Utils::GetSizeOfRect(_frameRect);
+	if (!_CalcFrameRect()) {
+		Logger::Get().Error("_CalcFrameRect 失败");
+		return false;
+	}
+
+	// 只移动窗口时无需重新创建纹理
+	const SIZE frameSize = Win32Utils::GetSizeOfRect(_frameRect);
+	if (frameSize.cx != oldFrameSize.cx || frameSize.cy != oldFrameSize.cy) {
+		if (!_CreateOutput()) {
+			Logger::Get().Error("_CreateOutput 失败");
+			return false;
+		}
+
+		// 丢弃尚未取走的旧尺寸的帧
+		_frameBitmaps.TryConsume();
+		_ReleaseFrameBitmaps();
+		if (!_CreateFrameBitmaps()) {
+			Logger::Get().Error("_CreateFrameBitmaps 失败");
+			return false;
+		}
+
+		// 新的输出尚无内容
+		_hasFrame = false;
+	}
+
+	return _StartCaptureThread();
+}
+
+FrameSourceBase::UpdateState GDIFrameSource::Update() {
+	_FrameBitmap* frameBitmap = _frameBitmaps.TryConsume();
+	if (!frameBitmap) {
+		if (_hasFrame) {
+			return UpdateState::NoUpdate;
+		}
+
+		// 第一帧之前不渲染。捕获线程发布帧后会唤醒渲染线程，设置超时以定期检查源窗口的状态
+		MsgWaitForMultipleObjectsEx(0, nullptr, 100, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+		return UpdateState::Waiting;
+	}
+
+	// 位图由渲染线程独占，直到下一次取得帧
+	MagApp::Get().GetDeviceResources().GetD3DDC()->UpdateSubresource(
+		_output.get(), 0, nullptr, frameBitmap->bits, (_frameRect.right - _frameRect.left) * 4, 0);
+	_frameTime = frameBitmap->frameTime;
+	_hasFrame = true;
+
+	return UpdateState::NewFrame;
+}
+
+bool GDIFrameSource::_CalcFrameRect() {
 	HWND hwndSrc = MagApp::Get().GetHwndSrc();
 
 	double a, bx, by;
@@ -57,56 +149,128 @@ bool GDIFrameSource::Initialize() {
 		return false;
 	}
 
+	return true;
+}
+
+bool GDIFrameSource::_CreateOutput() {
 	_output = MagApp::Get().GetDeviceResources().CreateTexture2D(
+		GPUMemoryOwner::FrameSource,
 		DXGI_FORMAT_B8G8R8A8_UNORM,
 		_frameRect.right - _frameRect.left,
 		_frameRect.bottom - _frameRect.top,
-		D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET,
-		D3D11_USAGE_DEFAULT,
-		D3D11_RESOURCE_MISC_GDI_COMPATIBLE
+		D3D11_BIND_SHADER_RESOURCE
 	);
 	if (!_output) {
 		Logger::Get().Error("创建纹理失败");
 		return false;
 	}
 
-	_dxgiSurface = _output.try_as<IDXGISurface1>();
-	if (!_dxgiSurface) {
-		Logger::Get().Error("从 Texture2D 获取 IDXGISurface1 失败");
-		return false;
+	return true;
+}
+
+bool GDIFrameSource::_CreateFrameBitmaps() noexcept {
+	BITMAPINFO bi{};
+	bi.bmiHeader.biSize = sizeof(bi.bmiHeader);
+	bi.bmiHeader.biWidth = _frameRect.right - _frameRect.left;
+	// 负值表示自顶向下
+	bi.bmiHeader.biHeight = -(_frameRect.bottom - _frameRect.top);
+	bi.bmiHeader.biPlanes = 1;
+	bi.bmiHeader.biBitCount = 32;
+	bi.bmiHeader.biCompression = BI_RGB;
+
+	for (_FrameBitmap& frameBitmap : _frameBitmaps.GetBuffers()) {
+		frameBitmap.hBmp = CreateDIBSection(NULL, &bi, DIB_RGB_COLORS, &frameBitmap.bits, NULL, 0);
+		if (!frameBitmap.hBmp) {
+			Logger::Get().Win32Error("CreateDIBSection 失败");
+			return false;
+		}
 	}
 
-	Logger::Get().Info("GDIFrameSource 初始化完成");
 	return true;
 }
 
-FrameSourceBase::UpdateState GDIFrameSource::Update() {
-	HWND hwndSrc = MagApp::Get().GetHwndSrc();
+void GDIFrameSource::_ReleaseFrameBitmaps() noexcept {
+	for (_FrameBitmap& frameBitmap : _frameBitmaps.GetBuffers()) {
+		if (frameBitmap.hBmp) {
+			DeleteObject(frameBitmap.hBmp);
+		}
+		frameBitmap = {};
+	}
+}
 
-	HDC hdcDest;
-	HRESULT hr = _dxgiSurface->GetDC(TRUE, &hdcDest);
-	if (FAILED(hr)) {
-		Logger::Get().ComError("从 Texture2D 获取 IDXGISurface1 失败", hr);
-		return UpdateState::Error;
+bool GDIFrameSource::_StartCaptureThread() noexcept {
+	_exiting.store(false, std::memory_order_relaxed);
+	_hCaptureThread = CreateThread(nullptr, 0, _CaptureThreadProc, this, 0, nullptr);
+	if (!_hCaptureThread) {
+		Logger::Get().Win32Error("CreateThread 失败");
+		return false;
 	}
 
-	HDC hdcSrc = GetDCEx(hwndSrc, NULL, DCX_LOCKWINDOWUPDATE | DCX_WINDOW);
-	if (!hdcSrc) {
-		Logger::Get().Win32Error("GetDC 失败");
-		_dxgiSurface->ReleaseDC(nullptr);
-		return UpdateState::Error;
+	return true;
+}
+
+void GDIFrameSource::_StopCaptureThread() noexcept {
+	if (!_hCaptureThread) {
+		return;
 	}
 
-	if (!BitBlt(hdcDest, 0, 0, _frameRect.right - _frameRect.left, _frameRect.bottom - _frameRect.top,
-		hdcSrc, _frameRect.left, _frameRect.top, SRCCOPY)
-		) {
-		Logger::Get().Win32Error("BitBlt 失败");
+	_exiting.store(true, std::memory_order_release);
+	WaitForSingleObject(_hCaptureThread, INFINITE);
+	CloseHandle(_hCaptureThread);
+	_hCaptureThread = NULL;
+}
+
+DWORD WINAPI GDIFrameSource::_CaptureThreadProc(LPVOID lpThreadParameter) {
+	GDIFrameSource& that = *(GDIFrameSource*)lpThreadParameter;
+
+	const RECT& frameRect = that._frameRect;
+	const SIZE frameSize = Win32Utils::GetSizeOfRect(frameRect);
+
+	HDC hdcMem = CreateCompatibleDC(NULL);
+	if (!hdcMem) {
+		Logger::Get().Win32Error("CreateCompatibleDC 失败");
+		return 1;
 	}
 
-	ReleaseDC(hwndSrc, hdcSrc);
-	_dxgiSurface->ReleaseDC(nullptr);
+	while (!that._exiting.load(std::memory_order_acquire)) {
+		// 每次 DWM 合成后捕获一次
+		if (FAILED(DwmFlush())) {
+			Sleep(1);
+		}
 
-	return UpdateState::NewFrame;
+		HDC hdcSrc = GetDCEx(that._hwndSrc, NULL, DCX_LOCKWINDOWUPDATE | DCX_WINDOW);
+		if (!hdcSrc) {
+			Logger::Get().Win32Error("GetDC 失败");
+			continue;
+		}
+
+		// FrameMailbox 保证渲染线程不会使用这个位图
+		_FrameBitmap& frameBitmap = that._frameBitmaps.GetWriteBuffer();
+		const int64_t captureTime = Utils::GetQPC();
+
+		HGDIOBJ hOldBmp = SelectObject(hdcMem, frameBitmap.hBmp);
+		const bool success = BitBlt(hdcMem, 0, 0, frameSize.cx, frameSize.cy,
+			hdcSrc, frameRect.left, frameRect.top, SRCCOPY);
+		SelectObject(hdcMem, hOldBmp);
+		ReleaseDC(that._hwndSrc, hdcSrc);
+
+		if (!success) {
+			Logger::Get().Win32Error("BitBlt 失败");
+			continue;
+		}
+
+		// 确保 GDI 已写入位图
+		GdiFlush();
+
+		frameBitmap.frameTime = captureTime;
+		that._frameBitmaps.Publish();
+
+		// 唤醒可能正在空闲的渲染线程
+		PostMessage(that._hwndHost, WM_NULL, 0, 0);
+	}
+
+	DeleteDC(hdcMem);
+	return 0;
 }
 
 }
@@ -1,12 +1,14 @@
 #pragma once
 #include "FrameSourceBase.h"
+#include "FrameMailbox.h"
 
 namespace Magpie::Core {
 
+// 在单独的线程中使用 BitBlt 将源窗口复制到内存中，渲染线程只需上传最新的帧
 class GDIFrameSource : public FrameSourceBase {
 public:
 	GDIFrameSource() {};
-	virtual ~GDIFrameSource() {}
+	virtual ~GDIFrameSource();
 
 	bool Initialize() override;
 
@@ -16,6 +18,8 @@ public:
 		return false;
 	}
 
+	bool OnSrcWndRectChanged() override;
+
 	const char* GetName() const noexcept override {
 		return "GDI";
 	}
@@ -30,8 +34,39 @@ protected:
 	}
 
 private:
+	// 计算源窗口客户区在窗口 DC 中的位置
+	bool _CalcFrameRect();
+
+	bool _CreateOutput();
+
+	bool _CreateFrameBitmaps() noexcept;
+
+	void _ReleaseFrameBitmaps() noexcept;
+
+	bool _StartCaptureThread() noexcept;
+
+	void _StopCaptureThread() noexcept;
+
+	static DWORD WINAPI _CaptureThreadProc(LPVOID lpThreadParameter);
+
+	// 捕获线程运行时只读
 	RECT _frameRect{};
-	winrt::com_ptr<IDXGISurface1> _dxgiSurface;
+	HWND _hwndSrc = NULL;
+	HWND _hwndHost = NULL;
+
+	HANDLE _hCaptureThread = NULL;
+	std::atomic<bool> _exiting = false;
+
+	// 自顶向下的 32 位 DIB，像素格式和 DXGI_FORMAT_B8G8R8A8_UNORM 相同
+	struct _FrameBitmap {
+		HBITMAP hBmp = NULL;
+		void* bits = nullptr;
+		// 帧被捕获的时刻，单位为 QPC 计数
+		int64_t frameTime = 0;
+	};
+	FrameMailbox<_FrameBitmap> _frameBitmaps;
+	// 是否已取得过帧
+	bool _hasFrame = false;
 };
 
 }
@@ -0,0 +1,248 @@
+#include "pch.h"
+#include "GPUMemoryTracker.h"
+#include "DDSLoderHelpers.h"
+#include "EffectHelper.h"
+#include "Logger.h"
+
+namespace Magpie::Core {
+
+static constexpr float BYTES_PER_MIB = 1024.0f * 1024.0f;
+
+GPUMemoryTracker::~GPUMemoryTracker() {
+	std::scoped_lock lk(_mutex);
+
+	// 这些资源仍被其他对象持有，它们的销毁通知不能再访问此对象
+	for (auto& [resource, entry] : _entries) {
+		winrt::com_ptr<ID3DDestructionNotifier> notifier;
+		if (SUCCEEDED(resource->QueryInterface(IID_PPV_ARGS(notifier.put())))) {
+			notifier->UnregisterDestructionCallback(entry.callbackId);
+		}
+	}
+}
+
+void GPUMemoryTracker::Track(ID3D11Resource* resource, GPUMemoryOwner owner, std::string_view name) noexcept {
+	if (!resource) {
+		return;
+	}
+
+	std::scoped_lock lk(_mutex);
+
+	auto it = _entries.find(resource);
+	if (it != _entries.end()) {
+		Allocation& allocation = it->second.allocation;
+		_ownerBytes[(size_t)allocation.owner] -= allocation.bytes;
+		_ownerBytes[(size_t)owner] += allocation.bytes;
+		allocation.owner = owner;
+		allocation.name = name;
+		return;
+	}
+
+	Allocation allocation;
+	if (!_GetAllocationInfo(resource, allocation)) {
+		return;
+	}
+	allocation.owner = owner;
+	allocation.name = name;
+
+	winrt::com_ptr<ID3DDestructionNotifier> notifier;
+	HRESULT hr = resource->QueryInterface(IID_PPV_ARGS(notifier.put()));
+	if (FAILED(hr)) {
+		Logger::Get().ComError("获取 ID3DDestructionNotifier 失败", hr);
+		return;
+	}
+
+	_Entry& entry = _entries[resource];
+	entry.tracker = this;
+	entry.resource = resource;
+	entry.allocation = std::move(allocation);
+
+	hr = notifier->RegisterDestructionCallback(&_OnResourceDestroyed, &entry, &entry.callbackId);
+	if (FAILED(hr)) {
+		Logger::Get().ComError("RegisterDestructionCallback 失败", hr);
+		_entries.erase(resource);
+		return;
+	}
+
+	_ownerBytes[(size_t)owner] += entry.allocation.bytes;
+	_currentBytes += entry.allocation.bytes;
+	_peakBytes = std::max(_peakBytes, _currentBytes);
+}
+
+bool GPUMemoryTracker::CheckBudget(uint64_t bytes, GPUMemoryOwner owner) noexcept {
+	if (_budget == 0) {
+		return true;
+	}
+
+	uint64_t currentBytes;
+	{
+		std::scoped_lock lk(_mutex);
+		currentBytes = _GetBudgetedBytes();
+	}
+	if (currentBytes + bytes <= _budget) {
+		return true;
+	}
+
+	_budgetReport = fmt::format("超出显存预算：为 {} 分配 {:.1f} MiB 失败，预算为 {:.1f} MiB，已占用 {:.1f} MiB\n{}",
+		GetOwnerName(owner), bytes / BYTES_PER_MIB, _budget / BYTES_PER_MIB,
+		currentBytes / BYTES_PER_MIB, GetReport());
+	Logger::Get().Error(_budgetReport);
+	return false;
+}
+
+bool GPUMemoryTracker::IsWithinBudget(uint64_t bytes) const noexcept {
+	if (_budget == 0) {
+		return true;
+	}
+
+	std::scoped_lock lk(_mutex);
+	return _GetBudgetedBytes() + bytes <= _budget;
+}
+
+void GPUMemoryTracker::GetSummary(SmallVectorImpl<Allocation>& result) const noexcept {
+	result.clear();
+
+	{
+		std::scoped_lock lk(_mutex);
+
+		phmap::flat_hash_map<std::pair<GPUMemoryOwner, std::string_view>, size_t> indices;
+		for (const auto& [resource, entry] : _entries) {
+			const Allocation& allocation = entry.allocation;
+
+			auto [it, inserted] = indices.try_emplace(std::make_pair(allocation.owner, std::string_view(allocation.name)), result.size());
+			if (inserted) {
+				result.push_back(allocation);
+				continue;
+			}
+
+			// 格式或尺寸不同的分配合并后不再有意义
+			Allocation& merged = result[it->second];
+			if (merged.format != allocation.format || merged.width != allocation.width || merged.height != allocation.height) {
+				merged.format = DXGI_FORMAT_UNKNOWN;
+				merged.width = 0;
+				merged.height = 0;
+			}
+			merged.bytes += allocation.bytes;
+		}
+	}
+
+	std::sort(result.begin(), result.end(), [](const Allocation& l, const Allocation& r) {
+		return l.bytes > r.bytes;
+	});
+}
+
+static std::string GetFormatName(DXGI_FORMAT format) noexcept {
+	if (format == DXGI_FORMAT_B8G8R8A8_UNORM) {
+		return "B8G8R8A8_UNORM";
+	}
+
+	for (const auto& desc : EffectHelper::FORMAT_DESCS) {
+		if (desc.dxgiFormat == format) {
+			return desc.name;
+		}
+	}
+
+	return fmt::format("DXGI_FORMAT {}", (int)format);
+}
+
+std::string GPUMemoryTracker::GetReport() const noexcept {
+	// 复制计数，GetSummary 也需要获取锁
+	std::array<uint64_t, (size_t)GPUMemoryOwner::COUNT> ownerBytes;
+	uint64_t currentBytes;
+	uint64_t peakBytes;
+	{
+		std::scoped_lock lk(_mutex);
+		ownerBytes = _ownerBytes;
+		currentBytes = _currentBytes;
+		peakBytes = _peakBytes;
+	}
+
+	std::string result = fmt::format("当前占用 {:.1f} MiB，峰值 {:.1f} MiB",
+		currentBytes / BYTES_PER_MIB, peakBytes / BYTES_PER_MIB);
+
+	for (size_t i = 0; i < (size_t)GPUMemoryOwner::COUNT; ++i) {
+		if (ownerBytes[i] > 0) {
+			result.append(fmt::format("\n\t{}：{:.1f} MiB", GetOwnerName((GPUMemoryOwner)i), ownerBytes[i] / BYTES_PER_MIB));
+		}
+	}
+
+	SmallVector<Allocation> summary;
+	GetSummary(summary);
+
+	// 只列出最大的几项
+	static constexpr size_t MAX_ITEMS = 8;
+	for (size_t i = 0, end = std::min(summary.size(), MAX_ITEMS); i < end; ++i) {
+		const Allocation& allocation = summary[i];
+		result.append(fmt::format("\n\t{} {}：{:.2f} MiB", GetOwnerName(allocation.owner), allocation.name, allocation.bytes / BYTES_PER_MIB));
+		if (allocation.width > 0 && allocation.format != DXGI_FORMAT_UNKNOWN) {
+			result.append(fmt::format(" ({}x{} {})", allocation.width, allocation.height, GetFormatName(allocation.format)));
+		}
+	}
+
+	return result;
+}
+
+uint64_t GPUMemoryTracker::CalcTextureBytes(DXGI_FORMAT format, UINT width, UINT height, UINT mipLevels, UINT arraySize) noexcept {
+	uint64_t result = 0;
+	for (UINT i = 0; i < mipLevels; ++i) {
+		size_t numBytes = 0;
+		if (FAILED(GetSurfaceInfo(std::max(width >> i, 1u), std::max(height >> i, 1u), format, &numBytes, nullptr, nullptr))) {
+			return 0;
+		}
+		result += numBytes;
+	}
+	return result * arraySize;
+}
+
+const char* GPUMemoryTracker::GetOwnerName(GPUMemoryOwner owner) noexcept {
+	switch (owner) {
+	case GPUMemoryOwner::Effect:
+		return "Effect";
+	case GPUMemoryOwner::FrameSource:
+		return "FrameSource";
+	case GPUMemoryOwner::Cursor:
+		return "Cursor";
+	case GPUMemoryOwner::Overlay:
+		return "Overlay";
+	default:
+		return "Other";
+	}
+}
+
+void WINAPI GPUMemoryTracker::_OnResourceDestroyed(void* data) {
+	_Entry& entry = *(_Entry*)data;
+	GPUMemoryTracker& tracker = *entry.tracker;
+
+	std::scoped_lock lk(tracker._mutex);
+	tracker._ownerBytes[(size_t)entry.allocation.owner] -= entry.allocation.bytes;
+	tracker._currentBytes -= entry.allocation.bytes;
+	// entry 在此之后失效
+	tracker._entries.erase(entry.resource);
+}
+
+bool GPUMemoryTracker::_GetAllocationInfo(ID3D11Resource* resource, Allocation& allocation) noexcept {
+	D3D11_RESOURCE_DIMENSION dimension;
+	resource->GetType(&dimension);
+
+	if (dimension == D3D11_RESOURCE_DIMENSION_TEXTURE2D) {
+		D3D11_TEXTURE2D_DESC desc;
+		((ID3D11Texture2D*)resource)->GetDesc(&desc);
+		allocation.format = desc.Format;
+		allocation.width = desc.Width;
+		allocation.height = desc.Height;
+		allocation.bytes = CalcTextureBytes(desc.Format, desc.Width, desc.Height, desc.MipLevels, desc.ArraySize);
+		return true;
+	} else if (dimension == D3D11_RESOURCE_DIMENSION_BUFFER) {
+		D3D11_BUFFER_DESC desc;
+		((ID3D11Buffer*)resource)->GetDesc(&desc);
+		allocation.format = DXGI_FORMAT_UNKNOWN;
+		allocation.width = desc.ByteWidth;
+		allocation.height = 1;
+		allocation.bytes = desc.ByteWidth;
+		return true;
+	}
+
+	// 不使用其他类型的资源
+	return false;
+}
+
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <parallel_hashmap/phmap.h>
+#include "SmallVector.h"
+#include "Win32Utils.h"
+
+namespace Magpie::Core {
+
+// 显存的用途
+enum class GPUMemoryOwner : uint8_t {
+	Effect,
+	FrameSource,
+	Cursor,
+	Overlay,
+	Other,
+	COUNT
+};
+
+// 统计通过 DeviceResources 分配的纹理和缓冲区占用的显存，并检查是否超出预算。
+// 资源销毁时由 ID3DDestructionNotifier 通知，因此释放时无需登记。大小根据格式和尺寸计算，
+// 不含驱动的对齐和填充。交换链的缓冲区由 DXGI 管理，不计入
+class GPUMemoryTracker {
+public:
+	struct Allocation {
+		// 效果的分配为 "效果名/纹理名"，其他为空
+		std::string name;
+		uint64_t bytes = 0;
+		// 缓冲区为 DXGI_FORMAT_UNKNOWN，宽为字节数，高为 1
+		DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+		UINT width = 0;
+		UINT height = 0;
+		GPUMemoryOwner owner = GPUMemoryOwner::Other;
+	};
+
+	GPUMemoryTracker() = default;
+	GPUMemoryTracker(const GPUMemoryTracker&) = delete;
+	GPUMemoryTracker(GPUMemoryTracker&&) = delete;
+
+	// 取消仍存活的资源的销毁通知
+	~GPUMemoryTracker();
+
+	// 登记资源，已登记的资源只更新所有者，如从纹理池中取出的纹理
+	void Track(ID3D11Resource* resource, GPUMemoryOwner owner, std::string_view name = {}) noexcept;
+
+	// 分配 bytes 字节前调用，超出预算时记录报告并返回 false
+	bool CheckBudget(uint64_t bytes, GPUMemoryOwner owner) noexcept;
+
+	// 和 CheckBudget 相同但不记录报告，用于判断是否需要先释放空闲的资源
+	bool IsWithinBudget(uint64_t bytes) const noexcept;
+
+	// 单位为字节，0 表示不限制
+	void SetBudget(uint64_t budget) noexcept {
+		_budget = budget;
+	}
+
+	uint64_t GetBudget() const noexcept {
+		return _budget;
+	}
+
+	// 替换效果链期间旧的效果链仍然存活，但替换成功后会被释放，检查预算时不计入
+	void SetReleasingBytes(uint64_t bytes) noexcept {
+		_releasingBytes = bytes;
+	}
+
+	uint64_t GetCurrentBytes() const noexcept {
+		std::scoped_lock lk(_mutex);
+		return _currentBytes;
+	}
+
+	uint64_t GetPeakBytes() const noexcept {
+		std::scoped_lock lk(_mutex);
+		return _peakBytes;
+	}
+
+	// 新的缩放开始时调用，峰值从当前占用开始统计
+	void ResetPeak() noexcept {
+		std::scoped_lock lk(_mutex);
+		_peakBytes = _currentBytes;
+	}
+
+	uint64_t GetOwnerBytes(GPUMemoryOwner owner) const noexcept {
+		std::scoped_lock lk(_mutex);
+		return _ownerBytes[(size_t)owner];
+	}
+
+	// 按所有者和名字汇总，同名的分配合并，按字节数降序排列
+	void GetSummary(SmallVectorImpl<Allocation>& result) const noexcept;
+
+	// 当前占用的文字报告，用于日志和覆盖层
+	std::string GetReport() const noexcept;
+
+	// 上次超出预算时的报告，取出后清空
+	std::string TakeBudgetReport() noexcept {
+		return std::move(_budgetReport);
+	}
+
+	static uint64_t CalcTextureBytes(DXGI_FORMAT format, UINT width, UINT height, UINT mipLevels = 1, UINT arraySize = 1) noexcept;
+
+	static const char* GetOwnerName(GPUMemoryOwner owner) noexcept;
+
+private:
+	struct _Entry {
+		GPUMemoryTracker* tracker = nullptr;
+		ID3D11Resource* resource = nullptr;
+		UINT callbackId = 0;
+		Allocation allocation;
+	};
+
+	static void WINAPI _OnResourceDestroyed(void* data);
+
+	static bool _GetAllocationInfo(ID3D11Resource* resource, Allocation& allocation) noexcept;
+
+	// 检查预算时计入的占用，调用前需持有 _mutex
+	uint64_t _GetBudgetedBytes() const noexcept {
+		return _currentBytes - std::min(_releasingBytes, _currentBytes);
+	}
+
+	// 资源可能在任意线程上被销毁，读写 _entries 和以下的计数都需持有
+	mutable Win32Utils::SRWMutex _mutex;
+	// _Entry 的地址被用作销毁通知的参数，因此需要节点稳定
+	phmap::node_hash_map<ID3D11Resource*, _Entry> _entries;
+
+	std::array<uint64_t, (size_t)GPUMemoryOwner::COUNT> _ownerBytes{};
+	uint64_t _currentBytes = 0;
+	uint64_t _peakBytes = 0;
+	uint64_t _budget = 0;
+	uint64_t _releasingBytes = 0;
+
+	std::string _budgetReport;
+};
+
+}
@@ -2,16 +2,42 @@
 #include "GPUTimer.h"
 #include "MagApp.h"
 #include "DeviceResources.h"
+#include "Logger.h"
+#include "TraceRecorder.h"
 
 
 namespace Magpie::Core {
 
+// 帧间隔超过中位数的这个倍数视为卡顿
+static constexpr float STUTTER_RATIO = 1.5f;
+// 样本太少时中位数不可靠
+static constexpr uint32_t STUTTER_MIN_SAMPLES = 30;
+
 void GPUTimer::OnBeginFrame() {
 	auto now = std::chrono::high_resolution_clock::now();
 
 	_elapsedTime = now - _lastTimePoint;
 	_lastTimePoint = now;
 
+	// 第一帧和空闲之后的帧间隔没有意义
+	if (_frameCount > 0 && !_isFrameSkipped) {
+		const float frameTime = std::chrono::duration<float, std::milli>(_elapsedTime).count();
+
+		if (_frameTimeHistogram.GetSampleCount() >= STUTTER_MIN_SAMPLES) {
+			const float medianFrameTime = _frameTimeHistogram.GetPercentile(50);
+			if (frameTime > medianFrameTime * STUTTER_RATIO) {
+				++_stutterCount;
+
+				std::move_backward(_recentStutters.begin(), _recentStutters.end() - 1, _recentStutters.end());
+				_recentStutters[0] = { _totalTime + _elapsedTime, frameTime, medianFrameTime };
+				_recentStutterCount = std::min(_recentStutterCount + 1, (uint32_t)_recentStutters.size());
+			}
+		}
+
+		_frameTimeHistogram.AddSample(frameTime);
+	}
+	_isFrameSkipped = false;
+
 	_totalTime += _elapsedTime;
 
 	// 更新当前帧率
@@ -26,42 +52,136 @@ void GPUTimer::OnBeginFrame() {
 	}
 }
 
-void GPUTimer::StartProfiling(std::chrono::microseconds updateInterval, UINT passCount) {
-	assert(passCount > 0);
+void GPUTimer::OnPresent() {
+	const auto now = std::chrono::steady_clock::now();
+
+	if (_lastPresentTime.time_since_epoch().count() != 0 && !_isFrameSkipped) {
+		_presentIntervalHistogram.AddSample(std::chrono::duration<float, std::milli>(now - _lastPresentTime).count());
+	}
+
+	_lastPresentTime = now;
+}
+
+void GPUTimer::StartProfiling(
+	std::chrono::microseconds updateInterval,
+	std::vector<std::string>&& passNames,
+	uint32_t queryDepth
+) {
+	const UINT passCount = (UINT)passNames.size();
+	assert(passCount > 0 && queryDepth > 0);
+
+	auto d3dDevice = MagApp::Get().GetDeviceResources().GetD3DDevice();
+
+	_queries.clear();
+	_queries.resize(queryDepth);
+	for (_QueryInfo& query : _queries) {
+		query.passes.resize(passCount);
+
+		D3D11_QUERY_DESC desc{ D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+		HRESULT hr = d3dDevice->CreateQuery(&desc, query.disjoint.put());
+
+		desc.Query = D3D11_QUERY_TIMESTAMP;
+		if (SUCCEEDED(hr)) {
+			hr = d3dDevice->CreateQuery(&desc, query.start.put());
+		}
+		for (winrt::com_ptr<ID3D11Query>& passQuery : query.passes) {
+			if (FAILED(hr)) {
+				break;
+			}
+			hr = d3dDevice->CreateQuery(&desc, passQuery.put());
+		}
+		if (SUCCEEDED(hr)) {
+			hr = d3dDevice->CreateQuery(&desc, query.overlay.put());
+		}
+
+		if (FAILED(hr)) {
+			Logger::Get().ComError("CreateQuery 失败", hr);
+			StopProfiling();
+			return;
+		}
+	}
 
 	_curQueryIdx = 0;
+	_oldestQueryIdx = 0;
 	_updateProfilingTime = updateInterval;
-	_profilingCounter = {};
+	_profilingEndTime = {};
 
-	_queries[0].passes.resize(passCount);
-	if (MagApp::Get().GetOptions().IsTripleBuffering()) {
-		_queries[1].passes.resize(passCount);
-	}
 	_passesTimings.resize(passCount);
+	_overlayTimings = {};
 	_gpuTimings.passes.resize(passCount);
+	_passNames = std::move(passNames);
 	_firstProfilingFrame = true;
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	_qpcFrequency = frequency.QuadPart;
 }
 
 void GPUTimer::StopProfiling() {
 	_curQueryIdx = -1;
+	_oldestQueryIdx = 0;
 	_updateProfilingTime = {};
-	_profilingCounter = {};
+	_profilingEndTime = {};
 
 	_queries = {};
 	_passesTimings = {};
+	_overlayTimings = {};
 	_gpuTimings = {};
+	_passNames = {};
 }
 
-void GPUTimer::OnBeginEffects() {
-	if (_curQueryIdx < 0) {
+void GPUTimer::EnableFrameTiming() noexcept {
+	// 帧调度和自适应画质可能都需要
+	if (_isFrameTiming) {
 		return;
 	}
 
-	_UpdateGPUTimings();
+	auto d3dDevice = MagApp::Get().GetDeviceResources().GetD3DDevice();
+
+	for (_FrameTimingQuery& query : _frameTimingQueries) {
+		D3D11_QUERY_DESC desc{ D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+		d3dDevice->CreateQuery(&desc, query.disjoint.put());
+
+		desc.Query = D3D11_QUERY_TIMESTAMP;
+		d3dDevice->CreateQuery(&desc, query.start.put());
+		d3dDevice->CreateQuery(&desc, query.end.put());
+	}
+
+	_isFrameTiming = true;
+}
 
+void GPUTimer::OnBeginEffects(bool isFullChain) {
 	auto d3dDC = MagApp::Get().GetDeviceResources().GetD3DDC();
-	d3dDC->Begin(_queries[_curQueryIdx].disjoint.get());
-	d3dDC->End(_queries[_curQueryIdx].start.get());
+
+	if (_isFrameTiming) {
+		_ReadFrameTiming();
+
+		_FrameTimingQuery& query = _frameTimingQueries[_curFrameTimingIdx];
+		query.isFullChain = isFullChain;
+		d3dDC->Begin(query.disjoint.get());
+		d3dDC->End(query.start.get());
+	}
+
+	if (_curQueryIdx < 0) {
+		return;
+	}
+
+	_ReadProfilingQueries();
+
+	_QueryInfo& query = _queries[_curQueryIdx];
+	if (query.issued) {
+		// GPU 落后太多，环已满，放弃最早的结果
+		query.issued = false;
+		_oldestQueryIdx = (_curQueryIdx + 1) % (uint32_t)_queries.size();
+	}
+
+	query.frameTime = _totalTime;
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	query.submitTime = now.QuadPart;
+
+	d3dDC->Begin(query.disjoint.get());
+	d3dDC->End(query.start.get());
 }
 
 void GPUTimer::OnEndPass(UINT idx) {
@@ -73,98 +193,223 @@ void GPUTimer::OnEndPass(UINT idx) {
 }
 
 void GPUTimer::OnEndEffects() {
+	auto d3dDC = MagApp::Get().GetDeviceResources().GetD3DDC();
+
+	if (_isFrameTiming) {
+		_FrameTimingQuery& query = _frameTimingQueries[_curFrameTimingIdx];
+		d3dDC->End(query.end.get());
+		d3dDC->End(query.disjoint.get());
+		query.issued = true;
+
+		_curFrameTimingIdx = (_curFrameTimingIdx + 1) % (uint32_t)_frameTimingQueries.size();
+	}
+}
+
+void GPUTimer::OnEndOverlay() {
 	if (_curQueryIdx < 0) {
 		return;
 	}
 
-	MagApp::Get().GetDeviceResources().GetD3DDC()->End(_queries[_curQueryIdx].disjoint.get());
+	auto d3dDC = MagApp::Get().GetDeviceResources().GetD3DDC();
+
+	_QueryInfo& query = _queries[_curQueryIdx];
+	d3dDC->End(query.overlay.get());
+	d3dDC->End(query.disjoint.get());
+	query.issued = true;
+
+	_curQueryIdx = (_curQueryIdx + 1) % (int)_queries.size();
 }
 
-template<typename T>
-static T GetQueryData(ID3D11DeviceContext3* d3dDC, ID3D11Query* query) {
-	T data{};
-	while (S_OK != d3dDC->GetData(query, &data, sizeof(data), 0)) {
-		Sleep(0);
+void GPUTimer::_ReadFrameTiming() noexcept {
+	_FrameTimingQuery& query = _frameTimingQueries[_curFrameTimingIdx];
+	if (!query.issued) {
+		return;
+	}
+	query.issued = false;
+
+	auto d3dDC = MagApp::Get().GetDeviceResources().GetD3DDC();
+
+	// 不刷新命令队列，结果尚不可用时放弃这一帧
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjointData{};
+	if (d3dDC->GetData(query.disjoint.get(), &disjointData, sizeof(disjointData), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK
+		|| disjointData.Disjoint
+	) {
+		return;
+	}
+
+	UINT64 startTimestamp = 0;
+	UINT64 endTimestamp = 0;
+	if (d3dDC->GetData(query.start.get(), &startTimestamp, sizeof(startTimestamp), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK
+		|| d3dDC->GetData(query.end.get(), &endTimestamp, sizeof(endTimestamp), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK
+	) {
+		return;
+	}
+
+	_frameGPUTime = (endTimestamp - startTimestamp) * 1000.0f / disjointData.Frequency;
+	_isFrameGPUTimeFullChain = query.isFullChain;
+	++_frameGPUTimeCount;
+
+	// 统计每个通道的用时时由其记录
+	if (_curQueryIdx < 0) {
+		_gpuTimeHistogram.AddSample(_frameGPUTime);
 	}
-	return data;
 }
 
-void GPUTimer::_UpdateGPUTimings() {
+void GPUTimer::WaitForProfilingResults(uint32_t maxPendingFrames) {
 	if (_curQueryIdx < 0) {
 		return;
 	}
 
-	if (MagApp::Get().GetOptions().IsTripleBuffering()) {
-		_curQueryIdx = 1 - _curQueryIdx;
+	const auto getPendingCount = [&]() {
+		return (uint32_t)std::count_if(_queries.begin(), _queries.end(),
+			[](const _QueryInfo& query) { return query.issued; });
+	};
+
+	if (getPendingCount() <= maxPendingFrames) {
+		return;
 	}
 
-	auto& curQueryInfo = _queries[_curQueryIdx];
+	// 读取时不刷新命令队列，因此先刷新一次
+	MagApp::Get().GetDeviceResources().GetD3DDC()->Flush();
 
-	if (curQueryInfo.disjoint) {
-		auto d3dDC = MagApp::Get().GetDeviceResources().GetD3DDC();
+	while (true) {
+		_ReadProfilingQueries();
+		if (getPendingCount() <= maxPendingFrames) {
+			break;
+		}
 
-		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjointData =
-			GetQueryData<D3D11_QUERY_DATA_TIMESTAMP_DISJOINT>(d3dDC, curQueryInfo.disjoint.get());
+		Sleep(0);
+	}
+}
 
-		if (!disjointData.Disjoint) {
-			const float toMS = 1000.0f / disjointData.Frequency;
+void GPUTimer::_ReadProfilingQueries() {
+	auto d3dDC = MagApp::Get().GetDeviceResources().GetD3DDC();
 
-			UINT64 startTimestamp = GetQueryData<UINT64>(d3dDC, curQueryInfo.start.get());
+	SmallVector<float> passTimings;
+	SmallVector<UINT64> timestamps;
+	while (true) {
+		_QueryInfo& query = _queries[_oldestQueryIdx];
+		if (!query.issued) {
+			break;
+		}
 
-			for (size_t i = 0; i < curQueryInfo.passes.size(); ++i) {
-				UINT64 timestamp = GetQueryData<UINT64>(d3dDC, curQueryInfo.passes[i].get());
+		// 不刷新命令队列也不等待，尚未完成时下一帧再试。之后提交的查询也不会完成
+		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjointData{};
+		if (d3dDC->GetData(query.disjoint.get(), &disjointData, sizeof(disjointData), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) {
+			break;
+		}
 
-				float t = (timestamp - startTimestamp) * toMS;
-				if (t > 0.01) {
-					_passesTimings[i].first += t;
-					++_passesTimings[i].second;
-				}
-				startTimestamp = timestamp;
+		// 时间戳查询在 disjoint 之前结束，此时应都已可用。即使结果不可靠也要读取，否则调试层将发出警告
+		// 第一个为开始的时刻，之后为每个通道结束的时刻，最后为覆盖层结束的时刻
+		timestamps.resize(query.passes.size() + 2);
+		bool succeeded = d3dDC->GetData(query.start.get(), &timestamps[0],
+			sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK;
+		for (size_t i = 0; i < query.passes.size(); ++i) {
+			if (d3dDC->GetData(query.passes[i].get(), &timestamps[i + 1],
+				sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) {
+				succeeded = false;
 			}
-		} else {
-			// 查询的值不可靠
+		}
+		if (d3dDC->GetData(query.overlay.get(), &timestamps.back(),
+			sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) {
+			succeeded = false;
+		}
 
-#ifdef _DEBUG
-			// 依然执行查询，否则调试层将发出警告
-			GetQueryData<D3D11_QUERY_DATA_TIMESTAMP_DISJOINT>(d3dDC, curQueryInfo.disjoint.get());
-			for (auto& query : curQueryInfo.passes) {
-				GetQueryData<UINT64>(d3dDC, query.get());
-			}
-#endif // _DEBUG
+		query.issued = false;
+		_oldestQueryIdx = (_oldestQueryIdx + 1) % (uint32_t)_queries.size();
+
+		if (!succeeded || disjointData.Disjoint) {
+			continue;
 		}
 
-		_profilingCounter += _elapsedTime;
+		const float toMS = 1000.0f / disjointData.Frequency;
+		passTimings.clear();
+		for (size_t i = 1, end = timestamps.size() - 1; i < end; ++i) {
+			passTimings.push_back((timestamps[i] - timestamps[i - 1]) * toMS);
+		}
+		const float overlayTiming = (timestamps.back() - timestamps[timestamps.size() - 2]) * toMS;
+
+		_AddProfilingResult(query.frameTime, passTimings, overlayTiming);
 
-		if (_firstProfilingFrame) {
-			_firstProfilingFrame = false;
+		if (_passTimingsCallback) {
+			_passTimingsCallback(passTimings);
+		}
 
-			// 在第一帧更新一次
-			for (UINT i = 0; i < _passesTimings.size(); ++i) {
-				_gpuTimings.passes[i] = _passesTimings[i].first;
+		TraceRecorder& traceRecorder = TraceRecorder::Get();
+		if (traceRecorder.IsRecording()) {
+			// GPU 和 CPU 的时钟无法对齐，以提交的时刻作为 GPU 开始执行的时刻
+			const auto toQPC = [&](UINT64 timestamp) {
+				return query.submitTime + int64_t((timestamp - timestamps[0]) * _qpcFrequency / disjointData.Frequency);
+			};
+
+			for (size_t i = 0; i < _passNames.size(); ++i) {
+				// 跳过这一帧没有渲染的通道
+				if (passTimings[i] > 0.01f) {
+					traceRecorder.AddSpan(TraceRecorder::Track::GPU,
+						_passNames[i], toQPC(timestamps[i]), toQPC(timestamps[i + 1]));
+				}
 			}
-		} else if (_profilingCounter >= _updateProfilingTime) {
-			// 更新渲染用时
-			for (UINT i = 0; i < _passesTimings.size(); ++i) {
-				_gpuTimings.passes[i] = _passesTimings[i].second == 0 ?
-					0.0f : _passesTimings[i].first / _passesTimings[i].second;
+
+			if (overlayTiming > 0.01f) {
+				traceRecorder.AddSpan(TraceRecorder::Track::GPU, "Overlay",
+					toQPC(timestamps[timestamps.size() - 2]), toQPC(timestamps.back()));
 			}
+		}
+	}
+}
+
+void GPUTimer::_AddProfilingResult(std::chrono::nanoseconds frameTime, const SmallVectorImpl<float>& passTimings, float overlayTiming) {
+	float gpuTime = 0.0f;
+	for (float passTiming : passTimings) {
+		gpuTime += passTiming;
+	}
+	_gpuTimeHistogram.AddSample(gpuTime);
+	_overlayGPUTimeHistogram.AddSample(overlayTiming);
 
-			std::fill(_passesTimings.begin(), _passesTimings.end(), std::pair<float, UINT>());
+	if (_firstProfilingFrame) {
+		_firstProfilingFrame = false;
 
-			_profilingCounter %= _updateProfilingTime;
+		// 第一个结果立即显示，而不是等待更新间隔
+		for (size_t i = 0; i < passTimings.size(); ++i) {
+			_gpuTimings.passes[i] = passTimings[i];
 		}
-	} else {
-		auto d3dDevice = MagApp::Get().GetDeviceResources().GetD3DDevice();
+		_gpuTimings.overlay = overlayTiming;
 
-		D3D11_QUERY_DESC desc{ D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
-		d3dDevice->CreateQuery(&desc, curQueryInfo.disjoint.put());
+		_profilingEndTime = frameTime + _updateProfilingTime;
+		return;
+	}
 
-		desc.Query = D3D11_QUERY_TIMESTAMP;
-		d3dDevice->CreateQuery(&desc, curQueryInfo.start.put());
-		for (UINT j = 0; j < curQueryInfo.passes.size(); ++j) {
-			d3dDevice->CreateQuery(&desc, curQueryInfo.passes[j].put());
+	if (frameTime >= _profilingEndTime) {
+		// 结果按帧的顺序到达，之前的区间已完整，更新渲染用时
+		for (size_t i = 0; i < _passesTimings.size(); ++i) {
+			_gpuTimings.passes[i] = _passesTimings[i].second == 0 ?
+				0.0f : _passesTimings[i].first / _passesTimings[i].second;
+		}
+
+		std::fill(_passesTimings.begin(), _passesTimings.end(), std::pair<float, UINT>());
+
+		_gpuTimings.overlay = _overlayTimings.second == 0 ?
+			0.0f : _overlayTimings.first / _overlayTimings.second;
+		_overlayTimings = {};
+
+		if (_updateProfilingTime.count() > 0) {
+			_profilingEndTime += (frameTime - _profilingEndTime) / _updateProfilingTime * _updateProfilingTime
+				+ _updateProfilingTime;
+		} else {
+			_profilingEndTime = frameTime + 1ns;
+		}
+	}
+
+	for (size_t i = 0; i < passTimings.size(); ++i) {
+		if (passTimings[i] > 0.01f) {
+			_passesTimings[i].first += passTimings[i];
+			++_passesTimings[i].second;
 		}
 	}
+
+	// 不显示覆盖层的帧也计入，结果为平均开销
+	_overlayTimings.first += overlayTiming;
+	++_overlayTimings.second;
 }
 
 }
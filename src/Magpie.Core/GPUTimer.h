@@ -1,5 +1,6 @@
 #pragma once
 #include "SmallVector.h"
+#include "FrameTimeHistogram.h"
 
 namespace Magpie::Core {
 
@@ -21,9 +22,53 @@ public:
 	// 在每帧开始时调用，用于记录帧率和检索渲染用时
 	void OnBeginFrame();
 
+	// 呈现后调用，用于统计呈现间隔
+	void OnPresent();
+
+	// 空闲时跳过了呈现，之后的第一次呈现间隔和下一帧的帧间隔不计入统计
+	void OnFrameSkipped() noexcept {
+		_isFrameSkipped = true;
+	}
+
+	// 帧间隔、效果链的 GPU 用时和呈现间隔在最近一段时间内的分布
+	const FrameTimeHistogram& GetFrameTimeHistogram() const noexcept {
+		return _frameTimeHistogram;
+	}
+
+	const FrameTimeHistogram& GetGPUTimeHistogram() const noexcept {
+		return _gpuTimeHistogram;
+	}
+
+	const FrameTimeHistogram& GetPresentIntervalHistogram() const noexcept {
+		return _presentIntervalHistogram;
+	}
+
+	// 覆盖层的 GPU 用时的分布，只在统计渲染用时期间记录。用于比较启用和禁用覆盖层缓存时的开销
+	const FrameTimeHistogram& GetOverlayGPUTimeHistogram() const noexcept {
+		return _overlayGPUTimeHistogram;
+	}
+
+	// 帧间隔超过中位数的 1.5 倍视为一次卡顿
+	struct StutterEvent {
+		// 开始缩放后经过的时间
+		std::chrono::nanoseconds time;
+		// 单位为 ms
+		float frameTime;
+		float medianFrameTime;
+	};
+
+	uint32_t GetStutterCount() const noexcept {
+		return _stutterCount;
+	}
+
+	// 最近的几次卡顿，最新的在前
+	std::span<const StutterEvent> GetRecentStutters() const noexcept {
+		return { _recentStutters.data(), _recentStutterCount };
+	}
+
 	struct GPUTimings {
 		SmallVector<float> passes;
-		// float overlay = 0.0f;
+		float overlay = 0.0f;
 	};
 
 	// 所有元素的处理时间，单位为 ms
@@ -31,21 +76,70 @@ public:
 		return _gpuTimings;
 	}
 
+	// 同时等待结果的查询的默认数量
+	static constexpr uint32_t DEFAULT_QUERY_DEPTH = 4;
+
 	// updateInterval 为更新渲染用时的间隔
 	// 可为 0，即每帧都更新
-	void StartProfiling(std::chrono::microseconds updateInterval, UINT passCount);
+	// passNames 为每个通道的名字，用于记录跟踪
+	// queryDepth 为同时等待结果的查询的数量，GPU 落后的帧数超过它时将丢弃最早的结果
+	void StartProfiling(
+		std::chrono::microseconds updateInterval,
+		std::vector<std::string>&& passNames,
+		uint32_t queryDepth = DEFAULT_QUERY_DEPTH
+	);
 
 	void StopProfiling();
 
-	void OnBeginEffects();
+	bool IsProfiling() const noexcept {
+		return _curQueryIdx >= 0;
+	}
+
+	// 每得到一帧各通道的用时后调用，单位为 ms。基准测试需要每一帧的结果而不是平均值
+	void SetPassTimingsCallback(std::function<void(const SmallVectorImpl<float>&)> callback) noexcept {
+		_passTimingsCallback = std::move(callback);
+	}
+
+	// 等待到尚未得到结果的帧不超过 maxPendingFrames。没有呈现时 CPU 不会等待 GPU，
+	// 基准测试需以此限制 GPU 落后的帧数，否则环满后将丢弃结果
+	void WaitForProfilingResults(uint32_t maxPendingFrames = 0);
+
+	// 帧调度需要每帧效果链的 GPU 用时，和 StartProfiling 无关
+	void EnableFrameTiming() noexcept;
+
+	// 最近一次得到结果的帧中效果链的 GPU 用时，单位为 ms。尚无结果时为负数
+	float GetFrameGPUTime() const noexcept {
+		return _frameGPUTime;
+	}
+
+	// 已得到结果的帧数，用于判断 GetFrameGPUTime 的结果是否更新
+	uint32_t GetFrameGPUTimeCount() const noexcept {
+		return _frameGPUTimeCount;
+	}
+
+	// GetFrameGPUTime 的结果所属的帧是否渲染了整个效果链
+	bool IsFrameGPUTimeFullChain() const noexcept {
+		return _isFrameGPUTimeFullChain;
+	}
+
+	// isFullChain 表示这一帧是否渲染整个效果链。没有新帧时只渲染部分通道，用时无法代表效果链的开销
+	void OnBeginEffects(bool isFullChain = true);
 
 	// 每个通道结束后调用
 	void OnEndPass(UINT idx);
 
 	void OnEndEffects();
 
+	// 绘制覆盖层后调用，没有覆盖层时也要调用
+	void OnEndOverlay();
+
 private:
-	void _UpdateGPUTimings();
+	// 读取所有已完成的查询，不等待 GPU
+	void _ReadProfilingQueries();
+
+	void _AddProfilingResult(std::chrono::nanoseconds frameTime, const SmallVectorImpl<float>& passTimings, float overlayTiming);
+
+	void _ReadFrameTiming() noexcept;
 
 	std::chrono::time_point<std::chrono::steady_clock> _lastTimePoint;
 
@@ -57,28 +151,67 @@ private:
 	UINT _framesThisSecond = 0;
 	std::chrono::nanoseconds _fpsCounter{};
 
+	static constexpr uint32_t HISTOGRAM_WINDOW_SIZE = 1000;
+	FrameTimeHistogram _frameTimeHistogram{ HISTOGRAM_WINDOW_SIZE };
+	FrameTimeHistogram _gpuTimeHistogram{ HISTOGRAM_WINDOW_SIZE };
+	FrameTimeHistogram _presentIntervalHistogram{ HISTOGRAM_WINDOW_SIZE };
+	FrameTimeHistogram _overlayGPUTimeHistogram{ HISTOGRAM_WINDOW_SIZE };
+	std::chrono::time_point<std::chrono::steady_clock> _lastPresentTime;
+	bool _isFrameSkipped = false;
+
+	std::array<StutterEvent, 8> _recentStutters{};
+	uint32_t _recentStutterCount = 0;
+	uint32_t _stutterCount = 0;
+
 	GPUTimings _gpuTimings;
 	// 记录的第一帧首先更新一次，而不是等待更新间隔
 	bool _firstProfilingFrame = true;
 	// 更新渲染用时的间隔
 	std::chrono::nanoseconds _updateProfilingTime{};
-	std::chrono::nanoseconds _profilingCounter{};
+	// 当前统计区间结束的时刻，结果所属帧的时刻超过它时更新渲染用时
+	std::chrono::nanoseconds _profilingEndTime{};
 
 	struct _QueryInfo {
 		winrt::com_ptr<ID3D11Query> disjoint;
 		winrt::com_ptr<ID3D11Query> start;
 		std::vector<winrt::com_ptr<ID3D11Query>> passes;
+		winrt::com_ptr<ID3D11Query> overlay;
+		// 提交查询的帧开始的时刻，用于将结果归入正确的统计区间
+		std::chrono::nanoseconds frameTime{};
+		// 提交查询时的 QPC 计数，用于将 GPU 时间戳换算为跟踪中的时刻
+		int64_t submitTime = 0;
+		bool issued = false;
 	};
-	// [(disjoint, [timestamp])]
-	// 允许额外的延迟时需保存两帧的数据
-	std::array<_QueryInfo, 2> _queries;
+	// 查询环，按提交顺序使用。GPU 按顺序执行，因此只需从最早提交的开始读取
+	std::vector<_QueryInfo> _queries;
 	// -1：无需统计渲染时间
 	// 否则为当前帧在 _queries 中的位置
 	int _curQueryIdx = -1;
+	// 最早提交且尚未读取的查询的位置
+	uint32_t _oldestQueryIdx = 0;
 
 	// 用于保存渲染时间
 	// (总计用时, 已统计帧数)
 	SmallVector<std::pair<float, UINT>, 0> _passesTimings;
+	std::pair<float, UINT> _overlayTimings;
+	std::vector<std::string> _passNames;
+	int64_t _qpcFrequency = 0;
+	std::function<void(const SmallVectorImpl<float>&)> _passTimingsCallback;
+
+	struct _FrameTimingQuery {
+		winrt::com_ptr<ID3D11Query> disjoint;
+		winrt::com_ptr<ID3D11Query> start;
+		winrt::com_ptr<ID3D11Query> end;
+		bool isFullChain = false;
+		bool issued = false;
+	};
+	// 查询的结果通常在两帧后可用，不等待，未完成时跳过
+	std::array<_FrameTimingQuery, 3> _frameTimingQueries;
+	uint32_t _curFrameTimingIdx = 0;
+	bool _isFrameTiming = false;
+	float _frameGPUTime = -1.0f;
+	uint32_t _frameGPUTimeCount = 0;
+	bool _isFrameGPUTimeFullChain = false;
 };
 
 }
@@ -66,17 +66,20 @@ bool GraphicsCaptureFrameSource::Initialize() {
 		}
 	}
 
-	_output = MagApp::Get().GetDeviceResources().CreateTexture2D(
-		DXGI_FORMAT_B8G8R8A8_UNORM,
-		_frameBox.right - _frameBox.left,
-		_frameBox.bottom - _frameBox.top,
-		D3D11_BIND_SHADER_RESOURCE
-	);
-	if (!_output) {
-		Logger::Get().Error("创建纹理失败");
+	// 直接使用帧的纹理时 _output 在第一帧到达前作为占位
+	if (!_CreateOutput()) {
+		Logger::Get().Error("_CreateOutput 失败");
 		return false;
 	}
 
+	_isZeroCopy = _CanZeroCopy();
+	if (_isZeroCopy) {
+		// 复制需要读写各一次
+		const float savedMB = (_frameBox.right - _frameBox.left) * (_frameBox.bottom - _frameBox.top)
+			* 4 * 2 / 1048576.0f;
+		Logger::Get().Info(fmt::format("将直接使用帧的纹理，每帧约节省 {:.1f} MB 显存带宽", savedMB));
+	}
+
 	if (!StartCapture()) {
 		Logger::Get().Error("_StartCapture 失败");
 		return false;
@@ -92,14 +95,21 @@ FrameSourceBase::UpdateState GraphicsCaptureFrameSource::Update() {
 		return UpdateState::Waiting;
 	}
 
-	winrt::Direct3D11CaptureFrame frame = _captureFramePool.TryGetNextFrame();
-	if (!frame) {
-		// 缓冲池没有帧则等待新的帧
-		// 因为已通过 FrameArrived 注册回调，所以每当有新帧时会有新消息到达
-		WaitMessage();
+	_Frame* newFrame = _frames.TryConsume();
+	if (!newFrame) {
+		if (_hasFrame) {
+			return UpdateState::NoUpdate;
+		}
+
+		// 第一帧之前不渲染。捕获线程发布帧后会唤醒渲染线程，设置超时以定期检查源窗口的状态
+		MsgWaitForMultipleObjectsEx(0, nullptr, 100, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
 		return UpdateState::Waiting;
 	}
 
+	// 移出 FrameMailbox，之后由渲染线程负责关闭
+	winrt::Direct3D11CaptureFrame frame = std::move(newFrame->frame);
+	_frameTime = newFrame->frameTime;
+
 	// 从帧获取 IDXGISurface
 	winrt::IDirect3DSurface d3dSurface = frame.Surface();
 
@@ -114,39 +124,145 @@ FrameSourceBase::UpdateState GraphicsCaptureFrameSource::Update() {
 		return UpdateState::Error;
 	}
 
+	D3D11_TEXTURE2D_DESC frameDesc;
+	withFrame->GetDesc(&frameDesc);
+
+	// 帧的尺寸和帧缓冲池相同。捕获区域改变后帧缓冲池重新创建前到达的帧仍是旧尺寸，
+	// 直接使用会读取错误的区域，复制时 _frameBox 还可能超出帧的范围，丢弃它们即可
+	if (frameDesc.Width != _frameBox.right || frameDesc.Height != _frameBox.bottom) {
+		frame.Close();
+		return UpdateState::Waiting;
+	}
+
+	if (_isZeroCopy) {
+		if (_CheckFrameTexture(frameDesc)) {
+			if (std::none_of(_poolTextures.begin(), _poolTextures.end(),
+				[&](const _PoolTexture& pooled) { return pooled.texture == withFrame.get(); })
+			) {
+				winrt::com_ptr<ID3D11ShaderResourceView> srv =
+					MagApp::Get().GetDeviceResources().GetShaderResourceView(withFrame.get());
+				if (!srv) {
+					Logger::Get().Error("GetShaderResourceView 失败");
+					frame.Close();
+					return UpdateState::Error;
+				}
+				_poolTextures.push_back({ withFrame.get(), std::move(srv) });
+			}
+
+			_output = std::move(withFrame);
+
+			// BeginFrame 已等待上一帧呈现，可以将它归还给帧缓冲池
+			if (_curFrame) {
+				_curFrame.Close();
+			}
+			_curFrame = std::move(frame);
+			_hasFrame = true;
+			return UpdateState::NewFrame;
+		}
+
+		Logger::Get().Info("帧的纹理无法作为输出，回落到复制");
+		_isZeroCopy = false;
+		_isZeroCopyFailed = true;
+
+		_RetirePoolTextures();
+		if (!_CreateOutput()) {
+			Logger::Get().Error("_CreateOutput 失败");
+			return UpdateState::Error;
+		}
+	}
+
 	MagApp::Get().GetDeviceResources().GetD3DDC()
 		->CopySubresourceRegion(_output.get(), 0, 0, 0, 0, withFrame.get(), 0, &_frameBox);
 
 	frame.Close();
+	_hasFrame = true;
 	return UpdateState::NewFrame;
 }
 
-bool GraphicsCaptureFrameSource::_CaptureWindow(IGraphicsCaptureItemInterop* interop) {
-	// DwmGetWindowAttribute 和 Graphics.Capture 无法应用于子窗口
-	HWND hwndSrc = MagApp::Get().GetHwndSrc();
+void GraphicsCaptureFrameSource::_OnFrameArrived(const winrt::Direct3D11CaptureFramePool& framePool) {
+	std::scoped_lock lk(_frameArrivedMutex);
 
-	// 包含边框的窗口尺寸
-	RECT srcRect{};
-	if (!Win32Utils::GetWindowFrameRect(hwndSrc, srcRect)) {
-		Logger::Get().Error("GetWindowFrameRect 失败");
-		return false;
+	if (!_isCapturing) {
+		return;
 	}
 
-	if (!_UpdateSrcFrameRect()) {
-		Logger::Get().Error("UpdateSrcFrameRect 失败");
+	winrt::Direct3D11CaptureFrame frame{ nullptr };
+	try {
+		frame = framePool.TryGetNextFrame();
+	} catch (const winrt::hresult_error& e) {
+		Logger::Get().Error(StrUtils::Concat("TryGetNextFrame 失败：", StrUtils::UTF16ToUTF8(e.message())));
+		return;
+	}
+
+	if (!frame) {
+		return;
+	}
+
+	_Frame& writeFrame = _frames.GetWriteBuffer();
+	{
+		// SystemRelativeTime 基于 QPC，单位为 100 纳秒
+		static const int64_t qpcFrequency = [] {
+			LARGE_INTEGER frequency;
+			QueryPerformanceFrequency(&frequency);
+			return frequency.QuadPart;
+		}();
+		// 分开计算以免溢出
+		const int64_t time = frame.SystemRelativeTime().count();
+		writeFrame.frameTime = time / 10'000'000 * qpcFrequency + time % 10'000'000 * qpcFrequency / 10'000'000;
+	}
+	writeFrame.frame = std::move(frame);
+	_frames.Publish();
+
+	// 换回的缓冲区中是未被渲染线程取走的旧帧，归还给帧缓冲池以接收新帧
+	_Frame& staleFrame = _frames.GetWriteBuffer();
+	if (staleFrame.frame) {
+		staleFrame.frame.Close();
+		staleFrame.frame = nullptr;
+	}
+
+	// 唤醒可能正在空闲的渲染线程
+	PostMessage(_hwndHost, WM_NULL, 0, 0);
+}
+
+bool GraphicsCaptureFrameSource::_CreateOutput() noexcept {
+	_output = MagApp::Get().GetDeviceResources().CreateTexture2D(
+		GPUMemoryOwner::FrameSource,
+		DXGI_FORMAT_B8G8R8A8_UNORM,
+		_frameBox.right - _frameBox.left,
+		_frameBox.bottom - _frameBox.top,
+		D3D11_BIND_SHADER_RESOURCE
+	);
+	if (!_output) {
+		Logger::Get().Error("创建纹理失败");
 		return false;
 	}
 
-	// 在源窗口存在 DPI 缩放时有时会有一像素的偏移（取决于窗口在屏幕上的位置）
-	// 可能是 DwmGetWindowAttribute 的 bug
-	_frameBox = {
-		UINT(_srcFrameRect.left - srcRect.left),
-		UINT(_srcFrameRect.top - srcRect.top),
-		0,
-		UINT(_srcFrameRect.right - srcRect.left),
-		UINT(_srcFrameRect.bottom - srcRect.top),
-		1
-	};
+	return true;
+}
+
+bool GraphicsCaptureFrameSource::_CheckFrameTexture(const D3D11_TEXTURE2D_DESC& desc) noexcept {
+	return (desc.BindFlags & D3D11_BIND_SHADER_RESOURCE)
+		&& desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM
+		&& desc.MipLevels == 1 && desc.ArraySize == 1 && desc.SampleDesc.Count == 1;
+}
+
+void GraphicsCaptureFrameSource::_RetirePoolTextures() noexcept {
+	if (_curFrame) {
+		_curFrame.Close();
+		_curFrame = nullptr;
+	}
+
+	_poolTextures.clear();
+}
+
+bool GraphicsCaptureFrameSource::_CaptureWindow(IGraphicsCaptureItemInterop* interop) {
+	// DwmGetWindowAttribute 和 Graphics.Capture 无法应用于子窗口
+	HWND hwndSrc = MagApp::Get().GetHwndSrc();
+
+	if (!_UpdateWindowFrameBox()) {
+		Logger::Get().Error("_UpdateWindowFrameBox 失败");
+		return false;
+	}
 
 	if (_TryCreateGraphicsCaptureItem(interop, hwndSrc)) {
 		return true;
@@ -208,6 +324,84 @@ bool GraphicsCaptureFrameSource::_CaptureWindow(IGraphicsCaptureItemInterop* int
 	return false;
 }
 
+bool GraphicsCaptureFrameSource::_UpdateWindowFrameBox() {
+	// 包含边框的窗口尺寸
+	RECT srcRect{};
+	if (!Win32Utils::GetWindowFrameRect(MagApp::Get().GetHwndSrc(), srcRect)) {
+		Logger::Get().Error("GetWindowFrameRect 失败");
+		return false;
+	}
+
+	if (!_UpdateSrcFrameRect()) {
+		Logger::Get().Error("UpdateSrcFrameRect 失败");
+		return false;
+	}
+
+	// 在源窗口存在 DPI 缩放时有时会有一像素的偏移（取决于窗口在屏幕上的位置）
+	// 可能是 DwmGetWindowAttribute 的 bug
+	_frameBox = {
+		UINT(_srcFrameRect.left - srcRect.left),
+		UINT(_srcFrameRect.top - srcRect.top),
+		0,
+		UINT(_srcFrameRect.right - srcRect.left),
+		UINT(_srcFrameRect.bottom - srcRect.top),
+		1
+	};
+
+	return true;
+}
+
+bool GraphicsCaptureFrameSource::OnSrcWndRectChanged() {
+	if (_isScreenCapture) {
+		// 屏幕捕获的捕获区域取决于源窗口所在的屏幕，重新开始缩放
+		return false;
+	}
+
+	const D3D11_BOX oldFrameBox = _frameBox;
+	if (!_UpdateWindowFrameBox()) {
+		Logger::Get().Error("_UpdateWindowFrameBox 失败");
+		return false;
+	}
+
+	const bool oldIsZeroCopy = _isZeroCopy;
+	_isZeroCopy = _CanZeroCopy();
+
+	const bool isPoolChanged = _frameBox.right != oldFrameBox.right
+		|| _frameBox.bottom != oldFrameBox.bottom || _isZeroCopy != oldIsZeroCopy;
+	if (oldIsZeroCopy && isPoolChanged) {
+		_RetirePoolTextures();
+	}
+
+	// 窗口捕获的帧以窗口左上角为原点，只移动窗口时无需更新。
+	// 不再直接使用帧的纹理时 _output 属于帧缓冲池，不能作为复制的目标
+	if (_frameBox.right - _frameBox.left != oldFrameBox.right - oldFrameBox.left
+		|| _frameBox.bottom - _frameBox.top != oldFrameBox.bottom - oldFrameBox.top
+		|| (oldIsZeroCopy && !_isZeroCopy)
+	) {
+		if (!_CreateOutput()) {
+			Logger::Get().Error("_CreateOutput 失败");
+			return false;
+		}
+	}
+
+	if (isPoolChanged) {
+		try {
+			// 使帧的尺寸和新的窗口尺寸匹配，之后到达的帧将使用新尺寸
+			_captureFramePool.Recreate(
+				_wrappedD3DDevice,
+				winrt::DirectXPixelFormat::B8G8R8A8UIntNormalized,
+				_GetFramePoolSize(),
+				{ (int)_frameBox.right, (int)_frameBox.bottom }
+			);
+		} catch (const winrt::hresult_error& e) {
+			Logger::Get().Error(StrUtils::Concat("重新创建帧缓冲池失败：", StrUtils::UTF16ToUTF8(e.message())));
+			return false;
+		}
+	}
+
+	return true;
+}
+
 bool GraphicsCaptureFrameSource::_TryCreateGraphicsCaptureItem(IGraphicsCaptureItemInterop* interop, HWND hwndSrc) noexcept {
 	try {
 		HRESULT hr = interop->CreateForWindow(
@@ -335,19 +529,27 @@ bool GraphicsCaptureFrameSource::StartCapture() {
 		return true;
 	}
 
+	_hwndHost = MagApp::Get().GetHwndHost();
+	{
+		std::scoped_lock lk(_frameArrivedMutex);
+		_isCapturing = true;
+	}
+
 	try {
-		// 创建帧缓冲池
+		// 创建帧缓冲池，FrameArrived 在线程池中触发
 		// 帧的尺寸和 _captureItem.Size() 不同
-		_captureFramePool = winrt::Direct3D11CaptureFramePool::Create(
+		_captureFramePool = winrt::Direct3D11CaptureFramePool::CreateFreeThreaded(
 			_wrappedD3DDevice,
 			winrt::DirectXPixelFormat::B8G8R8A8UIntNormalized,
-			1,	// 帧的缓存数量
+			_GetFramePoolSize(),
 			{ (int)_frameBox.right, (int)_frameBox.bottom } // 帧的尺寸为包含源窗口的最小尺寸
 		);
 
-		// 注册回调是为了确保每当有新的帧时会向当前线程发送消息
-		// 回调中什么也不做
-		_captureFramePool.FrameArrived([](const auto&, const auto&) {});
+		_frameArrivedRevoker = _captureFramePool.FrameArrived(winrt::auto_revoke,
+			[this](const winrt::Direct3D11CaptureFramePool& framePool, const auto&) {
+				_OnFrameArrived(framePool);
+			}
+		);
 
 		_captureSession = _captureFramePool.CreateCaptureSession(_captureItem);
 
@@ -380,6 +582,24 @@ bool GraphicsCaptureFrameSource::StartCapture() {
 }
 
 void GraphicsCaptureFrameSource::StopCapture() {
+	_frameArrivedRevoker.revoke();
+	{
+		// 等待正在执行的回调
+		std::scoped_lock lk(_frameArrivedMutex);
+		_isCapturing = false;
+	}
+
+	// 捕获线程已停止，可以访问所有缓冲区
+	for (_Frame& frame : _frames.GetBuffers()) {
+		if (frame.frame) {
+			frame.frame.Close();
+			frame.frame = nullptr;
+		}
+	}
+
+	// 当前输出仍可使用，视图在输出被替换后释放
+	_RetirePoolTextures();
+
 	if (_captureSession) {
 		_captureSession.Close();
 		_captureSession = nullptr;
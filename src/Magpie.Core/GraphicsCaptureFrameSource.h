@@ -1,5 +1,8 @@
 #pragma once
 #include "FrameSourceBase.h"
+#include "SmallVector.h"
+#include "FrameMailbox.h"
+#include "Win32Utils.h"
 #include <winrt/Windows.Graphics.Capture.h>
 #include <Windows.Graphics.Capture.Interop.h>
 
@@ -7,6 +10,7 @@ namespace Magpie::Core {
 
 // 使用 Window Runtime 的 Windows.Graphics.Capture API 抓取窗口
 // 见 https://docs.microsoft.com/en-us/windows/uwp/audio-video-camera/screen-capture
+// 帧在线程池中到达，通过 FrameMailbox 传递给渲染线程，渲染线程无需等待新帧
 class GraphicsCaptureFrameSource : public FrameSourceBase {
 public:
 	GraphicsCaptureFrameSource() {};
@@ -20,6 +24,8 @@ public:
 		return _isScreenCapture;
 	}
 
+	bool OnSrcWndRectChanged() override;
+
 	const char* GetName() const noexcept override {
 		return NAME;
 	}
@@ -42,22 +48,75 @@ protected:
 private:
 	bool _CaptureWindow(IGraphicsCaptureItemInterop* interop);
 
+	// 计算源窗口客户区在窗口捕获的帧中的位置
+	bool _UpdateWindowFrameBox();
+
 	bool _CaptureMonitor(IGraphicsCaptureItemInterop* interop);
 
 	bool _TryCreateGraphicsCaptureItem(IGraphicsCaptureItemInterop* interop, HWND hwndSrc) noexcept;
 
 	void _RemoveOwnerFromAltTabList(HWND hwndSrc) noexcept;
 
+	bool _CreateOutput() noexcept;
+
+	// 在线程池中调用，将帧发布给渲染线程
+	void _OnFrameArrived(const winrt::Windows::Graphics::Capture::Direct3D11CaptureFramePool& framePool);
+
+	// 帧缓冲池中的帧数。未被取走的帧和正在接收的帧各占用一个，直接使用帧的纹理时当前帧也被占用
+	int32_t _GetFramePoolSize() const noexcept {
+		return _isZeroCopy ? 3 : 2;
+	}
+
+	// 捕获区域位于帧的左上角时可以直接将帧的纹理作为输出
+	bool _CanZeroCopy() const noexcept {
+		return !_isZeroCopyFailed && _frameBox.left == 0 && _frameBox.top == 0;
+	}
+
+	// 检查帧的纹理能否作为输出，不检查尺寸
+	static bool _CheckFrameTexture(const D3D11_TEXTURE2D_DESC& desc) noexcept;
+
+	// 当前帧缓冲池中的纹理不再使用时调用，效果仍持有当前输出的视图直到输出被替换
+	void _RetirePoolTextures() noexcept;
+
 	LONG_PTR _originalSrcExStyle = 0;
 	LONG_PTR _originalOwnerExStyle = 0;
 	winrt::com_ptr<ITaskbarList> _taskbarList;
 
 	D3D11_BOX _frameBox{};
 
+	// 直接使用帧的纹理作为输出，省去一次复制
+	bool _isZeroCopy = false;
+	// 帧的纹理无法作为输出，不再尝试
+	bool _isZeroCopyFailed = false;
+	// 直接使用帧的纹理时持有当前帧，直到下一帧到达
+	winrt::Windows::Graphics::Capture::Direct3D11CaptureFrame _curFrame{ nullptr };
+	// 当前帧缓冲池中已作为输出的纹理和它们的视图。持有视图使效果切换输入时总能从缓存中取出
+	struct _PoolTexture {
+		ID3D11Texture2D* texture = nullptr;
+		winrt::com_ptr<ID3D11ShaderResourceView> srv;
+	};
+	SmallVector<_PoolTexture, 3> _poolTextures;
+
 	bool _isScreenCapture = false;
 
+	// 捕获线程和渲染线程间传递的帧，渲染线程取走帧后将它移出 FrameMailbox
+	struct _Frame {
+		winrt::Windows::Graphics::Capture::Direct3D11CaptureFrame frame{ nullptr };
+		// 帧被捕获的时刻，单位为 QPC 计数
+		int64_t frameTime = 0;
+	};
+	FrameMailbox<_Frame> _frames;
+	// 使 FrameArrived 回调互斥，并保证停止捕获后不再发布帧
+	Win32Utils::SRWMutex _frameArrivedMutex;
+	// 由 _frameArrivedMutex 保护
+	bool _isCapturing = false;
+	// 是否已取得过帧
+	bool _hasFrame = false;
+	HWND _hwndHost = NULL;
+
 	winrt::Windows::Graphics::Capture::GraphicsCaptureItem _captureItem{ nullptr };
 	winrt::Windows::Graphics::Capture::Direct3D11CaptureFramePool _captureFramePool{ nullptr };
+	winrt::Windows::Graphics::Capture::Direct3D11CaptureFramePool::FrameArrived_revoker _frameArrivedRevoker;
 	winrt::Windows::Graphics::Capture::GraphicsCaptureSession _captureSession{ nullptr };
 	winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice _wrappedD3DDevice{ nullptr };
 };
@@ -8,6 +8,7 @@
 #include "DeviceResources.h"
 #include "StrUtils.h"
 #include "Logger.h"
+#include "Utils.h"
 
 namespace Magpie::Core {
 
@@ -50,6 +51,20 @@ float4 main(PS_INPUT input) : SV_Target {
 	return input.col * float4(1, 1, 1, texture0.Sample(sampler0, input.uv).r);
 })";
 
+// 用一个覆盖整个视口的三角形合成缓存的覆盖层，绘制区域由裁剪矩形限制
+static constexpr const char* COMPOSITE_VERTEX_SHADER = R"(
+float4 main(uint id : SV_VertexID) : SV_POSITION {
+	float2 uv = float2((id << 1) & 2, id & 2);
+	return float4(uv * float2(2, -2) + float2(-1, 1), 0, 1);
+})";
+
+static constexpr const char* COMPOSITE_PIXEL_SHADER = R"(
+Texture2D cache : register(t0);
+
+float4 main(float4 pos : SV_POSITION) : SV_Target {
+	return cache.Load(int3(pos.xy, 0));
+})";
+
 struct VERTEX_CONSTANT_BUFFER_DX11 {
 	float mvp[4][4];
 };
@@ -89,12 +104,177 @@ void ImGuiBackend::_SetupRenderState(ImDrawData* drawData, ID3D11DeviceContext*
 	ctx->RSSetState(_rasterizerState.get());
 }
 
-void ImGuiBackend::RenderDrawData(ImDrawData* drawData) noexcept {
+static uint64_t CombineHash(uint64_t seed, uint64_t hash) noexcept {
+	return seed ^ (hash + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2));
+}
+
+// 顶点、索引和绘制命令都相同则绘制结果相同
+static uint64_t HashDrawData(const ImDrawData* drawData) noexcept {
+	const ImVec2 display[] = { drawData->DisplayPos, drawData->DisplaySize };
+	uint64_t result = Utils::HashData({ (const BYTE*)display, sizeof(display) });
+
+	for (int n = 0; n < drawData->CmdListsCount; ++n) {
+		const ImDrawList* cmdList = drawData->CmdLists[n];
+		result = CombineHash(result, Utils::HashData({ (const BYTE*)cmdList->VtxBuffer.Data, cmdList->VtxBuffer.size_in_bytes() }));
+		result = CombineHash(result, Utils::HashData({ (const BYTE*)cmdList->IdxBuffer.Data, cmdList->IdxBuffer.size_in_bytes() }));
+		result = CombineHash(result, Utils::HashData({ (const BYTE*)cmdList->CmdBuffer.Data, cmdList->CmdBuffer.size_in_bytes() }));
+	}
+
+	return result;
+}
+
+void ImGuiBackend::RenderDrawData(ImDrawData* drawData, ID3D11RenderTargetView* rtv) noexcept {
 	// Avoid rendering when minimized
 	if (drawData->DisplaySize.x <= 0.0f || drawData->DisplaySize.y <= 0.0f) {
 		return;
 	}
 
+	if (MagApp::Get().GetOptions().IsDisableOverlayCache()) {
+		MagApp::Get().GetDeviceResources().GetD3DDC()->OMSetRenderTargets(1, &rtv, nullptr);
+		_RenderDrawData(drawData);
+		return;
+	}
+
+	// 大部分帧中覆盖层没有变化，如只显示帧率时每秒才变化一次
+	const uint64_t hash = HashDrawData(drawData);
+	if (!_cacheTexture || hash != _cacheHash) {
+		if (!_UpdateCache(drawData)) {
+			Logger::Get().Error("_UpdateCache 失败");
+			_cacheHash = 0;
+
+			MagApp::Get().GetDeviceResources().GetD3DDC()->OMSetRenderTargets(1, &rtv, nullptr);
+			_RenderDrawData(drawData);
+			return;
+		}
+
+		_cacheHash = hash;
+	}
+
+	_CompositeCache(rtv);
+}
+
+bool ImGuiBackend::_UpdateCache(ImDrawData* drawData) noexcept {
+	DeviceResources& dr = MagApp::Get().GetDeviceResources();
+	ID3D11DeviceContext4* ctx = dr.GetD3DDC();
+
+	D3D11_TEXTURE2D_DESC backBufferDesc;
+	dr.GetBackBuffer()->GetDesc(&backBufferDesc);
+
+	static constexpr float TRANSPARENT_COLOR[4]{};
+
+	D3D11_TEXTURE2D_DESC cacheDesc{};
+	if (_cacheTexture) {
+		_cacheTexture->GetDesc(&cacheDesc);
+	}
+
+	if (cacheDesc.Width != backBufferDesc.Width || cacheDesc.Height != backBufferDesc.Height || cacheDesc.Format != backBufferDesc.Format) {
+		_cacheRtv = nullptr;
+		_cacheSrv = nullptr;
+		_cacheTexture = dr.CreateTexture2D(
+			GPUMemoryOwner::Overlay,
+			backBufferDesc.Format,
+			backBufferDesc.Width,
+			backBufferDesc.Height,
+			D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE
+		);
+		if (!_cacheTexture) {
+			Logger::Get().Error("创建纹理失败");
+			return false;
+		}
+
+		_cacheRtv = dr.GetRenderTargetView(_cacheTexture.get());
+		if (!_cacheRtv) {
+			Logger::Get().Error("GetRenderTargetView 失败");
+			_cacheTexture = nullptr;
+			return false;
+		}
+		_cacheSrv = dr.GetShaderResourceView(_cacheTexture.get());
+		if (!_cacheSrv) {
+			Logger::Get().Error("GetShaderResourceView 失败");
+			_cacheRtv = nullptr;
+			_cacheTexture = nullptr;
+			return false;
+		}
+
+		ctx->ClearRenderTargetView(_cacheRtv.get(), TRANSPARENT_COLOR);
+	} else if (_cacheBounds.right > _cacheBounds.left && _cacheBounds.bottom > _cacheBounds.top) {
+		// 其他区域仍是透明的
+		ctx->ClearView(_cacheRtv.get(), TRANSPARENT_COLOR, &_cacheBounds, 1);
+	}
+
+	// 计算新内容的范围
+	ImVec2 minPos(FLT_MAX, FLT_MAX);
+	ImVec2 maxPos(-FLT_MAX, -FLT_MAX);
+	for (int n = 0; n < drawData->CmdListsCount; ++n) {
+		for (const ImDrawVert& vert : drawData->CmdLists[n]->VtxBuffer) {
+			minPos.x = std::min(minPos.x, vert.pos.x);
+			minPos.y = std::min(minPos.y, vert.pos.y);
+			maxPos.x = std::max(maxPos.x, vert.pos.x);
+			maxPos.y = std::max(maxPos.y, vert.pos.y);
+		}
+	}
+
+	if (minPos.x > maxPos.x) {
+		_cacheBounds = {};
+	} else {
+		const ImVec2 clipOff = drawData->DisplayPos;
+		_cacheBounds = {
+			std::clamp((LONG)std::floor(minPos.x - clipOff.x), 0L, (LONG)backBufferDesc.Width),
+			std::clamp((LONG)std::floor(minPos.y - clipOff.y), 0L, (LONG)backBufferDesc.Height),
+			std::clamp((LONG)std::ceil(maxPos.x - clipOff.x), 0L, (LONG)backBufferDesc.Width),
+			std::clamp((LONG)std::ceil(maxPos.y - clipOff.y), 0L, (LONG)backBufferDesc.Height)
+		};
+	}
+
+	// 使用 ImGui 的混合方式绘制到透明的纹理上，结果是预乘 Alpha 的
+	{
+		ID3D11RenderTargetView* t = _cacheRtv.get();
+		ctx->OMSetRenderTargets(1, &t, nullptr);
+	}
+	_RenderDrawData(drawData);
+
+	return true;
+}
+
+void ImGuiBackend::_CompositeCache(ID3D11RenderTargetView* rtv) noexcept {
+	if (_cacheBounds.right <= _cacheBounds.left || _cacheBounds.bottom <= _cacheBounds.top) {
+		return;
+	}
+
+	ID3D11DeviceContext4* ctx = MagApp::Get().GetDeviceResources().GetD3DDC();
+
+	D3D11_TEXTURE2D_DESC cacheDesc;
+	_cacheTexture->GetDesc(&cacheDesc);
+
+	D3D11_VIEWPORT vp{};
+	vp.Width = (float)cacheDesc.Width;
+	vp.Height = (float)cacheDesc.Height;
+	vp.MaxDepth = 1.0f;
+	ctx->RSSetViewports(1, &vp);
+	ctx->RSSetScissorRects(1, &_cacheBounds);
+	ctx->RSSetState(_rasterizerState.get());
+
+	ctx->OMSetRenderTargets(1, &rtv, nullptr);
+	const float blendFactor[4]{};
+	ctx->OMSetBlendState(_compositeBlendState.get(), blendFactor, 0xffffffff);
+
+	ctx->IASetInputLayout(nullptr);
+	ctx->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	ctx->VSSetShader(_compositeVertexShader.get(), nullptr, 0);
+	ctx->PSSetShader(_compositePixelShader.get(), nullptr, 0);
+	{
+		ID3D11ShaderResourceView* t = _cacheSrv.get();
+		ctx->PSSetShaderResources(0, 1, &t);
+	}
+
+	ctx->Draw(3, 0);
+
+	// 缓存更新时将作为渲染目标
+	ID3D11ShaderResourceView* nullSrv = nullptr;
+	ctx->PSSetShaderResources(0, 1, &nullSrv);
+}
+
+void ImGuiBackend::_RenderDrawData(ImDrawData* drawData) noexcept {
 	DeviceResources& dr = MagApp::Get().GetDeviceResources();
 	ID3D11DeviceContext4* ctx = dr.GetD3DDC();
 	ID3D11Device5* d3dDevice = dr.GetD3DDevice();
@@ -114,6 +294,7 @@ void ImGuiBackend::RenderDrawData(ImDrawData* drawData) noexcept {
 			Logger::Get().ComError("CreateBuffer 失败", hr);
 			return;
 		}
+		dr.GetMemoryTracker().Track(_vertexBuffer.get(), GPUMemoryOwner::Overlay);
 	}
 	if (!_indexBuffer || _indexBufferSize < drawData->TotalIdxCount) {
 		_indexBufferSize = drawData->TotalIdxCount + 10000;
@@ -127,6 +308,7 @@ void ImGuiBackend::RenderDrawData(ImDrawData* drawData) noexcept {
 			Logger::Get().ComError("CreateBuffer 失败", hr);
 			return;
 		}
+		dr.GetMemoryTracker().Track(_indexBuffer.get(), GPUMemoryOwner::Overlay);
 	}
 
 	// Upload vertex/index data into a single contiguous GPU buffer
@@ -223,7 +405,8 @@ void ImGuiBackend::RenderDrawData(ImDrawData* drawData) noexcept {
 
 bool ImGuiBackend::_CreateFontsTexture() noexcept {
 	ImGuiIO& io = ImGui::GetIO();
-	ID3D11Device5* d3dDevice = MagApp::Get().GetDeviceResources().GetD3DDevice();
+	DeviceResources& dr = MagApp::Get().GetDeviceResources();
+	ID3D11Device5* d3dDevice = dr.GetD3DDevice();
 
 	HRESULT hr;
 
@@ -234,31 +417,29 @@ bool ImGuiBackend::_CreateFontsTexture() noexcept {
 
 	// Upload texture to graphics system
 	{
-		D3D11_TEXTURE2D_DESC desc{};
-		desc.Width = width;
-		desc.Height = height;
-		desc.MipLevels = 1;
-		desc.ArraySize = 1;
-		desc.Format = DXGI_FORMAT_R8_UNORM;
-		desc.SampleDesc.Count = 1;
-		desc.Usage = D3D11_USAGE_DEFAULT;
-		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-
-		winrt::com_ptr<ID3D11Texture2D> texture = nullptr;
 		D3D11_SUBRESOURCE_DATA subResource{};
 		subResource.pSysMem = pixels;
 		subResource.SysMemPitch = width;
-		hr = d3dDevice->CreateTexture2D(&desc, &subResource, texture.put());
-		if (FAILED(hr)) {
-			Logger::Get().ComError("CreateTexture2D 失败", hr);
+		winrt::com_ptr<ID3D11Texture2D> texture = dr.CreateTexture2D(
+			GPUMemoryOwner::Overlay,
+			DXGI_FORMAT_R8_UNORM,
+			width,
+			height,
+			D3D11_BIND_SHADER_RESOURCE,
+			D3D11_USAGE_DEFAULT,
+			0,
+			&subResource
+		);
+		if (!texture) {
+			Logger::Get().Error("创建字体纹理失败");
 			return false;
 		}
 
 		// Create texture view
 		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc{};
-		srvDesc.Format = desc.Format;
+		srvDesc.Format = DXGI_FORMAT_R8_UNORM;
 		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-		srvDesc.Texture2D.MipLevels = desc.MipLevels;
+		srvDesc.Texture2D.MipLevels = 1;
 		hr = d3dDevice->CreateShaderResourceView(texture.get(), &srvDesc, _fontTextureView.put());
 		if (FAILED(hr)) {
 			Logger::Get().ComError("CreateShaderResourceView 失败", hr);
@@ -336,6 +517,7 @@ bool ImGuiBackend::_CreateDeviceObjects() noexcept {
 		desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
 		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 		d3dDevice->CreateBuffer(&desc, nullptr, _vertexConstantBuffer.put());
+		MagApp::Get().GetDeviceResources().GetMemoryTracker().Track(_vertexConstantBuffer.get(), GPUMemoryOwner::Overlay);
 	}
 
 	static winrt::com_ptr<ID3DBlob> pixelShaderBlob;
@@ -377,6 +559,66 @@ bool ImGuiBackend::_CreateDeviceObjects() noexcept {
 		}
 	}
 
+	static winrt::com_ptr<ID3DBlob> compositeVertexShaderBlob;
+	if (!compositeVertexShaderBlob) {
+		hr = D3DCompile(COMPOSITE_VERTEX_SHADER, StrUtils::StrLen(COMPOSITE_VERTEX_SHADER),
+			nullptr, nullptr, nullptr, "main", "vs_5_0", 0, 0, compositeVertexShaderBlob.put(), nullptr);
+		if (FAILED(hr)) {
+			Logger::Get().ComError("编译顶点着色器失败", hr);
+			return false;
+		}
+	}
+
+	hr = d3dDevice->CreateVertexShader(
+		compositeVertexShaderBlob->GetBufferPointer(),
+		compositeVertexShaderBlob->GetBufferSize(),
+		nullptr,
+		_compositeVertexShader.put()
+	);
+	if (FAILED(hr)) {
+		Logger::Get().ComError("CreateVertexShader 失败", hr);
+		return false;
+	}
+
+	static winrt::com_ptr<ID3DBlob> compositePixelShaderBlob;
+	if (!compositePixelShaderBlob) {
+		hr = D3DCompile(COMPOSITE_PIXEL_SHADER, StrUtils::StrLen(COMPOSITE_PIXEL_SHADER),
+			nullptr, nullptr, nullptr, "main", "ps_5_0", 0, 0, compositePixelShaderBlob.put(), nullptr);
+		if (FAILED(hr)) {
+			Logger::Get().ComError("编译像素着色器失败", hr);
+			return false;
+		}
+	}
+
+	hr = d3dDevice->CreatePixelShader(
+		compositePixelShaderBlob->GetBufferPointer(),
+		compositePixelShaderBlob->GetBufferSize(),
+		nullptr,
+		_compositePixelShader.put()
+	);
+	if (FAILED(hr)) {
+		Logger::Get().ComError("CreatePixelShader 失败", hr);
+		return false;
+	}
+
+	// 缓存的颜色已预乘 Alpha
+	{
+		D3D11_BLEND_DESC desc{};
+		desc.RenderTarget[0].BlendEnable = true;
+		desc.RenderTarget[0].SrcBlend = D3D11_BLEND_ONE;
+		desc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+		desc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+		desc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+		desc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+		desc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+		desc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+		hr = d3dDevice->CreateBlendState(&desc, _compositeBlendState.put());
+		if (FAILED(hr)) {
+			Logger::Get().ComError("CreateBlendState 失败", hr);
+			return false;
+		}
+	}
+
 	// Create the rasterizer state
 	{
 		D3D11_RASTERIZER_DESC desc{};
@@ -404,6 +646,22 @@ void ImGuiBackend::NewFrame() noexcept {
 	}
 }
 
+void ImGuiBackend::UpdateFontsTexture() noexcept {
+	// 尚未创建设备对象时将在 NewFrame 中创建
+	if (!_fontSampler) {
+		return;
+	}
+
+	_fontTextureView = nullptr;
+	_fontSampler = nullptr;
+	if (!_CreateFontsTexture()) {
+		Logger::Get().Error("_CreateFontsTexture 失败");
+	}
+
+	// 缓存中的文字来自旧的纹理，下一帧重新绘制
+	_cacheHash = 0;
+}
+
 bool ImGuiBackend::Initialize() noexcept {
 	// Setup backend capabilities flags
 	ImGuiIO& io = ImGui::GetIO();
@@ -13,7 +13,12 @@ public:
 	bool Initialize() noexcept;
 
 	void NewFrame() noexcept;
-	void RenderDrawData(ImDrawData* drawData) noexcept;
+
+	// 重新创建字体纹理并使缓存失效
+	void UpdateFontsTexture() noexcept;
+
+	// 内容和上一帧相同时直接合成缓存的纹理，不再上传顶点和绘制
+	void RenderDrawData(ImDrawData* drawData, ID3D11RenderTargetView* rtv) noexcept;
 	
 private:
 	bool _CreateDeviceObjects() noexcept;
@@ -21,6 +26,13 @@ private:
 	void _SetupRenderState(ImDrawData* drawData, ID3D11DeviceContext* ctx) noexcept;
 	bool _CreateFontsTexture() noexcept;
 
+	// 绘制到当前的渲染目标
+	void _RenderDrawData(ImDrawData* drawData) noexcept;
+
+	bool _UpdateCache(ImDrawData* drawData) noexcept;
+
+	void _CompositeCache(ID3D11RenderTargetView* rtv) noexcept;
+
 	winrt::com_ptr<ID3D11Buffer> _vertexBuffer;
 	int _vertexBufferSize = 5000;
 
@@ -35,6 +47,19 @@ private:
 	winrt::com_ptr<ID3D11ShaderResourceView> _fontTextureView;
 	winrt::com_ptr<ID3D11BlendState> _blendState;
 	winrt::com_ptr<ID3D11RasterizerState> _rasterizerState;
+
+	// 缓存的覆盖层，RGB 通道已预乘 A 通道，尺寸和后缓冲区相同
+	winrt::com_ptr<ID3D11Texture2D> _cacheTexture;
+	winrt::com_ptr<ID3D11RenderTargetView> _cacheRtv;
+	winrt::com_ptr<ID3D11ShaderResourceView> _cacheSrv;
+	// 绘制数据的哈希，用于检测内容变化
+	uint64_t _cacheHash = 0;
+	// 缓存中有内容的区域，合成时只处理这个区域
+	D3D11_RECT _cacheBounds{};
+
+	winrt::com_ptr<ID3D11VertexShader> _compositeVertexShader;
+	winrt::com_ptr<ID3D11PixelShader> _compositePixelShader;
+	winrt::com_ptr<ID3D11BlendState> _compositeBlendState;
 };
 
 }
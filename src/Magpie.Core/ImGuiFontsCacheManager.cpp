@@ -6,6 +6,8 @@
 #include "Win32Utils.h"
 #include "CommonSharedConstants.h"
 #include "StrUtils.h"
+#include "Utils.h"
+#include <zip/zip.h>
 
 namespace yas::detail {
 
@@ -141,24 +143,74 @@ namespace Magpie::Core {
 
 // 缓存版本
 // 当缓存文件结构有更改时更新它，使旧缓存失效
-static constexpr const uint32_t FONTS_CACHE_VERSION = 1;
+static constexpr const uint32_t FONTS_CACHE_VERSION = 2;
+
+// 缓存文件是只有这一个条目的 zip 文件
+static constexpr const char* CACHE_ENTRY_NAME = "fonts";
 
 static std::wstring GetCacheFileName(const std::wstring_view& language) noexcept {
 	return StrUtils::Concat(CommonSharedConstants::CACHE_DIR, L"fonts_", language);
 }
 
-void ImGuiFontsCacheManager::Save(std::wstring_view language, const ImFontAtlas& fontAltas) noexcept {
-	_buffer.reserve(131072);
+bool ImGuiFontsCacheManager::Serialize(
+	float dpiScale,
+	std::span<const ImWchar> extraGlyphs,
+	const ImFontAtlas& fontAltas,
+	std::vector<BYTE>& buffer
+) noexcept {
+	buffer.clear();
+	buffer.reserve(131072);
 
 	try {
-		yas::vector_ostream os(_buffer);
+		yas::vector_ostream os(buffer);
 		yas::binary_oarchive<yas::vector_ostream<BYTE>, yas::binary> oa(os);
 
-		oa& FONTS_CACHE_VERSION& fontAltas;
+		oa& FONTS_CACHE_VERSION& dpiScale;
+
+		const uint32_t glyphCount = (uint32_t)extraGlyphs.size();
+		oa& glyphCount;
+		oa.write(extraGlyphs.data(), extraGlyphs.size_bytes());
+
+		oa& fontAltas;
 	} catch (...) {
 		Logger::Get().Error("序列化 ImFontAtlas 失败");
+		return false;
+	}
+
+	return true;
+}
+
+void ImGuiFontsCacheManager::Save(std::wstring_view language, std::span<const BYTE> buffer) noexcept {
+	// 字体纹理只有 A 通道且大部分是空白，压缩率很高
+	zip_t* zip = zip_stream_open(nullptr, 0, ZIP_DEFAULT_COMPRESSION_LEVEL, 'w');
+	if (!zip) {
+		Logger::Get().Error("zip_stream_open 失败");
+		return;
+	}
+	Utils::ScopeExit se([zip]() {
+		zip_stream_close(zip);
+	});
+
+	if (zip_entry_open(zip, CACHE_ENTRY_NAME) != 0) {
+		Logger::Get().Error("zip_entry_open 失败");
+		return;
+	}
+	const int ec = zip_entry_write(zip, buffer.data(), buffer.size());
+	zip_entry_close(zip);
+	if (ec != 0) {
+		Logger::Get().Error(fmt::format("压缩字体缓存失败，错误代码：{}", ec));
+		return;
+	}
+
+	void* compressed = nullptr;
+	size_t compressedSize = 0;
+	if (zip_stream_copy(zip, &compressed, &compressedSize) < 0) {
+		Logger::Get().Error("zip_stream_copy 失败");
 		return;
 	}
+	Utils::ScopeExit se1([compressed]() {
+		free(compressed);
+	});
 
 	if (!Win32Utils::DirExists(CommonSharedConstants::CACHE_DIR)) {
 		if (!CreateDirectory(CommonSharedConstants::CACHE_DIR, nullptr)) {
@@ -168,25 +220,78 @@ void ImGuiFontsCacheManager::Save(std::wstring_view language, const ImFontAtlas&
 	}
 
 	std::wstring cacheFileName = GetCacheFileName(language);
-	if (!Win32Utils::WriteFile(cacheFileName.c_str(), _buffer.data(), _buffer.size())) {
+	if (!Win32Utils::WriteFile(cacheFileName.c_str(), compressed, compressedSize)) {
 		Logger::Get().Error("保存字体缓存失败");
 	}
 }
 
-bool ImGuiFontsCacheManager::Load(std::wstring_view language, ImFontAtlas& fontAltas) noexcept {
-	if (_buffer.empty()) {
-		std::wstring cacheFileName = GetCacheFileName(language);
-		if (!Win32Utils::FileExists(cacheFileName.c_str())) {
+bool ImGuiFontsCacheManager::Load(
+	std::wstring_view language,
+	float dpiScale,
+	std::vector<ImWchar>& extraGlyphs,
+	ImFontAtlas& fontAltas
+) noexcept {
+	std::wstring cacheFileName = GetCacheFileName(language);
+	if (!Win32Utils::FileExists(cacheFileName.c_str())) {
+		return false;
+	}
+
+	Win32Utils::ScopedHandle hFile(Win32Utils::SafeHandle(
+		CreateFile2(cacheFileName.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr)));
+	if (!hFile) {
+		Logger::Get().Win32Error("打开字体缓存失败");
+		return false;
+	}
+
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(hFile.get(), &fileSize) || fileSize.QuadPart == 0) {
+		return false;
+	}
+
+	// 映射到内存后直接解压，无需先将文件读入缓冲区
+	Win32Utils::ScopedHandle hFileMapping(CreateFileMapping(hFile.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+	if (!hFileMapping) {
+		Logger::Get().Win32Error("CreateFileMapping 失败");
+		return false;
+	}
+
+	const char* fileData = (const char*)MapViewOfFile(hFileMapping.get(), FILE_MAP_READ, 0, 0, 0);
+	if (!fileData) {
+		Logger::Get().Win32Error("MapViewOfFile 失败");
+		return false;
+	}
+	Utils::ScopeExit se([fileData]() {
+		UnmapViewOfFile(fileData);
+	});
+
+	std::vector<BYTE> buffer;
+	{
+		zip_t* zip = zip_stream_open(fileData, (size_t)fileSize.QuadPart, 0, 'r');
+		if (!zip) {
+			Logger::Get().Error("字体缓存已损坏");
+			return false;
+		}
+		Utils::ScopeExit se1([zip]() {
+			zip_stream_close(zip);
+		});
+
+		if (zip_entry_open(zip, CACHE_ENTRY_NAME) != 0) {
+			Logger::Get().Error("字体缓存已损坏");
 			return false;
 		}
 
-		if (!Win32Utils::ReadFile(cacheFileName.c_str(), _buffer) || _buffer.empty()) {
+		buffer.resize((size_t)zip_entry_size(zip));
+		const ssize_t readSize = zip_entry_noallocread(zip, buffer.data(), buffer.size());
+		zip_entry_close(zip);
+
+		if (readSize != (ssize_t)buffer.size()) {
+			Logger::Get().Error("解压字体缓存失败");
 			return false;
 		}
 	}
 
 	try {
-		yas::mem_istream mi(_buffer.data(), _buffer.size());
+		yas::mem_istream mi(buffer.data(), buffer.size());
 		yas::binary_iarchive<yas::mem_istream, yas::binary> ia(mi);
 
 		uint32_t cacheVersion;
@@ -196,6 +301,18 @@ bool ImGuiFontsCacheManager::Load(std::wstring_view language, ImFontAtlas& fontA
 			return false;
 		}
 
+		float cacheDpiScale;
+		ia& cacheDpiScale;
+		if (cacheDpiScale != dpiScale) {
+			Logger::Get().Info("字体缓存的 DPI 缩放不匹配");
+			return false;
+		}
+
+		uint32_t glyphCount = 0;
+		ia& glyphCount;
+		extraGlyphs.resize(glyphCount);
+		ia.read(extraGlyphs.data(), glyphCount * sizeof(ImWchar));
+
 		ia& fontAltas;
 	} catch (...) {
 		Logger::Get().Error("反序列化失败");
@@ -1,6 +1,5 @@
 #pragma once
-
-struct ImFontAtlas;
+#include <imgui.h>
 
 namespace Magpie::Core {
 
@@ -14,15 +13,17 @@ public:
 	ImGuiFontsCacheManager(const ImGuiFontsCacheManager&) = delete;
 	ImGuiFontsCacheManager(ImGuiFontsCacheManager&&) = delete;
 
-	bool Load(std::wstring_view language, ImFontAtlas& fontAltas) noexcept;
+	// extraGlyphs 为惰性加入图集的字符，DPI 缩放不同时缓存无效
+	bool Load(std::wstring_view language, float dpiScale, std::vector<ImWchar>& extraGlyphs, ImFontAtlas& fontAltas) noexcept;
+
+	// 序列化需要读取图集的像素数据，应在创建字体纹理前调用
+	bool Serialize(float dpiScale, std::span<const ImWchar> extraGlyphs, const ImFontAtlas& fontAltas, std::vector<BYTE>& buffer) noexcept;
 
-	void Save(std::wstring_view language, const ImFontAtlas& fontAltas) noexcept;
+	// 压缩并写入 Serialize 的结果，可以在后台线程调用
+	void Save(std::wstring_view language, std::span<const BYTE> buffer) noexcept;
 
 private:
 	ImGuiFontsCacheManager() = default;
-
-	// 不支持在运行时更改语言，因此我们可以缓存字体数据
-	std::vector<BYTE> _buffer;
 };
 
 }
@@ -138,7 +138,7 @@ static DWORD WINAPI ThreadProc(LPVOID /*lpThreadParameter*/) {
 	return 0;
 }
 
-bool ImGuiImpl::Initialize() {
+bool ImGuiImpl::Initialize(ImFontAtlas* fontAtlas) {
 #ifdef _DEBUG
 	// 检查 ImGUI 版本是否匹配
 	if (!IMGUI_CHECKVERSION()) {
@@ -147,7 +147,7 @@ bool ImGuiImpl::Initialize() {
 	}
 #endif // _DEBUG
 
-	ImGui::CreateContext();
+	ImGui::CreateContext(fontAtlas);
 
 	// Setup backend capabilities flags
 	ImGuiIO& io = ImGui::GetIO();
@@ -160,7 +160,8 @@ bool ImGuiImpl::Initialize() {
 	_backend->Initialize();
 
 	auto& dr = MagApp::Get().GetDeviceResources();
-	if (!dr.GetRenderTargetView(dr.GetBackBuffer(), &_rtv)) {
+	_rtv = dr.GetRenderTargetView(dr.GetBackBuffer());
+	if (!_rtv) {
 		Logger::Get().Error("GetRenderTargetView 失败");
 		return false;
 	}
@@ -273,9 +274,12 @@ void ImGuiImpl::EndFrame() {
 	ImGui::GetDrawData()->DisplayPos = ImVec2(float(-outputRect.left), float(-outputRect.top));
 	ImGui::GetDrawData()->DisplaySize = ImVec2((float)(outputRect.right), (float)(outputRect.bottom));
 
-	auto d3dDC = MagApp::Get().GetDeviceResources().GetD3DDC();
-	d3dDC->OMSetRenderTargets(1, &_rtv, NULL);
-	_backend->RenderDrawData(ImGui::GetDrawData());
+	_backend->RenderDrawData(ImGui::GetDrawData(), _rtv.get());
+}
+
+void ImGuiImpl::UpdateFontsTexture(ImFontAtlas* fontAtlas) {
+	ImGui::GetIO().Fonts = fontAtlas;
+	_backend->UpdateFontsTexture();
 }
 
 void ImGuiImpl::Tooltip(const char* content, float maxWidth) {
@@ -1,5 +1,7 @@
 #pragma once
 
+struct ImFontAtlas;
+
 namespace Magpie::Core {
 
 class ImGuiBackend;
@@ -12,12 +14,16 @@ public:
 
 	~ImGuiImpl();
 
-	bool Initialize();
+	// fontAtlas 由调用者管理，生命周期应长于 ImGuiImpl
+	bool Initialize(ImFontAtlas* fontAtlas);
 
 	void NewFrame();
 
 	void EndFrame();
 
+	// 字体图集重新构建后调用，重新构建的图集地址已改变
+	void UpdateFontsTexture(ImFontAtlas* fontAtlas);
+
 	void ClearStates();
 
 	// 将提示窗口限制在屏幕内
@@ -25,7 +31,7 @@ public:
 private:
 	std::unique_ptr<ImGuiBackend> _backend;
 
-	ID3D11RenderTargetView* _rtv = nullptr;
+	winrt::com_ptr<ID3D11RenderTargetView> _rtv;
 	uint32_t _handlerId = 0;
 
 	HANDLE _hHookThread = NULL;
@@ -0,0 +1,110 @@
+#include "pch.h"
+#include "LatencyTracker.h"
+
+namespace Magpie::Core {
+
+void LatencyTracker::OnPresent(const FrameTimes& times, uint32_t presentCount) noexcept {
+	if (presentCount == 0) {
+		_AddFrame(times);
+		return;
+	}
+
+	if (_pendingCount == MAX_PENDING_FRAMES) {
+		// 呈现统计长时间没有更新，放弃最早的帧的显示时刻
+		_AddFrame(_pendingFrames[0].times);
+		std::move(_pendingFrames.begin() + 1, _pendingFrames.end(), _pendingFrames.begin());
+		--_pendingCount;
+	}
+
+	_pendingFrames[_pendingCount++] = { times, presentCount };
+}
+
+void LatencyTracker::OnFrameStatistics(uint32_t presentCount, int64_t syncTime) noexcept {
+	uint32_t i = 0;
+	for (; i < _pendingCount; ++i) {
+		_PendingFrame& frame = _pendingFrames[i];
+		if (frame.presentCount > presentCount) {
+			break;
+		}
+
+		// 更早的帧已显示或被丢弃，无法得知显示的时刻
+		if (frame.presentCount == presentCount) {
+			frame.times.display = syncTime;
+		}
+		_AddFrame(frame.times);
+	}
+
+	if (i > 0) {
+		std::move(_pendingFrames.begin() + i, _pendingFrames.begin() + _pendingCount, _pendingFrames.begin());
+		_pendingCount -= i;
+	}
+}
+
+LatencyTracker::Percentiles LatencyTracker::GetPercentiles(Stage stage) const noexcept {
+	std::array<int64_t, MAX_SAMPLES> durations;
+	uint32_t count = 0;
+
+	for (uint32_t i = 0; i < _sampleCount; ++i) {
+		const FrameTimes& times = _samples[i];
+
+		int64_t start = 0;
+		int64_t end = 0;
+		switch (stage) {
+		case Stage::CaptureToUpdate:
+			start = times.capture;
+			end = times.update;
+			break;
+		case Stage::Dispatch:
+			start = times.dispatchStart;
+			end = times.dispatchEnd;
+			break;
+		case Stage::UpdateToPresent:
+			start = times.update;
+			end = times.present;
+			break;
+		case Stage::CaptureToPresent:
+			start = times.capture;
+			end = times.present;
+			break;
+		case Stage::CaptureToDisplay:
+			start = times.capture;
+			end = times.display;
+			break;
+		}
+
+		// 时刻未知或不可信时跳过
+		if (start == 0 || end == 0 || end < start) {
+			continue;
+		}
+
+		durations[count++] = end - start;
+	}
+
+	if (count == 0) {
+		return {};
+	}
+
+	const auto getPercentile = [&](uint32_t percentile) {
+		const auto nth = durations.begin() + (count - 1) * percentile / 100;
+		std::nth_element(durations.begin(), nth, durations.begin() + count);
+		return float(*nth * 1000.0 / _qpcFrequency);
+	};
+
+	Percentiles result;
+	result.p50 = getPercentile(50);
+	result.p90 = getPercentile(90);
+	result.p99 = getPercentile(99);
+	return result;
+}
+
+void LatencyTracker::_AddFrame(const FrameTimes& times) noexcept {
+	++_frameCount;
+
+	_samples[_nextSample] = times;
+	_nextSample = (_nextSample + 1) % MAX_SAMPLES;
+	if (_sampleCount < MAX_SAMPLES) {
+		++_sampleCount;
+	}
+}
+
+}
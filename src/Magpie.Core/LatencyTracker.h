@@ -0,0 +1,81 @@
+#pragma once
+#include <array>
+
+namespace Magpie::Core {
+
+// 统计从捕获到显示的延迟。记录每个新帧在各阶段的时刻，计算各阶段用时的百分位数
+// 只进行计算，不依赖 D3D 和 DXGI。时刻的单位为 QPC 计数
+class LatencyTracker {
+public:
+	struct FrameTimes {
+		// 帧源捕获这一帧的时刻
+		int64_t capture = 0;
+		// 渲染线程取得这一帧的时刻
+		int64_t update = 0;
+		// 开始和完成提交效果链的时刻
+		int64_t dispatchStart = 0;
+		int64_t dispatchEnd = 0;
+		// Present 返回的时刻
+		int64_t present = 0;
+		// 显示的时刻，来自呈现统计，未知时为 0
+		int64_t display = 0;
+	};
+
+	enum class Stage {
+		// 捕获到渲染线程取得
+		CaptureToUpdate,
+		// 提交效果链
+		Dispatch,
+		// 取得到 Present 返回
+		UpdateToPresent,
+		CaptureToPresent,
+		CaptureToDisplay,
+		COUNT
+	};
+
+	struct Percentiles {
+		// 单位为 ms，没有样本时为负数
+		float p50 = -1.0f;
+		float p90 = -1.0f;
+		float p99 = -1.0f;
+	};
+
+	explicit LatencyTracker(int64_t qpcFrequency) noexcept : _qpcFrequency(qpcFrequency) {}
+
+	// 新帧呈现后调用。presentCount 为这一帧的 PresentCount，为 0 表示无法取得呈现统计
+	void OnPresent(const FrameTimes& times, uint32_t presentCount) noexcept;
+
+	// 取得呈现统计后调用。presentCount 为最近一次显示的帧，syncTime 为它显示的时刻
+	void OnFrameStatistics(uint32_t presentCount, int64_t syncTime) noexcept;
+
+	Percentiles GetPercentiles(Stage stage) const noexcept;
+
+	uint32_t GetFrameCount() const noexcept {
+		return _frameCount;
+	}
+
+private:
+	void _AddFrame(const FrameTimes& times) noexcept;
+
+	static constexpr uint32_t MAX_SAMPLES = 512;
+	// 等待呈现统计的帧数上限，超过后不再等待最早的帧
+	static constexpr uint32_t MAX_PENDING_FRAMES = 8;
+
+	int64_t _qpcFrequency = 0;
+
+	std::array<FrameTimes, MAX_SAMPLES> _samples;
+	uint32_t _sampleCount = 0;
+	uint32_t _nextSample = 0;
+
+	struct _PendingFrame {
+		FrameTimes times;
+		uint32_t presentCount = 0;
+	};
+	// 等待显示的帧，按 PresentCount 从小到大排列
+	std::array<_PendingFrame, MAX_PENDING_FRAMES> _pendingFrames;
+	uint32_t _pendingCount = 0;
+
+	uint32_t _frameCount = 0;
+};
+
+}
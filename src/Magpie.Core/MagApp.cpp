@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "MagApp.h"
 #include "Logger.h"
+#include "Utils.h"
 #include "Win32Utils.h"
 #include "ExclModeHack.h"
 #include "DeviceResources.h"
@@ -8,6 +9,8 @@
 #include "DesktopDuplicationFrameSource.h"
 #include "GDIFrameSource.h"
 #include "DwmSharedSurfaceFrameSource.h"
+#include "ReplayFrameSource.h"
+#include "CaptureMethodScorer.h"
 #include "StrUtils.h"
 #include "CursorManager.h"
 #include "Renderer.h"
@@ -123,7 +126,12 @@ bool MagApp::Start(HWND hwndSrc, MagOptions&& options) {
 		return false;
 	}
 
-	_deviceResources = std::make_unique<DeviceResources>();
+	++_sessionId;
+
+	// 复用上次缩放的 D3D 设备以及缓存的着色器、采样器和纹理
+	if (!_deviceResources || !_deviceResources->IsReusable(_options)) {
+		_deviceResources = std::make_unique<DeviceResources>();
+	}
 	if (!_deviceResources->Initialize()) {
 		Logger::Get().Error("初始化 DeviceResources 失败");
 		Stop();
@@ -143,6 +151,9 @@ bool MagApp::Start(HWND hwndSrc, MagOptions&& options) {
 		return false;
 	}
 
+	// 新的效果链已取走可用的纹理，剩余的不再需要
+	_deviceResources->TrimCachedResources();
+
 	_cursorManager = std::make_unique<CursorManager>();
 	if (!_cursorManager->Initialize()) {
 		Logger::Get().Error("初始化 CursorManager 失败");
@@ -183,6 +194,38 @@ bool MagApp::Start(HWND hwndSrc, MagOptions&& options) {
 	return true;
 }
 
+bool MagApp::StartHeadless(MagOptions&& options, SIZE outputSize) {
+	if (_hwndHost || _isHeadless) {
+		return false;
+	}
+
+	_options = std::move(options);
+	_hostWndRect = { 0, 0, outputSize.cx, outputSize.cy };
+	_isHeadless = true;
+
+	++_sessionId;
+
+	// 不复用缓存的 D3D 设备，基准测试的结果不应受之前的缩放影响
+	_deviceResources = std::make_unique<DeviceResources>();
+	if (!_deviceResources->Initialize()) {
+		Logger::Get().Error("初始化 DeviceResources 失败");
+		StopHeadless();
+		return false;
+	}
+
+	return true;
+}
+
+void MagApp::StopHeadless() noexcept {
+	if (!_isHeadless) {
+		return;
+	}
+
+	_deviceResources.reset();
+	_hostWndRect = {};
+	_isHeadless = false;
+}
+
 winrt::fire_and_forget MagApp::_WaitForSrcMovingOrSizing() {
 	HWND hwndSrc = _hwndSrc;
 	while (true) {
@@ -218,6 +261,19 @@ winrt::fire_and_forget MagApp::_WaitForSrcMovingOrSizing() {
 	});	
 }
 
+winrt::fire_and_forget MagApp::_ReleaseCachedResourcesAfter(std::chrono::seconds timeout) {
+	const uint32_t sessionId = _sessionId;
+
+	co_await timeout;
+	co_await _dispatcher;
+
+	// 期间没有开始新的缩放才释放
+	if (!_hwndHost && _sessionId == sessionId && _deviceResources) {
+		_deviceResources.reset();
+		Logger::Get().Info("已释放缓存的缩放资源");
+	}
+}
+
 void MagApp::Stop(bool isSrcMovingOrSizing) {
 	if (_hwndHost) {
 		_dispatcher.TryEnqueue([this, isSrcMovingOrSizing]() {
@@ -237,6 +293,16 @@ void MagApp::ToggleOverlay() {
 	_renderer->SetUIVisibility(!_renderer->IsUIVisiable());
 }
 
+void MagApp::UpdateOptions(MagOptions&& options) {
+	if (_hwndHost && _renderer) {
+		_renderer->UpdateEffects(std::move(options.effects), std::move(options.downscalingEffect));
+	} else if (_isWaitingForSrcMovingOrSizing) {
+		// 重新开始缩放时生效
+		_options.effects = std::move(options.effects);
+		_options.downscalingEffect = std::move(options.downscalingEffect);
+	}
+}
+
 uint32_t MagApp::RegisterWndProcHandler(std::function<std::optional<LRESULT>(HWND, UINT, WPARAM, LPARAM)> handler) noexcept {
 	uint32_t id = _nextWndProcHandlerID++;
 	_wndProcHandlers.emplace_back(std::move(handler), id);
@@ -404,6 +470,33 @@ static bool CalcHostWndRect(HWND hWnd, MultiMonitorUsage multiMonitorUsage, RECT
 	return true;
 }
 
+bool MagApp::IsHostWndRectValid() const noexcept {
+	RECT hostWndRect;
+	if (!CalcHostWndRect(_hwndSrc, _options.multiMonitorUsage, hostWndRect)) {
+		Logger::Get().Error("CalcHostWndRect 失败");
+		return false;
+	}
+
+	if (hostWndRect != _hostWndRect) {
+		// 源窗口被移到了其他屏幕
+		return false;
+	}
+
+	if (!_options.IsAllowScalingMaximized()) {
+		// 源窗口和缩放窗口重合则不缩放，见 _CreateHostWnd
+		RECT srcRect;
+		if (!Win32Utils::GetWindowFrameRect(_hwndSrc, srcRect)) {
+			Win32Utils::GetClientScreenRect(_hwndSrc, srcRect);
+		}
+
+		if (srcRect == _hostWndRect) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 // 创建缩放窗口
 bool MagApp::_CreateHostWnd() {
 	if (FindWindow(HOST_WINDOW_CLASS_NAME, nullptr)) {
@@ -462,21 +555,31 @@ bool MagApp::_CreateHostWnd() {
 	return true;
 }
 
-bool MagApp::_InitFrameSource() {
-	switch (_options.captureMethod) {
+static std::unique_ptr<FrameSourceBase> CreateFrameSource(CaptureMethod captureMethod) {
+	switch (captureMethod) {
 	case CaptureMethod::GraphicsCapture:
-		_frameSource = std::make_unique<GraphicsCaptureFrameSource>();
-		break;
+		return std::make_unique<GraphicsCaptureFrameSource>();
 	case CaptureMethod::DesktopDuplication:
-		_frameSource = std::make_unique<DesktopDuplicationFrameSource>();
-		break;
+		return std::make_unique<DesktopDuplicationFrameSource>();
 	case CaptureMethod::GDI:
-		_frameSource = std::make_unique<GDIFrameSource>();
-		break;
+		return std::make_unique<GDIFrameSource>();
 	case CaptureMethod::DwmSharedSurface:
-		_frameSource = std::make_unique<DwmSharedSurfaceFrameSource>();
-		break;
+		return std::make_unique<DwmSharedSurfaceFrameSource>();
+	case CaptureMethod::Replay:
+		return std::make_unique<ReplayFrameSource>();
 	default:
+		return nullptr;
+	}
+}
+
+bool MagApp::_InitFrameSource() {
+	// 结果由 MagService 记录到配置文件中，之后缩放时不再试用
+	if (_options.IsAutoCaptureMethod() && _options.captureMethod != CaptureMethod::Replay) {
+		_options.captureMethod = _ProbeCaptureMethod();
+	}
+
+	_frameSource = CreateFrameSource(_options.captureMethod);
+	if (!_frameSource) {
 		Logger::Get().Critical("未知的捕获模式");
 		return false;
 	}
@@ -495,6 +598,231 @@ bool MagApp::_InitFrameSource() {
 	return true;
 }
 
+// 试用每种捕获模式的时长上限和取得的新帧数
+static constexpr uint32_t PROBE_DURATION_MS = 300;
+static constexpr uint32_t PROBE_FRAMES = 10;
+// 试用时调用 Update 的间隔。GraphicsCapture 没有新帧时在 Update 中等待消息，
+// 使用计时器确保窗口内容静止时也能按时返回
+static constexpr UINT PROBE_POLL_INTERVAL_MS = 4;
+
+// 初始化捕获模式时可能移动源窗口、修改源窗口和所有者的样式以及设置主窗口的显示关联，
+// 试用结束后还原它们，否则未被选中的捕获模式也会留下影响
+class WindowStateKeeper {
+public:
+	WindowStateKeeper(HWND hwndSrc, HWND hwndHost) noexcept
+		: _hwndSrc(hwndSrc), _hwndOwner(GetWindowOwner(hwndSrc)), _hwndHost(hwndHost) {
+		_srcPlacement.length = sizeof(_srcPlacement);
+		if (!GetWindowPlacement(hwndSrc, &_srcPlacement)) {
+			Logger::Get().Win32Error("GetWindowPlacement 失败");
+			_srcPlacement.length = 0;
+		}
+		_srcExStyle = GetWindowLongPtr(hwndSrc, GWL_EXSTYLE);
+		if (_hwndOwner) {
+			_ownerExStyle = GetWindowLongPtr(_hwndOwner, GWL_EXSTYLE);
+		}
+		if (!GetWindowDisplayAffinity(hwndHost, &_hostAffinity)) {
+			_hostAffinity = WDA_NONE;
+		}
+	}
+
+	void Restore() const noexcept {
+		// 首先还原所有者窗口的样式以压制任务栏的动画
+		if (_hwndOwner && GetWindowLongPtr(_hwndOwner, GWL_EXSTYLE) != _ownerExStyle) {
+			SetWindowLongPtr(_hwndOwner, GWL_EXSTYLE, _ownerExStyle);
+		}
+		if (GetWindowLongPtr(_hwndSrc, GWL_EXSTYLE) != _srcExStyle) {
+			SetWindowLongPtr(_hwndSrc, GWL_EXSTYLE, _srcExStyle);
+		}
+
+		if (_srcPlacement.length != 0) {
+			WINDOWPLACEMENT curPlacement{ .length = sizeof(curPlacement) };
+			if (GetWindowPlacement(_hwndSrc, &curPlacement)
+				&& std::memcmp(&curPlacement.rcNormalPosition, &_srcPlacement.rcNormalPosition, sizeof(RECT)) != 0
+			) {
+				if (!SetWindowPlacement(_hwndSrc, &_srcPlacement)) {
+					Logger::Get().Win32Error("SetWindowPlacement 失败");
+				}
+			}
+		}
+
+		DWORD curAffinity = WDA_NONE;
+		if (GetWindowDisplayAffinity(_hwndHost, &curAffinity) && curAffinity != _hostAffinity) {
+			if (!SetWindowDisplayAffinity(_hwndHost, _hostAffinity)) {
+				Logger::Get().Win32Error("SetWindowDisplayAffinity 失败");
+			}
+		}
+	}
+
+private:
+	HWND _hwndSrc;
+	HWND _hwndOwner;
+	HWND _hwndHost;
+	WINDOWPLACEMENT _srcPlacement{};
+	LONG_PTR _srcExStyle = 0;
+	LONG_PTR _ownerExStyle = 0;
+	DWORD _hostAffinity = WDA_NONE;
+};
+
+// 使用每种可用的捕获模式捕获几帧，测量取得新帧的 CPU 用时、复制的 GPU 用时和帧间隔，选择开销最小的。
+// 都不可用时返回原来的捕获模式
+CaptureMethod MagApp::_ProbeCaptureMethod() {
+	SmallVector<CaptureMethod, 4> methods{ CaptureMethod::GraphicsCapture };
+	if (Win32Utils::GetOSVersion().Is20H1OrNewer()) {
+		methods.push_back(CaptureMethod::DesktopDuplication);
+	}
+	methods.push_back(CaptureMethod::GDI);
+	methods.push_back(CaptureMethod::DwmSharedSurface);
+
+	ID3D11Device5* d3dDevice = _deviceResources->GetD3DDevice();
+	ID3D11DeviceContext4* d3dDC = _deviceResources->GetD3DDC();
+
+	// 用于测量复制的 GPU 用时，创建失败时只比较 CPU 用时
+	winrt::com_ptr<ID3D11Query> disjointQuery;
+	std::array<std::pair<winrt::com_ptr<ID3D11Query>, winrt::com_ptr<ID3D11Query>>, PROBE_FRAMES> timestampQueries;
+	{
+		D3D11_QUERY_DESC desc{ D3D11_QUERY_TIMESTAMP_DISJOINT };
+		HRESULT hr = d3dDevice->CreateQuery(&desc, disjointQuery.put());
+		desc.Query = D3D11_QUERY_TIMESTAMP;
+		for (auto& [start, end] : timestampQueries) {
+			if (FAILED(hr)) {
+				break;
+			}
+			hr = d3dDevice->CreateQuery(&desc, start.put());
+			if (SUCCEEDED(hr)) {
+				hr = d3dDevice->CreateQuery(&desc, end.put());
+			}
+		}
+
+		if (FAILED(hr)) {
+			Logger::Get().ComError("CreateQuery 失败", hr);
+			disjointQuery = nullptr;
+		}
+	}
+
+	const int64_t qpcFrequency = []() {
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		return frequency.QuadPart;
+	}();
+	const auto toMs = [qpcFrequency](int64_t duration) {
+		return float(duration * 1000.0 / qpcFrequency);
+	};
+
+	const UINT_PTR timerId = SetTimer(NULL, 0, PROBE_POLL_INTERVAL_MS, nullptr);
+	if (!timerId) {
+		Logger::Get().Win32Error("SetTimer 失败");
+		return _options.captureMethod;
+	}
+
+	const WindowStateKeeper windowState(_hwndSrc, _hwndHost);
+
+	std::vector<CaptureMethodScorer::ProbeResult> results(methods.size());
+	for (size_t i = 0; i < methods.size(); ++i) {
+		CaptureMethodScorer::ProbeResult& result = results[i];
+		result.method = methods[i];
+
+		std::unique_ptr<FrameSourceBase> frameSource = CreateFrameSource(result.method);
+		// 先销毁捕获模式，它的析构函数也会还原一部分状态
+		Utils::ScopeExit se([&]() {
+			frameSource.reset();
+			windowState.Restore();
+		});
+
+		if (!frameSource->Initialize()) {
+			Logger::Get().Info(StrUtils::Concat(frameSource->GetName(), " 不可用"));
+			result.failed = true;
+			continue;
+		}
+
+		if (disjointQuery) {
+			d3dDC->Begin(disjointQuery.get());
+		}
+
+		int64_t lastFrameTime = 0;
+		const int64_t deadline = Utils::GetQPC() + qpcFrequency * PROBE_DURATION_MS / 1000;
+		while (result.acquireTimes.size() < PROBE_FRAMES && Utils::GetQPC() < deadline) {
+			const auto& [startQuery, endQuery] = timestampQueries[result.acquireTimes.size()];
+			if (disjointQuery) {
+				d3dDC->End(startQuery.get());
+			}
+
+			const int64_t updateStart = Utils::GetQPC();
+			const FrameSourceBase::UpdateState state = frameSource->Update();
+			const int64_t updateEnd = Utils::GetQPC();
+
+			if (state == FrameSourceBase::UpdateState::Error) {
+				result.failed = true;
+				break;
+			}
+
+			if (state == FrameSourceBase::UpdateState::NewFrame) {
+				if (disjointQuery) {
+					d3dDC->End(endQuery.get());
+				}
+
+				result.acquireTimes.push_back(toMs(updateEnd - updateStart));
+
+				const int64_t frameTime = frameSource->GetFrameTime() ? frameSource->GetFrameTime() : updateStart;
+				if (lastFrameTime != 0) {
+					result.frameIntervals.push_back(toMs(frameTime - lastFrameTime));
+				}
+				lastFrameTime = frameTime;
+			}
+
+			// 等待下一次轮询，只取出计时器消息，其他消息留给之后的消息循环
+			MsgWaitForMultipleObjectsEx(0, nullptr, PROBE_POLL_INTERVAL_MS, QS_TIMER, 0);
+			MSG msg;
+			while (PeekMessage(&msg, NULL, WM_TIMER, WM_TIMER, PM_REMOVE)) {
+				// 无法只取出此计时器的消息，其他计时器的消息照常分发
+				if (msg.hwnd != NULL || msg.wParam != timerId) {
+					DispatchMessage(&msg);
+				}
+			}
+		}
+
+		if (disjointQuery) {
+			d3dDC->End(disjointQuery.get());
+			d3dDC->Flush();
+
+			// 只在缩放开始时执行一次，可以等待 GPU
+			D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjointData;
+			while (d3dDC->GetData(disjointQuery.get(), &disjointData, sizeof(disjointData), 0) == S_FALSE) {
+				Sleep(1);
+			}
+
+			if (!disjointData.Disjoint) {
+				for (size_t j = 0; j < result.acquireTimes.size(); ++j) {
+					uint64_t start = 0;
+					uint64_t end = 0;
+					if (d3dDC->GetData(timestampQueries[j].first.get(), &start, sizeof(start), 0) != S_OK ||
+						d3dDC->GetData(timestampQueries[j].second.get(), &end, sizeof(end), 0) != S_OK) {
+						result.copyTimes.clear();
+						break;
+					}
+					result.copyTimes.push_back(float((end - start) * 1000.0 / disjointData.Frequency));
+				}
+			}
+		}
+
+		if (result.failed || result.acquireTimes.empty()) {
+			Logger::Get().Info(StrUtils::Concat(frameSource->GetName(), " 未取得新帧"));
+		} else {
+			Logger::Get().Info(fmt::format("{} 的开销：{:.3f} ms（{} 帧）",
+				frameSource->GetName(), CaptureMethodScorer::Score(result), result.acquireTimes.size()));
+		}
+	}
+
+	KillTimer(NULL, timerId);
+
+	const int idx = CaptureMethodScorer::Pick(results);
+	if (idx < 0) {
+		Logger::Get().Error("所有捕获模式都不可用");
+		return _options.captureMethod;
+	}
+
+	return results[idx].method;
+}
+
 bool MagApp::_DisableDirectFlip() {
 	// 没有显式关闭 DirectFlip 的方法
 	// 将全屏窗口设为稍微透明，以灰色全屏窗口为背景
@@ -573,7 +901,16 @@ void MagApp::_OnQuit() {
 	_cursorManager.reset();
 	_renderer.reset();
 	_frameSource.reset();
-	_deviceResources.reset();
+
+	if (_deviceResources) {
+		if (_options.resourceCacheTimeout > 0) {
+			// 保留 D3D 设备和缓存的资源，再次缩放时可快速启动
+			_deviceResources->ReleaseSessionResources();
+			_ReleaseCachedResourcesAfter(std::chrono::seconds(_options.resourceCacheTimeout));
+		} else {
+			_deviceResources.reset();
+		}
+	}
 
 	_nextWndProcHandlerID = 1;
 	_wndProcHandlers.clear();
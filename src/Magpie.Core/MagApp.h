@@ -23,8 +23,20 @@ public:
 
 	void Stop(bool isSrcMovingOrSizing = false);
 
+	// 不创建窗口，只初始化 D3D 设备，用于基准测试。outputSize 代替缩放窗口的尺寸
+	bool StartHeadless(MagOptions&& options, SIZE outputSize);
+
+	void StopHeadless() noexcept;
+
+	bool IsHeadless() const noexcept {
+		return _isHeadless;
+	}
+
 	void ToggleOverlay();
 
+	// 缩放时应用新的选项，目前只支持更新效果链，其他选项在下次缩放时生效
+	void UpdateOptions(MagOptions&& options);
+
 	HINSTANCE GetHInstance() const noexcept {
 		return _hInst;
 	}
@@ -41,6 +53,9 @@ public:
 		return _hostWndRect;
 	}
 
+	// 源窗口位置或大小改变后检查缩放窗口的位置和尺寸是否仍然适用
+	bool IsHostWndRectValid() const noexcept;
+
 	DeviceResources& GetDeviceResources() noexcept {
 		return *_deviceResources;
 	}
@@ -82,6 +97,8 @@ private:
 
 	bool _InitFrameSource();
 
+	CaptureMethod _ProbeCaptureMethod();
+
 	bool _DisableDirectFlip();
 
 	static LRESULT CALLBACK _HostWndProcStatic(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
@@ -94,6 +111,9 @@ private:
 
 	winrt::fire_and_forget _WaitForSrcMovingOrSizing();
 
+	// 超时后释放上次缩放保留的资源
+	winrt::fire_and_forget _ReleaseCachedResourcesAfter(std::chrono::seconds timeout);
+
 	const winrt::DispatcherQueue _dispatcher{ nullptr };
 
 	HINSTANCE _hInst = NULL;
@@ -121,6 +141,10 @@ private:
 	bool _roundCornerDisabled = false;
 
 	bool _isWaitingForSrcMovingOrSizing = false;
+	bool _isHeadless = false;
+
+	// 每次缩放开始时递增，用于检查保留的资源是否已被新的缩放使用
+	uint32_t _sessionId = 0;
 };
 
 }
@@ -8,6 +8,8 @@ enum class CaptureMethod {
 	DesktopDuplication,
 	GDI,
 	DwmSharedSurface,
+	// 从录制的文件中读取帧，用于测试性能
+	Replay,
 };
 
 enum class MultiMonitorUsage {
@@ -45,6 +47,15 @@ struct MagFlags {
 	static constexpr const uint32_t DisableDirectFlip = 0x2000;
 	static constexpr const uint32_t DisableFontCache = 0x4000;
 	static constexpr const uint32_t AllowScalingMaximized = 0x8000;
+	static constexpr const uint32_t HotReloadEffects = 0x10000;
+	static constexpr const uint32_t FramePacing = 0x20000;
+	static constexpr const uint32_t LimitToSourceFrameRate = 0x40000;
+	static constexpr const uint32_t AdaptiveQuality = 0x80000;
+	static constexpr const uint32_t AutoCaptureMethod = 0x100000;
+	// 使用 WARP 而不是显卡，用于在没有显卡的环境中运行基准测试
+	static constexpr const uint32_t UseWarp = 0x200000;
+	// 每帧重新绘制覆盖层，用于对比缓存的效果
+	static constexpr const uint32_t DisableOverlayCache = 0x400000;
 };
 
 struct DownscalingEffect {
@@ -85,6 +96,7 @@ struct MagOptions {
 	DEFINE_FLAG_ACCESSOR(IsSaveEffectSources, MagFlags::SaveEffectSources, flags)
 	DEFINE_FLAG_ACCESSOR(IsWarningsAreErrors, MagFlags::WarningsAreErrors, flags)
 	DEFINE_FLAG_ACCESSOR(IsAllowScalingMaximized, MagFlags::AllowScalingMaximized, flags)
+	DEFINE_FLAG_ACCESSOR(IsHotReloadEffects, MagFlags::HotReloadEffects, flags)
 	DEFINE_FLAG_ACCESSOR(IsSimulateExclusiveFullscreen, MagFlags::SimulateExclusiveFullscreen, flags)
 	DEFINE_FLAG_ACCESSOR(Is3DGameMode, MagFlags::Is3DGameMode, flags)
 	DEFINE_FLAG_ACCESSOR(IsShowFPS, MagFlags::ShowFPS, flags)
@@ -94,15 +106,36 @@ struct MagOptions {
 	DEFINE_FLAG_ACCESSOR(IsAdjustCursorSpeed, MagFlags::AdjustCursorSpeed, flags)
 	DEFINE_FLAG_ACCESSOR(IsDrawCursor, MagFlags::DrawCursor, flags)
 	DEFINE_FLAG_ACCESSOR(IsDisableDirectFlip, MagFlags::DisableDirectFlip, flags)
+	DEFINE_FLAG_ACCESSOR(IsFramePacing, MagFlags::FramePacing, flags)
+	DEFINE_FLAG_ACCESSOR(IsLimitToSourceFrameRate, MagFlags::LimitToSourceFrameRate, flags)
+	DEFINE_FLAG_ACCESSOR(IsAdaptiveQuality, MagFlags::AdaptiveQuality, flags)
+	DEFINE_FLAG_ACCESSOR(IsAutoCaptureMethod, MagFlags::AutoCaptureMethod, flags)
+	DEFINE_FLAG_ACCESSOR(IsUseWarp, MagFlags::UseWarp, flags)
+	DEFINE_FLAG_ACCESSOR(IsDisableOverlayCache, MagFlags::DisableOverlayCache, flags)
 
 	Cropping cropping{};
 	uint32_t flags = MagFlags::VSync | MagFlags::AdjustCursorSpeed | MagFlags::DrawCursor;	// MagFlags
 	int graphicsCard = -1;
+	// 退出缩放后保留 D3D 设备、着色器和纹理的时长，单位为秒。0 表示立即释放
+	uint32_t resourceCacheTimeout = 60;
+	// 显存预算，单位为 MiB。构建效果链等分配超出预算时失败，0 表示不限制
+	uint32_t videoMemoryBudget = 0;
 	float cursorScaling = 1.0f;
+	// 帧调度时在预测的渲染用时之外预留的时间，单位为毫秒
+	float framePacingMargin = 1.5f;
+	// 不使用垂直同步时的最大帧率，0 表示不限制
+	float maxFrameRate = 0.0f;
 	CaptureMethod captureMethod = CaptureMethod::GraphicsCapture;
 	MultiMonitorUsage multiMonitorUsage = MultiMonitorUsage::Closest;
 	CursorInterpolationMode cursorInterpolationMode = CursorInterpolationMode::NearestNeighbor;
 
+	// 捕获方式为 Replay 时使用的录制文件
+	std::wstring replayFile;
+	// 播放录制文件的帧率，0 表示使用录制时的帧率，负数表示每次 Update 都前进一帧
+	float replayFrameRate = 0.0f;
+	// 不为空时记录整个缩放过程的跟踪，见 TraceRecorder
+	std::wstring traceFile;
+
 	DownscalingEffect downscalingEffect;
 
 	std::vector<EffectOption> effects;
@@ -32,8 +32,19 @@ void MagRuntime::Run(HWND hwndSrc, const MagOptions& options) {
 	_isRunningChangedEvent(true);
 
 	_EnsureDispatcherQueue();
-	_dqc.DispatcherQueue().TryEnqueue([hwndSrc, options(options)]() mutable {
-		MagApp::Get().Start(hwndSrc, std::move(options));
+	_dqc.DispatcherQueue().TryEnqueue([this, hwndSrc, options(options)]() mutable {
+		const bool isAutoCaptureMethod = options.IsAutoCaptureMethod();
+
+		MagApp& app = MagApp::Get();
+		if (!app.Start(hwndSrc, std::move(options)) || !isAutoCaptureMethod) {
+			return;
+		}
+
+		// 通知主线程记住选中的捕获模式
+		const CaptureMethod captureMethod = app.GetOptions().captureMethod;
+		if (captureMethod != CaptureMethod::Replay) {
+			_captureMethodProbedEvent(hwndSrc, captureMethod);
+		}
 	});
 }
 
@@ -48,6 +59,17 @@ void MagRuntime::ToggleOverlay() {
 	});
 }
 
+void MagRuntime::UpdateOptions(const MagOptions& options) {
+	if (!IsRunning()) {
+		return;
+	}
+
+	_EnsureDispatcherQueue();
+	_dqc.DispatcherQueue().TryEnqueue([options(options)]() mutable {
+		MagApp::Get().UpdateOptions(std::move(options));
+	});
+}
+
 void MagRuntime::Stop() {
 	if (!IsRunning()) {
 		return;
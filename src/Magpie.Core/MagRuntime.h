@@ -7,6 +7,7 @@
 namespace Magpie::Core {
 
 struct MagOptions;
+enum class CaptureMethod;
 
 class MagRuntime {
 public:
@@ -21,6 +22,9 @@ public:
 
 	void ToggleOverlay();
 
+	// 缩放时更新效果链而无需重新开始缩放
+	void UpdateOptions(const MagOptions& options);
+
 	void Stop();
 
 	bool IsRunning() const {
@@ -43,6 +47,22 @@ public:
 		_isRunningChangedEvent.remove(token);
 	}
 
+	// 自动选择捕获模式后在缩放线程上触发，参数为源窗口和选中的捕获模式
+	winrt::event_token CaptureMethodProbed(winrt::delegate<HWND, CaptureMethod> const& handler) {
+		return _captureMethodProbedEvent.add(handler);
+	}
+
+	WinRTUtils::EventRevoker CaptureMethodProbed(winrt::auto_revoke_t, winrt::delegate<HWND, CaptureMethod> const& handler) {
+		winrt::event_token token = CaptureMethodProbed(handler);
+		return WinRTUtils::EventRevoker([this, token]() {
+			CaptureMethodProbed(token);
+		});
+	}
+
+	void CaptureMethodProbed(winrt::event_token const& token) noexcept {
+		_captureMethodProbedEvent.remove(token);
+	}
+
 private:
 	void _MagWindThreadProc() noexcept;
 
@@ -52,6 +72,7 @@ private:
 	// 主线程使用 DispatcherQueue 和缩放线程沟通，因此无需约束内存定序，只需确保原子性即可
 	std::atomic<HWND> _hwndSrc;
 	winrt::event<winrt::delegate<bool>> _isRunningChangedEvent;
+	winrt::event<winrt::delegate<HWND, CaptureMethod>> _captureMethodProbedEvent;
 
 	winrt::Windows::System::DispatcherQueueController _dqc{ nullptr };
 	// 应在 _dqc 后初始化
@@ -9,34 +9,18 @@
 #include "StrUtils.h"
 #include "Win32Utils.h"
 #include "FrameSourceBase.h"
+#include "FrameRateLimiter.h"
+#include "LatencyTracker.h"
+#include "FrameTimeHistogram.h"
+#include "TraceRecorder.h"
 #include "CommonSharedConstants.h"
 #include "EffectDesc.h"
 #include <bit>	// std::bit_ceil
 #include <random>
-#include "ImGuiHelper.h"
-#include "ImGuiFontsCacheManager.h"
+#include "OverlayFonts.h"
 
 namespace Magpie::Core {
 
-static const std::wstring& GetSystemFontsFolder() noexcept {
-	static std::wstring result;
-
-	if (result.empty()) {
-		wchar_t* fontsFolder = nullptr;
-		HRESULT hr = SHGetKnownFolderPath(FOLDERID_Fonts, 0, NULL, &fontsFolder);
-		if (FAILED(hr)) {
-			CoTaskMemFree(fontsFolder);
-			Logger::Get().ComError("SHGetKnownFolderPath 失败", hr);
-			return result;
-		}
-
-		result = fontsFolder;
-		CoTaskMemFree(fontsFolder);
-	}
-
-	return result;
-}
-
 OverlayDrawer::OverlayDrawer() noexcept {
 	HWND hwndSrc = MagApp::Get().GetHwndSrc();
 	_isSrcMainWnd = Win32Utils::GetWndClassName(hwndSrc) == CommonSharedConstants::MAIN_WINDOW_CLASS_NAME;
@@ -186,9 +170,16 @@ static SmallVector<UINT> GenerateTimelineColors() {
 	return result;
 }
 
-bool OverlayDrawer::Initialize() noexcept {
+bool OverlayDrawer::Initialize(std::shared_ptr<OverlayFonts> fonts) noexcept {
+	// 字体图集在缩放开始时已在后台构建，通常无需等待
+	if (!fonts->Wait()) {
+		Logger::Get().Error("构建字体失败");
+		return false;
+	}
+	_fonts = std::move(fonts);
+
 	_imguiImpl.reset(new ImGuiImpl());
-	if (!_imguiImpl->Initialize()) {
+	if (!_imguiImpl->Initialize(&_fonts->GetAtlas())) {
 		Logger::Get().Error("初始化 ImGuiImpl 失败");
 		return false;
 	}
@@ -203,25 +194,26 @@ bool OverlayDrawer::Initialize() noexcept {
 	style.WindowMinSize = ImVec2(10, 10);
 	style.ScaleAllSizes(_dpiScale);
 
-	if (!_BuildFonts()) {
-		Logger::Get().Error("_BuildFonts 失败");
-		return false;
-	}
+	_UpdateFonts();
 
 	_RetrieveHardwareInfo();
 	_timelineColors = GenerateTimelineColors();
-
-	// 将 _fontUI 设为默认字体
-	ImGui::GetIO().FontDefault = _fontUI;
+	_RequestEffectGlyphs();
 
 	return true;
 }
 
 void OverlayDrawer::Draw() noexcept {
+	if (!IsDrawing()) {
+		return;
+	}
+
 	bool isShowFPS = MagApp::Get().GetOptions().IsShowFPS();
 
-	if (!_isUIVisiable && !isShowFPS) {
-		return;
+	// 将之前的帧中用到的新字符加入图集，ImGui 要求在 NewFrame 之前修改图集
+	if (_fonts->UpdateGlyphs()) {
+		_UpdateFonts();
+		_imguiImpl->UpdateFontsTexture(&_fonts->GetAtlas());
 	}
 
 	_imguiImpl->NewFrame();
@@ -230,6 +222,10 @@ void OverlayDrawer::Draw() noexcept {
 		_DrawFPS();
 	}
 
+	if (_isShowEffectsError) {
+		_DrawEffectsError();
+	}
+
 	if (_isUIVisiable) {
 		_DrawUI();
 	}
@@ -238,6 +234,21 @@ void OverlayDrawer::Draw() noexcept {
 	_imguiImpl->EndFrame();
 }
 
+bool OverlayDrawer::IsDrawing() const noexcept {
+	return _isUIVisiable || _isShowEffectsError || MagApp::Get().GetOptions().IsShowFPS();
+}
+
+void OverlayDrawer::OnEffectsChanged() noexcept {
+	_timelineColors = GenerateTimelineColors();
+	_RequestEffectGlyphs();
+}
+
+void OverlayDrawer::ShowEffectsError(std::string&& errorMsg) noexcept {
+	_effectsError = std::move(errorMsg);
+	_isShowEffectsError = true;
+	_fonts->RequestGlyphs(_effectsError);
+}
+
 void OverlayDrawer::SetUIVisibility(bool value) noexcept {
 	if (_isUIVisiable == value) {
 		return;
@@ -283,204 +294,6 @@ void OverlayDrawer::SetUIVisibility(bool value) noexcept {
 	}
 }
 
-static const std::wstring& GetAppLanguage() noexcept {
-	static std::wstring language;
-	if (language.empty()) {
-		winrt::ResourceContext resourceContext = winrt::ResourceContext::GetForViewIndependentUse();
-		language = resourceContext.QualifierValues().Lookup(L"Language");
-		StrUtils::ToLowerCase(language);
-	}
-	return language;
-}
-
-bool OverlayDrawer::_BuildFonts() noexcept {
-	const std::wstring& language = GetAppLanguage();
-
-	ImFontAtlas& fontAtlas = *ImGui::GetIO().Fonts;
-
-	bool fontCacheDisabled = MagApp::Get().GetOptions().IsDisableFontCache();
-	if (!fontCacheDisabled && ImGuiFontsCacheManager::Get().Load(language, fontAtlas)) {
-		_fontUI = fontAtlas.Fonts[0];
-		_fontMonoNumbers = fontAtlas.Fonts[1];
-		_fontFPS = fontAtlas.Fonts[2];
-		return true;
-	}
-
-	fontAtlas.Flags |= ImFontAtlasFlags_NoPowerOfTwoHeight;
-	if (!MagApp::Get().GetOptions().Is3DGameMode()) {
-		// 非 3D 游戏模式无需 ImGui 绘制光标
-		fontAtlas.Flags |= ImFontAtlasFlags_NoMouseCursors;
-	}
-
-	std::wstring fontPath = GetSystemFontsFolder();
-	if (Win32Utils::GetOSVersion().IsWin11()) {
-		fontPath += L"\\SegUIVar.ttf";
-	} else {
-		fontPath += L"\\segoeui.ttf";
-	}
-
-	std::vector<uint8_t> fontData;
-	if (!Win32Utils::ReadFile(fontPath.c_str(), fontData)) {
-		Logger::Get().Error("读取字体文件失败");
-		return false;
-	}
-
-	// 构建字体前 uiRanges 不能析构，因为 ImGui 只保存了指针
-	ImVector<ImWchar> uiRanges;
-	_BuildFontUI(language, fontData, uiRanges);
-	_BuildFontFPS(fontData);
-
-	if (!fontAtlas.Build()) {
-		Logger::Get().Error("构建字体失败");
-		return false;
-	}
-
-	if (!fontCacheDisabled) {
-		ImGuiFontsCacheManager::Get().Save(language, fontAtlas);
-	}
-	
-	return true;
-}
-
-void OverlayDrawer::_BuildFontUI(std::wstring_view language, const std::vector<uint8_t>& fontData, ImVector<ImWchar>& uiRanges) noexcept {
-	ImFontAtlas& fontAtlas = *ImGui::GetIO().Fonts;
-
-	std::string extraFontPath;
-	const ImWchar* extraRanges = nullptr;
-	int extraFontNo = 0;
-
-	ImFontGlyphRangesBuilder builder;
-	
-	if (language == L"en-us") {
-		builder.AddRanges(ImGuiHelper::ENGLISH_RANGES);
-	} else if (language == L"ru" || language == L"uk") {
-		builder.AddRanges(fontAtlas.GetGlyphRangesCyrillic());
-	} else if (language == L"tr" || language == L"hu") {
-		builder.AddRanges(ImGuiHelper::Latin_1_Extended_A_RANGES);
-	} else if (language == L"vi") {
-		builder.AddRanges(fontAtlas.GetGlyphRangesVietnamese());
-	} else {
-		// 默认 Basic Latin + Latin-1 Supplement
-		// 参见 https://en.wikipedia.org/wiki/Latin-1_Supplement
-		builder.AddRanges(fontAtlas.GetGlyphRangesDefault());
-
-		// 一些语言需要加载额外的字体：
-		// 简体中文 -> Microsoft YaHei UI
-		// 繁体中文 -> Microsoft JhengHei UI
-		// 日语 -> Yu Gothic UI
-		// 韩语/朝鲜语 -> Malgun Gothic
-		// 参见 https://learn.microsoft.com/en-us/windows/apps/design/style/typography#fonts-for-non-latin-languages
-		if (language == L"zh-hans") {
-			// msyh.ttc: 0 是微软雅黑，1 是 Microsoft YaHei UI
-			extraFontPath = StrUtils::Concat(StrUtils::UTF16ToUTF8(GetSystemFontsFolder()), "\\msyh.ttc");
-			extraFontNo = 1;
-			extraRanges = ImGuiHelper::GetGlyphRangesChineseSimplifiedOfficial();
-		} else if (language == L"zh-hant") {
-			// msjh.ttc: 0 是 Microsoft JhengHei，1 是 Microsoft JhengHei UI
-			extraFontPath = StrUtils::Concat(StrUtils::UTF16ToUTF8(GetSystemFontsFolder()), "\\msjh.ttc");
-			extraFontNo = 1;
-			extraRanges = ImGuiHelper::GetGlyphRangesChineseTraditionalOfficial();
-		} else if (language == L"ja") {
-			// YuGothM.ttc: 0 是 Yu Gothic Medium，1 是 Yu Gothic UI
-			extraFontPath = StrUtils::Concat(StrUtils::UTF16ToUTF8(GetSystemFontsFolder()), "\\YuGothM.ttc");
-			extraFontNo = 1;
-			extraRanges = fontAtlas.GetGlyphRangesJapanese();
-		} else if (language == L"ko") {
-			extraFontPath = StrUtils::Concat(StrUtils::UTF16ToUTF8(GetSystemFontsFolder()), "\\malgun.ttf");
-			extraRanges = fontAtlas.GetGlyphRangesKorean();
-		}
-	}
-	builder.SetBit(L'■');
-	builder.BuildRanges(&uiRanges);
-
-	ImFontConfig config;
-	config.FontDataOwnedByAtlas = false;
-
-	const float fontSize = 18 * _dpiScale;
-
-	//////////////////////////////////////////////////////////
-	// 
-	// uiRanges (+ extraRanges) -> _fontUI
-	// 
-	//////////////////////////////////////////////////////////
-
-
-#ifdef _DEBUG
-	std::char_traits<char>::copy(config.Name, "_fontUI", std::size(config.Name));
-#endif
-
-	_fontUI = fontAtlas.AddFontFromMemoryTTF(
-		(void*)fontData.data(), (int)fontData.size(), fontSize, &config, uiRanges.Data);
-
-	if (extraRanges) {
-		assert(Win32Utils::FileExists(StrUtils::UTF8ToUTF16(extraFontPath).c_str()));
-
-		// 在 MergeMode 下已有字符会跳过而不是覆盖
-		config.MergeMode = true;
-		config.FontNo = extraFontNo;
-		// 额外字体数据由 ImGui 管理，退出缩放时释放
-		config.FontDataOwnedByAtlas = true;
-		fontAtlas.AddFontFromFileTTF(extraFontPath.c_str(), fontSize, &config, extraRanges);
-		config.FontDataOwnedByAtlas = false;
-		config.FontNo = 0;
-		config.MergeMode = false;
-	}
-
-	//////////////////////////////////////////////////////////
-	//
-	// NUMBER_RANGES + NOT_NUMBER_RANGES -> _fontMonoNumbers
-	//
-	//////////////////////////////////////////////////////////
-
-#ifdef _DEBUG
-	std::char_traits<char>::copy(config.Name, "_fontMonoNumbers", std::size(config.Name));
-#endif
-
-	// 等宽的数字字符
-	config.GlyphMinAdvanceX = config.GlyphMaxAdvanceX = fontSize * 0.42f;
-	_fontMonoNumbers = fontAtlas.AddFontFromMemoryTTF(
-		(void*)fontData.data(), (int)fontData.size(), fontSize, &config, ImGuiHelper::NUMBER_RANGES);
-
-	// 其他不等宽的字符
-	config.MergeMode = true;
-	config.GlyphMinAdvanceX = 0;
-	config.GlyphMaxAdvanceX = std::numeric_limits<float>::max();
-	fontAtlas.AddFontFromMemoryTTF(
-		(void*)fontData.data(), (int)fontData.size(), fontSize, &config, ImGuiHelper::NOT_NUMBER_RANGES);
-}
-
-void OverlayDrawer::_BuildFontFPS(const std::vector<uint8_t>& fontData) noexcept {
-	ImFontAtlas& fontAtlas = *ImGui::GetIO().Fonts;
-
-	ImFontConfig config;
-	config.FontDataOwnedByAtlas = false;
-
-	const float fpsSize = 24 * _dpiScale;
-
-	//////////////////////////////////////////////////////////
-	//
-	// NUMBER_RANGES + " FPS" -> _fontFPS
-	// 
-	//////////////////////////////////////////////////////////
-
-#ifdef _DEBUG
-	std::char_traits<char>::copy(config.Name, "_fontFPS", std::size(config.Name));
-#endif
-
-	// 等宽的数字字符
-	config.MergeMode = false;
-	config.GlyphMinAdvanceX = config.GlyphMaxAdvanceX = fpsSize * 0.42f;
-	_fontFPS = fontAtlas.AddFontFromMemoryTTF(
-		(void*)fontData.data(), (int)fontData.size(), fpsSize, &config, ImGuiHelper::NUMBER_RANGES);
-
-	// 其他不等宽的字符
-	config.MergeMode = true;
-	config.GlyphMinAdvanceX = 0;
-	config.GlyphMaxAdvanceX = std::numeric_limits<float>::max();
-	fontAtlas.AddFontFromMemoryTTF(
-		(void*)fontData.data(), (int)fontData.size(), fpsSize, &config, (const ImWchar*)L"  FFPPSS");
-}
-
 static std::string_view GetEffectDisplayName(const EffectDesc* desc) noexcept {
 	auto delimPos = desc->name.find_last_of('\\');
 	if (delimPos == std::string::npos) {
@@ -728,6 +541,36 @@ void OverlayDrawer::_DrawFPS() noexcept {
 	ImGui::PopStyleVar();
 }
 
+void OverlayDrawer::_DrawEffectsError() noexcept {
+	const ImVec2 displaySize = ImGui::GetIO().DisplaySize;
+	const float margin = 10 * _dpiScale;
+	const float maxWidth = displaySize.x * 0.6f;
+
+	// 显示在左下角，不接收输入以免影响源窗口
+	ImGui::SetNextWindowPos(ImVec2(margin, displaySize.y - margin), ImGuiCond_Always, ImVec2(0.0f, 1.0f));
+	ImGui::SetNextWindowSizeConstraints(ImVec2(), ImVec2(maxWidth, displaySize.y * 0.5f));
+	ImGui::SetNextWindowBgAlpha(0.8f);
+
+	if (!ImGui::Begin("EffectsError", nullptr, ImGuiWindowFlags_NoNav | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoInputs)) {
+		ImGui::End();
+		return;
+	}
+
+	ImGui::PushTextWrapPos(maxWidth - ImGui::GetStyle().WindowPadding.x * 2);
+
+	ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 0.4f, 0.4f, 1.0f));
+	ImGui::TextUnformatted(_GetResourceString(L"Overlay_EffectsError").c_str());
+	ImGui::PopStyleColor();
+
+	if (!_effectsError.empty()) {
+		ImGui::Separator();
+		ImGui::TextUnformatted(_effectsError.c_str(), _effectsError.c_str() + _effectsError.size());
+	}
+
+	ImGui::PopTextWrapPos();
+	ImGui::End();
+}
+
 // 自定义提示
 static void MyPlotLines(float(*values_getter)(void* data, int idx), void* data, int values_count, int values_offset, const char* overlay_text, float scale_min, float scale_max, ImVec2 graph_size) {
 	// 通过改变光标位置避免绘制提示窗口
@@ -788,6 +631,15 @@ void OverlayDrawer::_DrawUI() noexcept {
 	ImGui::TextUnformatted(StrUtils::Concat(vSyncStr, ": ", stateStr).c_str());
 	const std::string& captureMethodStr = _GetResourceString(L"Overlay_Profiler_CaptureMethod");
 	ImGui::TextUnformatted(StrUtils::Concat(captureMethodStr.c_str(), ": ", MagApp::Get().GetFrameSource().GetName()).c_str());
+	if (const FrameRateLimiter* frameRateLimiter = renderer.GetFrameRateLimiter()) {
+		// 尚未测得源窗口的帧率时为 0
+		if (float frameRateLimit = frameRateLimiter->GetFrameRateLimit(); frameRateLimit > 0) {
+			const std::string& frameRateLimitStr = _GetResourceString(L"Overlay_Profiler_FrameRateLimit");
+			ImGui::TextUnformatted(fmt::format("{}: {:.0f} FPS", frameRateLimitStr, frameRateLimit).c_str());
+		}
+		const std::string& jitterStr = _GetResourceString(L"Overlay_Profiler_PacingJitter");
+		ImGui::TextUnformatted(fmt::format("{}: {:.2f} ms", jitterStr, frameRateLimiter->GetJitter()).c_str());
+	}
 	ImGui::PopTextWrapPos();
 
 	ImGui::Spacing();
@@ -876,9 +728,163 @@ void OverlayDrawer::_DrawUI() noexcept {
 		ImGui::PopFont();
 	}
 
+	ImGui::Spacing();
+	const std::string& latencyStr = _GetResourceString(L"Overlay_Profiler_Latency");
+	if (ImGui::CollapsingHeader(latencyStr.c_str(), ImGuiTreeNodeFlags_DefaultOpen)) {
+		static constexpr std::pair<LatencyTracker::Stage, const wchar_t*> STAGES[] = {
+			{ LatencyTracker::Stage::CaptureToUpdate, L"Overlay_Profiler_Latency_CaptureToUpdate" },
+			{ LatencyTracker::Stage::Dispatch, L"Overlay_Profiler_Latency_Dispatch" },
+			{ LatencyTracker::Stage::UpdateToPresent, L"Overlay_Profiler_Latency_UpdateToPresent" },
+			{ LatencyTracker::Stage::CaptureToPresent, L"Overlay_Profiler_Latency_CaptureToPresent" },
+			{ LatencyTracker::Stage::CaptureToDisplay, L"Overlay_Profiler_Latency_CaptureToDisplay" }
+		};
+
+		ImGui::Spacing();
+		ImGui::TextUnformatted("P50 / P90 / P99");
+
+		const LatencyTracker& latencyTracker = renderer.GetLatencyTracker();
+		for (const auto& [stage, resourceKey] : STAGES) {
+			const LatencyTracker::Percentiles percentiles = latencyTracker.GetPercentiles(stage);
+			// 没有呈现统计时无法得知显示的时刻
+			if (percentiles.p50 < 0) {
+				continue;
+			}
+
+			ImGui::TextUnformatted(StrUtils::Concat(_GetResourceString(resourceKey), ":").c_str());
+			ImGui::SameLine();
+			ImGui::PushFont(_fontMonoNumbers);
+			ImGui::TextUnformatted(fmt::format("{:.1f} / {:.1f} / {:.1f} ms",
+				percentiles.p50, percentiles.p90, percentiles.p99).c_str());
+			ImGui::PopFont();
+		}
+	}
+
+	ImGui::Spacing();
+	const std::string& distributionStr = _GetResourceString(L"Overlay_Profiler_Distribution");
+	if (ImGui::CollapsingHeader(distributionStr.c_str(), ImGuiTreeNodeFlags_DefaultOpen)) {
+		const std::pair<const FrameTimeHistogram*, const wchar_t*> histograms[] = {
+			{ &gpuTimer.GetFrameTimeHistogram(), L"Overlay_Profiler_Distribution_FrameTime" },
+			{ &gpuTimer.GetGPUTimeHistogram(), L"Overlay_Profiler_Distribution_GPUTime" },
+			{ &gpuTimer.GetPresentIntervalHistogram(), L"Overlay_Profiler_Distribution_PresentInterval" }
+		};
+
+		ImGui::Spacing();
+		ImGui::TextUnformatted("P50 / P95 / P99 / Max");
+
+		for (const auto& [histogram, resourceKey] : histograms) {
+			if (histogram->GetSampleCount() == 0) {
+				continue;
+			}
+
+			ImGui::TextUnformatted(StrUtils::Concat(_GetResourceString(resourceKey), ":").c_str());
+			ImGui::SameLine();
+			ImGui::PushFont(_fontMonoNumbers);
+			ImGui::TextUnformatted(fmt::format("{:.1f} / {:.1f} / {:.1f} / {:.1f} ms", histogram->GetPercentile(50),
+				histogram->GetPercentile(95), histogram->GetPercentile(99), histogram->GetMax()).c_str());
+			ImGui::PopFont();
+		}
+
+		ImGui::Spacing();
+		ImGui::TextUnformatted(StrUtils::Concat(_GetResourceString(L"Overlay_Profiler_Distribution_Stutters"), ":").c_str());
+		ImGui::SameLine();
+		ImGui::PushFont(_fontMonoNumbers);
+		ImGui::TextUnformatted(fmt::format("{}", gpuTimer.GetStutterCount()).c_str());
+
+		// 开始缩放后的时刻、帧间隔和它是中位数的几倍
+		for (const GPUTimer::StutterEvent& stutter : gpuTimer.GetRecentStutters()) {
+			ImGui::TextUnformatted(fmt::format("{:.1f} s  {:.1f} ms  x{:.1f}",
+				std::chrono::duration<float>(stutter.time).count(),
+				stutter.frameTime, stutter.frameTime / stutter.medianFrameTime).c_str());
+		}
+		ImGui::PopFont();
+	}
+
+	ImGui::Spacing();
+	const std::string& videoMemoryStr = _GetResourceString(L"Overlay_Profiler_VideoMemory");
+	if (ImGui::CollapsingHeader(videoMemoryStr.c_str())) {
+		static constexpr std::pair<GPUMemoryOwner, const wchar_t*> OWNERS[] = {
+			{ GPUMemoryOwner::Effect, L"Overlay_Profiler_VideoMemory_Effects" },
+			{ GPUMemoryOwner::FrameSource, L"Overlay_Profiler_VideoMemory_FrameSource" },
+			{ GPUMemoryOwner::Cursor, L"Overlay_Profiler_VideoMemory_Cursor" },
+			{ GPUMemoryOwner::Overlay, L"Overlay_Profiler_VideoMemory_Overlay" },
+			{ GPUMemoryOwner::Other, L"Overlay_Profiler_VideoMemory_Other" }
+		};
+		static constexpr float BYTES_PER_MIB = 1024.0f * 1024.0f;
+
+		const GPUMemoryTracker& memoryTracker = MagApp::Get().GetDeviceResources().GetMemoryTracker();
+
+		ImGui::Spacing();
+		ImGui::TextUnformatted(StrUtils::Concat(
+			_GetResourceString(L"Overlay_Profiler_VideoMemory_Current"), " / ",
+			_GetResourceString(L"Overlay_Profiler_VideoMemory_Peak"), " / ",
+			_GetResourceString(L"Overlay_Profiler_VideoMemory_Budget"), ":").c_str());
+		ImGui::PushFont(_fontMonoNumbers);
+		const uint64_t budget = memoryTracker.GetBudget();
+		ImGui::TextUnformatted(fmt::format("{:.1f} / {:.1f} / {} MiB",
+			memoryTracker.GetCurrentBytes() / BYTES_PER_MIB, memoryTracker.GetPeakBytes() / BYTES_PER_MIB,
+			budget == 0 ? "-" : fmt::format("{:.0f}", budget / BYTES_PER_MIB)).c_str());
+		ImGui::PopFont();
+
+		ImGui::Spacing();
+		for (const auto& [owner, resourceKey] : OWNERS) {
+			const uint64_t bytes = memoryTracker.GetOwnerBytes(owner);
+			if (bytes == 0) {
+				continue;
+			}
+
+			ImGui::TextUnformatted(StrUtils::Concat(_GetResourceString(resourceKey), ":").c_str());
+			ImGui::SameLine();
+			DrawTextWithFont(fmt::format("{:.2f} MiB", bytes / BYTES_PER_MIB).c_str(), _fontMonoNumbers);
+		}
+
+		// 效果中占用最多的几项
+		SmallVector<GPUMemoryTracker::Allocation> allocations;
+		memoryTracker.GetSummary(allocations);
+
+		ImGui::Spacing();
+		ImGui::PushStyleVar(ImGuiStyleVar_CellPadding, ImVec2(0, 2 * _dpiScale));
+		if (ImGui::BeginTable("videoMemory", 2, ImGuiTableFlags_PadOuterX)) {
+			ImGui::TableSetupColumn("name", ImGuiTableColumnFlags_WidthStretch | ImGuiTableColumnFlags_NoResize | ImGuiTableColumnFlags_NoReorder);
+			ImGui::TableSetupColumn("size", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_NoResize | ImGuiTableColumnFlags_NoReorder);
+
+			static constexpr size_t MAX_ROWS = 8;
+			size_t rowCount = 0;
+			for (const GPUMemoryTracker::Allocation& allocation : allocations) {
+				if (allocation.owner != GPUMemoryOwner::Effect) {
+					continue;
+				}
+
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(allocation.name.c_str());
+				if (ImGui::IsItemHovered() && allocation.width > 0 && allocation.format != DXGI_FORMAT_UNKNOWN) {
+					ImGuiImpl::Tooltip(fmt::format("{}x{}", allocation.width, allocation.height).c_str());
+				}
+				ImGui::TableNextColumn();
+				DrawTextWithFont(fmt::format("{:.2f} MiB", allocation.bytes / BYTES_PER_MIB).c_str(), _fontMonoNumbers);
+
+				if (++rowCount == MAX_ROWS) {
+					break;
+				}
+			}
+
+			ImGui::EndTable();
+		}
+		ImGui::PopStyleVar();
+	}
+
 	ImGui::Spacing();
 	const std::string& timingsStr = _GetResourceString(L"Overlay_Profiler_Timings");
 	if (ImGui::CollapsingHeader(timingsStr.c_str(), ImGuiTreeNodeFlags_DefaultOpen)) {
+		// 记录每帧各通道的用时以便离线分析
+		ImGui::Spacing();
+		const std::string& traceStr = _GetResourceString(TraceRecorder::Get().IsRecording()
+			? L"Overlay_Profiler_Timings_StopTrace"
+			: L"Overlay_Profiler_Timings_StartTrace");
+		if (ImGui::Button(traceStr.c_str())) {
+			renderer.ToggleTraceRecording();
+		}
+
 		const auto& gpuTimings = gpuTimer.GetGPUTimings();
 		const UINT nEffect = renderer.GetEffectCount();
 		
@@ -1098,22 +1104,30 @@ void OverlayDrawer::_DrawUI() noexcept {
 			ImGui::EndTable();
 		}
 
-		if (nEffect > 1) {
-			ImGui::Separator();
+		ImGui::Separator();
 
-			if (ImGui::BeginTable("total", 2, ImGuiTableFlags_PadOuterX)) {
-				ImGui::TableSetupColumn("name", ImGuiTableColumnFlags_WidthStretch | ImGuiTableColumnFlags_NoResize | ImGuiTableColumnFlags_NoReorder);
-				ImGui::TableSetupColumn("time", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_NoResize | ImGuiTableColumnFlags_NoReorder);
+		if (ImGui::BeginTable("total", 2, ImGuiTableFlags_PadOuterX)) {
+			ImGui::TableSetupColumn("name", ImGuiTableColumnFlags_WidthStretch | ImGuiTableColumnFlags_NoResize | ImGuiTableColumnFlags_NoReorder);
+			ImGui::TableSetupColumn("time", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_NoResize | ImGuiTableColumnFlags_NoReorder);
 
+			if (nEffect > 1) {
 				ImGui::TableNextRow();
 				ImGui::TableNextColumn();
 				const std::string& totalStr = _GetResourceString(L"Overlay_Profiler_Timings_Total");
 				ImGui::TextUnformatted(totalStr.c_str());
 				ImGui::TableNextColumn();
 				DrawTextWithFont(fmt::format("{:.3f} ms", effectsTotalTime).c_str(), _fontMonoNumbers);
-
-				ImGui::EndTable();
 			}
+
+			// 覆盖层自身的开销，不计入效果的总用时
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			const std::string& overlayStr = _GetResourceString(L"Overlay_Profiler_Timings_Overlay");
+			ImGui::TextUnformatted(overlayStr.c_str());
+			ImGui::TableNextColumn();
+			DrawTextWithFont(fmt::format("{:.3f} ms", gpuTimings.overlay).c_str(), _fontMonoNumbers);
+
+			ImGui::EndTable();
 		}
 		ImGui::PopStyleVar();
 	}
@@ -1125,6 +1139,27 @@ void OverlayDrawer::_RetrieveHardwareInfo() noexcept {
 	DXGI_ADAPTER_DESC desc{};
 	HRESULT hr = MagApp::Get().GetDeviceResources().GetGraphicsAdapter()->GetDesc(&desc);
 	_hardwareInfo.gpuName = SUCCEEDED(hr) ? StrUtils::UTF16ToUTF8(desc.Description) : "UNAVAILABLE";
+	_fonts->RequestGlyphs(_hardwareInfo.gpuName);
+}
+
+void OverlayDrawer::_UpdateFonts() noexcept {
+	_fontUI = _fonts->GetUIFont();
+	_fontMonoNumbers = _fonts->GetMonoNumbersFont();
+	_fontFPS = _fonts->GetFPSFont();
+
+	// 将 _fontUI 设为默认字体
+	ImGui::GetIO().FontDefault = _fontUI;
+}
+
+void OverlayDrawer::_RequestEffectGlyphs() noexcept {
+	const Renderer& renderer = MagApp::Get().GetRenderer();
+	for (uint32_t i = 0, nEffect = renderer.GetEffectCount(); i < nEffect; ++i) {
+		const EffectDesc& desc = renderer.GetEffectDesc(i);
+		_fonts->RequestGlyphs(desc.name);
+		for (const EffectPassDesc& passDesc : desc.passes) {
+			_fonts->RequestGlyphs(passDesc.desc);
+		}
+	}
 }
 
 void OverlayDrawer::_EnableSrcWnd(bool enable) noexcept {
@@ -1145,7 +1180,10 @@ const std::string& OverlayDrawer::_GetResourceString(const std::wstring_view& ke
 		return it->second;
 	}
 
-	return cache[key] = StrUtils::UTF16ToUTF8(_resourceLoader.GetString(key));
+	std::string& result = cache[key];
+	result = StrUtils::UTF16ToUTF8(_resourceLoader.GetString(key));
+	_fonts->RequestGlyphs(result);
+	return result;
 }
 
 }
@@ -7,6 +7,7 @@ namespace Magpie::Core {
 
 struct EffectDesc;
 class ImGuiImpl;
+class OverlayFonts;
 
 class OverlayDrawer {
 public:
@@ -16,20 +17,36 @@ public:
 
 	~OverlayDrawer();
 
-	bool Initialize() noexcept;
+	bool Initialize(std::shared_ptr<OverlayFonts> fonts) noexcept;
 
 	void Draw() noexcept;
 
+	// 是否有需要绘制的内容
+	bool IsDrawing() const noexcept;
+
 	bool IsUIVisiable() const noexcept {
 		return _isUIVisiable;
 	}
 
 	void SetUIVisibility(bool value) noexcept;
 
+	// 效果链被替换后调用
+	void OnEffectsChanged() noexcept;
+
+	// 更新效果链失败时显示错误，errorMsg 为详细信息，可以为空
+	void ShowEffectsError(std::string&& errorMsg) noexcept;
+
+	void HideEffectsError() noexcept {
+		_effectsError.clear();
+		_isShowEffectsError = false;
+	}
+
 private:
-	bool _BuildFonts() noexcept;
-	void _BuildFontUI(std::wstring_view language, const std::vector<uint8_t>& fontData, ImVector<ImWchar>& uiRanges) noexcept;
-	void _BuildFontFPS(const std::vector<uint8_t>& fontData) noexcept;
+	// 字体图集重新构建后字体的指针会改变
+	void _UpdateFonts() noexcept;
+
+	// 效果名和通道描述可能含有图集中没有的字符
+	void _RequestEffectGlyphs() noexcept;
 
 	struct _EffectTimings {
 		const EffectDesc* desc = nullptr;
@@ -43,6 +60,8 @@ private:
 
 	void _DrawFPS() noexcept;
 
+	void _DrawEffectsError() noexcept;
+
 	void _DrawUI() noexcept;
 
 	void _RetrieveHardwareInfo() noexcept;
@@ -53,6 +72,8 @@ private:
 
 	float _dpiScale = 1.0f;
 
+	// 需在 _imguiImpl 之后析构，ImGui 上下文引用了它的图集
+	std::shared_ptr<OverlayFonts> _fonts;
 	ImFont* _fontUI = nullptr;	// 普通 UI 文字
 	ImFont* _fontMonoNumbers = nullptr;	// 普通 UI 文字，但数字部分是等宽的，只支持 ASCII
 	ImFont* _fontFPS = nullptr;	// FPS
@@ -62,6 +83,8 @@ private:
 
 	SmallVector<UINT> _timelineColors;
 
+	std::string _effectsError;
+
 	struct {
 		std::string gpuName;
 	} _hardwareInfo;
@@ -72,6 +95,7 @@ private:
 
 	bool _isUIVisiable = false;
 	bool _isSrcMainWnd = false;
+	bool _isShowEffectsError = false;
 };
 
 }
@@ -0,0 +1,435 @@
+#include "pch.h"
+#include "OverlayFonts.h"
+#include "MagApp.h"
+#include "Logger.h"
+#include "StrUtils.h"
+#include "Win32Utils.h"
+#include "ImGuiHelper.h"
+#include "ImGuiFontsCacheManager.h"
+
+namespace Magpie::Core {
+
+// CJK 的标点、假名和全角字符很常用且数量少，总是加入图集
+static constexpr ImWchar CJK_COMMON_RANGES[] = { 0x3000, 0x30FF, 0xFF00, 0xFFEF, 0 };
+
+static const std::wstring& GetSystemFontsFolder() noexcept {
+	static std::wstring result;
+
+	if (result.empty()) {
+		wchar_t* fontsFolder = nullptr;
+		HRESULT hr = SHGetKnownFolderPath(FOLDERID_Fonts, 0, NULL, &fontsFolder);
+		if (FAILED(hr)) {
+			CoTaskMemFree(fontsFolder);
+			Logger::Get().ComError("SHGetKnownFolderPath 失败", hr);
+			return result;
+		}
+
+		result = fontsFolder;
+		CoTaskMemFree(fontsFolder);
+	}
+
+	return result;
+}
+
+static const std::wstring& GetAppLanguage() noexcept {
+	static std::wstring language;
+	if (language.empty()) {
+		winrt::ResourceContext resourceContext = winrt::ResourceContext::GetForViewIndependentUse();
+		language = resourceContext.QualifierValues().Lookup(L"Language");
+		StrUtils::ToLowerCase(language);
+	}
+	return language;
+}
+
+static bool IsInRanges(const ImWchar* ranges, ImWchar c) noexcept {
+	for (; ranges[0]; ranges += 2) {
+		if (c >= ranges[0] && c <= ranges[1]) {
+			return true;
+		}
+	}
+	return false;
+}
+
+winrt::fire_and_forget OverlayFonts::BuildAsync(std::shared_ptr<OverlayFonts> fonts, float dpiScale) {
+	// 在调用线程中读取设置，ResourceContext 也需在这里获取
+	fonts->_language = GetAppLanguage();
+	fonts->_dpiScale = dpiScale;
+	fonts->_isCacheDisabled = MagApp::Get().GetOptions().IsDisableFontCache();
+
+	fonts->_atlas->Flags |= ImFontAtlasFlags_NoPowerOfTwoHeight;
+	if (!MagApp::Get().GetOptions().Is3DGameMode()) {
+		// 非 3D 游戏模式无需 ImGui 绘制光标
+		fonts->_atlas->Flags |= ImFontAtlasFlags_NoMouseCursors;
+	}
+
+	co_await winrt::resume_background();
+
+	const auto startTime = std::chrono::steady_clock::now();
+	fonts->_isSucceeded = fonts->_Build();
+	Logger::Get().Info(fmt::format("构建字体图集用时 {:.1f} 毫秒",
+		std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count()));
+
+	fonts->_isCompleted.store(true, std::memory_order_release);
+	fonts->_isCompleted.notify_all();
+}
+
+bool OverlayFonts::Wait() noexcept {
+	_isCompleted.wait(false, std::memory_order_acquire);
+	return _isSucceeded;
+}
+
+void OverlayFonts::RequestGlyphs(std::string_view text) noexcept {
+	// 不需要额外字体的语言已包含所有字符
+	if (!_extraRanges || !_fontUI) {
+		return;
+	}
+
+	for (wchar_t c : StrUtils::UTF8ToUTF16(text)) {
+		// 只支持 BMP
+		if (c < 0x80 || (c >= 0xD800 && c <= 0xDFFF)) {
+			continue;
+		}
+
+		if (_extraGlyphs.contains(c) || _pendingGlyphs.contains(c) || _buildingGlyphs.contains(c)
+			|| _fontUI->FindGlyphNoFallback(c) || !IsInRanges(_extraRanges, c)) {
+			continue;
+		}
+
+		_pendingGlyphs.insert(c);
+	}
+}
+
+bool OverlayFonts::UpdateGlyphs() noexcept {
+	if (_glyphsBuild) {
+		if (!_isGlyphsBuildCompleted.load(std::memory_order_acquire)) {
+			return false;
+		}
+
+		std::unique_ptr<_GlyphsBuild> build = std::move(_glyphsBuild);
+		_isGlyphsBuildCompleted.store(false, std::memory_order_relaxed);
+		_buildingGlyphs.clear();
+
+		if (!build->isSucceeded) {
+			// 失败通常是因为字体文件无效，不再加入额外字符
+			_pendingGlyphs.clear();
+			_extraRanges = nullptr;
+			return false;
+		}
+
+		// 新的图集引用了 extraFontRanges 的内存，交换不会改变它的地址
+		_atlas = std::move(build->atlas);
+		_extraGlyphs = std::move(build->extraGlyphs);
+		_extraFontRanges.swap(build->extraFontRanges);
+		_UpdateFontPointers();
+		return true;
+	}
+
+	if (_pendingGlyphs.empty()) {
+		return false;
+	}
+
+	// 字体文件可能有几十 MB，在后台读取，完成前保留等待加入的字符
+	switch (_fontDataState.load(std::memory_order_acquire)) {
+	case _FontDataState::NotLoaded:
+		_fontDataState.store(_FontDataState::Loading, std::memory_order_relaxed);
+		_ReadFontDataAsync(shared_from_this());
+		return false;
+	case _FontDataState::Loading:
+		return false;
+	case _FontDataState::Failed:
+		_pendingGlyphs.clear();
+		return false;
+	default:
+		break;
+	}
+
+	// ImGui 不支持向已构建的图集添加字符，因此在后台构建新的图集，完成前继续使用原来的。
+	// 构建期间记录的字符留待下一次构建
+	_glyphsBuild = std::make_unique<_GlyphsBuild>();
+	_glyphsBuild->atlas->Flags = _atlas->Flags;
+	_glyphsBuild->extraGlyphs = _extraGlyphs;
+	_glyphsBuild->extraGlyphs.insert(_pendingGlyphs.begin(), _pendingGlyphs.end());
+	_buildingGlyphs = std::move(_pendingGlyphs);
+	_pendingGlyphs.clear();
+
+	_BuildGlyphsAsync(shared_from_this(), _glyphsBuild.get());
+	return false;
+}
+
+winrt::fire_and_forget OverlayFonts::_BuildGlyphsAsync(std::shared_ptr<OverlayFonts> fonts, _GlyphsBuild* build) {
+	co_await winrt::resume_background();
+
+	const auto startTime = std::chrono::steady_clock::now();
+
+	// CJK 字符只有用到的部分，因此很快
+	fonts->_AddFonts(*build->atlas, build->extraGlyphs, build->extraFontRanges);
+	build->isSucceeded = build->atlas->Build();
+
+	if (build->isSucceeded) {
+		Logger::Get().Info(fmt::format("字体图集已包含 {} 个额外字符，重新构建用时 {:.1f} 毫秒", build->extraGlyphs.size(),
+			std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count()));
+
+		if (!fonts->_isCacheDisabled) {
+			fonts->_SaveCache(build->extraGlyphs, *build->atlas);
+		}
+	} else {
+		Logger::Get().Error("构建字体失败");
+	}
+
+	fonts->_isGlyphsBuildCompleted.store(true, std::memory_order_release);
+}
+
+bool OverlayFonts::_Build() noexcept {
+	_InitRanges();
+
+	if (!_isCacheDisabled) {
+		std::vector<ImWchar> extraGlyphs;
+		if (ImGuiFontsCacheManager::Get().Load(_language, _dpiScale, extraGlyphs, *_atlas)) {
+			_extraGlyphs.insert(extraGlyphs.begin(), extraGlyphs.end());
+			_UpdateFontPointers();
+			return true;
+		}
+
+		// 清空读取了一半的缓存
+		_atlas->Clear();
+	}
+
+	if (!_ReadFontData()) {
+		Logger::Get().Error("_ReadFontData 失败");
+		_fontDataState.store(_FontDataState::Failed, std::memory_order_relaxed);
+		return false;
+	}
+	_fontDataState.store(_FontDataState::Loaded, std::memory_order_relaxed);
+
+	_AddFonts(*_atlas, _extraGlyphs, _extraFontRanges);
+
+	if (!_atlas->Build()) {
+		Logger::Get().Error("构建字体失败");
+		return false;
+	}
+	_UpdateFontPointers();
+
+	if (!_isCacheDisabled) {
+		_SaveCache(_extraGlyphs, *_atlas);
+	}
+
+	return true;
+}
+
+void OverlayFonts::_InitRanges() noexcept {
+	ImFontGlyphRangesBuilder builder;
+
+	if (_language == L"en-us") {
+		builder.AddRanges(ImGuiHelper::ENGLISH_RANGES);
+	} else if (_language == L"ru" || _language == L"uk") {
+		builder.AddRanges(_atlas->GetGlyphRangesCyrillic());
+	} else if (_language == L"tr" || _language == L"hu") {
+		builder.AddRanges(ImGuiHelper::Latin_1_Extended_A_RANGES);
+	} else if (_language == L"vi") {
+		builder.AddRanges(_atlas->GetGlyphRangesVietnamese());
+	} else {
+		// 默认 Basic Latin + Latin-1 Supplement
+		// 参见 https://en.wikipedia.org/wiki/Latin-1_Supplement
+		builder.AddRanges(_atlas->GetGlyphRangesDefault());
+
+		// 一些语言需要加载额外的字体：
+		// 简体中文 -> Microsoft YaHei UI
+		// 繁体中文 -> Microsoft JhengHei UI
+		// 日语 -> Yu Gothic UI
+		// 韩语/朝鲜语 -> Malgun Gothic
+		// 参见 https://learn.microsoft.com/en-us/windows/apps/design/style/typography#fonts-for-non-latin-languages
+		if (_language == L"zh-hans") {
+			// msyh.ttc: 0 是微软雅黑，1 是 Microsoft YaHei UI
+			_extraFontPath = StrUtils::Concat(GetSystemFontsFolder(), L"\\msyh.ttc");
+			_extraFontNo = 1;
+			_extraRanges = ImGuiHelper::GetGlyphRangesChineseSimplifiedOfficial();
+		} else if (_language == L"zh-hant") {
+			// msjh.ttc: 0 是 Microsoft JhengHei，1 是 Microsoft JhengHei UI
+			_extraFontPath = StrUtils::Concat(GetSystemFontsFolder(), L"\\msjh.ttc");
+			_extraFontNo = 1;
+			_extraRanges = ImGuiHelper::GetGlyphRangesChineseTraditionalOfficial();
+		} else if (_language == L"ja") {
+			// YuGothM.ttc: 0 是 Yu Gothic Medium，1 是 Yu Gothic UI
+			_extraFontPath = StrUtils::Concat(GetSystemFontsFolder(), L"\\YuGothM.ttc");
+			_extraFontNo = 1;
+			_extraRanges = _atlas->GetGlyphRangesJapanese();
+		} else if (_language == L"ko") {
+			_extraFontPath = StrUtils::Concat(GetSystemFontsFolder(), L"\\malgun.ttf");
+			_extraRanges = _atlas->GetGlyphRangesKorean();
+		}
+	}
+	builder.SetBit(L'■');
+	builder.BuildRanges(&_uiRanges);
+}
+
+bool OverlayFonts::_ReadFontData() noexcept {
+	std::wstring fontPath = GetSystemFontsFolder();
+	if (Win32Utils::GetOSVersion().IsWin11()) {
+		fontPath += L"\\SegUIVar.ttf";
+	} else {
+		fontPath += L"\\segoeui.ttf";
+	}
+
+	if (!Win32Utils::ReadFile(fontPath.c_str(), _fontData)) {
+		Logger::Get().Error("读取字体文件失败");
+		return false;
+	}
+
+	if (!_extraFontPath.empty()) {
+		assert(Win32Utils::FileExists(_extraFontPath.c_str()));
+
+		if (!Win32Utils::ReadFile(_extraFontPath.c_str(), _extraFontData)) {
+			Logger::Get().Error("读取字体文件失败");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+winrt::fire_and_forget OverlayFonts::_ReadFontDataAsync(std::shared_ptr<OverlayFonts> fonts) {
+	co_await winrt::resume_background();
+
+	if (fonts->_ReadFontData()) {
+		fonts->_fontDataState.store(_FontDataState::Loaded, std::memory_order_release);
+	} else {
+		Logger::Get().Error("_ReadFontData 失败");
+		fonts->_fontDataState.store(_FontDataState::Failed, std::memory_order_release);
+	}
+}
+
+void OverlayFonts::_AddFonts(
+	ImFontAtlas& atlas,
+	const phmap::flat_hash_set<ImWchar>& extraGlyphs,
+	ImVector<ImWchar>& extraFontRanges
+) noexcept {
+	ImFontConfig config;
+	config.FontDataOwnedByAtlas = false;
+
+	const float fontSize = 18 * _dpiScale;
+
+	//////////////////////////////////////////////////////////
+	//
+	// uiRanges (+ extraFontRanges) -> _fontUI
+	//
+	//////////////////////////////////////////////////////////
+
+#ifdef _DEBUG
+	std::char_traits<char>::copy(config.Name, "_fontUI", std::size(config.Name));
+#endif
+
+	atlas.AddFontFromMemoryTTF(
+		(void*)_fontData.data(), (int)_fontData.size(), fontSize, &config, _uiRanges.Data);
+
+	if (!_extraFontData.empty()) {
+		ImFontGlyphRangesBuilder builder;
+		builder.AddRanges(CJK_COMMON_RANGES);
+		for (ImWchar c : extraGlyphs) {
+			builder.AddChar(c);
+		}
+		extraFontRanges.clear();
+		builder.BuildRanges(&extraFontRanges);
+
+		// 在 MergeMode 下已有字符会跳过而不是覆盖
+		config.MergeMode = true;
+		config.FontNo = _extraFontNo;
+		atlas.AddFontFromMemoryTTF(
+			(void*)_extraFontData.data(), (int)_extraFontData.size(), fontSize, &config, extraFontRanges.Data);
+		config.FontNo = 0;
+		config.MergeMode = false;
+	}
+
+	//////////////////////////////////////////////////////////
+	//
+	// NUMBER_RANGES + NOT_NUMBER_RANGES -> _fontMonoNumbers
+	//
+	//////////////////////////////////////////////////////////
+
+#ifdef _DEBUG
+	std::char_traits<char>::copy(config.Name, "_fontMonoNumbers", std::size(config.Name));
+#endif
+
+	// 等宽的数字字符
+	config.GlyphMinAdvanceX = config.GlyphMaxAdvanceX = fontSize * 0.42f;
+	atlas.AddFontFromMemoryTTF(
+		(void*)_fontData.data(), (int)_fontData.size(), fontSize, &config, ImGuiHelper::NUMBER_RANGES);
+
+	// 其他不等宽的字符
+	config.MergeMode = true;
+	config.GlyphMinAdvanceX = 0;
+	config.GlyphMaxAdvanceX = std::numeric_limits<float>::max();
+	atlas.AddFontFromMemoryTTF(
+		(void*)_fontData.data(), (int)_fontData.size(), fontSize, &config, ImGuiHelper::NOT_NUMBER_RANGES);
+
+	//////////////////////////////////////////////////////////
+	//
+	// NUMBER_RANGES + " FPS" -> _fontFPS
+	//
+	//////////////////////////////////////////////////////////
+
+	const float fpsSize = 24 * _dpiScale;
+
+#ifdef _DEBUG
+	std::char_traits<char>::copy(config.Name, "_fontFPS", std::size(config.Name));
+#endif
+
+	// 等宽的数字字符
+	config.MergeMode = false;
+	config.GlyphMinAdvanceX = config.GlyphMaxAdvanceX = fpsSize * 0.42f;
+	atlas.AddFontFromMemoryTTF(
+		(void*)_fontData.data(), (int)_fontData.size(), fpsSize, &config, ImGuiHelper::NUMBER_RANGES);
+
+	// 其他不等宽的字符
+	config.MergeMode = true;
+	config.GlyphMinAdvanceX = 0;
+	config.GlyphMaxAdvanceX = std::numeric_limits<float>::max();
+	atlas.AddFontFromMemoryTTF(
+		(void*)_fontData.data(), (int)_fontData.size(), fpsSize, &config, (const ImWchar*)L"  FFPPSS");
+}
+
+void OverlayFonts::_UpdateFontPointers() noexcept {
+	_fontUI = _atlas->Fonts[0];
+	_fontMonoNumbers = _atlas->Fonts[1];
+	_fontFPS = _atlas->Fonts[2];
+}
+
+void OverlayFonts::_SaveCache(const phmap::flat_hash_set<ImWchar>& extraGlyphs, const ImFontAtlas& atlas) noexcept {
+	std::vector<ImWchar> sortedGlyphs(extraGlyphs.begin(), extraGlyphs.end());
+	std::sort(sortedGlyphs.begin(), sortedGlyphs.end());
+
+	std::vector<BYTE> cacheData;
+	if (!ImGuiFontsCacheManager::Get().Serialize(_dpiScale, sortedGlyphs, atlas, cacheData)) {
+		return;
+	}
+
+	{
+		std::scoped_lock lk(_cacheMutex);
+		_pendingCacheData = std::move(cacheData);
+		if (_isWritingCache) {
+			return;
+		}
+		_isWritingCache = true;
+	}
+
+	_WriteCacheAsync(shared_from_this());
+}
+
+winrt::fire_and_forget OverlayFonts::_WriteCacheAsync(std::shared_ptr<OverlayFonts> fonts) {
+	co_await winrt::resume_background();
+
+	while (true) {
+		std::vector<BYTE> cacheData;
+		{
+			std::scoped_lock lk(fonts->_cacheMutex);
+			if (fonts->_pendingCacheData.empty()) {
+				fonts->_isWritingCache = false;
+				break;
+			}
+			cacheData.swap(fonts->_pendingCacheData);
+		}
+
+		ImGuiFontsCacheManager::Get().Save(fonts->_language, cacheData);
+	}
+}
+
+}
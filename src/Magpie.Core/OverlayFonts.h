@@ -0,0 +1,137 @@
+#pragma once
+#include <imgui.h>
+#include <parallel_hashmap/phmap.h>
+#include "Win32Utils.h"
+
+namespace Magpie::Core {
+
+// 覆盖层使用的字体图集。缩放开始时在后台构建，CJK 字符数量庞大，只包含常用的标点和
+// 假名，其他字符在首次使用时加入图集。加入的字符保存在缓存中，之后的缩放无需再次加入
+class OverlayFonts : public std::enable_shared_from_this<OverlayFonts> {
+public:
+	OverlayFonts() = default;
+	OverlayFonts(const OverlayFonts&) = delete;
+	OverlayFonts(OverlayFonts&&) = delete;
+
+	// 在后台线程构建字体图集，完成前 fonts 不会析构
+	static winrt::fire_and_forget BuildAsync(std::shared_ptr<OverlayFonts> fonts, float dpiScale);
+
+	// 等待后台构建完成，失败时返回 false
+	bool Wait() noexcept;
+
+	// 可在多个 ImGui 上下文间共享。UpdateGlyphs 重新构建图集后地址改变
+	ImFontAtlas& GetAtlas() noexcept {
+		return *_atlas;
+	}
+
+	// 普通 UI 文字
+	ImFont* GetUIFont() const noexcept {
+		return _fontUI;
+	}
+
+	// 普通 UI 文字，但数字部分是等宽的，只支持 ASCII
+	ImFont* GetMonoNumbersFont() const noexcept {
+		return _fontMonoNumbers;
+	}
+
+	// FPS
+	ImFont* GetFPSFont() const noexcept {
+		return _fontFPS;
+	}
+
+	// 记录 text 中尚未加入图集的字符，text 为 UTF-8 编码
+	void RequestGlyphs(std::string_view text) noexcept;
+
+	// 应在两帧之间调用。记录的字符在后台加入新的图集，不阻塞调用线程，构建完成后的下一次调用
+	// 替换图集并返回 true，此时图集和字体的指针已改变，字体纹理也需重新创建。失败时保留原来的图集
+	bool UpdateGlyphs() noexcept;
+
+private:
+	enum class _FontDataState : uint8_t {
+		NotLoaded,
+		Loading,
+		Loaded,
+		Failed
+	};
+
+	bool _Build() noexcept;
+
+	// 根据语言选择字符范围和额外字体
+	void _InitRanges() noexcept;
+
+	bool _ReadFontData() noexcept;
+
+	// 从缓存加载图集时没有读取字体文件，首次需要加入字符时在后台读取
+	static winrt::fire_and_forget _ReadFontDataAsync(std::shared_ptr<OverlayFonts> fonts);
+
+	// 向空的图集添加字体，extraFontRanges 由 extraGlyphs 生成，在图集构建前不能析构
+	void _AddFonts(
+		ImFontAtlas& atlas,
+		const phmap::flat_hash_set<ImWchar>& extraGlyphs,
+		ImVector<ImWchar>& extraFontRanges
+	) noexcept;
+
+	// 图集中的字体依次为 _fontUI、_fontMonoNumbers 和 _fontFPS
+	void _UpdateFontPointers() noexcept;
+
+	// 在当前线程序列化图集，在后台压缩和写入。创建字体纹理后图集的像素数据将被释放，
+	// 因此必须在此之前调用
+	void _SaveCache(const phmap::flat_hash_set<ImWchar>& extraGlyphs, const ImFontAtlas& atlas) noexcept;
+
+	static winrt::fire_and_forget _WriteCacheAsync(std::shared_ptr<OverlayFonts> fonts);
+
+	// 在后台构建包含新字符的图集
+	struct _GlyphsBuild {
+		std::unique_ptr<ImFontAtlas> atlas = std::make_unique<ImFontAtlas>();
+		// 新的图集包含的所有额外字符
+		phmap::flat_hash_set<ImWchar> extraGlyphs;
+		ImVector<ImWchar> extraFontRanges;
+		bool isSucceeded = false;
+	};
+
+	// 只访问 build 和构建后不再改变的成员
+	static winrt::fire_and_forget _BuildGlyphsAsync(std::shared_ptr<OverlayFonts> fonts, _GlyphsBuild* build);
+
+	std::unique_ptr<ImFontAtlas> _atlas = std::make_unique<ImFontAtlas>();
+	ImFont* _fontUI = nullptr;
+	ImFont* _fontMonoNumbers = nullptr;
+	ImFont* _fontFPS = nullptr;
+
+	std::wstring _language;
+	float _dpiScale = 1.0f;
+	bool _isCacheDisabled = false;
+
+	std::atomic<_FontDataState> _fontDataState = _FontDataState::NotLoaded;
+	std::vector<uint8_t> _fontData;
+	// 一些语言需要额外的字体，为空表示不需要
+	std::wstring _extraFontPath;
+	std::vector<uint8_t> _extraFontData;
+	int _extraFontNo = 0;
+	// 额外字体支持的所有字符，惰性加入图集
+	const ImWchar* _extraRanges = nullptr;
+
+	// 构建图集前 ImGui 只保存了字符范围的指针，因此它们不能析构
+	ImVector<ImWchar> _uiRanges;
+	ImVector<ImWchar> _extraFontRanges;
+
+	// 已加入图集的额外字符，包括字体中不存在的
+	phmap::flat_hash_set<ImWchar> _extraGlyphs;
+	// 等待加入图集的额外字符
+	phmap::flat_hash_set<ImWchar> _pendingGlyphs;
+	// 正在后台加入图集的额外字符
+	phmap::flat_hash_set<ImWchar> _buildingGlyphs;
+
+	// 不为空表示正在后台构建图集，完成前只有后台线程访问
+	std::unique_ptr<_GlyphsBuild> _glyphsBuild;
+	std::atomic<bool> _isGlyphsBuildCompleted = false;
+
+	// 同一时间只有一个后台任务写入缓存，写入期间产生的新数据由它接着写入
+	Win32Utils::SRWMutex _cacheMutex;
+	std::vector<BYTE> _pendingCacheData;
+	bool _isWritingCache = false;
+
+	std::atomic<bool> _isCompleted = false;
+	bool _isSucceeded = false;
+};
+
+}
@@ -0,0 +1,77 @@
+#include "pch.h"
+#include "RectHelper.h"
+
+namespace Magpie::Core {
+
+// 合并后多出的面积不超过覆盖面积的 1/4 时合并两个矩形
+static constexpr int64_t MERGE_WASTE_RATIO = 4;
+
+// 矩形过多时 O(n^2) 的合并开销变大，直接使用包围盒
+static constexpr uint32_t MAX_INPUT_RECTS = 256;
+
+void RectHelper::ClipRect(const RECT& rect, const RECT& clip, SmallVectorImpl<RECT>& result) noexcept {
+	const RECT intersection = Intersect(rect, clip);
+	if (IsEmpty(intersection)) {
+		return;
+	}
+
+	result.push_back({
+		intersection.left - clip.left,
+		intersection.top - clip.top,
+		intersection.right - clip.left,
+		intersection.bottom - clip.top
+	});
+}
+
+static RECT BoundingRect(const SmallVectorImpl<RECT>& rects) noexcept {
+	RECT result = rects[0];
+	for (const RECT& rect : rects) {
+		result = RectHelper::Union(result, rect);
+	}
+	return result;
+}
+
+void RectHelper::CoalesceRects(SmallVectorImpl<RECT>& rects, uint32_t maxCount) noexcept {
+	if (rects.size() <= 1) {
+		return;
+	}
+
+	if (rects.size() > MAX_INPUT_RECTS) {
+		const RECT bounding = BoundingRect(rects);
+		rects.assign(1, bounding);
+		return;
+	}
+
+	// 合并产生的矩形可能和已检查过的矩形可以合并，因此重复直到没有变化
+	bool merged = true;
+	while (merged) {
+		merged = false;
+
+		for (uint32_t i = 0; i < rects.size(); ++i) {
+			for (uint32_t j = i + 1; j < rects.size();) {
+				const RECT& r1 = rects[i];
+				const RECT& r2 = rects[j];
+
+				const int64_t covered = Area(r1) + Area(r2) - Area(Intersect(r1, r2));
+				const RECT merged12 = Union(r1, r2);
+				const int64_t waste = Area(merged12) - covered;
+
+				if (waste * MERGE_WASTE_RATIO > covered) {
+					++j;
+					continue;
+				}
+
+				rects[i] = merged12;
+				rects.erase(rects.begin() + j);
+				merged = true;
+			}
+		}
+	}
+
+	if (rects.size() > maxCount) {
+		const RECT bounding = BoundingRect(rects);
+		rects.assign(1, bounding);
+	}
+}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "SmallVector.h"
+
+namespace Magpie::Core {
+
+// 处理捕获时的更新区域，只进行矩形运算，不依赖 D3D
+struct RectHelper {
+	static bool IsEmpty(const RECT& rect) noexcept {
+		return rect.right <= rect.left || rect.bottom <= rect.top;
+	}
+
+	static int64_t Area(const RECT& rect) noexcept {
+		return IsEmpty(rect) ? 0 : int64_t(rect.right - rect.left) * (rect.bottom - rect.top);
+	}
+
+	static RECT Intersect(const RECT& r1, const RECT& r2) noexcept {
+		return {
+			std::max(r1.left, r2.left),
+			std::max(r1.top, r2.top),
+			std::min(r1.right, r2.right),
+			std::min(r1.bottom, r2.bottom)
+		};
+	}
+
+	static RECT Union(const RECT& r1, const RECT& r2) noexcept {
+		return {
+			std::min(r1.left, r2.left),
+			std::min(r1.top, r2.top),
+			std::max(r1.right, r2.right),
+			std::max(r1.bottom, r2.bottom)
+		};
+	}
+
+	// 将 rect 和 clip 的交集添加到 result，坐标以 clip 的左上角为原点。交集为空时不添加
+	static void ClipRect(const RECT& rect, const RECT& clip, SmallVectorImpl<RECT>& result) noexcept;
+
+	// 合并重叠或相邻的矩形，合并后多出的面积很小时也会合并以减少复制的次数。
+	// 结果中的矩形数量不超过 maxCount，否则合并为包围盒
+	static void CoalesceRects(SmallVectorImpl<RECT>& rects, uint32_t maxCount = 16) noexcept;
+};
+
+}
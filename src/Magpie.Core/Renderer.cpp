@@ -7,40 +7,151 @@
 #include "FrameSourceBase.h"
 #include "DeviceResources.h"
 #include "GPUTimer.h"
+#include "TraceRecorder.h"
 #include "EffectDrawer.h"
 #include "OverlayDrawer.h"
+#include "OverlayFonts.h"
 #include "Logger.h"
 #include "CursorManager.h"
 #include "WindowHelper.h"
 #include "Utils.h"
+#include "EffectsWatcher.h"
+#include "FrameRateLimiter.h"
+#include "AdaptiveQualityController.h"
 
 namespace Magpie::Core {
 
+// 空闲时检查光标等变化的间隔，单位为毫秒
+static constexpr DWORD IDLE_CHECK_INTERVAL = 8;
+
+// 自适应画质的预算占刷新间隔的比例，剩下的留给光标、覆盖层和呈现
+static constexpr float ADAPTIVE_QUALITY_BUDGET_RATIO = 0.8f;
+
+// 同一效果开销从高到低的各版本的后缀
+static constexpr std::wstring_view ANIME4K_VARIANTS[] = { L"_UL", L"_VL", L"_L", L"_M", L"_S" };
+static constexpr std::wstring_view NNEDI3_VARIANTS[] = { L"_nns64_win8x6", L"_nns16_win8x4" };
+static constexpr std::span<const std::wstring_view> EFFECT_VARIANTS[] = { ANIME4K_VARIANTS, NNEDI3_VARIANTS };
+
 Renderer::Renderer() {}
 
-Renderer::~Renderer() {}
+Renderer::~Renderer() {
+	TraceRecorder::Get().Stop();
+
+	if (_latencyTracker && _latencyTracker->GetFrameCount() > 0) {
+		static constexpr std::pair<LatencyTracker::Stage, const char*> STAGES[] = {
+			{ LatencyTracker::Stage::CaptureToUpdate, "捕获到渲染" },
+			{ LatencyTracker::Stage::Dispatch, "提交效果链" },
+			{ LatencyTracker::Stage::UpdateToPresent, "渲染到呈现" },
+			{ LatencyTracker::Stage::CaptureToPresent, "捕获到呈现" },
+			{ LatencyTracker::Stage::CaptureToDisplay, "捕获到显示" }
+		};
+
+		std::string msg = fmt::format("最近 {} 帧的延迟 (P50/P90/P99)：",
+			std::min(_latencyTracker->GetFrameCount(), 512u));
+		for (const auto& [stage, name] : STAGES) {
+			const LatencyTracker::Percentiles percentiles = _latencyTracker->GetPercentiles(stage);
+			if (percentiles.p50 < 0) {
+				continue;
+			}
+
+			msg += fmt::format("\n\t{}：{:.2f} / {:.2f} / {:.2f} 毫秒",
+				name, percentiles.p50, percentiles.p90, percentiles.p99);
+		}
+		Logger::Get().Info(msg);
+	}
+
+	if (_gpuTimer) {
+		// 分别在启用和禁用覆盖层缓存时运行即可比较两者的开销
+		const FrameTimeHistogram& overlayHistogram = _gpuTimer->GetOverlayGPUTimeHistogram();
+		if (overlayHistogram.GetSampleCount() > 0) {
+			Logger::Get().Info(fmt::format("最近 {} 帧覆盖层的 GPU 用时 (P50/P90/P99)：{:.3f} / {:.3f} / {:.3f} 毫秒，覆盖层缓存{}",
+				overlayHistogram.GetSampleCount(), overlayHistogram.GetPercentile(50),
+				overlayHistogram.GetPercentile(90), overlayHistogram.GetPercentile(99),
+				MagApp::Get().GetOptions().IsDisableOverlayCache() ? "已禁用" : "已启用"));
+		}
+	}
+
+	if (_gpuTimer && _gpuTimer->GetStutterCount() > 0) {
+		Logger::Get().Info(fmt::format("卡顿 {} 次", _gpuTimer->GetStutterCount()));
+	}
+
+	if (_skippedPresentCount > 0) {
+		Logger::Get().Info(fmt::format("空闲时跳过了 {} 次呈现", _skippedPresentCount));
+	}
+
+	if (_framePacer && _framePacer->GetFrameCount() > 0) {
+		Logger::Get().Info(fmt::format("帧调度：共 {} 帧，估计错过垂直同步 {} 次",
+			_framePacer->GetFrameCount(), _framePacer->GetMissCount()));
+	}
+}
 
 bool Renderer::Initialize() {
+	_initStartTime = std::chrono::steady_clock::now();
+
 	_gpuTimer.reset(new GPUTimer());
 
+	{
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		_latencyTracker = std::make_unique<LatencyTracker>(frequency.QuadPart);
+	}
+
 	if (!GetWindowRect(MagApp::Get().GetHwndSrc(), &_srcWndRect)) {
 		Logger::Get().Win32Error("GetWindowRect 失败");
 		return false;
 	}
 
+	// 和编译效果同时进行
+	_overlayFonts = std::make_shared<OverlayFonts>();
+	OverlayFonts::BuildAsync(_overlayFonts, GetDpiForWindow(MagApp::Get().GetHwndHost()) / 96.0f);
+
+	// 在编译效果前开始记录跟踪
+	if (const std::wstring& traceFile = MagApp::Get().GetOptions().traceFile; !traceFile.empty()) {
+		if (!TraceRecorder::Get().Start(traceFile.c_str())) {
+			Logger::Get().Error("开始记录跟踪失败");
+		}
+	}
+
 	if (!_BuildEffects()) {
 		Logger::Get().Error("_BuildEffects 失败");
 		return false;
 	}
 
+	if (TraceRecorder::Get().IsRecording()) {
+		_StartProfiling();
+	}
+
 	if (MagApp::Get().GetOptions().IsShowFPS()) {
-		_overlayDrawer.reset(new OverlayDrawer());
-		if (!_overlayDrawer->Initialize()) {
-			_overlayDrawer.reset();
-			Logger::Get().Error("初始化 OverlayDrawer 失败");
+		_InitOverlayDrawer();
+	}
+
+	if (MagApp::Get().GetOptions().IsHotReloadEffects()) {
+		_effectsWatcher = std::make_unique<EffectsWatcher>();
+		if (!_effectsWatcher->Initialize(MagApp::Get().GetHwndHost())) {
+			_effectsWatcher.reset();
+			Logger::Get().Error("初始化 EffectsWatcher 失败");
 		}
 	}
 
+	if (MagApp::Get().GetOptions().IsFramePacing() && !_InitFramePacing()) {
+		Logger::Get().Error("_InitFramePacing 失败");
+	}
+
+	{
+		const MagOptions& options = MagApp::Get().GetOptions();
+		if (!options.IsVSync() && (options.maxFrameRate > 0 || options.IsLimitToSourceFrameRate())) {
+			_frameRateLimiter = std::make_unique<FrameRateLimiter>();
+			if (!_frameRateLimiter->Initialize(options.maxFrameRate, options.IsLimitToSourceFrameRate())) {
+				_frameRateLimiter.reset();
+				Logger::Get().Error("初始化 FrameRateLimiter 失败");
+			}
+		}
+	}
+
+	if (MagApp::Get().GetOptions().IsAdaptiveQuality()) {
+		_InitAdaptiveQuality();
+	}
+
 	// 初始化所有效果共用的动态常量缓冲区
 	D3D11_BUFFER_DESC bd{};
 	bd.Usage = D3D11_USAGE_DYNAMIC;
@@ -48,12 +159,13 @@ bool Renderer::Initialize() {
 	bd.ByteWidth = 4 * (UINT)_dynamicConstants.size();
 	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
 
-	HRESULT hr = MagApp::Get().GetDeviceResources().GetD3DDevice()
-		->CreateBuffer(&bd, nullptr, _dynamicCB.put());
+	DeviceResources& dr = MagApp::Get().GetDeviceResources();
+	HRESULT hr = dr.GetD3DDevice()->CreateBuffer(&bd, nullptr, _dynamicCB.put());
 	if (FAILED(hr)) {
 		Logger::Get().ComError("CreateBuffer 失败", hr);
 		return false;
 	}
+	dr.GetMemoryTracker().Track(_dynamicCB.get(), GPUMemoryOwner::Effect, "DYNAMIC_CONSTANTS");
 
 	return true;
 }
@@ -61,33 +173,106 @@ bool Renderer::Initialize() {
 
 void Renderer::Render(bool onPrint) {
 	int srcState = _CheckSrcState();
+	if (srcState == 2 && _OnSrcWndRectChanged()) {
+		srcState = 0;
+	}
 	if (srcState != 0) {
 		Logger::Get().Info("源窗口状态改变，退出全屏");
 		MagApp::Get().Stop(srcState == 2);
 		return;
 	}
 
+	if (_effectsWatcher) {
+		_ReloadChangedEffects();
+	}
+
+	// 在帧之间替换后台编译完成的效果链
+	if (_pendingEffects && _pendingEffects->isCompleted.load(std::memory_order_acquire)) {
+		_SwapPendingEffects();
+	}
+
 	DeviceResources& dr = MagApp::Get().GetDeviceResources();
 
 	if (!_waitingForNextFrame) {
+		if (_frameRateLimiter) {
+			_frameRateLimiter->WaitForNextFrame();
+		}
+
 		dr.BeginFrame();
 		_gpuTimer->OnBeginFrame();
+
+		if (_framePacer) {
+			_WaitForFramePacing();
+		}
+	}
+
+	if (_framePacer) {
+		// 等待新帧的时间不计入渲染用时
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+		_frameStartTime = now.QuadPart;
 	}
 
 	// 首先处理配置改变产生的回调
 	// MagApp::Get().GetOptions().OnBeginFrame();
 
-	auto state = onPrint ? FrameSourceBase::UpdateState::NoUpdate : MagApp::Get().GetFrameSource().Update();
+	FrameSourceBase::UpdateState state;
+	if (onPrint) {
+		state = FrameSourceBase::UpdateState::NoUpdate;
+	} else if (_isEffectsChanged) {
+		// 效果链已改变，使用当前帧重新渲染所有效果，而不是等待新帧
+		state = FrameSourceBase::UpdateState::NewFrame;
+		_isEffectsChanged = false;
+	} else {
+		const int64_t captureStart = Utils::GetQPC();
+		state = MagApp::Get().GetFrameSource().Update();
+
+		if (state == FrameSourceBase::UpdateState::NewFrame) {
+			_latencyFrameTimes.update = Utils::GetQPC();
+			// 没有新帧时可能在 Update 中等待，不记录
+			TraceRecorder::Get().AddSpan(TraceRecorder::Track::CPU, "Capture", captureStart, _latencyFrameTimes.update);
+			// 帧源无法得知捕获的时刻时在 Update 中捕获
+			const int64_t frameTime = MagApp::Get().GetFrameSource().GetFrameTime();
+			_latencyFrameTimes.capture = frameTime != 0 ? frameTime : _latencyFrameTimes.update;
+
+			if (_frameRateLimiter) {
+				_frameRateLimiter->OnSourceFrame(_latencyFrameTimes.capture);
+			}
+		}
+	}
 	_waitingForNextFrame = state == FrameSourceBase::UpdateState::Waiting
 		|| state == FrameSourceBase::UpdateState::Error;
 	if (_waitingForNextFrame) {
 		return;
 	}
 
+	// 帧源不复制帧时每帧的输出纹理可能不同
+	if (state == FrameSourceBase::UpdateState::NewFrame
+		&& !_effects.front().SetInput(MagApp::Get().GetFrameSource().GetOutput())
+	) {
+		Logger::Get().Error("SetInput 失败");
+	}
+
 	MagApp::Get().GetCursorManager().OnBeginFrame();
 
-	if (!_UpdateDynamicConstants()) {
-		Logger::Get().Error("_UpdateDynamicConstants 失败");
+	if (state == FrameSourceBase::UpdateState::NoUpdate && !onPrint && _IsIdleFrame()) {
+		// 后缓冲区的内容不会改变，跳过绘制和呈现。没有呈现时帧延迟对象不会再次触发，
+		// 因此下次不调用 BeginFrame
+		++_skippedPresentCount;
+		_gpuTimer->OnFrameSkipped();
+		_waitingForNextFrame = true;
+		_framePacingSchedule = {};
+
+		// 光标没有对应的消息，因此等待消息的同时定期检查
+		MsgWaitForMultipleObjectsEx(0, nullptr, IDLE_CHECK_INTERVAL, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+		return;
+	}
+
+	{
+		TraceRecorder::Scope traceScope(TraceRecorder::Track::CPU, "UpdateConstants");
+		if (!_UpdateDynamicConstants()) {
+			Logger::Get().Error("_UpdateDynamicConstants 失败");
+		}
 	}
 
 	auto d3dDC = dr.GetD3DDC();
@@ -102,14 +287,17 @@ void Renderer::Render(bool onPrint) {
 		SIZE hostSize = Win32Utils::GetSizeOfRect(MagApp::Get().GetHostWndRect());
 		if (outputSize.cx < hostSize.cx || outputSize.cy < hostSize.cy) {
 			// 存在黑边时渲染每帧前清空后缓冲区
-			ID3D11UnorderedAccessView* backBufferUAV = nullptr;
-			dr.GetUnorderedAccessView(dr.GetBackBuffer(), &backBufferUAV);
-			static const UINT black[4] = { 0,0,0,255 };
-			d3dDC->ClearUnorderedAccessViewUint(backBufferUAV, black);
+			// 最后一个效果持有后缓冲区的视图，总能从缓存中取出
+			winrt::com_ptr<ID3D11UnorderedAccessView> backBufferUAV = dr.GetUnorderedAccessView(dr.GetBackBuffer());
+			if (backBufferUAV) {
+				static const UINT black[4] = { 0,0,0,255 };
+				d3dDC->ClearUnorderedAccessViewUint(backBufferUAV.get(), black);
+			}
 		}
 	}
 
-	_gpuTimer->OnBeginEffects();
+	_latencyFrameTimes.dispatchStart = Utils::GetQPC();
+	_gpuTimer->OnBeginEffects(state == FrameSourceBase::UpdateState::NewFrame);
 
 	uint32_t idx = 0;
 	if (state == FrameSourceBase::UpdateState::NoUpdate) {
@@ -130,25 +318,67 @@ void Renderer::Render(bool onPrint) {
 
 		if (i == _effects.size()) {
 			// 只渲染最后一个 Effect 的最后一个 pass
-			_effects.back().Draw(idx, true);
+			_effects.back().Draw(*_gpuTimer, idx, true);
 		} else {
 			for (; i < _effects.size(); ++i) {
-				_effects[i].Draw(idx);
+				_effects[i].Draw(*_gpuTimer, idx);
 			}
 		}
 	} else {
 		for (auto& effect : _effects) {
-			effect.Draw(idx);
+			effect.Draw(*_gpuTimer, idx);
 		}
 	}
 
 	_gpuTimer->OnEndEffects();
+	_latencyFrameTimes.dispatchEnd = Utils::GetQPC();
+	TraceRecorder::Get().AddSpan(TraceRecorder::Track::CPU, "Dispatch",
+		_latencyFrameTimes.dispatchStart, _latencyFrameTimes.dispatchEnd);
 
 	if (_overlayDrawer) {
 		_overlayDrawer->Draw();
 	}
+	_gpuTimer->OnEndOverlay();
+
+	{
+		TraceRecorder::Scope traceScope(TraceRecorder::Track::CPU, "Present");
+		dr.EndFrame();
+	}
+	_gpuTimer->OnPresent();
+	_UpdateLatency();
+
+	if (_framePacer) {
+		_OnFramePacingEnd();
+	}
+
+	if (_adaptiveQuality) {
+		_UpdateAdaptiveQuality();
+	}
 
-	dr.EndFrame();
+	if (_timeToFirstFrame < 0) {
+		_timeToFirstFrame = std::chrono::duration<float, std::milli>(
+			std::chrono::steady_clock::now() - _initStartTime).count();
+		Logger::Get().Info(fmt::format("首帧用时 {} 毫秒", _timeToFirstFrame));
+	}
+}
+
+bool Renderer::_IsIdleFrame() const noexcept {
+	if (_overlayDrawer && _overlayDrawer->IsDrawing()) {
+		return false;
+	}
+
+	if (MagApp::Get().GetCursorManager().IsCursorChanged()) {
+		return false;
+	}
+
+	// 使用动态常量的效果每帧的输出都可能不同
+	for (const EffectDrawer& effect : _effects) {
+		if (effect.IsUseDynamic()) {
+			return false;
+		}
+	}
+
+	return true;
 }
 
 bool Renderer::IsUIVisiable() const noexcept {
@@ -159,31 +389,76 @@ void Renderer::SetUIVisibility(bool value) {
 	if (!value) {
 		if (_overlayDrawer && _overlayDrawer->IsUIVisiable()) {
 			_overlayDrawer->SetUIVisibility(false);
-			_gpuTimer->StopProfiling();
+			if (!TraceRecorder::Get().IsRecording()) {
+				_gpuTimer->StopProfiling();
+			}
 		}
 		return;
 	}
 
-	if (!_overlayDrawer) {
-		_overlayDrawer.reset(new OverlayDrawer());
-		if (!_overlayDrawer->Initialize()) {
-			_overlayDrawer.reset();
-			Logger::Get().Error("初始化 OverlayDrawer 失败");
-			return;
-		}
+	if (!_InitOverlayDrawer()) {
+		return;
 	}
 
 	if (!_overlayDrawer->IsUIVisiable()) {
 		_overlayDrawer->SetUIVisibility(true);
 
-		uint32_t passCount = 0;
-		for (const auto& effect : _effects) {
-			passCount += (uint32_t)effect.GetDesc().passes.size();
+		if (!_gpuTimer->IsProfiling()) {
+			_StartProfiling();
 		}
+	}
+}
 
-		// StartProfiling 必须在 OnBeginFrame 之前调用
-		_gpuTimer->StartProfiling(500ms, passCount);
+void Renderer::ToggleTraceRecording() {
+	TraceRecorder& traceRecorder = TraceRecorder::Get();
+	if (traceRecorder.IsRecording()) {
+		traceRecorder.Stop();
+		if (!IsUIVisiable()) {
+			_gpuTimer->StopProfiling();
+		}
+		return;
+	}
+
+	SYSTEMTIME time;
+	GetLocalTime(&time);
+	const std::wstring fileName = fmt::format(L"logs\\trace_{}{:02}{:02}_{:02}{:02}{:02}.json",
+		time.wYear, time.wMonth, time.wDay, time.wHour, time.wMinute, time.wSecond);
+	if (!traceRecorder.Start(fileName.c_str())) {
+		Logger::Get().Error("开始记录跟踪失败");
+		return;
 	}
+
+	if (!_gpuTimer->IsProfiling()) {
+		_StartProfiling();
+	}
+}
+
+void Renderer::_StartProfiling() {
+	std::vector<std::string> passNames;
+	for (const EffectDrawer& effect : _effects) {
+		const EffectDesc& desc = effect.GetDesc();
+		for (const EffectPassDesc& passDesc : desc.passes) {
+			passNames.push_back(passDesc.desc.empty() ? desc.name : StrUtils::Concat(desc.name, "/", passDesc.desc));
+		}
+	}
+
+	// StartProfiling 必须在 OnBeginFrame 之前调用
+	_gpuTimer->StartProfiling(500ms, std::move(passNames));
+}
+
+bool Renderer::_InitOverlayDrawer() {
+	if (_overlayDrawer) {
+		return true;
+	}
+
+	_overlayDrawer.reset(new OverlayDrawer());
+	if (!_overlayDrawer->Initialize(_overlayFonts)) {
+		_overlayDrawer.reset();
+		Logger::Get().Error("初始化 OverlayDrawer 失败");
+		return false;
+	}
+
+	return true;
 }
 
 bool CheckForeground(HWND hwndForeground) {
@@ -275,7 +550,116 @@ int Renderer::_CheckSrcState() {
 	return 0;
 }
 
-static bool CompileEffect(bool isLastEffect, const EffectOption& option, EffectDesc& result) {
+bool Renderer::_OnSrcWndRectChanged() {
+	if (!MagApp::Get().IsHostWndRectValid()) {
+		Logger::Get().Info("缩放窗口需要重新创建");
+		return false;
+	}
+
+	FrameSourceBase& frameSource = MagApp::Get().GetFrameSource();
+	ID3D11Texture2D* oldInput = frameSource.GetOutput();
+	if (!frameSource.OnSrcWndRectChanged()) {
+		Logger::Get().Info("帧源无法就地更新");
+		return false;
+	}
+
+	if (!GetWindowRect(MagApp::Get().GetHwndSrc(), &_srcWndRect)) {
+		Logger::Get().Win32Error("GetWindowRect 失败");
+		return false;
+	}
+
+	if (frameSource.GetOutput() == oldInput) {
+		// 帧源的输出不变，如只移动了源窗口
+		return true;
+	}
+
+	bool success = true;
+	int duration = Utils::Measure([&]() {
+		success = _ResizeEffects();
+	});
+
+	if (!success) {
+		Logger::Get().Error("_ResizeEffects 失败");
+		return false;
+	}
+
+	// 尺寸改变的纹理已放回纹理池，不再需要
+	MagApp::Get().GetDeviceResources().TrimCachedResources();
+
+	const RECT& srcFrameRect = frameSource.GetSrcFrameRect();
+	Logger::Get().Info(fmt::format("源窗口尺寸改变为 {}x{}，就地调整效果用时 {} 毫秒",
+		srcFrameRect.right - srcFrameRect.left, srcFrameRect.bottom - srcFrameRect.top, duration / 1000.0f));
+	return true;
+}
+
+bool Renderer::_ResizeEffects() {
+	const size_t effectCount = MagApp::Get().GetOptions().effects.size();
+	// 存在降采样效果时它位于最后
+	const bool hasDownscalingEffect = _effects.size() > effectCount;
+
+	ID3D11Texture2D* effectInput = MagApp::Get().GetFrameSource().GetOutput();
+	for (size_t i = 0; i < _effects.size(); ++i) {
+		bool isLastEffect = i == _effects.size() - 1;
+
+		if (!_effects[i].Resize(
+			effectInput,
+			isLastEffect ? &_outputRect : nullptr,
+			isLastEffect ? &_virtualOutputRect : nullptr
+		)) {
+			Logger::Get().Error(fmt::format("调整效果#{} ({}) 的尺寸失败", i, _effects[i].GetDesc().name));
+			return false;
+		}
+
+		effectInput = _effects[i].GetOutputTexture();
+	}
+
+	// 是否需要降采样可能随尺寸改变，这时效果链的结构不同，需重新构建
+	if (!MagApp::Get().GetOptions().downscalingEffect.name.empty()) {
+		const SIZE hostSize = Win32Utils::GetSizeOfRect(MagApp::Get().GetHostWndRect());
+
+		SIZE outputSize{};
+		if (hasDownscalingEffect) {
+			D3D11_TEXTURE2D_DESC desc;
+			_effects[effectCount - 1].GetOutputTexture()->GetDesc(&desc);
+			outputSize = { (LONG)desc.Width, (LONG)desc.Height };
+		} else {
+			outputSize = Win32Utils::GetSizeOfRect(_virtualOutputRect);
+		}
+
+		if ((outputSize.cx > hostSize.cx || outputSize.cy > hostSize.cy) != hasDownscalingEffect) {
+			Logger::Get().Info("降采样需求改变");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// 由缩放选项决定的编译标志。编译可能在后台线程进行，因此应在渲染线程读取后传入
+static uint32_t GetOptionsCompileFlags() noexcept {
+	const MagOptions& options = MagApp::Get().GetOptions();
+
+	uint32_t compileFlags = 0;
+	if (options.IsDisableEffectCache()) {
+		compileFlags |= EffectCompilerFlags::NoCache;
+	}
+	if (options.IsSaveEffectSources()) {
+		compileFlags |= EffectCompilerFlags::SaveSources;
+	}
+	if (options.IsWarningsAreErrors()) {
+		compileFlags |= EffectCompilerFlags::WarningsAreErrors;
+	}
+	return compileFlags;
+}
+
+// errorMsg 用于在覆盖层中显示
+static bool CompileEffect(
+	bool isLastEffect,
+	const EffectOption& option,
+	EffectDesc& result,
+	uint32_t compileFlag,
+	std::string* errorMsg = nullptr
+) {
 	result.name = StrUtils::UTF16ToUTF8(option.name);
 	// 将文件夹分隔符统一为 '\'
 	for (char& c : result.name) {
@@ -293,137 +677,247 @@ static bool CompileEffect(bool isLastEffect, const EffectOption& option, EffectD
 		result.flags |= EffectFlags::FP16;
 	}
 
-	uint32_t compileFlag = 0;
-	MagOptions& options = MagApp::Get().GetOptions();
-	if (options.IsDisableEffectCache()) {
-		compileFlag |= EffectCompilerFlags::NoCache;
-	}
-	if (options.IsSaveEffectSources()) {
-		compileFlag |= EffectCompilerFlags::SaveSources;
-	}
-	if (options.IsWarningsAreErrors()) {
-		compileFlag |= EffectCompilerFlags::WarningsAreErrors;
-	}
-
+	std::string compilerMsg;
 	bool success = true;
 	int duration = Utils::Measure([&]() {
-		success = !EffectCompiler::Compile(result, compileFlag, &option.parameters);
+		success = !EffectCompiler::Compile(result, compileFlag, &option.parameters, errorMsg ? &compilerMsg : nullptr);
 	});
 
 	if (success) {
 		Logger::Get().Info(fmt::format("编译 {}.hlsl 用时 {} 毫秒", StrUtils::UTF16ToUTF8(option.name), duration / 1000.0f));
-	} else {
+	} else if (!(compileFlag & EffectCompilerFlags::CacheOnly)) {
 		Logger::Get().Error(StrUtils::Concat("编译 ", StrUtils::UTF16ToUTF8(option.name), ".hlsl 失败"));
+
+		if (errorMsg) {
+			*errorMsg = StrUtils::Concat(StrUtils::UTF16ToUTF8(option.name), ".hlsl");
+			if (!compilerMsg.empty()) {
+				errorMsg->append("\n").append(compilerMsg);
+			}
+		}
 	}
 	return success;
 }
 
-bool Renderer::_BuildEffects() {
-	const std::vector<EffectOption>& effectsOption = MagApp::Get().GetOptions().effects;
-	uint32_t effectCount = (int)effectsOption.size();
-	if (effectCount == 0) {
-		return false;
+// 热重载时改变的效果需跳过缓存，因为缓存不检查包含的文件
+static uint32_t GetExtraCompileFlag(
+	const EffectOption& option,
+	const phmap::flat_hash_set<std::wstring>* changedEffects
+) noexcept {
+	return changedEffects && changedEffects->contains(option.name) ? EffectCompilerFlags::RefreshCache : 0;
+}
+
+static void JoinErrorMsgs(std::span<const std::string> errorMsgs, std::string& result) noexcept {
+	result.clear();
+	for (const std::string& msg : errorMsgs) {
+		if (msg.empty()) {
+			continue;
+		}
+
+		if (!result.empty()) {
+			result.push_back('\n');
+		}
+		result.append(msg);
+	}
+}
+
+// 并行编译所有效果。fallbackEffectsOption 不为空时，内联参数的效果如果未命中缓存则改为
+// 编译不内联参数的版本以免阻塞，fallbackEffectsOption 中保存实际使用的选项，都命中时为空
+static bool CompileEffects(
+	const std::vector<EffectOption>& effectsOption,
+	std::vector<EffectDesc>& effectDescs,
+	uint32_t compileFlags,
+	std::vector<EffectOption>* fallbackEffectsOption = nullptr,
+	const phmap::flat_hash_set<std::wstring>* changedEffects = nullptr,
+	std::string* errorMsg = nullptr
+) {
+	const uint32_t effectCount = (uint32_t)effectsOption.size();
+	effectDescs.resize(effectCount);
+
+	std::vector<std::string> errorMsgs(errorMsg ? effectCount : 0);
+
+	if (fallbackEffectsOption) {
+		*fallbackEffectsOption = effectsOption;
 	}
 
-	// 并行编译所有效果
-	std::vector<EffectDesc> effectDescs(effectsOption.size());
 	std::atomic<bool> anyFailure;
+	std::atomic<bool> anyFallback;
 
 	int duration = Utils::Measure([&]() {
 		Win32Utils::RunParallel([&](uint32_t id) {
-			if (!CompileEffect(id == effectCount - 1, effectsOption[id], effectDescs[id])) {
+			const bool isLastEffect = id == effectCount - 1;
+			const EffectOption& option = effectsOption[id];
+
+			if (fallbackEffectsOption && (option.flags & EffectOptionFlags::InlineParams)) {
+				if (CompileEffect(isLastEffect, option, effectDescs[id], compileFlags | EffectCompilerFlags::CacheOnly)) {
+					return;
+				}
+
+				// 每个线程只修改自己的元素
+				EffectOption& fallbackOption = (*fallbackEffectsOption)[id];
+				fallbackOption.flags &= ~EffectOptionFlags::InlineParams;
+				anyFallback.store(true, std::memory_order_relaxed);
+
+				effectDescs[id] = {};
+				if (!CompileEffect(isLastEffect, fallbackOption, effectDescs[id], compileFlags)) {
+					anyFailure.store(true, std::memory_order_relaxed);
+				}
+				return;
+			}
+
+			if (!CompileEffect(isLastEffect, option, effectDescs[id],
+				compileFlags | GetExtraCompileFlag(option, changedEffects), errorMsg ? &errorMsgs[id] : nullptr)
+			) {
 				anyFailure.store(true, std::memory_order_relaxed);
 			}
 		}, effectCount);
 	});
 
 	if (anyFailure.load(std::memory_order_relaxed)) {
+		if (errorMsg) {
+			JoinErrorMsgs(errorMsgs, *errorMsg);
+		}
 		return false;
 	}
 
+	if (fallbackEffectsOption && !anyFallback.load(std::memory_order_relaxed)) {
+		fallbackEffectsOption->clear();
+	}
+
 	if (effectCount > 1) {
 		Logger::Get().Info(fmt::format("编译着色器总计用时 {} 毫秒", duration / 1000.0f));
 	}
 
+	return true;
+}
+
+static EffectOption GetDownscalingEffectOption(const DownscalingEffect& downscalingEffect) {
+	EffectOption result;
+	result.name = downscalingEffect.name;
+	result.parameters = downscalingEffect.parameters;
+	result.scalingType = ScalingType::Fit;
+	result.flags = EffectOptionFlags::InlineParams;	// 内联参数
+	return result;
+}
+
+// 需降采样时最后一个效果不再是效果链的最后一个，需重新编译
+struct DownscalingEffectDescs {
+	EffectDesc lastEffectDesc;
+	EffectDesc downscalingEffectDesc;
+};
+
+static bool CompileDownscalingEffects(
+	const EffectOption& lastEffectOption,
+	const EffectOption& downscalingEffectOption,
+	DownscalingEffectDescs& result,
+	uint32_t compileFlags,
+	const phmap::flat_hash_set<std::wstring>* changedEffects = nullptr,
+	std::string* errorMsg = nullptr
+) {
+	std::atomic<bool> anyFailure;
+	std::array<std::string, 2> errorMsgs;
+
+	// 在分离光标渲染逻辑后这里可优化
+	int duration = Utils::Measure([&]() {
+		Win32Utils::RunParallel([&](uint32_t id) {
+			const EffectOption& option = id == 0 ? lastEffectOption : downscalingEffectOption;
+			if (!CompileEffect(
+				id == 1,
+				option,
+				id == 0 ? result.lastEffectDesc : result.downscalingEffectDesc,
+				compileFlags | GetExtraCompileFlag(option, changedEffects),
+				errorMsg ? &errorMsgs[id] : nullptr
+			)) {
+				anyFailure.store(true, std::memory_order_relaxed);
+			}
+		}, 2);
+	});
+
+	if (anyFailure.load(std::memory_order_relaxed)) {
+		if (errorMsg) {
+			JoinErrorMsgs(errorMsgs, *errorMsg);
+		}
+		return false;
+	}
+
+	Logger::Get().Info(fmt::format("编译降采样着色器用时 {} 毫秒", duration / 1000.0f));
+	return true;
+}
+
+// 初始化效果链。需要降采样时如果 downscalingEffectDescs 为空则在此编译
+static bool InitializeEffects(
+	const std::vector<EffectOption>& effectsOption,
+	const DownscalingEffect& downscalingEffect,
+	const std::vector<EffectDesc>& effectDescs,
+	DownscalingEffectDescs* downscalingEffectDescs,
+	std::vector<EffectDrawer>& effects,
+	RECT& outputRect,
+	RECT& virtualOutputRect
+) {
+	const uint32_t effectCount = (uint32_t)effectsOption.size();
+
+	DeviceResources& dr = MagApp::Get().GetDeviceResources();
 	ID3D11Texture2D* effectInput = MagApp::Get().GetFrameSource().GetOutput();
 
-	DownscalingEffect& downscalingEffect = MagApp::Get().GetOptions().downscalingEffect;
 	if (!downscalingEffect.name.empty()) {
-		_effects.reserve(effectsOption.size() + 1);
+		effects.reserve(effectsOption.size() + 1);
 	}
-	_effects.resize(effectsOption.size());
+	effects.resize(effectsOption.size());
 
 	for (uint32_t i = 0; i < effectCount; ++i) {
 		bool isLastEffect = i == effectCount - 1;
 
-		if (!_effects[i].Initialize(
-			effectDescs[i], effectsOption[i], effectInput,
-			isLastEffect ? &_outputRect : nullptr,
-			isLastEffect ? &_virtualOutputRect : nullptr
+		if (!effects[i].Initialize(
+			dr, effectDescs[i], effectsOption[i], effectInput,
+			isLastEffect ? &outputRect : nullptr,
+			isLastEffect ? &virtualOutputRect : nullptr
 		)) {
 			Logger::Get().Error(fmt::format("初始化效果#{} ({}) 失败", i, StrUtils::UTF16ToUTF8(effectsOption[i].name)));
 			return false;
 		}
 
-		effectInput = _effects[i].GetOutputTexture();
+		effectInput = effects[i].GetOutputTexture();
 	}
 	
 	if (!downscalingEffect.name.empty()) {
 		const SIZE hostSize = Win32Utils::GetSizeOfRect(MagApp::Get().GetHostWndRect());
-		const SIZE outputSize = Win32Utils::GetSizeOfRect(_virtualOutputRect);
+		const SIZE outputSize = Win32Utils::GetSizeOfRect(virtualOutputRect);
 		if (outputSize.cx > hostSize.cx || outputSize.cy > hostSize.cy) {
 			// 需降采样
-			EffectOption downscalingEffectOption;
-			downscalingEffectOption.name = downscalingEffect.name;
-			downscalingEffectOption.parameters = downscalingEffect.parameters;
-			downscalingEffectOption.scalingType = ScalingType::Fit;
-			downscalingEffectOption.flags = EffectOptionFlags::InlineParams;	// 内联参数
-
-			EffectDesc downscalingEffectDesc;
-
-			// 最后一个效果需重新编译
-			// 在分离光标渲染逻辑后这里可优化
-			duration = Utils::Measure([&]() {
-				Win32Utils::RunParallel([&](uint32_t id) {
-					if (!CompileEffect(
-						id == 1,
-						id == 0 ? effectsOption.back() : downscalingEffectOption,
-						id == 0 ? effectDescs.back() : downscalingEffectDesc
-					)) {
-						anyFailure.store(true, std::memory_order_relaxed);
-					}
-				}, 2);
-			});
-
-			if (anyFailure.load(std::memory_order_relaxed)) {
-				return false;
+			EffectOption downscalingEffectOption = GetDownscalingEffectOption(downscalingEffect);
+
+			DownscalingEffectDescs compiledDescs;
+			if (!downscalingEffectDescs) {
+				if (!CompileDownscalingEffects(effectsOption.back(),
+					downscalingEffectOption, compiledDescs, GetOptionsCompileFlags())
+				) {
+					return false;
+				}
+				downscalingEffectDescs = &compiledDescs;
 			}
-			
-			Logger::Get().Info(fmt::format("编译降采样着色器用时 {} 毫秒", duration / 1000.0f));
 
-			_effects.pop_back();
-			if (_effects.empty()) {
+			effects.pop_back();
+			if (effects.empty()) {
 				effectInput = MagApp::Get().GetFrameSource().GetOutput();
 			} else {
-				effectInput = _effects.back().GetOutputTexture();
+				effectInput = effects.back().GetOutputTexture();
 			}
 
-			_effects.resize(_effects.size() + 2);
+			effects.resize(effects.size() + 2);
 
 			// 重新构建最后一个效果
-			const size_t originLastEffectIdx = _effects.size() - 2;
-			if (!_effects[originLastEffectIdx].Initialize(effectDescs.back(), effectsOption.back(),
-				effectInput, nullptr, nullptr)
+			const size_t originLastEffectIdx = effects.size() - 2;
+			if (!effects[originLastEffectIdx].Initialize(dr, downscalingEffectDescs->lastEffectDesc,
+				effectsOption.back(), effectInput, nullptr, nullptr)
 			) {
 				Logger::Get().Error(fmt::format("初始化效果#{} ({}) 失败",
 					originLastEffectIdx, StrUtils::UTF16ToUTF8(effectsOption.back().name)));
 				return false;
 			}
-			effectInput = _effects[originLastEffectIdx].GetOutputTexture();
+			effectInput = effects[originLastEffectIdx].GetOutputTexture();
 
 			// 构建降采样效果
-			if (!_effects.back().Initialize(downscalingEffectDesc, downscalingEffectOption,
-				effectInput, &_outputRect, &_virtualOutputRect
+			if (!effects.back().Initialize(dr, downscalingEffectDescs->downscalingEffectDesc,
+				downscalingEffectOption, effectInput, &outputRect, &virtualOutputRect
 			)) {
 				Logger::Get().Error(fmt::format("初始化降采样效果 ({}) 失败",
 					StrUtils::UTF16ToUTF8(downscalingEffect.name)));
@@ -434,6 +928,332 @@ bool Renderer::_BuildEffects() {
 	return true;
 }
 
+bool Renderer::_BuildEffects() {
+	const MagOptions& options = MagApp::Get().GetOptions();
+	if (options.effects.empty()) {
+		return false;
+	}
+
+	// 禁用缓存时无法知道内联参数的版本能否很快得到
+	std::vector<EffectOption> fallbackEffectsOption;
+	std::vector<EffectDesc> effectDescs;
+	if (!CompileEffects(options.effects, effectDescs, GetOptionsCompileFlags(),
+		options.IsDisableEffectCache() ? nullptr : &fallbackEffectsOption)
+	) {
+		return false;
+	}
+
+	if (fallbackEffectsOption.empty()) {
+		return InitializeEffects(options.effects, options.downscalingEffect,
+			effectDescs, nullptr, _effects, _outputRect, _virtualOutputRect);
+	}
+
+	// 先使用不内联参数的版本，内联参数的版本在后台编译，完成后替换
+	if (!InitializeEffects(fallbackEffectsOption, options.downscalingEffect,
+		effectDescs, nullptr, _effects, _outputRect, _virtualOutputRect)
+	) {
+		return false;
+	}
+
+	Logger::Get().Info("内联参数的效果未命中缓存，先使用不内联参数的版本");
+	_isFallbackEffects = true;
+	_StartCompileEffects(std::vector<EffectOption>(options.effects), DownscalingEffect(options.downscalingEffect));
+	return true;
+}
+
+struct Renderer::_PendingEffects {
+	std::vector<EffectOption> effects;
+	DownscalingEffect downscalingEffect;
+
+	std::vector<EffectDesc> effectDescs;
+	std::optional<DownscalingEffectDescs> downscalingEffectDescs;
+
+	// 热重载时改变的效果
+	phmap::flat_hash_set<std::wstring> changedEffects;
+	// 在渲染线程读取，编译线程不访问 MagOptions
+	uint32_t compileFlags = 0;
+	// 编译失败时在覆盖层中显示
+	std::string errorMsg;
+
+	// 替换完成后被替换的效果，见 Renderer::_downgradedEffects
+	std::vector<std::pair<uint32_t, std::wstring>> downgradedEffects;
+	// 由自适应画质发起
+	bool isAdaptiveQuality = false;
+
+	bool success = false;
+	// 由编译线程设置
+	std::atomic<bool> isCompleted = false;
+};
+
+void Renderer::UpdateEffects(std::vector<EffectOption>&& effects, DownscalingEffect&& downscalingEffect) {
+	if (effects.empty()) {
+		return;
+	}
+
+	if (_UpdateEffectsInPlace(effects, downscalingEffect)) {
+		// 正在编译的效果链已过时
+		_pendingEffects.reset();
+
+		MagOptions& options = MagApp::Get().GetOptions();
+		options.effects = std::move(effects);
+		options.downscalingEffect = std::move(downscalingEffect);
+
+		if (_adaptiveQuality) {
+			// 缩放选项改变后之前的用时不再准确
+			_adaptiveQuality->Reset();
+		}
+
+		if (_isFallbackEffects) {
+			// 按新的选项重新编译内联参数的版本
+			_StartCompileEffects(std::vector<EffectOption>(options.effects), DownscalingEffect(options.downscalingEffect));
+		}
+		return;
+	}
+
+	_StartCompileEffects(std::move(effects), std::move(downscalingEffect));
+	// 新的效果链使用用户选择的效果
+	_pendingEffects->downgradedEffects.clear();
+}
+
+void Renderer::_StartCompileEffects(
+	std::vector<EffectOption>&& effects,
+	DownscalingEffect&& downscalingEffect,
+	phmap::flat_hash_set<std::wstring>&& changedEffects
+) {
+	if (_pendingEffects) {
+		// 之前未完成的编译结果将被丢弃，但它要重新加载的效果仍需重新加载
+		for (const std::wstring& effectName : _pendingEffects->changedEffects) {
+			changedEffects.insert(effectName);
+		}
+	}
+
+	_pendingEffects = std::make_shared<_PendingEffects>();
+	_pendingEffects->effects = std::move(effects);
+	_pendingEffects->downscalingEffect = std::move(downscalingEffect);
+	_pendingEffects->changedEffects = std::move(changedEffects);
+	_pendingEffects->compileFlags = GetOptionsCompileFlags();
+	_pendingEffects->downgradedEffects = _downgradedEffects;
+	_CompileEffectsAsync(_pendingEffects, MagApp::Get().GetHwndHost());
+}
+
+void Renderer::_ReloadChangedEffects() {
+	const phmap::flat_hash_set<std::wstring> changedFiles = _effectsWatcher->TakeChangedFiles();
+	if (changedFiles.empty()) {
+		return;
+	}
+
+	// 正在后台编译时基于它的选项
+	const MagOptions& options = MagApp::Get().GetOptions();
+	std::vector<EffectOption> effects = _pendingEffects ? _pendingEffects->effects : options.effects;
+	DownscalingEffect downscalingEffect = _pendingEffects ? _pendingEffects->downscalingEffect : options.downscalingEffect;
+
+	phmap::flat_hash_set<std::wstring> changedEffects;
+	for (const EffectOption& effect : effects) {
+		if (EffectsWatcher::IsEffectChanged(effect.name, changedFiles)) {
+			changedEffects.insert(effect.name);
+		}
+	}
+	if (!downscalingEffect.name.empty() && EffectsWatcher::IsEffectChanged(downscalingEffect.name, changedFiles)) {
+		changedEffects.insert(downscalingEffect.name);
+	}
+
+	if (changedEffects.empty()) {
+		return;
+	}
+
+	Logger::Get().Info(fmt::format("{} 个效果已改变，重新编译", changedEffects.size()));
+	_StartCompileEffects(std::move(effects), std::move(downscalingEffect), std::move(changedEffects));
+}
+
+void Renderer::_ShowEffectsError(std::string&& errorMsg) {
+	if (!_InitOverlayDrawer()) {
+		return;
+	}
+
+	_overlayDrawer->ShowEffectsError(std::move(errorMsg));
+	// 立即显示，即使源窗口没有新帧
+	_isEffectsChanged = true;
+}
+
+// 效果链的结构不变时只需更新参数和缩放选项
+bool Renderer::_UpdateEffectsInPlace(
+	const std::vector<EffectOption>& effects,
+	const DownscalingEffect& downscalingEffect
+) {
+	const MagOptions& options = MagApp::Get().GetOptions();
+	const std::vector<EffectOption>& curEffects = options.effects;
+	if (effects.size() != curEffects.size()) {
+		return false;
+	}
+
+	// 降采样效果总是内联参数
+	if (downscalingEffect.name != options.downscalingEffect.name
+		|| (!downscalingEffect.name.empty() && downscalingEffect.parameters != options.downscalingEffect.parameters)) {
+		return false;
+	}
+
+	bool isScalingChanged = false;
+	for (size_t i = 0; i < effects.size(); ++i) {
+		const EffectOption& effect = effects[i];
+		const EffectOption& curEffect = curEffects[i];
+
+		if (effect.name != curEffect.name || effect.flags != curEffect.flags) {
+			return false;
+		}
+
+		// 内联参数改变需要重新编译
+		if ((effect.flags & EffectOptionFlags::InlineParams) && effect.parameters != curEffect.parameters) {
+			return false;
+		}
+
+		if (effect.scalingType != curEffect.scalingType || effect.scale != curEffect.scale) {
+			isScalingChanged = true;
+		}
+	}
+
+	for (size_t i = 0; i < effects.size(); ++i) {
+		if (!(effects[i].flags & EffectOptionFlags::InlineParams)
+			&& effects[i].parameters != curEffects[i].parameters
+			&& !_effects[i].UpdateParameters(effects[i])
+		) {
+			Logger::Get().Error(fmt::format("更新效果#{} ({}) 的参数失败", i, _effects[i].GetDesc().name));
+			return false;
+		}
+
+		_effects[i].SetScaling(effects[i].scalingType, effects[i].scale);
+	}
+
+	if (isScalingChanged) {
+		if (!_ResizeEffects()) {
+			Logger::Get().Error("_ResizeEffects 失败");
+			return false;
+		}
+
+		MagApp::Get().GetDeviceResources().TrimCachedResources();
+	}
+
+	// 使用当前帧重新渲染
+	_isEffectsChanged = true;
+	Logger::Get().Info("已就地更新效果参数");
+	return true;
+}
+
+winrt::fire_and_forget Renderer::_CompileEffectsAsync(std::shared_ptr<_PendingEffects> pendingEffects, HWND hwndHost) {
+	co_await winrt::resume_background();
+
+	bool success = CompileEffects(pendingEffects->effects, pendingEffects->effectDescs,
+		pendingEffects->compileFlags, nullptr, &pendingEffects->changedEffects, &pendingEffects->errorMsg);
+
+	if (success && !pendingEffects->downscalingEffect.name.empty()) {
+		// 是否需要降采样取决于初始化的结果，因此提前编译
+		success = CompileDownscalingEffects(
+			pendingEffects->effects.back(),
+			GetDownscalingEffectOption(pendingEffects->downscalingEffect),
+			pendingEffects->downscalingEffectDescs.emplace(),
+			pendingEffects->compileFlags,
+			&pendingEffects->changedEffects,
+			&pendingEffects->errorMsg
+		);
+	}
+
+	pendingEffects->success = success;
+	pendingEffects->isCompleted.store(true, std::memory_order_release);
+
+	// 唤醒可能正在等待新帧的缩放线程
+	PostMessage(hwndHost, WM_NULL, 0, 0);
+}
+
+void Renderer::_SwapPendingEffects() {
+	std::shared_ptr<_PendingEffects> pendingEffects = std::move(_pendingEffects);
+	if (!pendingEffects->success && pendingEffects->isAdaptiveQuality) {
+		// 不是用户的操作，无需显示错误
+		Logger::Get().Error("自适应画质编译效果失败，停止自适应画质");
+		_adaptiveQuality.reset();
+		return;
+	}
+
+	if (!pendingEffects->success) {
+		Logger::Get().Error("编译新的效果链失败，继续使用当前效果链");
+		_ShowEffectsError(std::move(pendingEffects->errorMsg));
+		return;
+	}
+
+	std::vector<EffectDrawer> effects;
+	RECT outputRect{};
+	RECT virtualOutputRect{};
+
+	// 替换成功后旧的效果链将被释放，检查显存预算时不计入
+	GPUMemoryTracker& memoryTracker = MagApp::Get().GetDeviceResources().GetMemoryTracker();
+	memoryTracker.SetReleasingBytes(memoryTracker.GetOwnerBytes(GPUMemoryOwner::Effect));
+	// 丢弃之前的分配失败留下的报告
+	memoryTracker.TakeBudgetReport();
+
+	bool success = true;
+	int duration = Utils::Measure([&]() {
+		success = InitializeEffects(
+			pendingEffects->effects,
+			pendingEffects->downscalingEffect,
+			pendingEffects->effectDescs,
+			pendingEffects->downscalingEffectDescs ? &*pendingEffects->downscalingEffectDescs : nullptr,
+			effects,
+			outputRect,
+			virtualOutputRect
+		);
+	});
+
+	memoryTracker.SetReleasingBytes(0);
+
+	if (!success) {
+		Logger::Get().Error("初始化新的效果链失败，继续使用当前效果链");
+		if (pendingEffects->isAdaptiveQuality) {
+			_adaptiveQuality.reset();
+		} else {
+			// 超出显存预算时显示各部分的占用
+			_ShowEffectsError(memoryTracker.TakeBudgetReport());
+		}
+		return;
+	}
+
+	// 旧的效果链的纹理被放回纹理池
+	_effects = std::move(effects);
+	_outputRect = outputRect;
+	_virtualOutputRect = virtualOutputRect;
+	MagApp::Get().GetDeviceResources().TrimCachedResources();
+
+	MagOptions& options = MagApp::Get().GetOptions();
+	options.effects = std::move(pendingEffects->effects);
+	options.downscalingEffect = std::move(pendingEffects->downscalingEffect);
+
+	if (_adaptiveQuality) {
+		_downgradedEffects = std::move(pendingEffects->downgradedEffects);
+		_FindCheaperEffects();
+		_adaptiveQuality->Reset();
+	}
+
+	if (_overlayDrawer) {
+		_overlayDrawer->OnEffectsChanged();
+		_overlayDrawer->HideEffectsError();
+	}
+
+	if (_gpuTimer->IsProfiling()) {
+		// 通道数可能改变
+		_gpuTimer->StopProfiling();
+		_StartProfiling();
+	}
+
+	_isEffectsChanged = true;
+	Logger::Get().Info(fmt::format("已替换效果链，初始化用时 {} 毫秒", duration / 1000.0f));
+
+	if (_isFallbackEffects) {
+		_isFallbackEffects = false;
+
+		const float timeToOptimal = std::chrono::duration<float, std::milli>(
+			std::chrono::steady_clock::now() - _initStartTime).count();
+		Logger::Get().Info(fmt::format("首帧用时 {} 毫秒，替换为内联参数的版本用时 {} 毫秒",
+			_timeToFirstFrame, timeToOptimal));
+	}
+}
+
 bool Renderer::_UpdateDynamicConstants() {
 	// cbuffer __CB1 : register(b0) {
 	//     int4 __cursorRect;
@@ -441,18 +1261,24 @@ bool Renderer::_UpdateDynamicConstants() {
 	//     uint2 __cursorPos;
 	//     uint __cursorType;
 	//     uint __frameCount;
+	//     float2 __cursorUVOffset;
 	// };
 
 	CursorManager& cursorManager = MagApp::Get().GetCursorManager();
+	ID3D11Texture2D* cursorTex = nullptr;
+	CursorManager::CursorType cursorType = CursorManager::CursorType::Color;
+	// 光标在图集中的位置
+	RECT cursorTexRect{};
 	if (cursorManager.HasCursor() && !(MagApp::Get().GetOptions().Is3DGameMode() && IsUIVisiable())) {
-		const POINT* pos = cursorManager.GetCursorPos();
-		const CursorManager::CursorInfo* ci = cursorManager.GetCursorInfo();
-
-		ID3D11Texture2D* cursorTex;
-		CursorManager::CursorType cursorType = CursorManager::CursorType::Color;
-		if (!cursorManager.GetCursorTexture(&cursorTex, cursorType)) {
+		if (!cursorManager.GetCursorTexture(&cursorTex, cursorType, cursorTexRect)) {
 			Logger::Get().Error("GetCursorTexture 失败");
+			cursorTex = nullptr;
 		}
+	}
+
+	if (cursorTex) {
+		const POINT* pos = cursorManager.GetCursorPos();
+		const CursorManager::CursorInfo* ci = cursorManager.GetCursorInfo();
 		assert(pos && ci);
 
 		float cursorScaling = (float)MagApp::Get().GetOptions().cursorScaling;
@@ -473,13 +1299,21 @@ bool Renderer::_UpdateDynamicConstants() {
 		_dynamicConstants[2].intVal = _dynamicConstants[0].intVal + cursorSize.cx;
 		_dynamicConstants[3].intVal = _dynamicConstants[1].intVal + cursorSize.cy;
 
-		_dynamicConstants[4].floatVal = 1.0f / cursorSize.cx;
-		_dynamicConstants[5].floatVal = 1.0f / cursorSize.cy;
+		// 将输出上的位置映射到图集中的 UV
+		D3D11_TEXTURE2D_DESC atlasDesc;
+		cursorTex->GetDesc(&atlasDesc);
+		const SIZE cursorTexSize = Win32Utils::GetSizeOfRect(cursorTexRect);
+
+		_dynamicConstants[4].floatVal = (float)cursorTexSize.cx / (cursorSize.cx * atlasDesc.Width);
+		_dynamicConstants[5].floatVal = (float)cursorTexSize.cy / (cursorSize.cy * atlasDesc.Height);
 
 		_dynamicConstants[6].uintVal = pos->x;
 		_dynamicConstants[7].uintVal = pos->y;
 
 		_dynamicConstants[8].uintVal = (uint32_t)cursorType;
+
+		_dynamicConstants[10].floatVal = (float)cursorTexRect.left / atlasDesc.Width;
+		_dynamicConstants[11].floatVal = (float)cursorTexRect.top / atlasDesc.Height;
 	} else {
 		_dynamicConstants[0].intVal = INT_MAX;
 		_dynamicConstants[1].intVal = INT_MAX;
@@ -506,4 +1340,234 @@ bool Renderer::_UpdateDynamicConstants() {
 	return true;
 }
 
+bool Renderer::_InitFramePacing() noexcept {
+	const MagOptions& options = MagApp::Get().GetOptions();
+	if (!options.IsVSync() || options.IsTripleBuffering()) {
+		// 不限制帧率或允许额外的延迟时无需调度
+		Logger::Get().Info("未启用垂直同步或启用了三重缓冲，不进行帧调度");
+		return true;
+	}
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	_qpcFrequency = frequency.QuadPart;
+
+	// 高精度计时器从 Win10 v1803 开始提供
+	_hFramePacingTimer.reset(CreateWaitableTimerEx(
+		nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS));
+	if (!_hFramePacingTimer) {
+		_hFramePacingTimer.reset(CreateWaitableTimerEx(nullptr, nullptr, 0, TIMER_ALL_ACCESS));
+		if (!_hFramePacingTimer) {
+			Logger::Get().Win32Error("CreateWaitableTimerEx 失败");
+			return false;
+		}
+	}
+
+	_framePacer = std::make_unique<FramePacer>();
+	_gpuTimer->EnableFrameTiming();
+	return true;
+}
+
+void Renderer::_WaitForFramePacing() noexcept {
+	DWM_TIMING_INFO timingInfo{};
+	timingInfo.cbSize = sizeof(timingInfo);
+	HRESULT hr = DwmGetCompositionTimingInfo(NULL, &timingInfo);
+	if (FAILED(hr)) {
+		Logger::Get().ComError("DwmGetCompositionTimingInfo 失败，停止帧调度", hr);
+		_framePacer.reset();
+		return;
+	}
+
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+
+	const int64_t margin = int64_t(MagApp::Get().GetOptions().framePacingMargin * _qpcFrequency / 1000);
+	_framePacingSchedule = _framePacer->GetSchedule(
+		now.QuadPart, (int64_t)timingInfo.qpcVBlank, (int64_t)timingInfo.qpcRefreshPeriod, margin);
+
+	if (_framePacingSchedule.wakeTime <= now.QuadPart) {
+		return;
+	}
+
+	// 负值表示相对时间，单位为 100 纳秒
+	LARGE_INTEGER dueTime;
+	dueTime.QuadPart = -(_framePacingSchedule.wakeTime - now.QuadPart) * 10'000'000 / _qpcFrequency;
+	if (!SetWaitableTimerEx(_hFramePacingTimer.get(), &dueTime, 0, nullptr, nullptr, nullptr, 0)) {
+		Logger::Get().Win32Error("SetWaitableTimerEx 失败");
+		return;
+	}
+
+	WaitForSingleObject(_hFramePacingTimer.get(), INFINITE);
+}
+
+void Renderer::_OnFramePacingEnd() noexcept {
+	if (_framePacingSchedule.deadline == 0) {
+		return;
+	}
+
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+
+	// 提交完成后 GPU 仍需执行效果链，使用最近得到的 GPU 用时估计完成的时刻
+	int64_t endTime = now.QuadPart;
+	const float gpuTime = _gpuTimer->GetFrameGPUTime();
+	if (gpuTime > 0) {
+		endTime += int64_t(gpuTime * _qpcFrequency / 1000);
+	}
+
+	_framePacer->AddSample(_framePacingSchedule, _frameStartTime, endTime);
+	_framePacingSchedule = {};
+}
+
+void Renderer::_UpdateLatency() noexcept {
+	IDXGISwapChain4* swapChain = MagApp::Get().GetDeviceResources().GetSwapChain();
+
+	if (_latencyFrameTimes.update != 0) {
+		_latencyFrameTimes.present = Utils::GetQPC();
+
+		UINT presentCount = 0;
+		if (_isFrameStatisticsAvailable && FAILED(swapChain->GetLastPresentCount(&presentCount))) {
+			presentCount = 0;
+		}
+
+		_latencyTracker->OnPresent(_latencyFrameTimes, presentCount);
+		_latencyFrameTimes = {};
+	}
+
+	if (!_isFrameStatisticsAvailable) {
+		return;
+	}
+
+	// 每次呈现后都检索，没有新帧时之前的帧也可能刚刚显示
+	DXGI_FRAME_STATISTICS stats{};
+	HRESULT hr = swapChain->GetFrameStatistics(&stats);
+	if (SUCCEEDED(hr)) {
+		_latencyTracker->OnFrameStatistics(stats.PresentCount, stats.SyncQPCTime.QuadPart);
+	} else if (hr != DXGI_ERROR_FRAME_STATISTICS_DISJOINT) {
+		Logger::Get().ComError("GetFrameStatistics 失败，将无法统计显示的时刻", hr);
+		_isFrameStatisticsAvailable = false;
+	}
+}
+
+void Renderer::_InitAdaptiveQuality() noexcept {
+	float frameTime = 1000.0f / 60;
+
+	DWM_TIMING_INFO timingInfo{};
+	timingInfo.cbSize = sizeof(timingInfo);
+	HRESULT hr = DwmGetCompositionTimingInfo(NULL, &timingInfo);
+	if (SUCCEEDED(hr) && timingInfo.qpcRefreshPeriod > 0) {
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		frameTime = float(timingInfo.qpcRefreshPeriod * 1000.0 / frequency.QuadPart);
+	} else {
+		Logger::Get().ComError("DwmGetCompositionTimingInfo 失败，假设刷新率为 60Hz", hr);
+	}
+
+	// 限制的帧率低于刷新率时允许更长的用时
+	const MagOptions& options = MagApp::Get().GetOptions();
+	if (!options.IsVSync() && options.maxFrameRate > 0) {
+		frameTime = std::max(frameTime, 1000.0f / options.maxFrameRate);
+	}
+
+	const float budget = frameTime * ADAPTIVE_QUALITY_BUDGET_RATIO;
+	_adaptiveQuality = std::make_unique<AdaptiveQualityController>(budget);
+	_gpuTimer->EnableFrameTiming();
+	_FindCheaperEffects();
+
+	Logger::Get().Info(fmt::format("已启用自适应画质，每帧预算 {} 毫秒", budget));
+}
+
+void Renderer::_FindCheaperEffects() noexcept {
+	const std::vector<EffectOption>& effects = MagApp::Get().GetOptions().effects;
+
+	_cheaperEffects.clear();
+	_cheaperEffects.resize(effects.size());
+
+	for (size_t i = 0; i < effects.size(); ++i) {
+		const std::wstring& name = effects[i].name;
+
+		for (std::span<const std::wstring_view> variants : EFFECT_VARIANTS) {
+			auto it = std::find_if(variants.begin(), variants.end(),
+				[&](std::wstring_view suffix) { return name.ends_with(suffix); });
+			if (it == variants.end()) {
+				continue;
+			}
+
+			// 不是每个效果都有所有版本，跳过不存在的
+			const std::wstring_view baseName(name.c_str(), name.size() - it->size());
+			for (++it; it != variants.end(); ++it) {
+				std::wstring cheaperName = StrUtils::Concat(baseName, *it);
+				if (Win32Utils::FileExists(StrUtils::Concat(L"effects\\", cheaperName, L".hlsl").c_str())) {
+					_cheaperEffects[i] = std::move(cheaperName);
+					break;
+				}
+			}
+			break;
+		}
+	}
+}
+
+void Renderer::_UpdateAdaptiveQuality() {
+	// 正在替换效果链时的用时不代表新的效果链
+	if (_pendingEffects) {
+		return;
+	}
+
+	const uint32_t gpuTimeCount = _gpuTimer->GetFrameGPUTimeCount();
+	if (gpuTimeCount == _lastFrameGPUTimeCount) {
+		return;
+	}
+	_lastFrameGPUTimeCount = gpuTimeCount;
+
+	// 没有新帧时只渲染了部分通道，用时偏低，会使预算判断失真
+	if (!_gpuTimer->IsFrameGPUTimeFullChain()) {
+		return;
+	}
+
+	// 优先替换开销最大的效果
+	int downgradeIdx = -1;
+	uint64_t maxThreadCount = 0;
+	for (size_t i = 0; i < _effects.size() && i < _cheaperEffects.size(); ++i) {
+		if (_cheaperEffects[i].empty()) {
+			continue;
+		}
+
+		const uint64_t threadCount = _effects[i].GetThreadCount();
+		if (downgradeIdx < 0 || threadCount > maxThreadCount) {
+			downgradeIdx = (int)i;
+			maxThreadCount = threadCount;
+		}
+	}
+
+	const AdaptiveQualityController::Action action = _adaptiveQuality->AddSample(
+		_gpuTimer->GetFrameGPUTime(), downgradeIdx >= 0, !_downgradedEffects.empty());
+	if (action == AdaptiveQualityController::Action::None) {
+		return;
+	}
+
+	const MagOptions& options = MagApp::Get().GetOptions();
+	std::vector<EffectOption> effects = options.effects;
+	std::vector<std::pair<uint32_t, std::wstring>> downgradedEffects = _downgradedEffects;
+
+	if (action == AdaptiveQualityController::Action::Decrease) {
+		std::wstring& name = effects[downgradeIdx].name;
+		Logger::Get().Info(StrUtils::Concat("GPU 用时超出预算，降低画质：",
+			StrUtils::UTF16ToUTF8(name), " -> ", StrUtils::UTF16ToUTF8(_cheaperEffects[downgradeIdx])));
+
+		downgradedEffects.emplace_back((uint32_t)downgradeIdx, std::move(name));
+		name = _cheaperEffects[downgradeIdx];
+	} else {
+		auto& [idx, originalName] = downgradedEffects.back();
+		Logger::Get().Info(StrUtils::Concat("GPU 用时有余量，提高画质：",
+			StrUtils::UTF16ToUTF8(effects[idx].name), " -> ", StrUtils::UTF16ToUTF8(originalName)));
+
+		effects[idx].name = std::move(originalName);
+		downgradedEffects.pop_back();
+	}
+
+	_StartCompileEffects(std::move(effects), DownscalingEffect(options.downscalingEffect));
+	_pendingEffects->downgradedEffects = std::move(downgradedEffects);
+	_pendingEffects->isAdaptiveQuality = true;
+}
+
 }
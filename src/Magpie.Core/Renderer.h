@@ -1,13 +1,23 @@
 #pragma once
 #include "EffectHelper.h"
+#include "FramePacer.h"
+#include "LatencyTracker.h"
+#include "Win32Utils.h"
+#include <parallel_hashmap/phmap.h>
 
 namespace Magpie::Core {
 
 class GPUTimer;
 class OverlayDrawer;
+class OverlayFonts;
 class CursorManager;
 class EffectDrawer;
+class EffectsWatcher;
+class FrameRateLimiter;
+class AdaptiveQualityController;
 struct EffectDesc;
+struct EffectOption;
+struct DownscalingEffect;
 
 class Renderer {
 public:
@@ -30,10 +40,22 @@ public:
 		return _overlayDrawer.get();
 	}
 
+	// 未限制帧率时为空
+	const FrameRateLimiter* GetFrameRateLimiter() const noexcept {
+		return _frameRateLimiter.get();
+	}
+
+	const LatencyTracker& GetLatencyTracker() const noexcept {
+		return *_latencyTracker;
+	}
+
 	bool IsUIVisiable() const noexcept;
 
 	void SetUIVisibility(bool value);
 
+	// 开始或停止记录跟踪，文件保存在 logs 文件夹中
+	void ToggleTraceRecording();
+
 	const RECT& GetOutputRect() const noexcept {
 		return _outputRect;
 	}
@@ -46,27 +68,126 @@ public:
 
 	const EffectDesc& GetEffectDesc(uint32_t idx) const noexcept;
 
+	// 缩放时更新效果链。只有非内联参数或缩放选项改变时就地更新，否则在后台编译新的
+	// 效果链，期间继续使用旧的效果链，完成后在帧之间替换
+	void UpdateEffects(std::vector<EffectOption>&& effects, DownscalingEffect&& downscalingEffect);
+
 private:
+	struct _PendingEffects;
+
 	int _CheckSrcState();
 
+	// 源窗口位置或大小改变后就地更新帧源和效果链，返回 false 表示需要重新开始缩放
+	bool _OnSrcWndRectChanged();
+
+	bool _ResizeEffects();
+
 	bool _BuildEffects();
 
+	bool _UpdateEffectsInPlace(const std::vector<EffectOption>& effects, const DownscalingEffect& downscalingEffect);
+
+	// changedEffects 为热重载时改变的效果
+	void _StartCompileEffects(
+		std::vector<EffectOption>&& effects,
+		DownscalingEffect&& downscalingEffect,
+		phmap::flat_hash_set<std::wstring>&& changedEffects = {}
+	);
+
+	void _ReloadChangedEffects();
+
+	// 更新效果链失败时在覆盖层中显示错误，继续使用当前效果链
+	void _ShowEffectsError(std::string&& errorMsg);
+
+	bool _InitOverlayDrawer();
+
+	// 覆盖层和记录跟踪都需要每个通道的 GPU 用时
+	void _StartProfiling();
+
+	static winrt::fire_and_forget _CompileEffectsAsync(std::shared_ptr<_PendingEffects> pendingEffects, HWND hwndHost);
+
+	void _SwapPendingEffects();
+
 	bool _UpdateDynamicConstants();
 
+	// 帧源没有新帧时检查后缓冲区的内容是否会改变
+	bool _IsIdleFrame() const noexcept;
+
+	bool _InitFramePacing() noexcept;
+
+	// 等待到帧调度确定的时刻再开始捕获和渲染
+	void _WaitForFramePacing() noexcept;
+
+	void _OnFramePacingEnd() noexcept;
+
+	// 呈现后记录新帧的各阶段的时刻并检索呈现统计
+	void _UpdateLatency() noexcept;
+
+	void _InitAdaptiveQuality() noexcept;
+
+	// 效果链改变后查找每个效果开销更低的版本
+	void _FindCheaperEffects() noexcept;
+
+	// 每帧结束时根据 GPU 用时决定是否替换效果
+	void _UpdateAdaptiveQuality();
+
 	RECT _srcWndRect{};
 	RECT _outputRect{};
 	// 尺寸可能大于主窗口
 	RECT _virtualOutputRect{};
 
 	bool _waitingForNextFrame = false;
+	// 效果链改变后的第一帧需渲染所有效果
+	bool _isEffectsChanged = false;
+	// 内联参数的效果未命中缓存，正在使用不内联参数的版本
+	bool _isFallbackEffects = false;
+
+	// 用于统计首帧用时和替换为内联参数的版本的用时
+	std::chrono::steady_clock::time_point _initStartTime;
+	float _timeToFirstFrame = -1.0f;
 
 	std::vector<EffectDrawer> _effects;
 	std::array<EffectHelper::Constant32, 12> _dynamicConstants;
 	winrt::com_ptr<ID3D11Buffer> _dynamicCB;
 
+	// 缩放开始时在后台构建，首次显示覆盖层时无需等待
+	std::shared_ptr<OverlayFonts> _overlayFonts;
 	std::unique_ptr<OverlayDrawer> _overlayDrawer;
 
 	std::unique_ptr<GPUTimer> _gpuTimer;
+
+	// 正在后台编译的效果链
+	std::shared_ptr<_PendingEffects> _pendingEffects;
+
+	// 开发者模式下监视效果文件，改变后重新加载
+	std::unique_ptr<EffectsWatcher> _effectsWatcher;
+
+	// 垂直同步时推迟捕获和渲染以降低延迟，未启用时为空
+	std::unique_ptr<FramePacer> _framePacer;
+	Win32Utils::ScopedHandle _hFramePacingTimer;
+	FramePacer::Schedule _framePacingSchedule;
+	// 这一帧开始捕获的时刻，单位为 QPC 计数
+	int64_t _frameStartTime = 0;
+	int64_t _qpcFrequency = 0;
+
+	// 不使用垂直同步时限制帧率，未启用时为空
+	std::unique_ptr<FrameRateLimiter> _frameRateLimiter;
+
+	std::unique_ptr<LatencyTracker> _latencyTracker;
+	// 新帧在各阶段的时刻，没有新帧时 update 为 0
+	LatencyTracker::FrameTimes _latencyFrameTimes;
+	// 窗口化时呈现统计可能不可用
+	bool _isFrameStatisticsAvailable = true;
+
+	// 效果链的 GPU 用时超出预算时替换为开销更低的版本，未启用时为空
+	std::unique_ptr<AdaptiveQualityController> _adaptiveQuality;
+	// 每个效果开销更低的版本，为空表示没有
+	std::vector<std::wstring> _cheaperEffects;
+	// 被替换的效果的索引和替换前的名字，最后替换的在末尾
+	std::vector<std::pair<uint32_t, std::wstring>> _downgradedEffects;
+	uint32_t _lastFrameGPUTimeCount = 0;
+
+	// 空闲时跳过的呈现次数
+	uint64_t _skippedPresentCount = 0;
 };
 
 }
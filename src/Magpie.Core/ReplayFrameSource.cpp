@@ -0,0 +1,228 @@
+#include "pch.h"
+#include "ReplayFrameSource.h"
+#include "MagApp.h"
+#include "DeviceResources.h"
+#include "Logger.h"
+#include "StrUtils.h"
+#include "RectHelper.h"
+
+namespace Magpie::Core {
+
+ReplayFrameSource::~ReplayFrameSource() {
+	if (_fileData) {
+		UnmapViewOfFile(_fileData);
+	}
+}
+
+bool ReplayFrameSource::Initialize() {
+	// 基准测试时没有源窗口
+	const bool hasSrcWnd = MagApp::Get().GetHwndSrc() != NULL;
+	if (hasSrcWnd) {
+		if (!FrameSourceBase::Initialize()) {
+			Logger::Get().Error("初始化 FrameSourceBase 失败");
+			return false;
+		}
+
+		if (!_UpdateSrcFrameRect()) {
+			Logger::Get().Error("_UpdateSrcFrameRect 失败");
+			return false;
+		}
+	}
+
+	const MagOptions& options = MagApp::Get().GetOptions();
+	if (options.replayFile.empty()) {
+		Logger::Get().Error("未指定录制文件");
+		return false;
+	}
+
+	if (!_MapFile(options.replayFile.c_str())) {
+		Logger::Get().Error("_MapFile 失败");
+		return false;
+	}
+
+	if (!_ParseFrames()) {
+		Logger::Get().Error("_ParseFrames 失败");
+		return false;
+	}
+
+	if (!hasSrcWnd) {
+		_srcFrameRect = { 0, 0, (LONG)_header.width, (LONG)_header.height };
+	}
+
+	_output = MagApp::Get().GetDeviceResources().CreateTexture2D(
+		GPUMemoryOwner::FrameSource,
+		DXGI_FORMAT_B8G8R8A8_UNORM,
+		_header.width,
+		_header.height,
+		D3D11_BIND_SHADER_RESOURCE
+	);
+	if (!_output) {
+		Logger::Get().Error("创建纹理失败");
+		return false;
+	}
+
+	_frameRate = options.replayFrameRate == 0 ? _header.frameRate : std::max(options.replayFrameRate, 0.0f);
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	_qpcFrequency = frequency.QuadPart;
+
+	Logger::Get().Info(fmt::format("ReplayFrameSource 初始化完成\n\t尺寸：{}x{}\n\t帧数：{}\n\t帧率：{}",
+		_header.width, _header.height, _header.frameCount, _frameRate));
+	return true;
+}
+
+FrameSourceBase::UpdateState ReplayFrameSource::Update() {
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+
+	// 到这一帧为止应已播放的帧数
+	uint64_t targetFrames;
+	if (_playedFrames == 0) {
+		_startTime = now.QuadPart;
+		targetFrames = 1;
+	} else if (_frameRate <= 0) {
+		targetFrames = _playedFrames + 1;
+	} else {
+		targetFrames = uint64_t((now.QuadPart - _startTime) * (double)_frameRate / _qpcFrequency) + 1;
+
+		if (targetFrames <= _playedFrames) {
+			// 等待到下一帧的时刻，期间仍处理消息
+			const int64_t nextFrameTime = _startTime + int64_t(_playedFrames * _qpcFrequency / _frameRate);
+			const DWORD timeout = (DWORD)std::max<int64_t>((nextFrameTime - now.QuadPart) * 1000 / _qpcFrequency, 1);
+			MsgWaitForMultipleObjectsEx(0, nullptr, timeout, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+			return UpdateState::Waiting;
+		}
+	}
+
+	const uint32_t frameCount = _header.frameCount;
+	const RECT frameRect{ 0, 0, (LONG)_header.width, (LONG)_header.height };
+
+	// 跳过的帧改变的区域也需从目标帧更新
+	SmallVector<RECT> rects;
+	bool isFullUpdate = _playedFrames == 0 || targetFrames - _playedFrames >= frameCount;
+	for (uint64_t i = _playedFrames; i < targetFrames && !isFullUpdate; ++i) {
+		const uint32_t frameIdx = uint32_t(i % frameCount);
+		if (frameIdx == 0) {
+			// 循环回到第一帧
+			isFullUpdate = true;
+			break;
+		}
+
+		const _FrameInfo& frame = _frames[frameIdx];
+		for (uint32_t j = 0; j < frame.dirtyRectCount; ++j) {
+			RectHelper::ClipRect(frame.dirtyRects[j], frameRect, rects);
+		}
+	}
+
+	_playedFrames = targetFrames;
+
+	if (isFullUpdate) {
+		rects.clear();
+		rects.push_back(frameRect);
+	} else if (rects.empty()) {
+		return UpdateState::NoUpdate;
+	} else {
+		RectHelper::CoalesceRects(rects);
+	}
+
+	_UploadRects(_frames[(targetFrames - 1) % frameCount], rects);
+
+	// 按帧率播放时以计划的时刻作为捕获的时刻
+	_frameTime = _frameRate > 0
+		? _startTime + int64_t((targetFrames - 1) * _qpcFrequency / _frameRate)
+		: now.QuadPart;
+	return UpdateState::NewFrame;
+}
+
+bool ReplayFrameSource::_MapFile(const wchar_t* fileName) {
+	Logger::Get().Info(StrUtils::Concat("读取录制文件：", StrUtils::UTF16ToUTF8(fileName)));
+
+	_hFile.reset(Win32Utils::SafeHandle(CreateFile2(fileName, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr)));
+	if (!_hFile) {
+		Logger::Get().Win32Error("打开录制文件失败");
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(_hFile.get(), &fileSize)) {
+		Logger::Get().Win32Error("GetFileSizeEx 失败");
+		return false;
+	}
+	_fileSize = (uint64_t)fileSize.QuadPart;
+
+	if (_fileSize < sizeof(FileHeader)) {
+		Logger::Get().Error("录制文件不完整");
+		return false;
+	}
+
+	_hFileMapping.reset(CreateFileMapping(_hFile.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+	if (!_hFileMapping) {
+		Logger::Get().Win32Error("CreateFileMapping 失败");
+		return false;
+	}
+
+	// 只有实际访问的页会被读取
+	_fileData = (const uint8_t*)MapViewOfFile(_hFileMapping.get(), FILE_MAP_READ, 0, 0, 0);
+	if (!_fileData) {
+		Logger::Get().Win32Error("MapViewOfFile 失败");
+		return false;
+	}
+
+	return true;
+}
+
+bool ReplayFrameSource::_ParseFrames() {
+	std::memcpy(&_header, _fileData, sizeof(_header));
+
+	if (_header.magic != FILE_MAGIC || _header.version != FILE_VERSION) {
+		Logger::Get().Error("不支持的录制文件");
+		return false;
+	}
+
+	if (_header.width == 0 || _header.height == 0 || _header.frameCount == 0) {
+		Logger::Get().Error("录制文件为空");
+		return false;
+	}
+
+	const uint64_t pixelsSize = (uint64_t)_header.width * _header.height * 4;
+	uint64_t offset = sizeof(FileHeader);
+
+	_frames.resize(_header.frameCount);
+	for (uint32_t i = 0; i < _header.frameCount; ++i) {
+		_FrameInfo& frame = _frames[i];
+
+		if (_fileSize - offset < sizeof(uint32_t)) {
+			Logger::Get().Error(fmt::format("录制文件不完整，只有 {} 帧", i));
+			return false;
+		}
+		std::memcpy(&frame.dirtyRectCount, _fileData + offset, sizeof(uint32_t));
+		offset += sizeof(uint32_t);
+
+		const uint64_t dirtyRectsSize = (uint64_t)frame.dirtyRectCount * sizeof(RECT);
+		if (_fileSize - offset < dirtyRectsSize + pixelsSize) {
+			Logger::Get().Error(fmt::format("录制文件不完整，只有 {} 帧", i));
+			return false;
+		}
+
+		frame.dirtyRects = (const RECT*)(_fileData + offset);
+		offset += dirtyRectsSize;
+		frame.pixels = _fileData + offset;
+		offset += pixelsSize;
+	}
+
+	return true;
+}
+
+void ReplayFrameSource::_UploadRects(const _FrameInfo& frame, const SmallVectorImpl<RECT>& rects) {
+	ID3D11DeviceContext4* d3dDC = MagApp::Get().GetDeviceResources().GetD3DDC();
+	const uint32_t rowPitch = _header.width * 4;
+
+	for (const RECT& rect : rects) {
+		const D3D11_BOX box{ (UINT)rect.left, (UINT)rect.top, 0, (UINT)rect.right, (UINT)rect.bottom, 1 };
+		const uint8_t* src = frame.pixels + (size_t)rect.top * rowPitch + (size_t)rect.left * 4;
+		d3dDC->UpdateSubresource(_output.get(), 0, &box, src, rowPitch, 0);
+	}
+}
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "FrameSourceBase.h"
+#include "Win32Utils.h"
+#include "SmallVector.h"
+
+namespace Magpie::Core {
+
+// 从录制的文件中读取帧，用于在没有源窗口和捕获 API 的情况下可重复地测试性能
+// 文件被映射到内存中，只读取每帧改变的部分
+class ReplayFrameSource : public FrameSourceBase {
+public:
+	// 录制文件的格式，所有数据为小端序
+	// 文件头之后依次为每一帧：uint32_t 脏矩形的数量，RECT 数组，然后是完整的 BGRA 像素，行之间没有填充
+	// 脏矩形的数量为 0 表示这一帧和上一帧相同。第一帧和循环回到第一帧时总是更新整个帧
+	struct FileHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t width;
+		uint32_t height;
+		uint32_t frameCount;
+		// 录制时的帧率，0 表示每次 Update 都前进一帧
+		float frameRate;
+	};
+
+	// 文件开头的 "MGRP"
+	static constexpr uint32_t FILE_MAGIC = 0x5052474D;
+	static constexpr uint32_t FILE_VERSION = 1;
+
+	ReplayFrameSource() {};
+	virtual ~ReplayFrameSource();
+
+	bool Initialize() override;
+
+	UpdateState Update() override;
+
+	bool IsScreenCapture() override {
+		return false;
+	}
+
+	// 输出和源窗口无关
+	bool OnSrcWndRectChanged() override {
+		return _UpdateSrcFrameRect();
+	}
+
+	const char* GetName() const noexcept override {
+		return "Replay";
+	}
+
+protected:
+	bool _HasRoundCornerInWin11() override {
+		return false;
+	}
+
+	bool _CanCaptureTitleBar() override {
+		return false;
+	}
+
+private:
+	struct _FrameInfo {
+		const RECT* dirtyRects = nullptr;
+		uint32_t dirtyRectCount = 0;
+		const uint8_t* pixels = nullptr;
+	};
+
+	bool _MapFile(const wchar_t* fileName);
+
+	bool _ParseFrames();
+
+	void _UploadRects(const _FrameInfo& frame, const SmallVectorImpl<RECT>& rects);
+
+	Win32Utils::ScopedHandle _hFile;
+	Win32Utils::ScopedHandle _hFileMapping;
+	const uint8_t* _fileData = nullptr;
+	uint64_t _fileSize = 0;
+
+	FileHeader _header{};
+	std::vector<_FrameInfo> _frames;
+
+	float _frameRate = 0.0f;
+	int64_t _qpcFrequency = 0;
+	int64_t _startTime = 0;
+	// 已播放的帧数，不回绕。为 0 表示尚未播放第一帧
+	uint64_t _playedFrames = 0;
+};
+
+}
@@ -806,6 +806,7 @@ winrt::com_ptr<ID3D11Texture2D> LoadImg(const wchar_t* fileName) {
 	initData.SysMemPitch = stride;
 
 	winrt::com_ptr<ID3D11Texture2D> result = MagApp::Get().GetDeviceResources().CreateTexture2D(
+		GPUMemoryOwner::Effect,
 		useFloatFormat ? DXGI_FORMAT_R16G16B16A16_FLOAT : DXGI_FORMAT_R8G8B8A8_UNORM,
 		width,
 		height,
@@ -0,0 +1,228 @@
+#include "pch.h"
+#include "TraceRecorder.h"
+#include "Logger.h"
+#include "Utils.h"
+#include "StrUtils.h"
+
+namespace Magpie::Core {
+
+// 后台线程写入文件的间隔
+static constexpr DWORD FLUSH_INTERVAL_MS = 50;
+
+// 用作 CPU 和 GPU 轨道的线程 ID，不会和实际的线程 ID 冲突
+static constexpr uint32_t CPU_TRACK_ID = 1;
+static constexpr uint32_t GPU_TRACK_ID = 2;
+
+TraceRecorder::~TraceRecorder() {
+	Stop();
+}
+
+bool TraceRecorder::Start(const wchar_t* fileName) {
+	if (IsRecording()) {
+		return false;
+	}
+
+	_hFile.reset(Win32Utils::SafeHandle(CreateFile2(fileName, GENERIC_WRITE, FILE_SHARE_READ, CREATE_ALWAYS, nullptr)));
+	if (!_hFile) {
+		Logger::Get().Win32Error("创建跟踪文件失败");
+		return false;
+	}
+
+	_hStopEvent.reset(CreateEvent(nullptr, FALSE, FALSE, nullptr));
+	if (!_hStopEvent) {
+		Logger::Get().Win32Error("CreateEvent 失败");
+		_hFile.reset();
+		return false;
+	}
+
+	if (!_slots) {
+		_slots = std::make_unique<_Slot[]>(CAPACITY);
+		for (uint32_t i = 0; i < CAPACITY; ++i) {
+			_slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+	_session.fetch_add(1, std::memory_order_relaxed);
+	_droppedCount.store(0, std::memory_order_relaxed);
+	_eventCount = 0;
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	_qpcFrequency = frequency.QuadPart;
+	_startTime = Utils::GetQPC();
+	_processId = GetCurrentProcessId();
+
+	// 之后的每个事件都以逗号开头。没有结尾的 ] 也是有效的格式，因此意外退出时文件仍可使用
+	const std::string header = fmt::format(
+		"[\n{{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":{0},\"args\":{{\"name\":\"Magpie\"}}}},\n"
+		"{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":{0},\"tid\":{1},\"args\":{{\"name\":\"CPU\"}}}},\n"
+		"{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":{0},\"tid\":{2},\"args\":{{\"name\":\"GPU\"}}}}",
+		_processId, CPU_TRACK_ID, GPU_TRACK_ID);
+	DWORD written;
+	WriteFile(_hFile.get(), header.data(), (DWORD)header.size(), &written, nullptr);
+
+	// 在启动后台线程前发布
+	_isRecording.store(true, std::memory_order_release);
+	_flushThread = std::thread(&TraceRecorder::_FlushThreadProc, this);
+
+	Logger::Get().Info(StrUtils::Concat("开始记录跟踪：", StrUtils::UTF16ToUTF8(fileName)));
+	return true;
+}
+
+void TraceRecorder::Stop() noexcept {
+	if (!_isRecording.exchange(false, std::memory_order_relaxed)) {
+		return;
+	}
+
+	// 后台线程写入剩余的事件后退出
+	SetEvent(_hStopEvent.get());
+	_flushThread.join();
+
+	static constexpr std::string_view FOOTER = "\n]\n";
+	DWORD written;
+	WriteFile(_hFile.get(), FOOTER.data(), (DWORD)FOOTER.size(), &written, nullptr);
+
+	_hFile.reset();
+	_hStopEvent.reset();
+
+	const uint32_t droppedCount = _droppedCount.load(std::memory_order_relaxed);
+	Logger::Get().Info(fmt::format("停止记录跟踪，共 {} 个事件，丢弃了 {} 个", _eventCount, droppedCount));
+}
+
+void TraceRecorder::AddSpan(Track track, std::string_view name, int64_t start, int64_t end) noexcept {
+	// 先读取记录的序号。如果在此之后记录被停止并重新开始，事件将被丢弃
+	const uint32_t session = _session.load(std::memory_order_relaxed);
+	if (!IsRecording()) {
+		return;
+	}
+
+	// 有界的多生产者队列，见 https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+	_Slot* slot;
+	uint64_t pos = _enqueuePos.load(std::memory_order_relaxed);
+	while (true) {
+		slot = &_slots[pos & (CAPACITY - 1)];
+		const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+		const int64_t diff = (int64_t)sequence - (int64_t)pos;
+		if (diff == 0) {
+			if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		} else if (diff < 0) {
+			// 缓冲区已满
+			_droppedCount.fetch_add(1, std::memory_order_relaxed);
+			return;
+		} else {
+			pos = _enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	_Event& event = slot->event;
+	event.start = start;
+	event.end = end;
+	event.session = session;
+	event.threadId = track == Track::Compile ? GetCurrentThreadId() : 0;
+	event.track = track;
+	size_t nameLen = std::min(name.size(), std::size(event.name));
+	// 不截断 UTF-8 字符
+	while (nameLen > 0 && nameLen < name.size() && ((uint8_t)name[nameLen] & 0xC0) == 0x80) {
+		--nameLen;
+	}
+	event.nameLen = (uint8_t)nameLen;
+	std::memcpy(event.name, name.data(), event.nameLen);
+
+	slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+bool TraceRecorder::_TryDequeue(_Event& event) noexcept {
+	_Slot& slot = _slots[_dequeuePos & (CAPACITY - 1)];
+	if (slot.sequence.load(std::memory_order_acquire) != _dequeuePos + 1) {
+		return false;
+	}
+
+	event = slot.event;
+	slot.sequence.store(_dequeuePos + CAPACITY, std::memory_order_release);
+	++_dequeuePos;
+	return true;
+}
+
+void TraceRecorder::_FlushThreadProc() noexcept {
+	const uint32_t session = _session.load(std::memory_order_relaxed);
+
+	std::string buffer;
+	while (true) {
+		const bool stopping = WaitForSingleObject(_hStopEvent.get(), FLUSH_INTERVAL_MS) == WAIT_OBJECT_0;
+
+		_Event event;
+		while (_TryDequeue(event)) {
+			// 丢弃之前的记录遗留的事件和开始于本次记录之前的事件
+			if (event.session != session || event.start < _startTime) {
+				continue;
+			}
+
+			_WriteEvent(event, buffer);
+			++_eventCount;
+		}
+
+		if (!buffer.empty()) {
+			DWORD written;
+			if (!WriteFile(_hFile.get(), buffer.data(), (DWORD)buffer.size(), &written, nullptr)) {
+				Logger::Get().Win32Error("写入跟踪文件失败");
+			}
+			buffer.clear();
+		}
+
+		if (stopping) {
+			break;
+		}
+	}
+}
+
+void TraceRecorder::_WriteEvent(const _Event& event, std::string& buffer) const {
+	uint32_t tid;
+	const char* category;
+	switch (event.track) {
+	case Track::CPU:
+		tid = CPU_TRACK_ID;
+		category = "cpu";
+		break;
+	case Track::GPU:
+		tid = GPU_TRACK_ID;
+		category = "gpu";
+		break;
+	default:
+		tid = event.threadId;
+		category = "compile";
+		break;
+	}
+
+	// 效果名包含文件夹分隔符，需转义
+	buffer.append(",\n{\"name\":\"");
+	for (uint8_t i = 0; i < event.nameLen; ++i) {
+		const char c = event.name[i];
+		if (c == '"' || c == '\\') {
+			buffer.push_back('\\');
+			buffer.push_back(c);
+		} else if ((unsigned char)c >= 0x20) {
+			buffer.push_back(c);
+		}
+	}
+
+	// 时刻的单位为微秒
+	const double toUs = 1e6 / _qpcFrequency;
+	fmt::format_to(std::back_inserter(buffer),
+		"\",\"cat\":\"{}\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":{},\"tid\":{}}}",
+		category, (event.start - _startTime) * toUs, (event.end - event.start) * toUs, _processId, tid);
+}
+
+TraceRecorder::Scope::Scope(Track track, std::string_view name) noexcept : _name(name), _track(track) {
+	if (TraceRecorder::Get().IsRecording()) {
+		_start = Utils::GetQPC();
+	}
+}
+
+TraceRecorder::Scope::~Scope() {
+	if (_start != 0) {
+		TraceRecorder::Get().AddSpan(_track, _name, _start, Utils::GetQPC());
+	}
+}
+
+}
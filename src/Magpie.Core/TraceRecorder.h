@@ -0,0 +1,104 @@
+#pragma once
+#include "Win32Utils.h"
+
+namespace Magpie::Core {
+
+// 将 CPU 和 GPU 各阶段的用时以 Chrome 的 trace event 格式写入文件，可在 chrome://tracing 或 Perfetto 中查看
+// 记录时只将事件写入无锁的环形缓冲区，由后台线程格式化并写入文件。缓冲区满时丢弃新事件
+class TraceRecorder {
+public:
+	static TraceRecorder& Get() noexcept {
+		static TraceRecorder instance;
+		return instance;
+	}
+
+	TraceRecorder(const TraceRecorder&) = delete;
+	TraceRecorder(TraceRecorder&&) = delete;
+
+	enum class Track : uint8_t {
+		// 渲染线程
+		CPU,
+		// 效果链的各通道，时刻由 GPU 时间戳换算而来，因此只有相对位置是准确的
+		GPU,
+		// 编译效果，可能在多个线程上同时进行，因此使用实际的线程 ID
+		Compile
+	};
+
+	bool Start(const wchar_t* fileName);
+
+	void Stop() noexcept;
+
+	bool IsRecording() const noexcept {
+		return _isRecording.load(std::memory_order_relaxed);
+	}
+
+	// 可在任意线程调用。name 过长时被截断，时刻的单位为 QPC 计数
+	void AddSpan(Track track, std::string_view name, int64_t start, int64_t end) noexcept;
+
+	// 记录所在作用域的用时
+	class Scope {
+	public:
+		Scope(Track track, std::string_view name) noexcept;
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope(Scope&&) = delete;
+
+	private:
+		std::string_view _name;
+		int64_t _start = 0;
+		Track _track;
+	};
+
+private:
+	TraceRecorder() = default;
+	~TraceRecorder();
+
+	struct _Event {
+		int64_t start;
+		int64_t end;
+		// 写入时所属的记录，用于丢弃之前的记录遗留的事件
+		uint32_t session;
+		uint32_t threadId;
+		Track track;
+		uint8_t nameLen;
+		char name[46];
+	};
+
+	struct _Slot {
+		// 等于写入位置时可写入，等于写入位置 + 1 时可读取
+		std::atomic<uint64_t> sequence;
+		_Event event;
+	};
+
+	// 为 2 的幂
+	static constexpr uint32_t CAPACITY = 16384;
+
+	bool _TryDequeue(_Event& event) noexcept;
+
+	void _FlushThreadProc() noexcept;
+
+	void _WriteEvent(const _Event& event, std::string& buffer) const;
+
+	// 其他线程可能仍在写入之前的记录的事件，因此重新开始记录时不重置缓冲区和读写位置
+	std::unique_ptr<_Slot[]> _slots;
+	alignas(64) std::atomic<uint64_t> _enqueuePos = 0;
+	// 只在后台线程访问
+	alignas(64) uint64_t _dequeuePos = 0;
+
+	std::atomic<bool> _isRecording = false;
+	// 每次开始记录时递增
+	std::atomic<uint32_t> _session = 0;
+	std::atomic<uint32_t> _droppedCount = 0;
+
+	Win32Utils::ScopedHandle _hFile;
+	Win32Utils::ScopedHandle _hStopEvent;
+	std::thread _flushThread;
+
+	int64_t _startTime = 0;
+	int64_t _qpcFrequency = 0;
+	uint32_t _processId = 0;
+	uint64_t _eventCount = 0;
+};
+
+}
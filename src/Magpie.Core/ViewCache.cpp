@@ -0,0 +1,125 @@
+#include "pch.h"
+#include "ViewCache.h"
+#include "Logger.h"
+
+namespace Magpie::Core {
+
+ViewCache::~ViewCache() {
+	std::scoped_lock lk(_mutex);
+
+	// 这些视图仍被其他对象持有，它们的销毁通知不能再访问此对象
+	for (auto& [key, entry] : _entries) {
+		winrt::com_ptr<ID3DDestructionNotifier> notifier;
+		if (SUCCEEDED(entry.view->QueryInterface(IID_PPV_ARGS(notifier.put())))) {
+			notifier->UnregisterDestructionCallback(entry.callbackId);
+		}
+	}
+}
+
+winrt::com_ptr<ID3D11RenderTargetView> ViewCache::GetRenderTargetView(ID3D11Texture2D* texture) noexcept {
+	winrt::com_ptr<ID3D11RenderTargetView> rtv;
+	if (ID3D11View* view = _Find(texture, _ViewType::RTV)) {
+		rtv.attach(static_cast<ID3D11RenderTargetView*>(view));
+		return rtv;
+	}
+
+	HRESULT hr = _d3dDevice->CreateRenderTargetView(texture, nullptr, rtv.put());
+	if (FAILED(hr)) {
+		Logger::Get().ComError("CreateRenderTargetView 失败", hr);
+		return nullptr;
+	}
+
+	_Add(texture, _ViewType::RTV, rtv.get());
+	return rtv;
+}
+
+winrt::com_ptr<ID3D11ShaderResourceView> ViewCache::GetShaderResourceView(ID3D11Texture2D* texture) noexcept {
+	winrt::com_ptr<ID3D11ShaderResourceView> srv;
+	if (ID3D11View* view = _Find(texture, _ViewType::SRV)) {
+		srv.attach(static_cast<ID3D11ShaderResourceView*>(view));
+		return srv;
+	}
+
+	HRESULT hr = _d3dDevice->CreateShaderResourceView(texture, nullptr, srv.put());
+	if (FAILED(hr)) {
+		Logger::Get().ComError("CreateShaderResourceView 失败", hr);
+		return nullptr;
+	}
+
+	_Add(texture, _ViewType::SRV, srv.get());
+	return srv;
+}
+
+winrt::com_ptr<ID3D11UnorderedAccessView> ViewCache::GetUnorderedAccessView(ID3D11Texture2D* texture) noexcept {
+	winrt::com_ptr<ID3D11UnorderedAccessView> uav;
+	if (ID3D11View* view = _Find(texture, _ViewType::UAV)) {
+		uav.attach(static_cast<ID3D11UnorderedAccessView*>(view));
+		return uav;
+	}
+
+	D3D11_UNORDERED_ACCESS_VIEW_DESC desc{};
+	desc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
+	desc.Texture2D.MipSlice = 0;
+
+	HRESULT hr = _d3dDevice->CreateUnorderedAccessView(texture, &desc, uav.put());
+	if (FAILED(hr)) {
+		Logger::Get().ComError("CreateUnorderedAccessView 失败", hr);
+		return nullptr;
+	}
+
+	_Add(texture, _ViewType::UAV, uav.get());
+	return uav;
+}
+
+ID3D11View* ViewCache::_Find(ID3D11Texture2D* texture, _ViewType type) const noexcept {
+	std::scoped_lock lk(_mutex);
+
+	auto it = _entries.find(std::make_pair(texture, type));
+	if (it == _entries.end()) {
+		return nullptr;
+	}
+
+	ID3D11View* view = it->second.view;
+	view->AddRef();
+	return view;
+}
+
+void ViewCache::_Add(ID3D11Texture2D* texture, _ViewType type, ID3D11View* view) noexcept {
+	winrt::com_ptr<ID3DDestructionNotifier> notifier;
+	HRESULT hr = view->QueryInterface(IID_PPV_ARGS(notifier.put()));
+	if (FAILED(hr)) {
+		Logger::Get().ComError("获取 ID3DDestructionNotifier 失败", hr);
+		return;
+	}
+
+	std::scoped_lock lk(_mutex);
+
+	auto [it, inserted] = _entries.try_emplace(std::make_pair(texture, type));
+	if (!inserted) {
+		return;
+	}
+
+	_Entry& entry = it->second;
+	entry.cache = this;
+	entry.texture = texture;
+	entry.view = view;
+	entry.type = type;
+
+	hr = notifier->RegisterDestructionCallback(&_OnViewDestroyed, &entry, &entry.callbackId);
+	if (FAILED(hr)) {
+		Logger::Get().ComError("RegisterDestructionCallback 失败", hr);
+		_entries.erase(it);
+	}
+}
+
+void WINAPI ViewCache::_OnViewDestroyed(void* data) {
+	const _Entry& entry = *(_Entry*)data;
+	ViewCache& cache = *entry.cache;
+	// entry 在移除后失效
+	const auto key = std::make_pair(entry.texture, entry.type);
+
+	std::scoped_lock lk(cache._mutex);
+	cache._entries.erase(key);
+}
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <parallel_hashmap/phmap.h>
+#include "Win32Utils.h"
+
+namespace Magpie::Core {
+
+// 缓存纹理的视图，同一纹理的同类视图只创建一次。缓存不持有视图，视图由使用者持有，销毁时由
+// ID3DDestructionNotifier 通知移除。视图持有纹理的引用，因此使用者释放纹理和视图后纹理即被销毁，
+// 无需手动释放缓存。视图只能在渲染线程上释放，否则可能在销毁期间被渲染线程从缓存中取出
+class ViewCache {
+public:
+	ViewCache() = default;
+	ViewCache(const ViewCache&) = delete;
+	ViewCache(ViewCache&&) = delete;
+
+	// 取消仍存活的视图的销毁通知
+	~ViewCache();
+
+	void Initialize(ID3D11Device* d3dDevice) noexcept {
+		_d3dDevice = d3dDevice;
+	}
+
+	// 失败时返回空
+	winrt::com_ptr<ID3D11RenderTargetView> GetRenderTargetView(ID3D11Texture2D* texture) noexcept;
+
+	winrt::com_ptr<ID3D11ShaderResourceView> GetShaderResourceView(ID3D11Texture2D* texture) noexcept;
+
+	winrt::com_ptr<ID3D11UnorderedAccessView> GetUnorderedAccessView(ID3D11Texture2D* texture) noexcept;
+
+	// 仍存活的视图数
+	size_t GetCount() const noexcept {
+		std::scoped_lock lk(_mutex);
+		return _entries.size();
+	}
+
+private:
+	enum class _ViewType : uint8_t {
+		RTV,
+		SRV,
+		UAV
+	};
+
+	struct _Entry {
+		ViewCache* cache = nullptr;
+		ID3D11Texture2D* texture = nullptr;
+		ID3D11View* view = nullptr;
+		UINT callbackId = 0;
+		_ViewType type = _ViewType::RTV;
+	};
+
+	// 找到时返回增加了引用计数的视图
+	ID3D11View* _Find(ID3D11Texture2D* texture, _ViewType type) const noexcept;
+
+	// 登记新创建的视图，登记失败只是不缓存
+	void _Add(ID3D11Texture2D* texture, _ViewType type, ID3D11View* view) noexcept;
+
+	static void WINAPI _OnViewDestroyed(void* data);
+
+	ID3D11Device* _d3dDevice = nullptr;
+
+	// 视图可能在任意线程上被销毁，读写 _entries 需持有
+	mutable Win32Utils::SRWMutex _mutex;
+	// 缓存中的视图仍存活，它们持有的纹理不会被销毁，因此可以用纹理的地址作为键。
+	// _Entry 的地址被用作销毁通知的参数，因此需要节点稳定
+	phmap::node_hash_map<std::pair<ID3D11Texture2D*, _ViewType>, _Entry> _entries;
+};
+
+}
@@ -97,6 +97,17 @@ int XamlApp::Run() {
 	return (int)msg.wParam;
 }
 
+int XamlApp::RunBenchmark(HINSTANCE hInstance, const wchar_t* arguments) {
+	_hInst = hInstance;
+
+	_InitializeLogger();
+	Logger::Get().Info("开始基准测试");
+
+	const int exitCode = winrt::Magpie::App::BenchmarkHelper::Run(arguments);
+	Logger::Get().Flush();
+	return exitCode;
+}
+
 void XamlApp::Quit() {
 	if (_mainWindow) {
 		_mainWindow.Destroy();
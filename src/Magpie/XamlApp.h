@@ -19,6 +19,9 @@ public:
 
 	int Run();
 
+	// 命令行的基准测试模式，不显示界面，也不受单实例限制。返回进程的退出代码
+	int RunBenchmark(HINSTANCE hInstance, const wchar_t* arguments);
+
 	void ShowMainWindow() noexcept;
 
 	void Quit();
@@ -54,6 +54,13 @@ int APIENTRY wWinMain(
 	SetCurDir();
 
 	auto& app = Magpie::XamlApp::Get();
+
+	// -benchmark 之后为基准测试的参数
+	static constexpr std::wstring_view BENCHMARK_ARG = L"-benchmark";
+	if (std::wstring_view(lpCmdLine).starts_with(BENCHMARK_ARG)) {
+		return app.RunBenchmark(hInstance, lpCmdLine + BENCHMARK_ARG.size());
+	}
+
 	if (!app.Initialize(hInstance, lpCmdLine)) {
 		return -1;
 	}
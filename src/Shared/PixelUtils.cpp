@@ -0,0 +1,357 @@
+#include "pch.h"
+#include "PixelUtils.h"
+#ifdef _M_X64
+#include <immintrin.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// 标量实现，也用于处理 SIMD 实现剩余的像素
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// 计算 round(c * a / 255)。对于所有 8 位的 c 和 a，和 lroundf(c * (a / 255.0f)) 的结果相同
+static uint32_t MulDiv255(uint32_t c, uint32_t a) noexcept {
+	return ((c * a + 128) * 257) >> 16;
+}
+
+static bool HasAlphaScalar(const uint32_t* pixels, size_t count) noexcept {
+	for (size_t i = 0; i < count; ++i) {
+		if (pixels[i] & 0xFF000000) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void PremultiplyAlphaScalar(uint32_t* pixels, size_t count, bool swapRB, bool invertAlpha) noexcept {
+	for (size_t i = 0; i < count; ++i) {
+		const uint32_t pixel = pixels[i];
+		uint32_t a = pixel >> 24;
+		uint32_t b = MulDiv255(pixel & 0xFF, a);
+		uint32_t g = MulDiv255((pixel >> 8) & 0xFF, a);
+		uint32_t r = MulDiv255((pixel >> 16) & 0xFF, a);
+
+		if (swapRB) {
+			std::swap(b, r);
+		}
+		if (invertAlpha) {
+			a = 255 - a;
+		}
+
+		pixels[i] = b | (g << 8) | (r << 16) | (a << 24);
+	}
+}
+
+static void SwapRBScalar(uint32_t* pixels, size_t count) noexcept {
+	for (size_t i = 0; i < count; ++i) {
+		const uint32_t pixel = pixels[i];
+		pixels[i] = (pixel & 0xFF00FF00) | ((pixel & 0xFF) << 16) | ((pixel >> 16) & 0xFF);
+	}
+}
+
+static void CopyMaskToChannelScalar(uint32_t* pixels, const uint32_t* mask, size_t count, uint32_t channel) noexcept {
+	const uint32_t shift = channel * 8;
+	const uint32_t keepMask = ~(0xFFu << shift);
+	for (size_t i = 0; i < count; ++i) {
+		pixels[i] = (pixels[i] & keepMask) | ((mask[i] & 0xFF) << shift);
+	}
+}
+
+static void FillAlphaScalar(uint32_t* pixels, size_t count) noexcept {
+	for (size_t i = 0; i < count; ++i) {
+		pixels[i] |= 0xFF000000;
+	}
+}
+
+#ifdef _M_X64
+
+enum class SimdLevel {
+	None,
+	SSE41,
+	AVX2
+};
+
+static SimdLevel GetSimdLevel() noexcept {
+	static const SimdLevel level = []() {
+		int info[4];
+		__cpuid(info, 0);
+		const int maxId = info[0];
+
+		__cpuid(info, 1);
+		const bool sse41 = info[2] & (1 << 19);
+		const bool osxsave = info[2] & (1 << 27);
+		const bool avx = info[2] & (1 << 28);
+
+		// 还需检查操作系统是否保存 YMM 寄存器
+		if (maxId >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+			__cpuidex(info, 7, 0);
+			if (info[1] & (1 << 5)) {
+				return SimdLevel::AVX2;
+			}
+		}
+
+		return sse41 ? SimdLevel::SSE41 : SimdLevel::None;
+	}();
+	return level;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// SSE4.1 实现，每次处理 4 个像素
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static __m128i SwapRBShuffle128() noexcept {
+	return _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+}
+
+// 每个 16 位通道乘以所在像素的 A 通道
+static __m128i PremultiplyHalf128(__m128i half) noexcept {
+	const __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(half, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	const __m128i t = _mm_add_epi16(_mm_mullo_epi16(half, alpha), _mm_set1_epi16(128));
+	return _mm_mulhi_epu16(t, _mm_set1_epi16(257));
+}
+
+static bool HasAlphaSSE41(const uint32_t* pixels, size_t count) noexcept {
+	const __m128i alphaMask = _mm_set1_epi32(0xFF000000);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const __m128i px = _mm_loadu_si128((const __m128i*)(pixels + i));
+		if (!_mm_testz_si128(px, alphaMask)) {
+			return true;
+		}
+	}
+
+	return HasAlphaScalar(pixels + i, count - i);
+}
+
+static void PremultiplyAlphaSSE41(uint32_t* pixels, size_t count, bool swapRB, bool invertAlpha) noexcept {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alphaMask = _mm_set1_epi32(0xFF000000);
+	const __m128i invertMask = invertAlpha ? alphaMask : zero;
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const __m128i px = _mm_loadu_si128((const __m128i*)(pixels + i));
+
+		const __m128i lo = PremultiplyHalf128(_mm_unpacklo_epi8(px, zero));
+		const __m128i hi = PremultiplyHalf128(_mm_unpackhi_epi8(px, zero));
+
+		// A 通道保持原值
+		__m128i result = _mm_blendv_epi8(_mm_packus_epi16(lo, hi), px, alphaMask);
+		result = _mm_xor_si128(result, invertMask);
+		if (swapRB) {
+			result = _mm_shuffle_epi8(result, SwapRBShuffle128());
+		}
+
+		_mm_storeu_si128((__m128i*)(pixels + i), result);
+	}
+
+	PremultiplyAlphaScalar(pixels + i, count - i, swapRB, invertAlpha);
+}
+
+static void SwapRBSSE41(uint32_t* pixels, size_t count) noexcept {
+	const __m128i shuffle = SwapRBShuffle128();
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const __m128i px = _mm_loadu_si128((const __m128i*)(pixels + i));
+		_mm_storeu_si128((__m128i*)(pixels + i), _mm_shuffle_epi8(px, shuffle));
+	}
+
+	SwapRBScalar(pixels + i, count - i);
+}
+
+static void CopyMaskToChannelSSE41(uint32_t* pixels, const uint32_t* mask, size_t count, uint32_t channel) noexcept {
+	const __m128i shift = _mm_cvtsi32_si128(channel * 8);
+	const __m128i channelMask = _mm_sll_epi32(_mm_set1_epi32(0xFF), shift);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const __m128i px = _mm_loadu_si128((const __m128i*)(pixels + i));
+		const __m128i m = _mm_loadu_si128((const __m128i*)(mask + i));
+		const __m128i result = _mm_or_si128(_mm_andnot_si128(channelMask, px), _mm_and_si128(_mm_sll_epi32(m, shift), channelMask));
+		_mm_storeu_si128((__m128i*)(pixels + i), result);
+	}
+
+	CopyMaskToChannelScalar(pixels + i, mask + i, count - i, channel);
+}
+
+static void FillAlphaSSE41(uint32_t* pixels, size_t count) noexcept {
+	const __m128i alphaMask = _mm_set1_epi32(0xFF000000);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const __m128i px = _mm_loadu_si128((const __m128i*)(pixels + i));
+		_mm_storeu_si128((__m128i*)(pixels + i), _mm_or_si128(px, alphaMask));
+	}
+
+	FillAlphaScalar(pixels + i, count - i);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// AVX2 实现，每次处理 8 个像素。解包、打包和字节重排都在 128 位的半边内进行，因此像素顺序不变
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static __m256i SwapRBShuffle256() noexcept {
+	return _mm256_broadcastsi128_si256(SwapRBShuffle128());
+}
+
+static __m256i PremultiplyHalf256(__m256i half) noexcept {
+	const __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(half, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	const __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(half, alpha), _mm256_set1_epi16(128));
+	return _mm256_mulhi_epu16(t, _mm256_set1_epi16(257));
+}
+
+static bool HasAlphaAVX2(const uint32_t* pixels, size_t count) noexcept {
+	const __m256i alphaMask = _mm256_set1_epi32(0xFF000000);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m256i px = _mm256_loadu_si256((const __m256i*)(pixels + i));
+		if (!_mm256_testz_si256(px, alphaMask)) {
+			return true;
+		}
+	}
+
+	return HasAlphaScalar(pixels + i, count - i);
+}
+
+static void PremultiplyAlphaAVX2(uint32_t* pixels, size_t count, bool swapRB, bool invertAlpha) noexcept {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i alphaMask = _mm256_set1_epi32(0xFF000000);
+	const __m256i invertMask = invertAlpha ? alphaMask : zero;
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m256i px = _mm256_loadu_si256((const __m256i*)(pixels + i));
+
+		const __m256i lo = PremultiplyHalf256(_mm256_unpacklo_epi8(px, zero));
+		const __m256i hi = PremultiplyHalf256(_mm256_unpackhi_epi8(px, zero));
+
+		__m256i result = _mm256_blendv_epi8(_mm256_packus_epi16(lo, hi), px, alphaMask);
+		result = _mm256_xor_si256(result, invertMask);
+		if (swapRB) {
+			result = _mm256_shuffle_epi8(result, SwapRBShuffle256());
+		}
+
+		_mm256_storeu_si256((__m256i*)(pixels + i), result);
+	}
+
+	PremultiplyAlphaScalar(pixels + i, count - i, swapRB, invertAlpha);
+}
+
+static void SwapRBAVX2(uint32_t* pixels, size_t count) noexcept {
+	const __m256i shuffle = SwapRBShuffle256();
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m256i px = _mm256_loadu_si256((const __m256i*)(pixels + i));
+		_mm256_storeu_si256((__m256i*)(pixels + i), _mm256_shuffle_epi8(px, shuffle));
+	}
+
+	SwapRBScalar(pixels + i, count - i);
+}
+
+static void CopyMaskToChannelAVX2(uint32_t* pixels, const uint32_t* mask, size_t count, uint32_t channel) noexcept {
+	const __m128i shift = _mm_cvtsi32_si128(channel * 8);
+	const __m256i channelMask = _mm256_sll_epi32(_mm256_set1_epi32(0xFF), shift);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m256i px = _mm256_loadu_si256((const __m256i*)(pixels + i));
+		const __m256i m = _mm256_loadu_si256((const __m256i*)(mask + i));
+		const __m256i result = _mm256_or_si256(_mm256_andnot_si256(channelMask, px), _mm256_and_si256(_mm256_sll_epi32(m, shift), channelMask));
+		_mm256_storeu_si256((__m256i*)(pixels + i), result);
+	}
+
+	CopyMaskToChannelScalar(pixels + i, mask + i, count - i, channel);
+}
+
+static void FillAlphaAVX2(uint32_t* pixels, size_t count) noexcept {
+	const __m256i alphaMask = _mm256_set1_epi32(0xFF000000);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m256i px = _mm256_loadu_si256((const __m256i*)(pixels + i));
+		_mm256_storeu_si256((__m256i*)(pixels + i), _mm256_or_si256(px, alphaMask));
+	}
+
+	FillAlphaScalar(pixels + i, count - i);
+}
+
+#endif
+
+bool PixelUtils::HasAlpha(const uint32_t* pixels, size_t count) noexcept {
+#ifdef _M_X64
+	switch (GetSimdLevel()) {
+	case SimdLevel::AVX2:
+		return HasAlphaAVX2(pixels, count);
+	case SimdLevel::SSE41:
+		return HasAlphaSSE41(pixels, count);
+	}
+#endif
+	return HasAlphaScalar(pixels, count);
+}
+
+void PixelUtils::PremultiplyAlpha(uint32_t* pixels, size_t count, bool swapRB, bool invertAlpha) noexcept {
+#ifdef _M_X64
+	switch (GetSimdLevel()) {
+	case SimdLevel::AVX2:
+		PremultiplyAlphaAVX2(pixels, count, swapRB, invertAlpha);
+		return;
+	case SimdLevel::SSE41:
+		PremultiplyAlphaSSE41(pixels, count, swapRB, invertAlpha);
+		return;
+	}
+#endif
+	PremultiplyAlphaScalar(pixels, count, swapRB, invertAlpha);
+}
+
+void PixelUtils::SwapRB(uint32_t* pixels, size_t count) noexcept {
+#ifdef _M_X64
+	switch (GetSimdLevel()) {
+	case SimdLevel::AVX2:
+		SwapRBAVX2(pixels, count);
+		return;
+	case SimdLevel::SSE41:
+		SwapRBSSE41(pixels, count);
+		return;
+	}
+#endif
+	SwapRBScalar(pixels, count);
+}
+
+void PixelUtils::CopyMaskToChannel(uint32_t* pixels, const uint32_t* mask, size_t count, uint32_t channel) noexcept {
+	assert(channel < 4);
+
+#ifdef _M_X64
+	switch (GetSimdLevel()) {
+	case SimdLevel::AVX2:
+		CopyMaskToChannelAVX2(pixels, mask, count, channel);
+		return;
+	case SimdLevel::SSE41:
+		CopyMaskToChannelSSE41(pixels, mask, count, channel);
+		return;
+	}
+#endif
+	CopyMaskToChannelScalar(pixels, mask, count, channel);
+}
+
+void PixelUtils::FillAlpha(uint32_t* pixels, size_t count) noexcept {
+#ifdef _M_X64
+	switch (GetSimdLevel()) {
+	case SimdLevel::AVX2:
+		FillAlphaAVX2(pixels, count);
+		return;
+	case SimdLevel::SSE41:
+		FillAlphaSSE41(pixels, count);
+		return;
+	}
+#endif
+	FillAlphaScalar(pixels, count);
+}
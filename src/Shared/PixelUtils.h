@@ -0,0 +1,20 @@
+#pragma once
+
+// 32 位像素的转换，像素在内存中依次为 B、G、R、A 四个字节。x64 上根据 CPU 支持的指令集
+// 选择 AVX2 或 SSE4.1 实现，否则使用标量实现，各实现的结果完全相同
+struct PixelUtils {
+	// 是否有像素的 A 通道不为 0
+	static bool HasAlpha(const uint32_t* pixels, size_t count) noexcept;
+
+	// RGB 通道预乘 A 通道，结果和 lroundf(c * (a / 255.0f)) 相同。
+	// swapRB 为 true 时交换 R 和 B 通道，invertAlpha 为 true 时 A 通道取反
+	static void PremultiplyAlpha(uint32_t* pixels, size_t count, bool swapRB = false, bool invertAlpha = false) noexcept;
+
+	static void SwapRB(uint32_t* pixels, size_t count) noexcept;
+
+	// 将 mask 中每个像素的第一个字节写入 pixels 中对应像素的第 channel 个字节
+	static void CopyMaskToChannel(uint32_t* pixels, const uint32_t* mask, size_t count, uint32_t channel) noexcept;
+
+	// A 通道置为 255
+	static void FillAlpha(uint32_t* pixels, size_t count) noexcept;
+};
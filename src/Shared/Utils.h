@@ -13,6 +13,13 @@ struct Utils {
 		return int(dura.count());
 	}
 
+	// 高精度计时器的当前值，频率由 QueryPerformanceFrequency 获得
+	static int64_t GetQPC() noexcept {
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+		return counter.QuadPart;
+	}
+
 	template<typename T>
 	class ScopeExit {
 	public: